@@ -0,0 +1,722 @@
+/*
+ *
+ * pnpBenchmark.c - the board throughput benchmark. Each board is run in its own scratch directory: the
+ * headless simulator is started in fast mode, then the controller is started on the board's centroid
+ * file with its output captured. When the controller reports that every part has been placed it is sent
+ * q, and the controller's CPU time and the simulator's session totals are collected. The results are
+ * printed as a table and written as JSON so that runs on different commits can be compared.
+ *
+ * Usage: pnpBenchmark [-c controller] [-s simulator] [-d board directory] [-o results file] [-l label]
+ *                     [-t timeout s] [-T trace directory] [-m machines] [-n] [-k] [extra centroid files...]
+ * -n skips the synthetic 1000 and 10000 part boards, -k keeps the scratch directories, -T has the
+ * controller write a <board>.trace.json Chrome trace of each board to the trace directory, -m places
+ * each board with a line of machines, one simulator each, the cycle time being that of the slowest
+ *
+ * Platform: Any POSIX compliant platform
+ * Intended for and tested on: Cygwin 64 bit
+ *
+ */
+
+#include <dirent.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "pnpBenchmark.h"
+#include "pnpLine.h"
+#include "pnpTrace.h"
+#include "pnpLog.h"
+
+static const char *BUNDLED_BOARDS[] = {"centroid_small_auto.txt", "centroid_medium_auto.txt", "centroid_large_auto.txt"};
+static const int SYNTHETIC_BOARDS[] = {1000, 10000};
+
+static int timeout_s = BENCHMARK_TIMEOUT_S;
+
+/*
+ Function: secondsSince
+ ----------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: gets the wall clock time elapsed since a previously recorded time
+ Argument(s):
+ const struct timespec *then - the earlier time, from CLOCK_MONOTONIC
+ Return Value: the elapsed time in s
+ Usage: double wall_time = secondsSince(&started);
+ */
+static double secondsSince(const struct timespec *then)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - then -> tv_sec) + (now.tv_nsec - then -> tv_nsec) / 1e9;
+}
+
+/*
+ Function: writeSyntheticBoard
+ -----------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ writes an autonomous mode centroid file of parts at random reachable PCB positions and rotations, fed
+ from random tape feeders. The same seed always gives the same board
+ Argument(s):
+ const char *path - the centroid file to write
+ int parts - the number of parts
+ unsigned long long seed - the random seed
+ Return Value:
+ TRUE (1) on success, FALSE (0) if the file could not be written
+ Usage: writeSyntheticBoard("synthetic_1000.txt", 1000, BENCHMARK_SYNTHETIC_SEED);
+ */
+int writeSyntheticBoard(const char *path, int parts, unsigned long long seed)
+{
+    unsigned long long state = seed * 0x9E3779B97F4A7C15ULL + 1;
+    double u[5];
+
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) return FALSE;
+
+    fprintf(fp, "a\n%d\n", parts);
+    for (int k = 0; k < parts; k++)
+    {
+        for (int n = 0; n < 5; n++)
+        {
+            state ^= state >> 12;
+            state ^= state << 25;
+            state ^= state >> 27;
+            u[n] = (state * 2685821657736338717ULL >> 11) / 9007199254740992.0;
+        }
+        fprintf(fp, "R%d 0603 %.1f %.2f %.2f %.2f %d\n", k + 1, 1.0 + 99.0 * u[0], 50.0 + 900.0 * u[1], 50.0 + 900.0 * u[2], 360.0 * u[3] - 180.0, (int)(u[4] * NUMBER_OF_FEEDERS));
+    }
+    return fclose(fp) == 0;
+}
+
+/*
+ Function: copyFile
+ ------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: copies a file
+ Argument(s):
+ const char *from - the file to copy
+ const char *to - the copy to create or overwrite
+ Return Value:
+ TRUE (1) on success, otherwise FALSE (0)
+ Usage: if (!copyFile(board, "centroid.txt")) ...
+ */
+static int copyFile(const char *from, const char *to)
+{
+    char buffer[65536];
+    size_t length;
+    int copied = TRUE;
+
+    FILE *in = fopen(from, "rb");
+    if (in == NULL) return FALSE;
+    FILE *out = fopen(to, "wb");
+    if (out == NULL)
+    {
+        fclose(in);
+        return FALSE;
+    }
+    while ((length = fread(buffer, 1, sizeof(buffer), in)) > 0)
+    {
+        if (fwrite(buffer, 1, length, out) != length) copied = FALSE;
+    }
+    fclose(in);
+    return (fclose(out) == 0) && copied;
+}
+
+/*
+ Function: spawn
+ ---------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: starts a program in a directory with its standard input and output redirected
+ Argument(s):
+ const char *directory - the working directory of the program
+ char *const arguments[] - the program path followed by its arguments, NULL terminated
+ int input - the file descriptor to use as standard input, or -1 for /dev/null
+ int output - the file descriptor to use as standard output and standard error
+ Return Value:
+ the process id, or -1 if the process could not be created
+ Usage: pid_t pid = spawn(directory, arguments, -1, log);
+ */
+static pid_t spawn(const char *directory, char *const arguments[], int input, int output)
+{
+    pid_t pid = fork();
+
+    if (pid != 0) return pid;
+
+    if (input < 0) input = open("/dev/null", O_RDONLY);
+    if (chdir(directory) != 0 || input < 0) _exit(127);
+    dup2(input, STDIN_FILENO);
+    dup2(output, STDOUT_FILENO);
+    dup2(output, STDERR_FILENO);
+    for (int fd = STDERR_FILENO + 1; fd < 256; fd++) close(fd);
+    execv(arguments[0], arguments);
+    _exit(127);
+}
+
+/*
+ Function: waitForExit
+ ---------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: waits for a child process to exit, killing it if it takes too long
+ Argument(s):
+ pid_t pid - the child process
+ long timeout_ms - how long to wait before killing it
+ struct rusage *usage - set to the resources used by the child, may be NULL
+ Return Value:
+ TRUE (1) if the child exited by itself with status 0, otherwise FALSE (0)
+ Usage: if (!waitForExit(controller, BENCHMARK_EXIT_TIMEOUT_MS, &usage)) ...
+ */
+static int waitForExit(pid_t pid, long timeout_ms, struct rusage *usage)
+{
+    struct rusage ignored;
+    int status = 0;
+
+    if (usage == NULL) usage = &ignored;
+    for (long waited = 0; waited < timeout_ms; waited += 10)
+    {
+        pid_t res = wait4(pid, &status, WNOHANG, usage);
+        if (res == pid) return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        if (res < 0) return FALSE;
+        poll(NULL, 0, 10);
+    }
+    kill(pid, SIGKILL);
+    wait4(pid, &status, 0, usage);
+    return FALSE;
+}
+
+/*
+ Function: waitForLogMarker
+ --------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: waits for a line containing a marker to appear in a log file being written by another process
+ Argument(s):
+ const char *path - the log file
+ const char *marker - the text to look for
+ long timeout_ms - how long to wait
+ Return Value:
+ TRUE (1) if the marker appeared, otherwise FALSE (0)
+ Usage: if (!waitForLogMarker("simulator.log", BENCHMARK_SIMULATOR_READY_MARKER, BENCHMARK_STARTUP_TIMEOUT_MS)) ...
+ */
+static int waitForLogMarker(const char *path, const char *marker, long timeout_ms)
+{
+    char line[512];
+
+    for (long waited = 0; waited < timeout_ms; waited += 10)
+    {
+        FILE *fp = fopen(path, "r");
+        if (fp != NULL)
+        {
+            int found = FALSE;
+            while (!found && fgets(line, sizeof(line), fp) != NULL) found = (strstr(line, marker) != NULL);
+            fclose(fp);
+            if (found) return TRUE;
+        }
+        poll(NULL, 0, 10);
+    }
+    return FALSE;
+}
+
+/*
+ Function: readSimulatorSummary
+ ------------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: reads the session totals the simulator prints when the controller quits
+ Argument(s):
+ const char *path - the simulator log
+ BenchmarkResult *result - the result to fill in
+ Return Value:
+ TRUE (1) if the totals were found, otherwise FALSE (0)
+ Usage: if (!readSimulatorSummary("simulator.log", result)) ...
+ */
+static int readSimulatorSummary(const char *path, BenchmarkResult *result)
+{
+    char line[512];
+    int found = FALSE;
+
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) return FALSE;
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        if (sscanf(line, "Time: %lf  Session finished, %d parts placed, %d dropped, %d bad instructions, %lu instructions, gantry travel %lf mm",
+                   &result -> sim_cycle_time, &result -> parts_placed, &result -> parts_dropped, &result -> bad_instructions,
+                   &result -> instructions, &result -> gantry_travel) == 6) found = TRUE;
+    }
+    fclose(fp);
+    return found;
+}
+
+/*
+ Function: countParts
+ --------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: gets the number of parts declared in a text centroid file
+ Argument(s):
+ const char *path - the centroid file
+ Return Value: the number of parts, or 0 if it could not be read
+ Usage: result -> parts = countParts(board);
+ */
+static int countParts(const char *path)
+{
+    char mode[8];
+    int parts = 0;
+
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) return 0;
+    if (fscanf(fp, "%7s %d", mode, &parts) != 2) parts = 0;
+    fclose(fp);
+    return parts;
+}
+
+/*
+ Function: watchController
+ -------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ copies the controller's output to its log until it reports that every part has been placed, reports a
+ problem, exits, or the timeout expires. The markers are searched for across read boundaries
+ Argument(s):
+ int output - the read end of the controller's output pipe
+ int log - the controller log file
+ const struct timespec *started - when the controller was started
+ char *failure - set to the reason if the controller did not complete, must hold 96 characters
+ Return Value:
+ TRUE (1) if the controller completed the board, otherwise FALSE (0)
+ Usage: if (watchController(output[0], log, &started, result -> failure)) ...
+ */
+static int watchController(int output, int log, const struct timespec *started, char *failure)
+{
+    char buffer[65536 + 64];
+    size_t carried = 0;
+    struct pollfd readable = {output, POLLIN, 0};
+
+    for (;;)
+    {
+        if (secondsSince(started) > timeout_s)
+        {
+            snprintf(failure, 96, "timed out after %d s", timeout_s);
+            return FALSE;
+        }
+        if (poll(&readable, 1, 100) <= 0) continue;
+
+        ssize_t length = read(output, buffer + carried, sizeof(buffer) - carried - 1);
+        if (length <= 0)
+        {
+            snprintf(failure, 96, "controller exited before completing the board");
+            return FALSE;
+        }
+        if (write(log, buffer + carried, length) != length) {}
+        buffer[carried + length] = '\0';
+
+        if (strstr(buffer, BENCHMARK_COMPLETED_MARKER) != NULL) return TRUE;
+        char *problem = strstr(buffer, BENCHMARK_PROBLEM_MARKER);
+        if (problem != NULL)
+        {
+            snprintf(failure, 96, "%.95s", problem);
+            char *end = strchr(failure, '\n');
+            if (end != NULL) *end = '\0';
+            return FALSE;
+        }
+
+        /* keep the tail in case a marker straddles this read and the next */
+        carried = carried + length;
+        if (carried > 63)
+        {
+            memmove(buffer, buffer + carried - 63, 63);
+            carried = 63;
+        }
+    }
+}
+
+/*
+ Function: machineFiles
+ ----------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ gets the files of one machine of a line in a scratch directory, named as the controller's
+ lineSessionFiles() names them, machine 0 using the files of the original single machine
+ Argument(s):
+ const char *directory - the scratch directory
+ int machine - the machine, from 0
+ char *shared_file - set to the shared file name, relative to the directory, must hold PNP_PATH_LENGTH characters
+ char *notify_fifo - set to the FIFO name, likewise
+ char *log - set to the path of the simulator's log, must hold PATH_MAX characters
+ Return Value:
+ TRUE (1) if every name fits, FALSE (0) if one would be truncated and is not to be used
+ Usage: if (machineFiles(directory, k, shared_file, notify_fifo, path)) ... use the files ...
+ */
+static int machineFiles(const char *directory, int machine, char *shared_file, char *notify_fifo, char *log)
+{
+    if (machine == 0)
+    {
+        return snprintf(shared_file, PNP_PATH_LENGTH, "%s", MEMORY_MAPPED_FILE) < PNP_PATH_LENGTH &&
+               snprintf(notify_fifo, PNP_PATH_LENGTH, "%s", PNP_NOTIFY_FIFO) < PNP_PATH_LENGTH &&
+               snprintf(log, PATH_MAX, "%s/simulator.log", directory) < PATH_MAX;
+    }
+    return snprintf(shared_file, PNP_PATH_LENGTH, LINE_SHARED_FILE_FORMAT, machine) < PNP_PATH_LENGTH &&
+           snprintf(notify_fifo, PNP_PATH_LENGTH, LINE_NOTIFY_FIFO_FORMAT, machine) < PNP_PATH_LENGTH &&
+           snprintf(log, PATH_MAX, "%s/simulator.%d.log", directory, machine) < PATH_MAX;
+}
+
+/*
+ Function: runBoard
+ ------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ runs the controller in autonomous mode on one board against fast mode simulators in a scratch directory,
+ one simulator for each machine of the line. The simulators' totals are added up, apart from the cycle
+ time which is that of the slowest machine
+ Argument(s):
+ const char *controller - absolute path of the controller
+ const char *simulator - absolute path of the simulator
+ const char *board - the centroid file of the board
+ const char *name - the name of the board in the results
+ const char *directory - an empty scratch directory to run in
+ int machines - the number of machines, 1 for the original single machine
+ BenchmarkResult *result - filled with the measurements
+ Return Value:
+ TRUE (1) if the board completed, otherwise FALSE (0) with result -> failure set
+ Usage: runBoard(controller, simulator, "centroid_large_auto.txt", "centroid_large_auto.txt", directory, 1, &result);
+ */
+int runBoard(const char *controller, const char *simulator, const char *board, const char *name, const char *directory, int machines, BenchmarkResult *result)
+{
+    char path[PATH_MAX], shared_file[PNP_PATH_LENGTH], notify_fifo[PNP_PATH_LENGTH], machines_argument[16];
+    char *simulator_arguments[] = {(char *)simulator, "-f", "-q", "-m", shared_file, NULL};
+    char *controller_arguments[] = {(char *)controller, "-m", machines_argument, NULL};
+    int input[2], output[2], summaries = 0;
+    struct timespec started;
+    struct rusage usage;
+    pid_t simulator_pid[PNP_MAX_SESSIONS], controller_pid;
+
+    memset(result, 0, sizeof(BenchmarkResult));
+    snprintf(result -> board, sizeof(result -> board), "%s", name);
+    result -> parts = countParts(board);
+
+    snprintf(path, sizeof(path), "%s/%s", directory, CENTROID_FILE);
+    if (!copyFile(board, path))
+    {
+        snprintf(result -> failure, sizeof(result -> failure), "could not copy the centroid file");
+        return FALSE;
+    }
+
+    /* start the simulators first and let them map their shared files, so that they are ready to acknowledge the controller */
+    snprintf(machines_argument, sizeof(machines_argument), "%d", machines);
+    for (int k = 0; k < machines; k++)
+    {
+        simulator_pid[k] = -1;
+        if (machineFiles(directory, k, shared_file, notify_fifo, path))
+        {
+            int simulator_log = open(path, O_CREAT | O_WRONLY | O_TRUNC, 0666);
+            simulator_pid[k] = spawn(directory, simulator_arguments, -1, simulator_log);
+            close(simulator_log);
+        }
+        if (simulator_pid[k] < 0 || !waitForLogMarker(path, BENCHMARK_SIMULATOR_READY_MARKER, BENCHMARK_STARTUP_TIMEOUT_MS))
+        {
+            snprintf(result -> failure, sizeof(result -> failure), "simulator %d did not start", k);
+            for (int started_k = 0; started_k <= k; started_k++)
+            {
+                if (simulator_pid[started_k] > 0) waitForExit(simulator_pid[started_k], 0, NULL);
+            }
+            return FALSE;
+        }
+    }
+
+    snprintf(path, sizeof(path), "%s/controller.log", directory);
+    int controller_log = open(path, O_CREAT | O_WRONLY | O_TRUNC, 0666);
+    if (pipe(input) != 0 || pipe(output) != 0)
+    {
+        snprintf(result -> failure, sizeof(result -> failure), "could not create pipes");
+        close(controller_log);
+        for (int k = 0; k < machines; k++) waitForExit(simulator_pid[k], 0, NULL);
+        return FALSE;
+    }
+
+    /* a single machine is run exactly as the controller always has been, without -m */
+    if (machines == 1) controller_arguments[1] = NULL;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    controller_pid = spawn(directory, controller_arguments, input[0], output[1]);
+    close(input[0]);
+    close(output[1]);
+
+    result -> completed = (controller_pid > 0) && watchController(output[0], controller_log, &started, result -> failure);
+    result -> wall_time = secondsSince(&started);
+
+    /* quit, then drain the rest of the output so the controller never blocks writing it */
+    if (write(input[1], "q", 1) != 1) {}
+    close(input[1]);
+    if (controller_pid > 0)
+    {
+        char buffer[4096];
+        struct pollfd readable = {output[0], POLLIN, 0};
+        ssize_t length = 1;
+
+        for (long waited = 0; length > 0 && waited < BENCHMARK_EXIT_TIMEOUT_MS; waited += 10)
+        {
+            if (poll(&readable, 1, 10) > 0 && (length = read(output[0], buffer, sizeof(buffer))) > 0) length = write(controller_log, buffer, length);
+        }
+        if (!waitForExit(controller_pid, result -> completed ? BENCHMARK_EXIT_TIMEOUT_MS : 0, &usage) && result -> completed)
+        {
+            snprintf(result -> failure, sizeof(result -> failure), "controller did not quit cleanly");
+            result -> completed = FALSE;
+        }
+        result -> controller_cpu_time = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+    }
+    close(output[0]);
+    close(controller_log);
+
+    for (int k = 0; k < machines; k++)
+    {
+        BenchmarkResult machine;
+
+        waitForExit(simulator_pid[k], BENCHMARK_EXIT_TIMEOUT_MS, NULL);
+        if (!machineFiles(directory, k, shared_file, notify_fifo, path) || !readSimulatorSummary(path, &machine)) continue;
+
+        summaries++;
+        if (machine.sim_cycle_time > result -> sim_cycle_time) result -> sim_cycle_time = machine.sim_cycle_time;
+        result -> instructions += machine.instructions;
+        result -> gantry_travel += machine.gantry_travel;
+        result -> parts_placed += machine.parts_placed;
+        result -> parts_dropped += machine.parts_dropped;
+        result -> bad_instructions += machine.bad_instructions;
+    }
+    if (summaries < machines && result -> completed)
+    {
+        snprintf(result -> failure, sizeof(result -> failure), "simulator did not report its session totals");
+        result -> completed = FALSE;
+    }
+    if (result -> completed && result -> parts_placed != result -> parts)
+    {
+        snprintf(result -> failure, sizeof(result -> failure), "%d of %d parts placed", result -> parts_placed, result -> parts);
+        result -> completed = FALSE;
+    }
+    return result -> completed;
+}
+
+/*
+ Function: writeJsonString
+ -------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: writes a quoted JSON string, escaping quotes, backslashes and control characters
+ Argument(s):
+ FILE *fp - the file
+ const char *text - the string
+ Return Value: none
+ Usage: writeJsonString(fp, result -> board);
+ */
+static void writeJsonString(FILE *fp, const char *text)
+{
+    fputc('"', fp);
+    for (; *text != '\0'; text++)
+    {
+        if (*text == '"' || *text == '\\') fprintf(fp, "\\%c", *text);
+        else if ((unsigned char)*text < 0x20) fprintf(fp, "\\u%04x", *text);
+        else fputc(*text, fp);
+    }
+    fputc('"', fp);
+}
+
+/*
+ Function: writeBenchmarkResults
+ -------------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: writes the results of a benchmark run as JSON, one object per board
+ Argument(s):
+ const char *path - the results file
+ const char *label - identifies the run, for example a commit id
+ const BenchmarkResult results[] - the results
+ int number_of_results - the number of boards
+ Return Value:
+ TRUE (1) on success, FALSE (0) if the file could not be written
+ Usage: writeBenchmarkResults(BENCHMARK_RESULTS_FILE, label, results, number_of_results);
+ */
+int writeBenchmarkResults(const char *path, const char *label, const BenchmarkResult results[], int number_of_results)
+{
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) return FALSE;
+
+    fprintf(fp, "{\n  \"label\": ");
+    writeJsonString(fp, label);
+    fprintf(fp, ",\n  \"results\": [\n");
+    for (int k = 0; k < number_of_results; k++)
+    {
+        const BenchmarkResult *r = &results[k];
+
+        fprintf(fp, "    {\"board\": ");
+        writeJsonString(fp, r -> board);
+        fprintf(fp, ", \"parts\": %d, \"completed\": %s, \"failure\": ", r -> parts, r -> completed ? "true" : "false");
+        writeJsonString(fp, r -> failure);
+        fprintf(fp, ", \"sim_cycle_time_s\": %.3f, \"wall_time_s\": %.3f, \"controller_cpu_time_s\": %.3f, \"instructions\": %lu, \"gantry_travel_mm\": %.1f, \"parts_placed\": %d, \"parts_dropped\": %d, \"bad_instructions\": %d}%s\n",
+                r -> sim_cycle_time, r -> wall_time, r -> controller_cpu_time, r -> instructions, r -> gantry_travel, r -> parts_placed, r -> parts_dropped, r -> bad_instructions, (k + 1 < number_of_results) ? "," : "");
+    }
+    fprintf(fp, "  ]\n}\n");
+    return fclose(fp) == 0;
+}
+
+/*
+ Function: removeScratchDirectory
+ --------------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ deletes the files the benchmark creates in a scratch directory and then the directory itself. A file
+ whose path does not fit in PATH_MAX is left alone rather than removing a truncated path
+ Argument(s):
+ const char *directory - the scratch directory
+ int machines - the number of machines the board was run with
+ Return Value: none
+ Usage: removeScratchDirectory(directory, machines);
+ */
+static void removeScratchDirectory(const char *directory, int machines)
+{
+    static const char *FILES[] = {CENTROID_FILE, CENTROID_BINARY_FILE, "controller.log"};
+    char path[PATH_MAX], shared_file[PNP_PATH_LENGTH], notify_fifo[PNP_PATH_LENGTH];
+    DIR *scratch = opendir(directory);
+    struct dirent *entry;
+
+    for (size_t k = 0; k < sizeof(FILES) / sizeof(FILES[0]); k++)
+    {
+        if (snprintf(path, sizeof(path), "%s/%s", directory, FILES[k]) < (int)sizeof(path)) remove(path);
+    }
+    /* the controller names its program cache after the board */
+    while (scratch != NULL && (entry = readdir(scratch)) != NULL)
+    {
+        if (strncmp(entry -> d_name, PROGRAM_CACHE_PREFIX, strlen(PROGRAM_CACHE_PREFIX)) != 0) continue;
+        if (snprintf(path, sizeof(path), "%s/%s", directory, entry -> d_name) < (int)sizeof(path)) remove(path);
+    }
+    if (scratch != NULL) closedir(scratch);
+    for (int k = 0; k < machines; k++)
+    {
+        if (!machineFiles(directory, k, shared_file, notify_fifo, path)) continue;
+        remove(path);
+        if (snprintf(path, sizeof(path), "%s/%s", directory, shared_file) < (int)sizeof(path)) remove(path);
+        if (snprintf(path, sizeof(path), "%s/%s", directory, notify_fifo) < (int)sizeof(path)) remove(path);
+    }
+    rmdir(directory);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *controller = BENCHMARK_CONTROLLER, *simulator = BENCHMARK_SIMULATOR, *board_directory = ".";
+    const char *results_file = BENCHMARK_RESULTS_FILE, *label = "", *trace_directory = NULL;
+    char controller_path[PATH_MAX], simulator_path[PATH_MAX], base[] = "/tmp/pnpBenchmark.XXXXXX";
+    char boards[BENCHMARK_MAX_BOARDS][PATH_MAX], names[BENCHMARK_MAX_BOARDS][64], directory[PATH_MAX];
+    char trace_path[PATH_MAX], trace_file[PATH_MAX + 80];
+    BenchmarkResult results[BENCHMARK_MAX_BOARDS];
+    int synthetic = TRUE, keep = FALSE, machines = 1, number_of_boards = 0, failures = 0, option;
+
+    while ((option = getopt(argc, argv, "c:s:d:o:l:t:T:m:nkh")) != -1)
+    {
+        switch (option)
+        {
+            case 'c': controller = optarg; break;
+            case 's': simulator = optarg; break;
+            case 'd': board_directory = optarg; break;
+            case 'o': results_file = optarg; break;
+            case 'l': label = optarg; break;
+            case 't': timeout_s = atoi(optarg); break;
+            case 'T': trace_directory = optarg; break;
+            case 'n': synthetic = FALSE; break;
+            case 'k': keep = TRUE; break;
+            case 'm':
+                machines = atoi(optarg);
+                if (machines >= 1 && machines <= PNP_MAX_SESSIONS) break;
+                /* fall through */
+            default:
+                printf("Usage: %s [-c controller] [-s simulator] [-d board directory] [-o results file] [-l label] [-t timeout s] [-T trace directory] [-m machines] [-n] [-k] [extra centroid files...]\n", argv[0]);
+                exit(option == 'h' ? 0 : 1);
+        }
+    }
+
+    if (realpath(controller, controller_path) == NULL || access(controller_path, X_OK) != 0)
+    {
+        printf("Controller %s not found, build it or pass -c\n", controller);
+        exit(1);
+    }
+    if (realpath(simulator, simulator_path) == NULL || access(simulator_path, X_OK) != 0)
+    {
+        printf("Simulator %s not found, build it or pass -s\n", simulator);
+        exit(1);
+    }
+    if (trace_directory != NULL && realpath(trace_directory, trace_path) == NULL)
+    {
+        printf("Trace directory %s not found\n", trace_directory);
+        exit(1);
+    }
+    /* the completion message is looked for on the controller's output, so it must not log to a file */
+    unsetenv(LOG_FILE_ENVIRONMENT_VARIABLE);
+    if (mkdtemp(base) == NULL)
+    {
+        perror("creation of scratch directory failed");
+        exit(1);
+    }
+
+    for (size_t k = 0; k < sizeof(BUNDLED_BOARDS) / sizeof(BUNDLED_BOARDS[0]); k++)
+    {
+        snprintf(boards[number_of_boards], PATH_MAX, "%s/%s", board_directory, BUNDLED_BOARDS[k]);
+        if (access(boards[number_of_boards], R_OK) != 0)
+        {
+            printf("Skipping %s, not found in %s\n", BUNDLED_BOARDS[k], board_directory);
+            continue;
+        }
+        snprintf(names[number_of_boards++], 64, "%s", BUNDLED_BOARDS[k]);
+    }
+    for (size_t k = 0; synthetic && k < sizeof(SYNTHETIC_BOARDS) / sizeof(SYNTHETIC_BOARDS[0]); k++)
+    {
+        snprintf(names[number_of_boards], 64, "synthetic_%d", SYNTHETIC_BOARDS[k]);
+        snprintf(boards[number_of_boards], PATH_MAX, "%s/%s.txt", base, names[number_of_boards]);
+        if (writeSyntheticBoard(boards[number_of_boards], SYNTHETIC_BOARDS[k], BENCHMARK_SYNTHETIC_SEED)) number_of_boards++;
+    }
+    for (int k = optind; k < argc && number_of_boards < BENCHMARK_MAX_BOARDS; k++)
+    {
+        const char *name = strrchr(argv[k], '/');
+        snprintf(boards[number_of_boards], PATH_MAX, "%s", argv[k]);
+        snprintf(names[number_of_boards++], 64, "%s", (name != NULL) ? name + 1 : argv[k]);
+    }
+
+    printf("%-26s %7s %12s %10s %10s %12s %14s  %s\n", "board", "parts", "sim cycle s", "wall s", "ctl cpu s", "instructions", "gantry mm", "status");
+    for (int k = 0; k < number_of_boards; k++)
+    {
+        snprintf(directory, sizeof(directory), "%s/%d", base, k);
+        mkdir(directory, 0777);
+
+        /* the controller is started in the scratch directory, so it is given an absolute path to trace to */
+        if (trace_directory != NULL)
+        {
+            snprintf(trace_file, sizeof(trace_file), "%s/%s.trace.json", trace_path, names[k]);
+            setenv(TRACE_ENVIRONMENT_VARIABLE, trace_file, 1);
+        }
+
+        runBoard(controller_path, simulator_path, boards[k], names[k], directory, machines, &results[k]);
+        if (!results[k].completed) failures++;
+
+        printf("%-26s %7d %12.2f %10.2f %10.2f %12lu %14.0f  %s\n", results[k].board, results[k].parts, results[k].sim_cycle_time, results[k].wall_time,
+               results[k].controller_cpu_time, results[k].instructions, results[k].gantry_travel, results[k].completed ? "ok" : results[k].failure);
+        fflush(stdout);
+
+        if (!keep) removeScratchDirectory(directory, machines);
+    }
+
+    for (size_t k = 0; synthetic && k < sizeof(SYNTHETIC_BOARDS) / sizeof(SYNTHETIC_BOARDS[0]); k++)
+    {
+        if (!keep) remove(boards[sizeof(BUNDLED_BOARDS) / sizeof(BUNDLED_BOARDS[0]) + k]);
+    }
+    if (keep) printf("Scratch directories kept in %s\n", base);
+    else rmdir(base);
+
+    if (!writeBenchmarkResults(results_file, label, results, number_of_boards)) printf("Could not write %s\n", results_file);
+    else printf("Results written to %s\n", results_file);
+
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,52 @@
+/*
+ *
+ * pnpBenchmark.h - declarations for the board throughput benchmark, which runs the controller in
+ * autonomous mode against the headless simulator for each board and records how long it took
+ *
+ * Platform: Any POSIX compliant platform
+ * Intended for and tested on: Cygwin 64 bit
+ *
+ */
+
+#ifndef PNP_BENCHMARK_H
+#define PNP_BENCHMARK_H
+
+#include "pnpCentroid.h"
+
+#define BENCHMARK_CONTROLLER "Assgn1_2021_Controller"     // default controller, looked for in the current working directory
+#define BENCHMARK_SIMULATOR "pnpSimulator"                 // default simulator, looked for in the current working directory
+#define BENCHMARK_RESULTS_FILE "benchmark_results.json"
+#define BENCHMARK_TIMEOUT_S 900                           // a board that has not completed in this many wall clock seconds fails
+#define BENCHMARK_STARTUP_TIMEOUT_MS 5000                 // how long to wait for the simulator to map the shared file
+#define BENCHMARK_EXIT_TIMEOUT_MS 5000                    // how long the controller and simulator get to exit after q before they are killed
+#define BENCHMARK_SYNTHETIC_SEED 2021                     // synthetic boards are the same every run
+#define BENCHMARK_MAX_BOARDS 32
+
+#define BENCHMARK_COMPLETED_MARKER "All components placed"
+#define BENCHMARK_PROBLEM_MARKER "Problem "
+#define BENCHMARK_SIMULATOR_READY_MARKER "waiting for the controller"
+
+typedef struct
+{
+    char board[64];                         // centroid file name, or synthetic_<n> for a generated board
+    int parts;                              // parts in the centroid file
+    int completed;                          // TRUE if every part was placed and the controller quit cleanly
+    char failure[96];                       // why the board failed, empty if completed
+    double sim_cycle_time;                  // s of simulation time from the first instruction until the head is home, on the slowest machine of a line
+    double wall_time;                       // s of wall clock time from starting the controller until it reported completion
+    double controller_cpu_time;             // s of user plus system CPU time used by the controller
+    unsigned long instructions;             // instructions executed by the simulator
+    double gantry_travel;                   // mm travelled by the gantry, including position amendments
+    int parts_placed;
+    int parts_dropped;
+    int bad_instructions;
+
+} BenchmarkResult;
+
+int writeSyntheticBoard(const char*, int, unsigned long long);
+
+int runBoard(const char*, const char*, const char*, const char*, const char*, int, BenchmarkResult*);
+
+int writeBenchmarkResults(const char*, const char*, const BenchmarkResult[], int);
+
+#endif // PNP_BENCHMARK_H
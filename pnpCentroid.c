@@ -0,0 +1,1027 @@
+/*
+ *
+ * pnpCentroid.c - the centroid file reader. Text files are streamed in fixed size chunks and split into
+ * whitespace separated fields by hand, numbers are converted with strtod/strtol, and the placement info
+ * is stored in a growable array allocated from an arena so that the whole board is freed in one go.
+ * Binary centroid files are memory mapped and used in place, their validation is cached beside them
+ *
+ * Platform: Any POSIX compliant platform
+ * Intended for and tested on: Cygwin 64 bit
+ *
+ */
+
+#include "pnpCentroid.h"
+
+typedef struct
+{
+    FILE *fp;
+    char buffer[CENTROID_READ_CHUNK];
+    size_t length;                          // bytes of the current chunk held in buffer
+    size_t position;                        // next byte of buffer to examine
+    int line;
+    int column;
+
+} CentroidReader;
+
+typedef struct
+{
+    const CentroidBinaryHeader *header;
+    const PlacementInfo *records;           // header -> count records
+
+} CentroidBinaryContents;
+
+typedef struct
+{
+    int operation_mode;
+    const PlacementStore *store;
+
+} CentroidTextContents;
+
+/*
+ Function: arenaInit
+ -------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ initializes an empty arena, no memory is allocated until the first arenaAlloc()
+ Argument(s):
+ Arena *arena - the arena
+ size_t block_size - the size of each block requested from the heap
+ Return Value: none
+ Usage:
+ arenaInit(&arena, ARENA_BLOCK_SIZE);
+ */
+void arenaInit(Arena *arena, size_t block_size)
+{
+    arena -> head = NULL;
+    arena -> block_size = block_size;
+}
+
+/*
+ Function: arenaAlloc
+ --------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ allocates suitably aligned memory from an arena, requesting a new block from the heap when the current
+ block is full. Allocations larger than the block size get a block of their own
+ Argument(s):
+ Arena *arena - the arena
+ size_t size - the number of bytes required
+ Return Value:
+ a pointer to the memory, or NULL if the heap is exhausted
+ Usage:
+ PlacementInfo *pi = arenaAlloc(&arena, sizeof(PlacementInfo) * count);
+ */
+void *arenaAlloc(Arena *arena, size_t size)
+{
+    size_t aligned = (size + sizeof(max_align_t) - 1) / sizeof(max_align_t) * sizeof(max_align_t);
+    ArenaBlock *block = arena -> head;
+
+    if (block == NULL || block -> capacity - block -> used < aligned)
+    {
+        size_t capacity = (aligned > arena -> block_size) ? aligned : arena -> block_size;
+
+        block = malloc(sizeof(ArenaBlock) + capacity);
+        if (block == NULL) return NULL;
+        block -> used = 0;
+        block -> capacity = capacity;
+        block -> next = arena -> head;
+        arena -> head = block;
+    }
+
+    void *memory = (char *)block -> data + block -> used;
+    block -> used += aligned;
+    return memory;
+}
+
+/*
+ Function: arenaFree
+ -------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: returns every block of an arena to the heap, invalidating all memory allocated from it
+ Argument(s):
+ Arena *arena - the arena
+ Return Value: none
+ Usage: arenaFree(&arena);
+ */
+void arenaFree(Arena *arena)
+{
+    while (arena -> head != NULL)
+    {
+        ArenaBlock *next = arena -> head -> next;
+        free(arena -> head);
+        arena -> head = next;
+    }
+}
+
+/*
+ Function: initPlacementStore
+ ----------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: initializes an empty placement store
+ Argument(s):
+ PlacementStore *store - the store
+ Return Value: none
+ Usage: initPlacementStore(&store);
+ */
+void initPlacementStore(PlacementStore *store)
+{
+    arenaInit(&store -> arena, ARENA_BLOCK_SIZE);
+    store -> pi = NULL;
+    store -> count = 0;
+    store -> capacity = 0;
+    store -> mapping = NULL;
+    store -> mapping_length = 0;
+    store -> validation_cached = FALSE;
+}
+
+/*
+ Function: reservePlacementStore
+ -------------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ makes room for at least the specified number of components, moving the existing placement info to a
+ larger array from the arena if necessary. The old array stays in the arena (or the mapped binary
+ centroid file) until the store is freed
+ Argument(s):
+ PlacementStore *store - the store
+ int capacity - the number of components the store must be able to hold
+ Return Value:
+ TRUE (1) on success, FALSE (0) if the memory could not be allocated
+ Usage:
+ if (!reservePlacementStore(&store, count)) ...
+ */
+int reservePlacementStore(PlacementStore *store, int capacity)
+{
+    if (capacity <= store -> capacity) return TRUE;
+
+    PlacementInfo *pi = arenaAlloc(&store -> arena, sizeof(PlacementInfo) * (size_t)capacity);
+    if (pi == NULL) return FALSE;
+
+    if (store -> count > 0) memcpy(pi, store -> pi, sizeof(PlacementInfo) * store -> count);
+    store -> pi = pi;
+    store -> capacity = capacity;
+    return TRUE;
+}
+
+/*
+ Function: appendPlacement
+ -------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ adds a component to the end of a placement store, doubling the capacity when the store is full
+ Argument(s):
+ PlacementStore *store - the store
+ Return Value:
+ a pointer to the new, uninitialized placement info, or NULL if the memory could not be allocated
+ Usage:
+ PlacementInfo *part = appendPlacement(&store);
+ */
+PlacementInfo *appendPlacement(PlacementStore *store)
+{
+    if (store -> count == store -> capacity && !reservePlacementStore(store, (store -> capacity > 0) ? store -> capacity * 2 : 64)) return NULL;
+    return &store -> pi[store -> count++];
+}
+
+/*
+ Function: freePlacementStore
+ ----------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: frees all the placement info held by a store and unmaps the binary centroid file it was loaded from
+ Argument(s):
+ PlacementStore *store - the store
+ Return Value: none
+ Usage: freePlacementStore(&store);
+ */
+void freePlacementStore(PlacementStore *store)
+{
+    arenaFree(&store -> arena);
+    if (store -> mapping != NULL) munmap(store -> mapping, store -> mapping_length);
+    store -> pi = NULL;
+    store -> count = 0;
+    store -> capacity = 0;
+    store -> mapping = NULL;
+    store -> mapping_length = 0;
+}
+
+/*
+ Function: setCentroidError
+ --------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: records where and why the centroid file could not be read
+ Argument(s):
+ CentroidError *error - the error to fill in, may be NULL
+ int line, int column - the position of the offending field
+ const char *message - a short description of the problem
+ Return Value: none
+ Usage: setCentroidError(error, line, column, "feeder is not a whole number");
+ */
+static void setCentroidError(CentroidError *error, int line, int column, const char *message)
+{
+    if (error == NULL) return;
+    error -> line = line;
+    error -> column = column;
+    snprintf(error -> message, sizeof(error -> message), "%s", message);
+}
+
+/*
+ Function: nextCentroidField
+ ---------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ gets the next whitespace separated field of the centroid file, refilling the chunk buffer from the file
+ as needed so that fields may straddle chunk boundaries
+ Argument(s):
+ CentroidReader *reader - the reader
+ char *field - set to the null terminated field, must hold CENTROID_MAX_FIELD_LENGTH + 1 characters
+ int *line, int *column - set to the position of the first character of the field
+ Return Value:
+ the length of the field, 0 at the end of the file, -1 if the field is longer than CENTROID_MAX_FIELD_LENGTH
+ Usage:
+ int length = nextCentroidField(&reader, field, &line, &column);
+ */
+static int nextCentroidField(CentroidReader *reader, char *field, int *line, int *column)
+{
+    int length = 0;
+
+    for (;;)
+    {
+        if (reader -> position == reader -> length)
+        {
+            reader -> length = fread(reader -> buffer, 1, CENTROID_READ_CHUNK, reader -> fp);
+            reader -> position = 0;
+            if (reader -> length == 0) break;
+        }
+
+        char ch = reader -> buffer[reader -> position];
+        if (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n' || ch == '\v' || ch == '\f')
+        {
+            if (length > 0) break;
+            reader -> position++;
+            if (ch == '\n')
+            {
+                reader -> line++;
+                reader -> column = 1;
+            }
+            else reader -> column++;
+            continue;
+        }
+
+        if (length == 0)
+        {
+            *line = reader -> line;
+            *column = reader -> column;
+        }
+        if (length == CENTROID_MAX_FIELD_LENGTH) return -1;
+        field[length++] = ch;
+        reader -> position++;
+        reader -> column++;
+    }
+
+    field[length] = '\0';
+    return length;
+}
+
+/*
+ Function: parseDoubleField
+ --------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: converts a whole field to a double, rejecting trailing characters
+ Argument(s):
+ const char *field - the field
+ double *value - set to the value
+ Return Value:
+ TRUE (1) if the whole field is a number, otherwise FALSE (0)
+ Usage: if (!parseDoubleField(field, &part -> x_target)) ...
+ */
+static int parseDoubleField(const char *field, double *value)
+{
+    char *end;
+
+    *value = strtod(field, &end);
+    return end != field && *end == '\0';
+}
+
+/*
+ Function: parseIntField
+ -----------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: converts a whole field to a base 10 int, rejecting trailing characters and out of range values
+ Argument(s):
+ const char *field - the field
+ int *value - set to the value
+ Return Value:
+ TRUE (1) if the whole field is a whole number that fits in an int, otherwise FALSE (0)
+ Usage: if (!parseIntField(field, &part -> feeder)) ...
+ */
+static int parseIntField(const char *field, int *value)
+{
+    char *end;
+    long number = strtol(field, &end, 10);
+
+    if (end == field || *end != '\0' || number < INT_MIN || number > INT_MAX) return FALSE;
+    *value = (int)number;
+    return TRUE;
+}
+
+/*
+ Function: parseCentroidStream
+ -----------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ parses the operation mode, the number of components and the placement info of every component from an
+ open centroid file into a placement store
+ Argument(s):
+ CentroidReader *reader - the reader, positioned at the start of the file
+ long long file_size - the size of the file in bytes, negative if unknown
+ int *operation_mode - set to MANUAL_CONTROL or AUTONOMOUS_CONTROL
+ PlacementStore *store - an initialized store to fill
+ CentroidError *error - set to the line, column and description of a content issue, may be NULL
+ Return Value:
+ as loadCentroidFile()
+ Usage:
+ res = parseCentroidStream(reader, fileSize(fp), operation_mode, store, error);
+ */
+static int parseCentroidStream(CentroidReader *reader, long long file_size, int *operation_mode, PlacementStore *store, CentroidError *error)
+{
+    char field[CENTROID_MAX_FIELD_LENGTH + 1];
+    int line = 1, column = 1, declared, length;
+
+    length = nextCentroidField(reader, field, &line, &column);
+    if (length == 1 && (field[0] == 'm' || field[0] == 'M')) *operation_mode = MANUAL_CONTROL;
+    else if (length == 1 && (field[0] == 'a' || field[0] == 'A')) *operation_mode = AUTONOMOUS_CONTROL;
+    else
+    {
+        setCentroidError(error, line, column, "operation mode must be m or a");
+        return CENTROID_FILE_PRESENT_BUT_CONTENT_ISSUE;
+    }
+
+    length = nextCentroidField(reader, field, &line, &column);
+    if (length <= 0 || !parseIntField(field, &declared) || declared < 0)
+    {
+        setCentroidError(error, line, column, "number of components must be a whole number");
+        return CENTROID_FILE_PRESENT_BUT_CONTENT_ISSUE;
+    }
+
+    /* reserve the whole board up front, unless the file is too short to hold that many rows */
+    if (file_size >= 0 && (long long)declared * CENTROID_MIN_ROW_LENGTH > file_size + CENTROID_MIN_ROW_LENGTH)
+    {
+        setCentroidError(error, line, column, "file is too short for the number of components");
+        return CENTROID_FILE_HAS_TOO_MANY_COMPONENTS;
+    }
+    if (!reservePlacementStore(store, declared))
+    {
+        setCentroidError(error, line, column, "not enough memory for the number of components");
+        return CENTROID_FILE_HAS_TOO_MANY_COMPONENTS;
+    }
+
+    for (int k = 0; k < declared; k++)
+    {
+        PlacementInfo *part = appendPlacement(store);
+        const char *problem = NULL;
+
+        for (int f = 0; f < NUMBER_OF_FIELDS_IN_PLACEMENT_INFO && problem == NULL; f++)
+        {
+            length = nextCentroidField(reader, field, &line, &column);
+            if (length == 0)
+            {
+                problem = "file ends before the last component";
+                break;
+            }
+            if (length < 0)
+            {
+                problem = "field is too long";
+                break;
+            }
+
+            switch (f)
+            {
+                case 0:
+                    if (length >= (int)sizeof(part -> component_designation)) problem = "designation is longer than 9 characters";
+                    else memcpy(part -> component_designation, field, length + 1);
+                    break;
+                case 1:
+                    if (length >= (int)sizeof(part -> component_footprint)) problem = "footprint is longer than 9 characters";
+                    else memcpy(part -> component_footprint, field, length + 1);
+                    break;
+                case 2:
+                    if (!parseDoubleField(field, &part -> component_value)) problem = "value is not a number";
+                    break;
+                case 3:
+                    if (!parseDoubleField(field, &part -> x_target)) problem = "x is not a number";
+                    break;
+                case 4:
+                    if (!parseDoubleField(field, &part -> y_target)) problem = "y is not a number";
+                    break;
+                case 5:
+                    if (!parseDoubleField(field, &part -> theta_target)) problem = "theta is not a number";
+                    break;
+                case 6:
+                    if (!parseIntField(field, &part -> feeder)) problem = "feeder is not a whole number";
+                    break;
+            }
+        }
+
+        if (problem != NULL)
+        {
+            setCentroidError(error, line, column, problem);
+            return CENTROID_FILE_PRESENT_BUT_CONTENT_ISSUE;
+        }
+    }
+
+    return CENTROID_FILE_PRESENT_AND_READ;
+}
+
+/*
+ Function: fileSize
+ ------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: gets the size of an open file
+ Argument(s):
+ FILE *fp - the file
+ Return Value:
+ the size in bytes, or -1 if it cannot be determined (for example a pipe)
+ Usage: long long size = fileSize(fp);
+ */
+static long long fileSize(FILE *fp)
+{
+    struct stat file_status;
+
+    if (fstat(fileno(fp), &file_status) != 0 || !S_ISREG(file_status.st_mode)) return -1;
+    return (long long)file_status.st_size;
+}
+
+/*
+ Function: loadTextCentroidFile
+ ------------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ reads a text centroid file: the operation mode (m or a), the number of components, then seven fields per
+ component (designation, footprint, value, x, y, theta, feeder). Fields are separated by any whitespace,
+ the file is streamed in CENTROID_READ_CHUNK byte chunks and there is no limit on the number of
+ components other than available memory
+ Argument(s):
+ as loadCentroidFile()
+ Return Value:
+ as loadCentroidFile()
+ Usage:
+ return loadTextCentroidFile(path, operation_mode, store, error);
+ */
+static int loadTextCentroidFile(const char *path, int *operation_mode, PlacementStore *store, CentroidError *error)
+{
+    CentroidReader *reader;
+    int res;
+
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) return CENTROID_FILE_NOT_PRESENT;
+
+    /* the chunk buffer is too big for the stack of a session thread so it comes from the heap */
+    reader = malloc(sizeof(CentroidReader));
+    if (reader == NULL)
+    {
+        fclose(fp);
+        return CENTROID_FILE_HAS_TOO_MANY_COMPONENTS;
+    }
+    reader -> fp = fp;
+    reader -> length = reader -> position = 0;
+    reader -> line = reader -> column = 1;
+
+    res = parseCentroidStream(reader, fileSize(fp), operation_mode, store, error);
+
+    free(reader);
+    fclose(fp);
+    return res;
+}
+
+/*
+ Function: fnv1a
+ ---------------
+ Date: 17/10/2026
+ Version 2.0
+ Purpose:
+ continues a 64 bit FNV-1a hash over more data, so that several arrays hash as if they were one. It
+ hashes the records of a binary centroid file and the compiled programs of pnpProgram.c
+ Argument(s):
+ uint64_t hash - the hash so far, FNV_OFFSET_BASIS to start
+ const void *data - the data
+ size_t length - the number of bytes
+ Return Value: the hash
+ Usage: header.content_hash = fnv1a(FNV_OFFSET_BASIS, records, sizeof(PlacementInfo) * count);
+ */
+uint64_t fnv1a(uint64_t hash, const void *data, size_t length)
+{
+    const unsigned char *byte = data;
+
+    for (size_t k = 0; k < length; k++)
+    {
+        hash ^= byte[k];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+/*
+ Function: replaceFile
+ ---------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ writes a file under a temporary name beside it and renames it into place, so that a process reading it
+ at the same time, or a run that stops part way, never sees a half written file. On failure the
+ temporary file is removed and any earlier file is left as it was
+ Argument(s):
+ const char *path - the file to write
+ const char *mode - "w" for a text file, "wb" for a binary one
+ FileWriter writer - writes the contents
+ const void *context - passed on to writer
+ Return Value:
+ TRUE (1) if the file was written and renamed into place, otherwise FALSE (0)
+ Usage:
+ if (!replaceFile(path, "w", writeInventoryContents, inventory)) return FALSE;
+ */
+int replaceFile(const char *path, const char *mode, FileWriter writer, const void *context)
+{
+    char temporary_path[4096];
+    int written;
+    FILE *fp;
+
+    if (snprintf(temporary_path, sizeof(temporary_path), "%s" REPLACE_FILE_SUFFIX, path) >= (int)sizeof(temporary_path)) return FALSE;
+
+    fp = fopen(temporary_path, mode);
+    if (fp == NULL) return FALSE;
+    written = writer(fp, context);
+    written = (fclose(fp) == 0) && written;
+
+    if (!written || rename(temporary_path, path) != 0)
+    {
+        remove(temporary_path);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/*
+ Function: validationCachePath
+ -----------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: builds the name of the validation cache of a binary centroid file
+ Argument(s):
+ const char *path - the binary centroid file
+ char *cache_path - set to the cache file name
+ size_t size - the size of cache_path
+ Return Value:
+ TRUE (1) if the name fits, otherwise FALSE (0)
+ Usage: if (validationCachePath(path, cache_path, sizeof(cache_path))) ...
+ */
+static int validationCachePath(const char *path, char *cache_path, size_t size)
+{
+    int length = snprintf(cache_path, size, "%s%s", path, CENTROID_CACHE_SUFFIX);
+    return length > 0 && (size_t)length < size;
+}
+
+/*
+ Function: fillValidationCache
+ -----------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: describes a binary centroid file as it was when its records were validated
+ Argument(s):
+ CentroidValidationCache *cache - the cache entry to fill
+ const struct stat *file_status - the status of the binary centroid file
+ uint64_t content_hash - the content hash from its header
+ Return Value: none
+ Usage: fillValidationCache(&cache, &file_status, header -> content_hash);
+ */
+static void fillValidationCache(CentroidValidationCache *cache, const struct stat *file_status, uint64_t content_hash)
+{
+    memset(cache, 0, sizeof(CentroidValidationCache));
+    cache -> magic = CENTROID_BINARY_MAGIC;
+    cache -> record_size = sizeof(PlacementInfo);
+    cache -> device = (uint64_t)file_status -> st_dev;
+    cache -> inode = (uint64_t)file_status -> st_ino;
+    cache -> size = (int64_t)file_status -> st_size;
+    cache -> modified_seconds = (int64_t)file_status -> st_mtim.tv_sec;
+    cache -> modified_nanoseconds = (int64_t)file_status -> st_mtim.tv_nsec;
+    cache -> content_hash = content_hash;
+}
+
+/*
+ Function: isValidationCached
+ ----------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ checks whether a binary centroid file is unchanged since its records were last validated, in which case
+ the records need neither hashing nor checking again
+ Argument(s):
+ const char *path - the binary centroid file
+ const struct stat *file_status - its current status
+ uint64_t content_hash - the content hash from its header
+ Return Value:
+ TRUE (1) if the validation cache matches the file, otherwise FALSE (0)
+ Usage: store -> validation_cached = isValidationCached(path, &file_status, header -> content_hash);
+ */
+static int isValidationCached(const char *path, const struct stat *file_status, uint64_t content_hash)
+{
+    char cache_path[4096];
+    CentroidValidationCache cached, current;
+    FILE *fp;
+    int matched = FALSE;
+
+    if (!validationCachePath(path, cache_path, sizeof(cache_path))) return FALSE;
+    fp = fopen(cache_path, "rb");
+    if (fp == NULL) return FALSE;
+
+    fillValidationCache(&current, file_status, content_hash);
+    if (fread(&cached, sizeof(cached), 1, fp) == 1) matched = memcmp(&cached, &current, sizeof(cached)) == 0;
+
+    fclose(fp);
+    return matched;
+}
+
+/*
+ Function: saveValidationCache
+ -----------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ records that a binary centroid file has been validated. Failure to write the cache (for example in a
+ read only directory) only means the file is validated again next time
+ Argument(s):
+ const char *path - the binary centroid file
+ const struct stat *file_status - its status when it was validated
+ uint64_t content_hash - the content hash from its header
+ Return Value: none
+ Usage: saveValidationCache(path, &file_status, header -> content_hash);
+ */
+static void saveValidationCache(const char *path, const struct stat *file_status, uint64_t content_hash)
+{
+    char cache_path[4096];
+    CentroidValidationCache cache;
+    FILE *fp;
+
+    if (!validationCachePath(path, cache_path, sizeof(cache_path))) return;
+    fp = fopen(cache_path, "wb");
+    if (fp == NULL) return;
+
+    fillValidationCache(&cache, file_status, content_hash);
+    fwrite(&cache, sizeof(cache), 1, fp);
+    fclose(fp);
+}
+
+/*
+ Function: writeBinaryCentroidContents
+ -------------------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: writes the header and records of a binary centroid file, the FileWriter of writeBinaryCentroidFile()
+ Argument(s):
+ FILE *fp - the open file
+ const void *context - the CentroidBinaryContents to write
+ Return Value: TRUE (1) if every write succeeded, otherwise FALSE (0)
+ Usage: replaceFile(path, "wb", writeBinaryCentroidContents, &contents);
+ */
+static int writeBinaryCentroidContents(FILE *fp, const void *context)
+{
+    const CentroidBinaryContents *contents = context;
+    size_t records_size = sizeof(PlacementInfo) * (size_t)contents -> header -> count;
+
+    return fwrite(contents -> header, sizeof(CentroidBinaryHeader), 1, fp) == 1 && (records_size == 0 || fwrite(contents -> records, records_size, 1, fp) == 1);
+}
+
+/*
+ Function: writeCentroidContents
+ -------------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: writes the mode, count and rows of a text centroid file, the FileWriter of writeCentroidFile()
+ Argument(s):
+ FILE *fp - the open file
+ const void *context - the CentroidTextContents to write
+ Return Value: TRUE (1) if every write succeeded, otherwise FALSE (0)
+ Usage: replaceFile(path, "w", writeCentroidContents, &contents);
+ */
+static int writeCentroidContents(FILE *fp, const void *context)
+{
+    const CentroidTextContents *contents = context;
+    int written = fprintf(fp, "%c\n%d\n", (contents -> operation_mode == MANUAL_CONTROL) ? 'M' : 'A', contents -> store -> count) > 0;
+
+    for (int k = 0; k < contents -> store -> count && written; k++)
+    {
+        const PlacementInfo *pi = &contents -> store -> pi[k];
+        written = fprintf(fp, "%s\t%s\t%.10g\t%.10g\t%.10g\t%.10g\t%d\n", pi -> component_designation, pi -> component_footprint,
+                          pi -> component_value, pi -> x_target, pi -> y_target, pi -> theta_target, pi -> feeder) > 0;
+    }
+    return written;
+}
+
+/*
+ Function: writeBinaryCentroidFile
+ ---------------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ writes the placement info of a store as a binary centroid file: a CentroidBinaryHeader followed by one
+ PlacementInfo record per component, through replaceFile() so that a controller starting at the same
+ time never maps a half written file
+ Argument(s):
+ const char *path - the binary centroid file to write
+ int operation_mode - MANUAL_CONTROL or AUTONOMOUS_CONTROL
+ const PlacementStore *store - the placement info to write
+ Return Value:
+ CENTROID_FILE_PRESENT_AND_READ (0) on success, CENTROID_FILE_WRITE_FAILED (-4) otherwise
+ Usage:
+ res = writeBinaryCentroidFile(CENTROID_BINARY_FILE, operation_mode, &store);
+ */
+int writeBinaryCentroidFile(const char *path, int operation_mode, const PlacementStore *store)
+{
+    CentroidBinaryHeader header;
+    PlacementInfo *records;
+    size_t records_size = sizeof(PlacementInfo) * (size_t)store -> count;
+    int written;
+
+    /* copy field by field into zeroed records so that padding and unused string bytes hash the same every time */
+    records = calloc(store -> count > 0 ? store -> count : 1, sizeof(PlacementInfo));
+    if (records == NULL) return CENTROID_FILE_WRITE_FAILED;
+    for (int k = 0; k < store -> count; k++)
+    {
+        strncpy(records[k].component_designation, store -> pi[k].component_designation, sizeof(records[k].component_designation) - 1);
+        strncpy(records[k].component_footprint, store -> pi[k].component_footprint, sizeof(records[k].component_footprint) - 1);
+        records[k].component_value = store -> pi[k].component_value;
+        records[k].x_target = store -> pi[k].x_target;
+        records[k].y_target = store -> pi[k].y_target;
+        records[k].theta_target = store -> pi[k].theta_target;
+        records[k].feeder = store -> pi[k].feeder;
+    }
+
+    memset(&header, 0, sizeof(header));
+    header.magic = CENTROID_BINARY_MAGIC;
+    header.version = CENTROID_BINARY_VERSION;
+    header.header_size = sizeof(CentroidBinaryHeader);
+    header.record_size = sizeof(PlacementInfo);
+    header.operation_mode = operation_mode;
+    header.count = store -> count;
+    header.content_hash = fnv1a(FNV_OFFSET_BASIS, records, records_size);
+
+    CentroidBinaryContents contents = {&header, records};
+    written = replaceFile(path, "wb", writeBinaryCentroidContents, &contents);
+    free(records);
+    return written ? CENTROID_FILE_PRESENT_AND_READ : CENTROID_FILE_WRITE_FAILED;
+}
+
+/*
+ Function: writeCentroidFile
+ ---------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ writes the placement info of a store as a text centroid file, the format read by loadCentroidFile(), one
+ tab separated row per component, through replaceFile() like the binary file
+ Argument(s):
+ const char *path - the text centroid file to write
+ int operation_mode - MANUAL_CONTROL or AUTONOMOUS_CONTROL
+ const PlacementStore *store - the placement info to write
+ Return Value:
+ CENTROID_FILE_PRESENT_AND_READ (0) on success, CENTROID_FILE_WRITE_FAILED (-4) otherwise
+ Usage:
+ res = writeCentroidFile("board.setup.txt", operation_mode, &store);
+ */
+int writeCentroidFile(const char *path, int operation_mode, const PlacementStore *store)
+{
+    CentroidTextContents contents = {operation_mode, store};
+
+    return replaceFile(path, "w", writeCentroidContents, &contents) ? CENTROID_FILE_PRESENT_AND_READ : CENTROID_FILE_WRITE_FAILED;
+}
+
+/*
+ Function: validateBinaryRecords
+ -------------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ checks the records of a binary centroid file against the content hash in its header, and that every
+ designation and footprint is null terminated within its field
+ Argument(s):
+ const CentroidBinaryHeader *header - the header of the file
+ const PlacementInfo *records - the records that follow it
+ CentroidError *error - set to a description of the problem, may be NULL
+ Return Value:
+ CENTROID_FILE_PRESENT_AND_READ (0) or CENTROID_FILE_PRESENT_BUT_CONTENT_ISSUE (-2)
+ Usage:
+ res = validateBinaryRecords(header, records, error);
+ */
+static int validateBinaryRecords(const CentroidBinaryHeader *header, const PlacementInfo *records, CentroidError *error)
+{
+    char message[sizeof(error -> message)];
+
+    if (fnv1a(FNV_OFFSET_BASIS, records, sizeof(PlacementInfo) * (size_t)header -> count) != header -> content_hash)
+    {
+        setCentroidError(error, 0, 0, "content hash does not match, the file is corrupt");
+        return CENTROID_FILE_PRESENT_BUT_CONTENT_ISSUE;
+    }
+
+    for (int k = 0; k < header -> count; k++)
+    {
+        if (memchr(records[k].component_designation, '\0', sizeof(records[k].component_designation)) == NULL ||
+            memchr(records[k].component_footprint, '\0', sizeof(records[k].component_footprint)) == NULL)
+        {
+            snprintf(message, sizeof(message), "designation or footprint of component %d is not terminated", k + 1);
+            setCentroidError(error, 0, 0, message);
+            return CENTROID_FILE_PRESENT_BUT_CONTENT_ISSUE;
+        }
+    }
+    return CENTROID_FILE_PRESENT_AND_READ;
+}
+
+/*
+ Function: loadBinaryCentroidFile
+ --------------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ maps a binary centroid file and points the placement store at its records without copying them. The
+ mapping is private so changes made to the placement info by the controller never reach the file. The
+ records are hashed and checked only if the validation cache beside the file does not match it
+ Argument(s):
+ as loadCentroidFile()
+ Return Value:
+ as loadCentroidFile()
+ Usage:
+ return loadBinaryCentroidFile(path, operation_mode, store, error);
+ */
+static int loadBinaryCentroidFile(const char *path, int *operation_mode, PlacementStore *store, CentroidError *error)
+{
+    struct stat file_status;
+    const CentroidBinaryHeader *header;
+    int fd, res;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) return CENTROID_FILE_NOT_PRESENT;
+    if (fstat(fd, &file_status) != 0 || file_status.st_size < (off_t)sizeof(CentroidBinaryHeader))
+    {
+        close(fd);
+        setCentroidError(error, 0, 0, "file is too short for the binary header");
+        return CENTROID_FILE_PRESENT_BUT_CONTENT_ISSUE;
+    }
+
+    store -> mapping = mmap(NULL, (size_t)file_status.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (store -> mapping == MAP_FAILED)
+    {
+        store -> mapping = NULL;
+        setCentroidError(error, 0, 0, "file could not be mapped");
+        return CENTROID_FILE_PRESENT_BUT_CONTENT_ISSUE;
+    }
+    store -> mapping_length = (size_t)file_status.st_size;
+    header = store -> mapping;
+
+    if (header -> magic != CENTROID_BINARY_MAGIC || header -> version != CENTROID_BINARY_VERSION)
+    {
+        setCentroidError(error, 0, 0, "not a binary centroid file of a supported version");
+        return CENTROID_FILE_PRESENT_BUT_CONTENT_ISSUE;
+    }
+    if (header -> record_size != sizeof(PlacementInfo) || header -> header_size < sizeof(CentroidBinaryHeader) || header -> header_size % _Alignof(PlacementInfo) != 0)
+    {
+        setCentroidError(error, 0, 0, "binary centroid file was written for a different record layout");
+        return CENTROID_FILE_PRESENT_BUT_CONTENT_ISSUE;
+    }
+    if (header -> operation_mode != MANUAL_CONTROL && header -> operation_mode != AUTONOMOUS_CONTROL)
+    {
+        setCentroidError(error, 0, 0, "operation mode must be manual or autonomous");
+        return CENTROID_FILE_PRESENT_BUT_CONTENT_ISSUE;
+    }
+    if (header -> count < 0 || (long long)header -> header_size + (long long)header -> count * header -> record_size != (long long)file_status.st_size)
+    {
+        setCentroidError(error, 0, 0, "number of components does not match the file size");
+        return CENTROID_FILE_HAS_TOO_MANY_COMPONENTS;
+    }
+
+    PlacementInfo *records = (PlacementInfo *)((char *)store -> mapping + header -> header_size);
+
+    store -> validation_cached = isValidationCached(path, &file_status, header -> content_hash);
+    if (!store -> validation_cached)
+    {
+        res = validateBinaryRecords(header, records, error);
+        if (res != CENTROID_FILE_PRESENT_AND_READ) return res;
+        saveValidationCache(path, &file_status, header -> content_hash);
+    }
+
+    *operation_mode = header -> operation_mode;
+    store -> pi = records;
+    store -> count = header -> count;
+    store -> capacity = header -> count;
+    return CENTROID_FILE_PRESENT_AND_READ;
+}
+
+/*
+ Function: isBinaryCentroidFile
+ ------------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ decides how to read a centroid file. Files named .txt are always text, anything else is binary if it
+ starts with CENTROID_BINARY_MAGIC
+ Argument(s):
+ const char *path - the centroid file
+ Return Value:
+ TRUE (1) if the file should be read as a binary centroid file, otherwise FALSE (0)
+ Usage: if (isBinaryCentroidFile(path)) ...
+ */
+static int isBinaryCentroidFile(const char *path)
+{
+    size_t length = strlen(path);
+    uint32_t magic = 0;
+    FILE *fp;
+
+    if (length >= 4 && strcmp(path + length - 4, ".txt") == 0) return FALSE;
+
+    fp = fopen(path, "rb");
+    if (fp == NULL) return FALSE;
+    if (fread(&magic, sizeof(magic), 1, fp) != 1) magic = 0;
+    fclose(fp);
+    return magic == CENTROID_BINARY_MAGIC;
+}
+
+/*
+ Function: loadCentroidFile
+ --------------------------
+ Date: 17/10/2026
+ Version 1.1
+ Purpose:
+ reads a centroid file, either a binary centroid file written by writeBinaryCentroidFile() which is
+ mapped and used in place, or a text file of the operation mode (m or a), the number of components,
+ then seven fields per component (designation, footprint, value, x, y, theta, feeder)
+ Argument(s):
+ const char *path - the centroid file to read
+ int *operation_mode - set to MANUAL_CONTROL or AUTONOMOUS_CONTROL
+ PlacementStore *store - initialized by the call and filled with the placement info of every component,
+ free with freePlacementStore() whatever the result
+ CentroidError *error - set to the line, column (text files only) and description of a content issue, may be NULL
+ Return Value:
+ one of:
+ CENTROID_FILE_PRESENT_AND_READ (0)
+ CENTROID_FILE_NOT_PRESENT (-1)
+ CENTROID_FILE_PRESENT_BUT_CONTENT_ISSUE (-2)
+ CENTROID_FILE_HAS_TOO_MANY_COMPONENTS (-3) - more components declared than the file or memory can hold
+ Usage:
+ int res = loadCentroidFile("board.txt", &operation_mode, &store, &error);
+ */
+int loadCentroidFile(const char *path, int *operation_mode, PlacementStore *store, CentroidError *error)
+{
+    initPlacementStore(store);
+    setCentroidError(error, 0, 0, "");
+
+    if (isBinaryCentroidFile(path)) return loadBinaryCentroidFile(path, operation_mode, store, error);
+    return loadTextCentroidFile(path, operation_mode, store, error);
+}
+
+/*
+ Function: getCentroidFileContents
+ ---------------------------------
+ Written by Jason Brown
+ Date: 19/05/2021
+ Version 2.0
+ Purpose:
+ gets the contents of the centroid file (including placement info of components) if it exists in the
+ current working directory and if its contents are valid. The binary conversion CENTROID_BINARY_FILE is
+ used instead when it is at least as new as CENTROID_FILE.
+ Argument(s):
+ The following arguments are passed by reference and so are available to the calling function:
+ int *operation_mode - a pointer to an integer variable representing the operation mode (manual or auto)
+ PlacementStore *store - filled with the placement info of every component, store -> count is the number of components to place
+ CentroidError *error - set to the line, column and description of a content issue, may be NULL
+ Return Value:
+ one of:
+ CENTROID_FILE_PRESENT_AND_READ (0)
+ CENTROID_FILE_NOT_PRESENT (-1)
+ CENTROID_FILE_PRESENT_BUT_CONTENT_ISSUE (-2)
+ CENTROID_FILE_HAS_TOO_MANY_COMPONENTS (-3)
+ Usage:
+ int res = getCentroidFileContents(&operation_mode, &store, &error);
+ */
+int getCentroidFileContents(int *operation_mode, PlacementStore *store, CentroidError *error)
+{
+    struct stat text_status, binary_status;
+
+    /* prefer the binary conversion of the centroid file unless the text file has been edited since */
+    if (stat(CENTROID_BINARY_FILE, &binary_status) == 0 &&
+        (stat(CENTROID_FILE, &text_status) != 0 || binary_status.st_mtim.tv_sec > text_status.st_mtim.tv_sec ||
+         (binary_status.st_mtim.tv_sec == text_status.st_mtim.tv_sec && binary_status.st_mtim.tv_nsec >= text_status.st_mtim.tv_nsec)))
+        return loadCentroidFile(CENTROID_BINARY_FILE, operation_mode, store, error);
+
+    return loadCentroidFile(CENTROID_FILE, operation_mode, store, error);
+}
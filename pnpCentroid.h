@@ -0,0 +1,119 @@
+/*
+ *
+ * pnpCentroid.h - declarations for the centroid file reader and the placement store it fills
+ *
+ * Platform: Any POSIX compliant platform
+ * Intended for and tested on: Cygwin 64 bit
+ *
+ */
+
+#ifndef PNP_CENTROID_H
+#define PNP_CENTROID_H
+
+#include "pnpControl.h"
+
+#define ARENA_BLOCK_SIZE (1024 * 1024)      // default size of each block the arena allocates from the heap
+#define CENTROID_READ_CHUNK (64 * 1024)     // the centroid file is read in chunks of this many bytes
+#define CENTROID_MAX_FIELD_LENGTH 63        // longest field accepted, designation and footprint are further limited to fit PlacementInfo
+#define CENTROID_MIN_ROW_LENGTH 14          // shortest possible row, "a b 0 0 0 0 0\n", used to reject impossible component counts
+
+#define CENTROID_BINARY_FILE "centroid.bin"
+#define CENTROID_BINARY_MAGIC 0x43504E50u   // "PNPC" in little endian byte order
+#define CENTROID_BINARY_VERSION 1
+#define CENTROID_CACHE_SUFFIX ".valid"      // the validation cache of a binary centroid file sits beside it with this suffix
+#define FNV_OFFSET_BASIS 14695981039346656037ULL  // starting value of a 64 bit FNV-1a hash, see fnv1a()
+#define FNV_PRIME 1099511628211ULL
+#define REPLACE_FILE_SUFFIX ".tmp"          // replaceFile() writes beside the file under its name with this suffix
+
+#define CENTROID_FILE_WRITE_FAILED -4
+
+typedef struct ArenaBlock
+{
+    struct ArenaBlock *next;
+    size_t used;
+    size_t capacity;
+    max_align_t data[];
+
+} ArenaBlock;
+
+typedef struct
+{
+    ArenaBlock *head;                       // most recently allocated block, allocations are served from here first
+    size_t block_size;
+
+} Arena;
+
+typedef struct
+{
+    Arena arena;                            // owns the placement array, freed in one go by freePlacementStore()
+    PlacementInfo *pi;                      // contiguous placement info of every component
+    int count;
+    int capacity;
+    void *mapping;                          // binary centroid file pi points into when loaded zero-copy, NULL otherwise
+    size_t mapping_length;
+    int validation_cached;                  // TRUE if a binary centroid file was accepted from its validation cache
+
+} PlacementStore;
+
+typedef struct
+{
+    uint32_t magic;                         // CENTROID_BINARY_MAGIC
+    uint32_t version;                       // CENTROID_BINARY_VERSION
+    uint32_t header_size;                   // offset of the first record, a multiple of 8
+    uint32_t record_size;                   // sizeof(PlacementInfo) of the writer, must match the reader
+    int32_t operation_mode;                 // MANUAL_CONTROL or AUTONOMOUS_CONTROL
+    int32_t count;
+    uint64_t content_hash;                  // FNV-1a of the records, padding bytes are written as zero
+
+} CentroidBinaryHeader;
+
+typedef struct
+{
+    uint32_t magic;                         // CENTROID_BINARY_MAGIC
+    uint32_t record_size;
+    uint64_t device;                        // identity and modification time of the binary file that was validated
+    uint64_t inode;
+    int64_t size;
+    int64_t modified_seconds;
+    int64_t modified_nanoseconds;
+    uint64_t content_hash;                  // content hash of the binary file that was validated
+
+} CentroidValidationCache;
+
+typedef struct
+{
+    int line;                               // 1-based line of the offending field, 0 if the problem is not tied to a position
+    int column;                             // 1-based column of the offending field
+    char message[80];
+
+} CentroidError;
+
+typedef int (*FileWriter)(FILE*, const void*);  // writes the contents of a file for replaceFile(), FALSE if any write failed
+
+void arenaInit(Arena*, size_t);
+
+void *arenaAlloc(Arena*, size_t);
+
+void arenaFree(Arena*);
+
+void initPlacementStore(PlacementStore*);
+
+int reservePlacementStore(PlacementStore*, int);
+
+PlacementInfo *appendPlacement(PlacementStore*);
+
+void freePlacementStore(PlacementStore*);
+
+uint64_t fnv1a(uint64_t, const void*, size_t);
+
+int replaceFile(const char*, const char*, FileWriter, const void*);
+
+int writeBinaryCentroidFile(const char*, int, const PlacementStore*);
+
+int writeCentroidFile(const char*, int, const PlacementStore*);
+
+int loadCentroidFile(const char*, int*, PlacementStore*, CentroidError*);
+
+int getCentroidFileContents(int*, PlacementStore*, CentroidError*);
+
+#endif // PNP_CENTROID_H
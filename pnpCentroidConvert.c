@@ -0,0 +1,46 @@
+/*
+ *
+ * pnpCentroidConvert.c - converts a text centroid file to the binary centroid format that the controller
+ * maps at startup without parsing
+ *
+ * Usage: pnpCentroidConvert [input centroid file] [output binary centroid file]
+ * defaults are centroid.txt and centroid.bin in the current working directory
+ *
+ * Platform: Any POSIX compliant platform
+ * Intended for and tested on: Cygwin 64 bit
+ *
+ */
+
+#include "pnpCentroid.h"
+
+int main(int argc, char *argv[])
+{
+    const char *input = (argc > 1) ? argv[1] : CENTROID_FILE;
+    const char *output = (argc > 2) ? argv[2] : CENTROID_BINARY_FILE;
+    int operation_mode, res;
+    PlacementStore store;
+    CentroidError error;
+
+    if (argc > 3)
+    {
+        printf("Usage: %s [input centroid file] [output binary centroid file]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    res = loadCentroidFile(input, &operation_mode, &store, &error);
+    if (res != CENTROID_FILE_PRESENT_AND_READ)
+    {
+        if (error.line > 0) printf("Problem with centroid file %s, error code %d at line %d column %d: %s\n", input, res, error.line, error.column, error.message);
+        else if (error.message[0] != '\0') printf("Problem with centroid file %s, error code %d: %s\n", input, res, error.message);
+        else printf("Problem with centroid file %s, error code %d\n", input, res);
+        freePlacementStore(&store);
+        return EXIT_FAILURE;
+    }
+
+    res = writeBinaryCentroidFile(output, operation_mode, &store);
+    if (res != CENTROID_FILE_PRESENT_AND_READ) printf("Could not write binary centroid file %s, error code %d\n", output, res);
+    else printf("Converted %d components in %s mode from %s to %s\n", store.count, (operation_mode == MANUAL_CONTROL) ? "manual" : "auto", input, output);
+
+    freePlacementStore(&store);
+    return (res == CENTROID_FILE_PRESENT_AND_READ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -2,651 +2,1202 @@
  *
  * pnpControl.c - the controller for the pick and place machine in manual and autonomous mode
  *
+ * The states are listed once in PNP_STATES, which generates the state numbers, the state names and the
+ * transition table for each mode. A state's handler runs one tick of it for the engine in
+ * pnpStateMachine.c. Manual mode steps through the states as the user directs, autonomous mode streams
+ * the board's compiled program (see pnpProgram.c) and its states only label the steps. Given several
+ * centroid files or a panel, the boards run one after another as a job (see pnpJob.c). Given several
+ * machines, a single board is split across them and placed by a line of simulators (see pnpLine.c)
+ *
  * Platform: Any POSIX compliant platform
  * Intended for and tested on: Cygwin 64 bit
  *
  */
 
-#include "pnpControl.h"
-
-// state names and numbers
-#define HOME                0
-#define MOVE_TO_FEEDER      1
-#define WAIT              	2
-#define LOWER_NOZZLE       	3
-#define PICK_COMPONENT     	4
-#define RAISE_COMPONENT    	5
-#define MOVE_TO_CAMERA    	6
-#define TAKE_UP_PHOTO    	7
-#define MOVE_TO_PCB	    	8
-#define TAKE_DOWN_PHOTO    	9
-#define ROTATE          	10
-#define ADJUST             	11
-#define LOWER_COMPONENT    	12
-#define PLACE_COMPONENT    	13
-#define RAISE_HEAD      	14
-#define COMPLETED         	15
+#include "pnpStateMachine.h"
+#include "pnpJob.h"
+#include "pnpLine.h"
+#include "pnpTrace.h"
+#include "pnpLog.h"
 
+#define STATE_NAME(state, name, manual_keys, manual_simulator, manual_handler, auto_keys, auto_simulator, auto_handler) name,
+#define MANUAL_TRANSITION(state, name, manual_keys, manual_simulator, manual_handler, auto_keys, auto_simulator, auto_handler) {manual_keys, manual_simulator, manual_handler},
+#define AUTO_TRANSITION(state, name, manual_keys, manual_simulator, manual_handler, auto_keys, auto_simulator, auto_handler) {auto_keys, auto_simulator, auto_handler},
 
 /* state_names of up to 19 characters (the 20th character is a null terminator), only required for display purposes */
-const char state_name[16][20] = {"HOME              ",
-                                "MOVE TO FEEDER		",
-                                "WAIT	            ",
-								"LOWER_NOZZLE       ",
-								"PICK_COMPONENT     ",
-								"RAISE_COMPONENT    ",
-								"MOVE_TO_CAMERA     ",
-								"TAKE_UP_PHOTO      ",
-								"MOVE_TO_PCB	    ",
-								"TAKE_DOWN_PHOTO    ",
-								"ROTATE  		    ",
-								"ADJUST  		    ",
-								"LOWER_COMPONENT    ",
-								"PLACE_COMPONENT    ",
-								"RAISE_HEAD         ",
-								"COMPLETED          "};
-
-const double TAPE_FEEDER_X[NUMBER_OF_FEEDERS] = {FDR_0_X, FDR_1_X, FDR_2_X, FDR_3_X, FDR_4_X, FDR_5_X, FDR_6_X, FDR_7_X, FDR_8_X, FDR_9_X};
-const double TAPE_FEEDER_Y[NUMBER_OF_FEEDERS] = {FDR_0_Y, FDR_1_Y, FDR_2_Y, FDR_3_Y, FDR_4_Y, FDR_5_Y, FDR_6_Y, FDR_7_Y, FDR_8_Y, FDR_9_Y};
+const char state_name[NUMBER_OF_STATES][20] = { PNP_STATES(STATE_NAME) };
 
 const char nozzle_name[3][10] = {"left", "centre", "right"};
 
-int main()
+static atomic_int machines_running;        // control threads of a line still placing their share of the board
+
+/*
+ Function: logPartDetails
+ ------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ prints the details of the next part to place in manual mode and asks for its tape feeder
+ Argument(s):
+ ControlContext *context - the controller state
+ int state - the state the details are printed in
+ const char *heading - "Part 0 details" for the first part, otherwise "Part details"
+ Return Value: none
+ Usage:
+ logPartDetails(context, STATE_WAIT, "Part details");
+ */
+static void logPartDetails(ControlContext *context, int state, const char *heading)
 {
-    pnpOpen();
+    PlacementInfo *pi = context -> pi;
+    int count = context -> part;
 
-    int operation_mode, number_of_components_to_place, res;
-    PlacementInfo pi[MAX_NUMBER_OF_COMPONENTS_TO_PLACE];
+    pnpLog(LOG_ESSENTIAL, state, count, "%s:\nDesignation: %s\nFootprint: %s\nValue: %.2f\nx: %.2f\ny: %.2f\ntheta: %.2f\nFeeder: %d\n\n",
+    heading, pi[count].component_designation, pi[count].component_footprint, pi[count].component_value, pi[count].x_target, pi[count].y_target, pi[count].theta_target, pi[count].feeder);
+    pnpLog(LOG_ESSENTIAL, state, count, "Time: %7.2f  select tape feeder to pick from \n", context -> snapshot.sim_time);
+}
 
-    /*
-     * read the centroid file to obtain the operation mode, number of components to place
-     * and the placement information for those components
-     */
-    res = getCentroidFileContents(&operation_mode, &number_of_components_to_place, pi);
+/*
+ Function: selectFeeder
+ ----------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ handles a number key in manual mode, moving to the feeder if it is the current part's feeder
+ Argument(s):
+ ControlContext *context - the controller state
+ int state - the state the key was pressed in
+ char c - the key pressed
+ Return Value:
+ the next state, STATE_MOVE_TO_FEEDER if the move was issued, otherwise state
+ Usage:
+ state = selectFeeder(context, STATE_WAIT, c);
+ */
+static int selectFeeder(ControlContext *context, int state, char c)
+{
+    PlacementInfo *pi = context -> pi;
+    int count = context -> part;
 
-    if (res != CENTROID_FILE_PRESENT_AND_READ)
+    if (context -> finished == FALSE && (c - '0') == pi[count].feeder)
     {
-        printf("Problem with centroid file, error code %d, press any key to continue\n", res);
-        getchar();
-        exit(res);
+        /* the expression (c - '0') obtains the integer value of the number key pressed */
+        setTargetPos(TAPE_FEEDER_X[c - '0'], TAPE_FEEDER_Y[c - '0']);
+        state = STATE_MOVE_TO_FEEDER;
+        pnpLog(LOG_STATE, state, count, "Time: %7.2f  New state: %.20s  Issued instruction to move to tape feeder %c\n", context -> snapshot.sim_time, state_name[state], c);
     }
+    else if (context -> finished == FALSE && c >= '0' && c <= '9')
+    {
+        pnpLog(LOG_ESSENTIAL, state, count, "Time: %7.2f  Feeder mismatch \n", context -> snapshot.sim_time);
+    }
+    return state;
+}
 
-    /* initialization of variables and controller window */
-    int state = HOME, finished = FALSE, picked = FALSE, adjusted = FALSE, rotated = FALSE, camera = FALSE, offset = 0, i = 0;
-    int autoPicked[3]={FALSE, FALSE, FALSE};
-    double theta_pick_error[3]= {0, 0, 0}; //array for angle errors
-    double x_preplace_error = 0; //gantry x error
-	double y_preplace_error = 0; //gantry y error
-	double rotateAngle; //angle needed to rotate
-    char c;
-    int count = 0; //setup a counter to keep track of parts
-	int pickedCount = 0; //setup a counter to keep track of autoPicking
-	int placedCount = 0; //setup a counter to keep track of autoPlacing
-
-    /* state machine code for manual control mode */
-    if (operation_mode == MANUAL_CONTROL)
-    {
-
-        printf("Time: %7.2f  Initial state: %.15s  Operating in manual control mode, there are %d parts to place\n\n", getSimTime(), state_name[HOME], number_of_components_to_place);
-        printf("Part 0 details:\nDesignation: %s\nFootprint: %s\nValue: %.2f\nx: %.2f\ny: %.2f\ntheta: %.2f\nFeeder: %d\n\n",
-        pi[count].component_designation, pi[count].component_footprint, pi[count].component_value, pi[count].x_target, pi[count].y_target, pi[count].theta_target, pi[count].feeder);
-        printf("Time: %7.2f  select tape feeder to pick from \n", getSimTime());
-		/* loop until user quits */
-        while(!isPnPSimulationQuitFlagOn())
+/* states shared by both modes */
+
+/*
+ Function: countFeederPick
+ -------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ counts the part being picked off its feeder's reel, and alerts the operator when the reel runs out.
+ A failed pick still takes a part off the tape, so every pick is counted
+ Argument(s):
+ ControlContext *context - the controller state, context -> part is the part being picked
+ int state - the state the pick is logged against
+ Return Value: none
+ Usage:
+ countFeederPick(context, STATE_PICK_COMPONENT);
+ */
+static void countFeederPick(ControlContext *context, int state)
+{
+    FeederInventory *inventory = context -> inventory;
+    int feeder = context -> pi[context -> part].feeder;
+
+    if (inventory == NULL) return;
+    switch (takeFeederPart(inventory, feeder))
+    {
+        case FEEDER_SPLICED:
+            pnpLog(LOG_ESSENTIAL, state, context -> part, "Time: %7.2f  Feeder %d ran out, picking from the spliced reel of %d parts\n", context -> snapshot.sim_time, feeder, inventory -> reel_size[feeder]);
+            break;
+        case FEEDER_EMPTY:
+            pnpLog(LOG_ESSENTIAL, state, context -> part, "Time: %7.2f  Feeder %d is out of parts, splice a new reel and update " FEEDER_INVENTORY_FILE "\n", context -> snapshot.sim_time, feeder);
+            break;
+    }
+}
+
+static int lowerNozzleState(ControlContext *context, char c)
+{
+    lowerNozzle(context -> nozzle);
+    pnpLog(LOG_STATE, STATE_PICK_COMPONENT, context -> part, "Time: %7.2f  New state: %.20s  Issued instruction to pick Component \n", context -> snapshot.sim_time, state_name[STATE_PICK_COMPONENT]);
+    return STATE_PICK_COMPONENT;
+}
+
+static int pickComponentState(ControlContext *context, char c)
+{
+    applyVacuum(context -> nozzle);
+    countFeederPick(context, STATE_PICK_COMPONENT);
+    pnpLog(LOG_STATE, STATE_RAISE_COMPONENT, context -> part, "Time: %7.2f  New state: %.20s  Issued instruction to Raise Nozzle \n", context -> snapshot.sim_time, state_name[STATE_RAISE_COMPONENT]);
+    return STATE_RAISE_COMPONENT;
+}
+
+static int placeComponentState(ControlContext *context, char c)
+{
+    releaseVacuum(context -> nozzle);
+    pnpLog(LOG_STATE, STATE_RAISE_HEAD, context -> part, "Time: %7.2f  New state: %.20s  Issued instruction to Raise Nozzle \n", context -> snapshot.sim_time, state_name[STATE_RAISE_HEAD]);
+    return STATE_RAISE_HEAD;
+}
+
+/* manual control mode, one step per key press on the centre nozzle */
+
+/* Initial state - waits for correct feeder to be selected */
+static int manualHome(ControlContext *context, char c)
+{
+    return selectFeeder(context, STATE_WAIT, c);
+}
+
+static int manualMoveToFeeder(ControlContext *context, char c)
+{
+    pnpLog(LOG_ESSENTIAL, STATE_WAIT, context -> part, "Time: %7.2f  New state: %.20s  Arrived at feeder, Press 'p' to pick\n", context -> snapshot.sim_time, state_name[STATE_WAIT]);
+    return STATE_WAIT;
+}
+
+static int manualWait(ControlContext *context, char c)
+{
+    int state = STATE_WAIT, count = context -> part;
+    double sim_time = context -> snapshot.sim_time;
+
+    if (context -> finished == TRUE) //check if there are any components to pick
+    {
+        pnpLog(LOG_ESSENTIAL, state, count, "Time: %7.2f  All components placed - press q to quit \n", sim_time);
+        state = STATE_COMPLETED;
+    }
+
+    state = selectFeeder(context, state, c);
+
+    if (context -> picked == FALSE && (c == 'p' || c == 'P'))
+    {
+        state = STATE_LOWER_NOZZLE;
+        pnpLog(LOG_STATE, state, count, "Time: %7.2f  New state: %.20s  Issued instruction to Lower Nozzle \n", sim_time, state_name[state]);
+    }
+    if (context -> picked == TRUE && (c == 'c' || c == 'C') && context -> rotated == FALSE && context -> camera == FALSE && context -> adjusted == FALSE)
+    {
+        setTargetPos(-100,100);
+        state = STATE_MOVE_TO_CAMERA;
+        pnpLog(LOG_STATE, state, count, "Time: %7.2f  New state: %.20s  Issued instruction to Move to Camera \n", sim_time, state_name[state]);
+    }
+
+    /* Rotate state - needs part picked and there to be an error after an up pic has been taken */
+    if (context -> theta_pick_error[CENTRE_NOZZLE] != 0 && (c == 'r' || c == 'R') && context -> rotated == FALSE && context -> picked == TRUE && context -> camera == TRUE)
+    {
+        state = STATE_ROTATE;
+        pnpLog(LOG_STATE, state, count, "Time: %7.2f  New state: %.20s  Issued instruction to Rotate component \n", sim_time, state_name[state]);
+    }
+
+    /* Adjust state - needs part picked and there to be an error after a down pic has been taken */
+    if ((context -> x_preplace_error != 0 || context -> y_preplace_error != 0) && (c == 'a' || c == 'A') && context -> adjusted == FALSE && context -> picked == TRUE && context -> camera == TRUE)
+    {
+        state = STATE_ADJUST;
+        pnpLog(LOG_STATE, state, count, "Time: %7.2f  New state: %.20s  Issued instruction to Adjust position of Gantry \n", sim_time, state_name[state]);
+    }
+    if ((c == 'p' || c == 'P') && context -> picked == TRUE && context -> rotated == TRUE && context -> adjusted == TRUE)
+    {
+        state = STATE_LOWER_COMPONENT;
+        pnpLog(LOG_STATE, state, count, "Time: %7.2f  New state: %.20s  Issued instruction to Lower Nozzle \n", sim_time, state_name[state]);
+    }
+    if (context -> picked == FALSE && (c == 'h' || c == 'H'))
+    {
+        setTargetPos(0,0);
+        if (isSimulatorReadyForNextInstruction())
+        state = STATE_HOME;
+        pnpLog(LOG_STATE, state, count, "Time: %7.2f  New state: %.20s  Issued instruction to Return Home \n", sim_time, state_name[state]);
+    }
+    return state;
+}
+
+static int manualRaiseComponent(ControlContext *context, char c)
+{
+    raiseNozzle(context -> nozzle);
+    context -> picked = TRUE;
+    pnpLog(LOG_ESSENTIAL, STATE_WAIT, context -> part, "Time: %7.2f  New state: %.20s  Component %.2f Picked. Press 'C' to move to camera and take photo\n", context -> snapshot.sim_time, state_name[STATE_WAIT], context -> pi[context -> part].component_value);
+    return STATE_WAIT;
+}
+
+static int manualMoveToCamera(ControlContext *context, char c)
+{
+    context -> camera = TRUE;
+    pnpLog(LOG_STATE, STATE_TAKE_UP_PHOTO, context -> part, "Time: %7.2f  New state: %.20s  Issued instruction to Take Photo from Below \n", context -> snapshot.sim_time, state_name[STATE_TAKE_UP_PHOTO]);
+    return STATE_TAKE_UP_PHOTO;
+}
+
+static int manualTakeUpPhoto(ControlContext *context, char c)
+{
+    PlacementInfo *pi = context -> pi;
+    int count = context -> part;
+
+    clearBatchVision(&context -> vision);
+    context -> vision.loaded[CENTRE_NOZZLE] = TRUE;
+    if (!captureLookupPhoto(&context -> vision)) return STATE_TAKE_UP_PHOTO;
+    context -> snapshot.sim_time = context -> vision.sim_time;
+    context -> theta_pick_error[CENTRE_NOZZLE] = context -> vision.theta_pick_error[CENTRE_NOZZLE];
+    if (context -> theta_pick_error[CENTRE_NOZZLE] == 0)
+    {
+        context -> rotated = TRUE;
+    }
+    pnpLog(LOG_STATE, STATE_TAKE_UP_PHOTO, count, "Time: %7.2f  Photo taken, Rotation error = %.2f \n", context -> snapshot.sim_time, context -> theta_pick_error[CENTRE_NOZZLE]);
+    setTargetPos(pi[count].x_target, pi[count].y_target);
+    pnpLog(LOG_STATE, STATE_MOVE_TO_PCB, count, "Time: %7.2f  New state: %.20s  Issued instruction to move to PCB position x: %.2f y: %.2f \n", context -> snapshot.sim_time, state_name[STATE_MOVE_TO_PCB], pi[count].x_target, pi[count].y_target);
+    return STATE_MOVE_TO_PCB;
+}
+
+static int manualMoveToPcb(ControlContext *context, char c)
+{
+    PlacementInfo *pi = context -> pi;
+    int count = context -> part;
+
+    pnpLog(LOG_STATE, STATE_MOVE_TO_PCB, count, "Time: %7.2f  Arrived at PCB position x: %.2f y: %.2f \n", context -> snapshot.sim_time, pi[count].x_target, pi[count].y_target);
+    pnpLog(LOG_STATE, STATE_TAKE_DOWN_PHOTO, count, "Time: %7.2f  New state: %.20s  Issued instruction to Take Photo from Above \n", context -> snapshot.sim_time, state_name[STATE_TAKE_DOWN_PHOTO]);
+    return STATE_TAKE_DOWN_PHOTO;
+}
+
+static int manualTakeDownPhoto(ControlContext *context, char c)
+{
+    int count = context -> part;
+
+    if (!captureLookdownPhoto(&context -> vision)) return STATE_TAKE_DOWN_PHOTO;
+    context -> snapshot.sim_time = context -> vision.sim_time;
+    context -> x_preplace_error = context -> vision.x_preplace_error;
+    context -> y_preplace_error = context -> vision.y_preplace_error;
+    if (context -> x_preplace_error == 0 && context -> y_preplace_error == 0)
+    {
+        context -> adjusted = TRUE;
+    }
+    pnpLog(LOG_STATE, STATE_WAIT, count, "Time: %7.2f  New state: %.20s  Photos taken, Position error = x: %.2f y: %.2f\n", context -> snapshot.sim_time, state_name[STATE_WAIT], context -> x_preplace_error, context -> y_preplace_error);
+    if (context -> theta_pick_error[CENTRE_NOZZLE] != 0)
+    {
+        pnpLog(LOG_ESSENTIAL, STATE_WAIT, count, "Press 'R' to Rotate\n");
+    }
+    if (context -> x_preplace_error != 0 || context -> y_preplace_error != 0)
+    {
+        pnpLog(LOG_ESSENTIAL, STATE_WAIT, count, "Press 'A' to adjust gantry\n");
+    }
+    return STATE_WAIT;
+}
+
+static int manualRotate(ControlContext *context, char c)
+{
+    double rotateAngle = context -> pi[context -> part].theta_target - context -> theta_pick_error[CENTRE_NOZZLE]; //angle needed to rotate
+
+    rotateNozzle(context -> nozzle, rotateAngle);
+    context -> rotated = TRUE;
+    pnpLog(LOG_STATE, STATE_WAIT, context -> part, "Time: %7.2f  New state: %.20s  Component Rotated , waiting for next instruction\n", context -> snapshot.sim_time, state_name[STATE_WAIT]);
+    return STATE_WAIT;
+}
+
+static int manualAdjust(ControlContext *context, char c)
+{
+    amendPos(context -> x_preplace_error, context -> y_preplace_error);
+    context -> adjusted = TRUE;
+    pnpLog(LOG_STATE, STATE_WAIT, context -> part, "Time: %7.2f  New state: %.20s  Gantry Adjusted , waiting for next instruction\n", context -> snapshot.sim_time, state_name[STATE_WAIT]);
+    return STATE_WAIT;
+}
+
+static int manualLowerComponent(ControlContext *context, char c)
+{
+    lowerNozzle(context -> nozzle);
+    pnpLog(LOG_STATE, STATE_PLACE_COMPONENT, context -> part, "Time: %7.2f  New state: %.20s  Issued instruction to Place component \n", context -> snapshot.sim_time, state_name[STATE_PLACE_COMPONENT]);
+    return STATE_PLACE_COMPONENT;
+}
+
+static int manualRaiseHead(ControlContext *context, char c)
+{
+    raiseNozzle(context -> nozzle);
+    //Reset variables
+    context -> picked = FALSE;
+    context -> rotated = FALSE;
+    context -> adjusted = FALSE;
+    context -> camera = FALSE;
+    //increase counter
+    context -> part = context -> part + 1;
+    pnpLog(LOG_STATE, STATE_WAIT, context -> part, "Time: %7.2f  New state: %.20s  Component %.2f Placed, waiting for next instruction\n", context -> snapshot.sim_time, state_name[STATE_WAIT], context -> pi[context -> part - 1].component_value);
+
+    if (context -> part == context -> number_of_components_to_place) //check if there are any components to pick
+    {
+        context -> finished = TRUE;
+    }
+    else
+    {
+        logPartDetails(context, STATE_WAIT, "Part details");
+    }
+    return STATE_WAIT;
+}
+
+static int manualCompleted(ControlContext *context, char c)
+{
+    if (c != NO_KEY) pnpLog(LOG_ESSENTIAL, STATE_COMPLETED, context -> part, "Time: %7.2f  All components placed - press q to quit \n", context -> snapshot.sim_time);
+    return STATE_COMPLETED;
+}
+
+/* autonomous control mode, streaming the compiled program of the board */
+
+/*
+ Function: checkPicks
+ --------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ checks every nozzle of a batch against its lookup photo once it has been read. A pick has failed if the
+ photo shows no part on the nozzle, or the part is turned further than PICK_MAX_THETA_ERROR out of line.
+ A part that failed is dropped in the reject bin if it is on its nozzle and picked again in a later
+ batch, or left off the board once it has failed PICK_MAX_ATTEMPTS times. The rest of the program is
+ then repaired around it with repairProgram(), which leaves the batches already run alone, so a bad pick
+ costs one more pick rather than a replan
+ Argument(s):
+ ControlContext *context - the controller state, context -> vision holds the lookup photo results
+ int lookup - the step of the lookup photo
+ Return Value: none
+ Usage:
+ checkPicks(context, step);
+ */
+static void checkPicks(ControlContext *context, int lookup)
+{
+    PnPProgram *program = &context -> program;
+    BatchVision *vision = &context -> vision;
+    double sim_time = context -> snapshot.sim_time;
+    int outcome[NUMBER_OF_NOZZLES], parts[NUMBER_OF_NOZZLES], failed = FALSE, res;
+
+    /* the batches are replaced by the repair, so the parts are copied out first */
+    memcpy(parts, program -> batch[program -> step[lookup].batch].part, sizeof(parts));
+    for (int nozzle = 0; nozzle < NUMBER_OF_NOZZLES; nozzle++)
+    {
+        int part = parts[nozzle];
+
+        outcome[nozzle] = PICK_OK;
+        vision -> loaded[nozzle] = (part != NO_PICKED_PART);
+        vision -> carrying[nozzle] = vision -> loaded[nozzle] && (context -> snapshot.nozzles_carrying & NOZZLE_BIT(nozzle)) != 0;
+        if (!vision -> loaded[nozzle] || (vision -> carrying[nozzle] && fabs(vision -> theta_pick_error[nozzle]) <= PICK_MAX_THETA_ERROR)) continue;
+
+        if (context -> failed_picks == NULL) context -> failed_picks = calloc((size_t)program -> number_of_parts, sizeof(int));
+        if (context -> table == NULL || context -> failed_picks == NULL)
+        {
+            pnpLog(LOG_ESSENTIAL, STATE_TAKE_UP_PHOTO, part, "Time: %7.2f  Pick of component %s on %s nozzle failed and cannot be repaired\n", sim_time, context -> pi[part].component_designation, nozzle_name[nozzle]);
+            continue;
+        }
+        failed = TRUE;
+        outcome[nozzle] = (++context -> failed_picks[part] < PICK_MAX_ATTEMPTS) ? PICK_RETRY : PICK_SKIP;
+        if (vision -> carrying[nozzle])
         {
-            /* print details of part 0 */
+            pnpLog(LOG_ESSENTIAL, STATE_TAKE_UP_PHOTO, part, "Time: %7.2f  Pick of component %s on %s nozzle failed, rotation error %.2f degrees\n", sim_time, context -> pi[part].component_designation, nozzle_name[nozzle], vision -> theta_pick_error[nozzle]);
+        }
+        else pnpLog(LOG_ESSENTIAL, STATE_TAKE_UP_PHOTO, part, "Time: %7.2f  Pick of component %s on %s nozzle failed, no part on the nozzle\n", sim_time, context -> pi[part].component_designation, nozzle_name[nozzle]);
+    }
+    if (!failed) return;
 
-            c = getKey();
+    if (context -> matrix.number_of_sites == 0 && !buildMotionCostMatrix(context -> table, context -> profile, &context -> matrix)) res = PLAN_OUT_OF_MEMORY;
+    else res = repairProgram(program, context -> table, &context -> matrix, PLAN_OPTION_GANG_PICK, lookup, vision, outcome);
+    if (res != PLAN_OK)
+    {
+        pnpLog(LOG_ESSENTIAL, STATE_TAKE_UP_PHOTO, context -> part, "Time: %7.2f  Problem repairing the placement route, error code %d, the batch is placed as planned\n", sim_time, res);
+        return;
+    }
 
-            switch (state)
-            {
+    for (int nozzle = 0; nozzle < NUMBER_OF_NOZZLES; nozzle++)
+    {
+        int part = parts[nozzle];
 
-                /* Initial state - waits for correct feeder to be selected */
-                case HOME:
-
-					state = WAIT;
-					if (finished == FALSE && (c - '0') == pi[count].feeder)
-					                    {
-                        /* the expression (c - '0') obtains the integer value of the number key pressed */
-                        setTargetPos(TAPE_FEEDER_X[c - '0'], TAPE_FEEDER_Y[c - '0']);
-                        state = MOVE_TO_FEEDER;
-                        printf("Time: %7.2f  New state: %.20s  Issued instruction to move to tape feeder %c\n", getSimTime(), state_name[state], c);
-                    }
-                    else if (finished == FALSE && (c == '0' || c == '1' || c == '2' || c == '3' || c == '4' || c == '5' || c == '6' || c == '7' || c == '8' || c == '9') && (c - '0') != pi[count].feeder)
-                    {
-                        printf("Time: %7.2f  Feeder mismatch \n", getSimTime());
-                    }
-
-                    break;
-
-                case MOVE_TO_FEEDER:
-
-                    if (isSimulatorReadyForNextInstruction())
-                    {
-                        state = WAIT;
-                        printf("Time: %7.2f  New state: %.20s  Arrived at feeder, Press 'p' to pick\n", getSimTime(), state_name[state]);
-                    }
-                    break;
-
-                case WAIT:
-
-                    if (finished == TRUE) //check if there are any components to pick
-					{
-						printf("Time: %7.2f  All components placed - press q to quit \n", getSimTime());
-						state = COMPLETED;
-					}
-
-					if (finished == FALSE && (c - '0') == pi[count].feeder)
-					                    {
-                        /* the expression (c - '0') obtains the integer value of the number key pressed */
-                        setTargetPos(TAPE_FEEDER_X[c - '0'], TAPE_FEEDER_Y[c - '0']);
-                        state = MOVE_TO_FEEDER;
-                        printf("Time: %7.2f  New state: %.20s  Issued instruction to move to tape feeder %c\n", getSimTime(), state_name[state], c);
-                    }
-                    else if (finished == FALSE && (c == '0' || c == '1' || c == '2' || c == '3' || c == '4' || c == '5' || c == '6' || c == '7' || c == '8' || c == '9') && (c - '0') != pi[count].feeder)
-                    {
-                        printf("Time: %7.2f  Feeder mismatch \n", getSimTime());
-                    }
-
-					if (picked == FALSE && (c == 'p' || c == 'P'))
-					{
-						state = LOWER_NOZZLE;
-						printf("Time: %7.2f  New state: %.20s  Issued instruction to Lower Nozzle \n", getSimTime(), state_name[state]);
-					}
-					if (picked == TRUE && (c == 'c' || c == 'C')&& rotated == FALSE && camera == FALSE && adjusted == FALSE)
-					{
-						setTargetPos(-100,100);
-						state = MOVE_TO_CAMERA;
-						printf("Time: %7.2f  New state: %.20s  Issued instruction to Move to Camera \n", getSimTime(), state_name[state]);
-					}
-
-                    /* Rotate state - needs part picked and there to be an error after an up pic has been taken */
-					if (theta_pick_error[1] != 0 && (c == 'r' || c == 'R') && rotated == FALSE && picked == TRUE && camera == TRUE)
-					{
-						state = ROTATE;
-						printf("Time: %7.2f  New state: %.20s  Issued instruction to Rotate component \n", getSimTime(), state_name[state]);
-					}
-
-					/* Adjust state - needs part picked and there to be an error after a down pic has been taken */
-					if ((x_preplace_error != 0 || y_preplace_error != 0) && (c == 'a' || c == 'A') && adjusted == FALSE && picked == TRUE && camera == TRUE)
-					{
-						state = ADJUST;
-						printf("Time: %7.2f  New state: %.20s  Issued instruction to Adjust position of Gantry \n", getSimTime(), state_name[state]);
-					}
-					if ((c == 'p' || c == 'P') && picked == TRUE && rotated == TRUE && adjusted == TRUE)
-					{
-						state = LOWER_COMPONENT;
-						printf("Time: %7.2f  New state: %.20s  Issued instruction to Lower Nozzle \n", getSimTime(), state_name[state]);
-					}
-					if (picked == FALSE && (c == 'h' || c == 'H'))
-					{
-						setTargetPos(0,0);
-						if (isSimulatorReadyForNextInstruction())
-						state = HOME;
-						printf("Time: %7.2f  New state: %.20s  Issued instruction to Return Home \n", getSimTime(), state_name[state]);
-					}
-                    break;
-            	case LOWER_NOZZLE:
-
-                    if (isSimulatorReadyForNextInstruction())
-					{
-						lowerNozzle(1);
-						state = PICK_COMPONENT;
-						printf("Time: %7.2f  New state: %.20s  Issued instruction to pick Component \n", getSimTime(), state_name[state]);
-					}
-                    break;
-
-                case PICK_COMPONENT:
-
-                    if (isSimulatorReadyForNextInstruction())
-					{
-						applyVacuum(1);
-						state = RAISE_COMPONENT;
-						printf("Time: %7.2f  New state: %.20s  Issued instruction to Raise Nozzle \n", getSimTime(), state_name[state]);
-					}
-                    break;
-
-                case RAISE_COMPONENT:
-
-                    if (isSimulatorReadyForNextInstruction())
-					{
-						raiseNozzle(1);
-						state = WAIT;
-						picked = TRUE;
-						printf("Time: %7.2f  New state: %.20s  Component %.2f Picked. Press 'C' to move to camera and take photo\n", getSimTime(), state_name[state], pi[count].component_value);
-					}
-                    break;
-
-
-				case MOVE_TO_CAMERA:
-                    camera  = TRUE;
-                    if (isSimulatorReadyForNextInstruction())
-					{
-						state = TAKE_UP_PHOTO;
-						printf("Time: %7.2f  New state: %.20s  Issued instruction to Take Photo from Below \n", getSimTime(), state_name[state]);
-					}
-                    break;
-
-				case TAKE_UP_PHOTO:
-
-                    if (isSimulatorReadyForNextInstruction())
-					{
-						takePhoto(0);
-						sleepMilliseconds(1000);
-						theta_pick_error[1] = getPickErrorTheta(1);
-						if (theta_pick_error[1] == 0)
-                        {
-                            rotated = TRUE;
-                        }
-						printf("Time: %7.2f  Photo taken, Rotation error = %.2f \n", getSimTime(), theta_pick_error[1]);
-						setTargetPos(pi[count].x_target, pi[count].y_target);
-						state = MOVE_TO_PCB;
-						printf("Time: %7.2f  New state: %.20s  Issued instruction to move to PCB position x: %.2f y: %.2f \n", getSimTime(), state_name[state], pi[count].x_target, pi[count].y_target);
-					}
-                    break;
-
-				case MOVE_TO_PCB:
-
-                    if (isSimulatorReadyForNextInstruction())
-					{
-						printf("Time: %7.2f  Arrived at PCB position x: %.2f y: %.2f \n", getSimTime(), pi[count].x_target, pi[count].y_target);
-						state = TAKE_DOWN_PHOTO;
-						printf("Time: %7.2f  New state: %.20s  Issued instruction to Take Photo from Above \n", getSimTime(), state_name[state]);
-					}
-                    break;
-
-				case TAKE_DOWN_PHOTO:
-
-                    if (isSimulatorReadyForNextInstruction())
-					{
-						takePhoto(1);
-						sleepMilliseconds(1000);
-						x_preplace_error = getPreplaceErrorX();
-						y_preplace_error = getPreplaceErrorY();
-						if (x_preplace_error == 0 && y_preplace_error == 0)
-                        {
-                            adjusted = TRUE;
-                        }
-						state = WAIT;
-						printf("Time: %7.2f  New state: %.20s  Photos taken, Position error = x: %.2f y: %.2f\n", getSimTime(), state_name[state], x_preplace_error, y_preplace_error);
-                        if (theta_pick_error[1] != 0)
-                        {
-                                printf("Press 'R' to Rotate\n");
-                        }
-                        if (x_preplace_error != 0 || y_preplace_error != 0)
-                        {
-                            printf("Press 'A' to adjust gantry\n");
-                        }
-					}
-                    break;
-
-				case ROTATE:
-
-                    if (isSimulatorReadyForNextInstruction())
-					{
-
-						rotateAngle =  pi[count].theta_target - theta_pick_error[1];
-						rotateNozzle(1, rotateAngle);
-						rotated = TRUE;
-						state = WAIT;
-						printf("Time: %7.2f  New state: %.20s  Component Rotated , waiting for next instruction\n", getSimTime(), state_name[state]);
-					}
-                    break;
-
-				case ADJUST:
-
-                    if (isSimulatorReadyForNextInstruction())
-					{
-                        amendPos(x_preplace_error, y_preplace_error);
-						adjusted = TRUE;
-						state = WAIT;
-						printf("Time: %7.2f  New state: %.20s  Gantry Adjusted , waiting for next instruction\n", getSimTime(), state_name[state]);
-					}
-                    break;
-
-				case LOWER_COMPONENT:
-
-                    if (isSimulatorReadyForNextInstruction())
-					{
-						lowerNozzle(1);
-						state = PLACE_COMPONENT;
-						printf("Time: %7.2f  New state: %.20s  Issued instruction to Place component \n", getSimTime(), state_name[state]);
-					}
-                    break;
-
-				case PLACE_COMPONENT:
-
-                    if (isSimulatorReadyForNextInstruction())
-					{
-						releaseVacuum(1);
-						state = RAISE_HEAD;
-						printf("Time: %7.2f  New state: %.20s  Issued instruction to Raise Nozzle \n", getSimTime(), state_name[state]);
-					}
-                    break;
-
-				case RAISE_HEAD:
-
-                    if (isSimulatorReadyForNextInstruction())
-					{
-						raiseNozzle(1);
-						//Reset variables
-						state = WAIT;
-						picked = FALSE;
-						rotated = FALSE;
-						adjusted = FALSE;
-						camera = FALSE;
-						//increase counter
-						count = count + 1;
-						printf("Time: %7.2f  New state: %.20s  Component %.2f Placed, waiting for next instruction\n", getSimTime(), state_name[state], pi[count].component_value);
-
-						if (count == number_of_components_to_place) //check if there are any components to pick
-                        {
-                            finished = TRUE;
-                        }
-                        else if (count != number_of_components_to_place)
-                        {
-                            printf("Part details:\nDesignation: %s\nFootprint: %s\nValue: %.2f\nx: %.2f\ny: %.2f\ntheta: %.2f\nFeeder: %d\n\n",
-                            pi[count].component_designation, pi[count].component_footprint, pi[count].component_value, pi[count].x_target, pi[count].y_target, pi[count].theta_target, pi[count].feeder);
-                            printf("Time: %7.2f  select tape feeder to pick from \n", getSimTime());
-                        }
-
-					}
-                    break;
-
-                    case COMPLETED:
-
-                    if (isSimulatorReadyForNextInstruction())
-					{
-
-						while(!isPnPSimulationQuitFlagOn())
-                        {
-                            c = getKey();
-                            if(c != '\0')
-                            {
-                                printf("Time: %7.2f  All components placed - press q to quit \n", getSimTime());
-                            }
-                        }
-                        break;
-
-					}
-                    break;
+        if (outcome[nozzle] == PICK_OK) continue;
+        context -> rejected += vision -> carrying[nozzle];
+        if (outcome[nozzle] == PICK_RETRY)
+        {
+            context -> retried++;
+            pnpLog(LOG_STATE, STATE_TAKE_UP_PHOTO, part, "Time: %7.2f  Component %s is picked again later, attempt %d of %d\n", sim_time, context -> pi[part].component_designation, context -> failed_picks[part] + 1, PICK_MAX_ATTEMPTS);
+        }
+        else
+        {
+            context -> skipped++;
+            pnpLog(LOG_ESSENTIAL, STATE_TAKE_UP_PHOTO, part, "Time: %7.2f  Component %s skipped after %d failed picks\n", sim_time, context -> pi[part].component_designation, context -> failed_picks[part]);
+        }
+    }
+}
 
+/*
+ Function: freePickRecovery
+ --------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: frees what checkPicks() built to repair the program of a board
+ Argument(s):
+ ControlContext *context - the controller state
+ Return Value: none
+ Usage: freePickRecovery(&context);
+ */
+static void freePickRecovery(ControlContext *context)
+{
+    free(context -> failed_picks);
+    context -> failed_picks = NULL;
+    freeMotionCostMatrix(&context -> matrix);
+}
+
+/*
+ Function: readProgramPhoto
+ --------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ copies the results of a completed photo of the program from a single snapshot, the pick error of
+ every nozzle for a lookup photo, the preplace errors for a lookdown photo. The picks are checked
+ against a lookup photo, which may change the program from the step after the photo on
+ Argument(s):
+ ControlContext *context - the controller state, context -> vision is updated
+ int step - the step of the TAKE_PHOTO
+ Return Value: none
+ Usage:
+ readProgramPhoto(context, step -> dependency);
+ */
+static void readProgramPhoto(ControlContext *context, int step)
+{
+    const ProgramStep *photo = &context -> program.step[step];
+    BatchVision *vision = &context -> vision;
+
+    pnpSnapshot(&context -> snapshot);
+    if (photo -> argument_3 == PHOTO_LOOKUP)
+    {
+        for (int nozzle = 0; nozzle < NUMBER_OF_NOZZLES; nozzle++) vision -> theta_pick_error[nozzle] = context -> snapshot.theta_pick_error[nozzle];
+        pnpLog(LOG_STATE, photo -> state, photo -> part, "Time: %7.2f  Up Photo taken, Rotation error = left: %.2f centre: %.2f right: %.2f\n", context -> snapshot.sim_time,
+        vision -> theta_pick_error[LEFT_NOZZLE], vision -> theta_pick_error[CENTRE_NOZZLE], vision -> theta_pick_error[RIGHT_NOZZLE]);
+        vision -> sim_time = context -> snapshot.sim_time;
+        context -> photo_read = step;
+        checkPicks(context, step);
+        return;
+    }
+    else
+    {
+        vision -> x_preplace_error = context -> snapshot.x_preplace_error;
+        vision -> y_preplace_error = context -> snapshot.y_preplace_error;
+        pnpLog(LOG_STATE, photo -> state, photo -> part, "Time: %7.2f  Down Photo taken, Position error = x: %.2f y: %.2f\n", context -> snapshot.sim_time, vision -> x_preplace_error, vision -> y_preplace_error);
+    }
+    vision -> sim_time = context -> snapshot.sim_time;
+    context -> photo_read = step;
+}
+
+/*
+ Function: logProgramStep
+ ------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ logs a step of the program as it is passed to the simulator
+ Argument(s):
+ ControlContext *context - the controller state
+ const ProgramStep *step - the step, with its arguments resolved
+ Return Value: none
+ Usage:
+ logProgramStep(context, &resolved);
+ */
+static void logProgramStep(ControlContext *context, const ProgramStep *step)
+{
+    PlacementInfo *pi = context -> pi;
+    double sim_time = context -> snapshot.sim_time;
+    const char *name = state_name[step -> state];
+    const char *designation = (step -> part >= 0) ? pi[step -> part].component_designation : "";
+
+    switch (step -> instruction)
+    {
+        case MOVE_HEAD:
+            pnpLog(LOG_STATE, step -> state, step -> part, "Time: %7.2f  New state: %.20s  Issued instruction to move the head to x: %.2f y: %.2f\n", sim_time, name, step -> argument_1, step -> argument_2);
+            break;
+        case ROTATE_NOZZLE:
+            pnpLog(LOG_STATE, step -> state, step -> part, "Time: %7.2f  New state: %.20s  Issued instruction to rotate %s nozzle to %.2f for component %s\n", sim_time, name, nozzle_name[step -> argument_3], step -> argument_1, designation);
+            break;
+        case LOWER_NOZZLE:
+            pnpLog(LOG_STATE, step -> state, step -> part, "Time: %7.2f  New state: %.20s  Issued instruction to lower %s nozzle\n", sim_time, name, nozzle_name[step -> argument_3]);
+            break;
+        case RAISE_NOZZLE:
+            pnpLog(LOG_STATE, step -> state, step -> part, "Time: %7.2f  New state: %.20s  Issued instruction to raise %s nozzle\n", sim_time, name, nozzle_name[step -> argument_3]);
+            break;
+        case APPLY_VACUUM:
+            pnpLog(LOG_STATE, step -> state, step -> part, "Time: %7.2f  New state: %.20s  Issued instruction to pick component %s on %s nozzle\n", sim_time, name, designation, nozzle_name[step -> argument_3]);
+            break;
+        case RELEASE_VACUUM:
+            if (step -> state == STATE_REJECT_COMPONENT)
+            {
+                pnpLog(LOG_STATE, step -> state, step -> part, "Time: %7.2f  New state: %.20s  Issued instruction to drop component %s from %s nozzle into the reject bin\n", sim_time, name, designation, nozzle_name[step -> argument_3]);
+                break;
             }
-            sleepMilliseconds((long) 1000 / POLL_LOOP_RATE);
+            pnpLog(LOG_STATE, step -> state, step -> part, "Time: %7.2f  New state: %.20s  Issued instruction to place component %s from %s nozzle\n", sim_time, name, designation, nozzle_name[step -> argument_3]);
+            break;
+        case TAKE_PHOTO:
+            pnpLog(LOG_STATE, step -> state, step -> part, "Time: %7.2f  New state: %.20s  Issued instruction to take %s photo\n", sim_time, name, (step -> argument_3 == PHOTO_LOOKUP) ? "lookup" : "lookdown");
+            break;
+        case AMEND_HEAD_POSITION:
+            pnpLog(LOG_STATE, step -> state, step -> part, "Time: %7.2f  New state: %.20s  Issued instruction to adjust gantry, Position error = x: %.2f y: %.2f\n", sim_time, name, step -> argument_1, step -> argument_2);
+            break;
+    }
+}
+
+/*
+ Function: autoExecute
+ ---------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ passes the steps of the compiled program to the simulator for as long as it has room for them. A step
+ that depends on a photo waits for the simulator to finish it, as a dependent step always directly
+ follows its photo the photo is then the last instruction completed and its results are read from a
+ single snapshot. Every other step is posted without waiting, and every pick posted is counted off the
+ feeder inventory
+ Argument(s):
+ ControlContext *context - the controller state, context -> next_step is advanced
+ char c - unused, keys are left to the engine's quit handling
+ Return Value:
+ the state of the next step still to post, or STATE_COMPLETED once the whole program is posted
+ Usage:
+ state = autoExecute(context, c);
+ */
+static int autoExecute(ControlContext *context, char c)
+{
+    PnPProgram *program = &context -> program;
+    ProgramStep resolved;
+
+    while (context -> next_step < program -> number_of_steps)
+    {
+        const ProgramStep *step = &program -> step[context -> next_step];
+
+        if (step -> dependency != PROGRAM_NO_DEPENDENCY && step -> dependency != context -> photo_read)
+        {
+            if (!isSimulatorReadyForNextInstruction()) return step -> state;
+            readProgramPhoto(context, step -> dependency);
+            continue;  // a failed pick repairs the program from this step on
         }
+        if (getInstructionCapacity() == 0) return step -> state;
+
+        resolveProgramStep(step, &context -> vision, &resolved);
+        postProgramStep(&resolved);
+        context -> part = (step -> part >= 0) ? step -> part : context -> part;
+        logProgramStep(context, &resolved);
+        if (resolved.instruction == APPLY_VACUUM) countFeederPick(context, step -> state);
+        context -> next_step++;
     }
+    return STATE_COMPLETED;
+}
 
-	/* state machine code for autonomous control mode */
+/*
+ Function: logPickFailures
+ -------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: reports how the failed picks of a board were handled, if any pick failed
+ Argument(s):
+ ControlContext *context - the controller state
+ Return Value: none
+ Usage: logPickFailures(context);
+ */
+static void logPickFailures(ControlContext *context)
+{
+    if (context -> failed_picks == NULL) return;
+    pnpLog(LOG_ESSENTIAL, STATE_COMPLETED, context -> part, "Time: %7.2f  Failed picks: %d components rejected, %d picked again, %d skipped\n",
+           context -> snapshot.sim_time, context -> rejected, context -> retried, context -> skipped);
+}
+
+static int autoCompleted(ControlContext *context, char c)
+{
+    /* in a job the next board follows straight on, otherwise park the head, then report the cycle time once it is home and idle until the user quits */
+    if (context -> more_boards)
+    {
+        logPickFailures(context);
+        context -> board_finished = TRUE;
+        return STATE_COMPLETED;
+    }
+    if (context -> parked == FALSE)
+    {
+        setTargetPos(0,0);
+        waitForInstructionCompletion();
+        pnpSnapshot(&context -> snapshot);
+        logPickFailures(context);
+        context -> parked = TRUE;
+    }
+    else if (c == NO_KEY) return STATE_COMPLETED;
+
+    pnpLog(LOG_ESSENTIAL, STATE_COMPLETED, context -> part, "Time: %7.2f  All components placed - press q to quit \n", context -> snapshot.sim_time);
+    logFlush();
+    return STATE_COMPLETED;
+}
+
+/* the transition table of each mode, indexed by state */
+static const StateTransition manual_transitions[NUMBER_OF_STATES] = { PNP_STATES(MANUAL_TRANSITION) };
+static const StateTransition auto_transitions[NUMBER_OF_STATES] = { PNP_STATES(AUTO_TRANSITION) };
+
+/*
+ Function: logAutoBoard
+ ----------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ logs how a board was prepared for autonomous mode, the planned route and its batches if it was just
+ compiled or the program loaded from the cache
+ Argument(s):
+ ControlContext *context - the controller state
+ JobBoard *board - the prepared board
+ Return Value: none
+ Usage:
+ logAutoBoard(&context, board);
+ */
+static void logAutoBoard(ControlContext *context, JobBoard *board)
+{
+    PlacementInfo *pi = context -> pi;
+    PlacementPlan *plan = &board -> plan;
+    PnPProgram *program = &board -> program;
+
+    pnpLog(LOG_STATE, STATE_HOME, 0, "Time: %7.2f  Operating in Auto control mode, there are %d parts to place in %d batches\n", context -> snapshot.sim_time, context -> number_of_components_to_place, program -> number_of_batches);
+    if (board -> cached)
+    {
+        pnpLog(LOG_STATE, STATE_HOME, 0, "Time: %7.2f  Loaded %d compiled instructions from %s, planned gantry travel %.0f mm\n\n", context -> snapshot.sim_time, program -> number_of_steps, board -> cache_file, program -> planned_travel);
+        return;
+    }
+
+    pnpLog(LOG_STATE, STATE_HOME, 0, "Time: %7.2f  Planned gantry travel %.0f mm, feeder order travel %.0f mm, %d head moves saved by gang picking\n", context -> snapshot.sim_time, plan -> planned_travel, plan -> naive_travel, plan -> head_moves_saved);
+    pnpLog(LOG_STATE, STATE_HOME, 0, "Time: %7.2f  Estimated cycle time %.2f s, feeder order %.2f s\n", context -> snapshot.sim_time, plan -> planned_time, plan -> naive_time);
+    for (int b = 0; b < plan -> number_of_batches; b++)
+    {
+        for (int k = 0; k < plan -> batch[b].number_of_parts; k++)
+        {
+            int p = plan -> batch[b].part[plan -> batch[b].pick_order[k]];
+            pnpLog(LOG_DETAIL, STATE_HOME, p, "Batch %d %s nozzle part %d details:\nDesignation: %s\nFootprint: %s\nValue: %.2f\nx: %.2f\ny: %.2f\ntheta: %.2f\nFeeder: %d\n\n",
+            b, nozzle_name[plan -> batch[b].pick_order[k]], p, pi[p].component_designation, pi[p].component_footprint, pi[p].component_value, pi[p].x_target, pi[p].y_target, pi[p].theta_target, pi[p].feeder);
+        }
+    }
+    pnpLog(LOG_STATE, STATE_HOME, 0, "Time: %7.2f  Compiled %d instructions%s%s\n\n", context -> snapshot.sim_time, program -> number_of_steps, board -> saved ? ", saved to " : "", board -> saved ? board -> cache_file : "");
+}
+
+/*
+ Function: reportCentroidProblem
+ -------------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ prints why a board's centroid file could not be read, with the line and column of the problem if known
+ Argument(s):
+ const JobBoard *board - the board
+ const char *action - what happens next, e.g. "press any key to continue"
+ Return Value: none
+ Usage:
+ reportCentroidProblem(board, "board skipped");
+ */
+static void reportCentroidProblem(const JobBoard *board, const char *action)
+{
+    const CentroidError *error = &board -> error;
+    int res = board -> centroid_result;
+
+    if (error -> line > 0) printf("Problem with centroid file, error code %d at line %d column %d: %s, %s\n", res, error -> line, error -> column, error -> message, action);
+    else if (error -> message[0] != '\0') printf("Problem with centroid file, error code %d: %s, %s\n", res, error -> message, action);
+    else printf("Problem with centroid file, error code %d, %s\n", res, action);
+}
+
+/*
+ Function: logFeederForecast
+ ---------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ warns the operator of every tracked reel that runs out within the boards still to place, with the
+ board it runs out on and roughly how long until it does, so a new reel can be ready in time
+ Argument(s):
+ const FeederInventory *inventory - the inventory
+ const int picks[][NUMBER_OF_FEEDERS] - the parts each board still to place takes from each feeder, from the next board on
+ const double time[] - the estimated cycle time in s of each board
+ int number_of_boards - the number of boards forecast
+ int first_board - the number the operator knows the first board forecast by, from 1
+ Return Value: none
+ Usage:
+ logFeederForecast(inventory, picks, time, boards, b + 1);
+ */
+static void logFeederForecast(const FeederInventory *inventory, const int picks[][NUMBER_OF_FEEDERS], const double time[], int number_of_boards, int first_board)
+{
+    FeederForecast forecast[NUMBER_OF_FEEDERS];
+
+    forecastFeederInventory(inventory, picks, time, number_of_boards, forecast);
+    for (int f = 0; f < NUMBER_OF_FEEDERS; f++)
+    {
+        if (forecast[f].board == FEEDER_NEVER) continue;
+        if (inventory -> remaining[f] == 0) pnpLog(LOG_ESSENTIAL, STATE_HOME, 0, "Time: %7.2f  Feeder %d is out of parts, board %d needs %d of them\n", getSimTime(), f, first_board + forecast[f].board, picks[forecast[f].board][f]);
+        else pnpLog(LOG_ESSENTIAL, STATE_HOME, 0, "Time: %7.2f  Feeder %d has %d parts left, it runs out on board %d in about %.0f s\n",
+               getSimTime(), f, inventory -> remaining[f], first_board + forecast[f].board, forecast[f].time);
+    }
+}
+
+/*
+ Function: deferStarvedBatches
+ -----------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ moves the batches of a program that would pick from a reel after it has run out to the end of the
+ route, so the other feeders keep placing while the reel is spliced. If memory runs out the program is
+ run as it is
+ Argument(s):
+ const FeederInventory *inventory - the inventory
+ const PlacementTable *table - the parts of the board the program was compiled from
+ PnPProgram *program - the program, not yet started
+ Return Value: none
+ Usage:
+ deferStarvedBatches(inventory, &board -> table, &board -> program);
+ */
+static void deferStarvedBatches(const FeederInventory *inventory, const PlacementTable *table, PnPProgram *program)
+{
+    int *starved = malloc(sizeof(int) * (program -> number_of_batches > 0 ? (size_t)program -> number_of_batches : 1));
+    unsigned int feeders;
+    int count;
+
+    if (starved == NULL) return;
+    count = findStarvedBatches(inventory, table, program, starved, &feeders);
+    if (count > 0 && deferProgramBatches(program, table, starved) == PLAN_OK)
+    {
+        for (int f = 0; f < NUMBER_OF_FEEDERS; f++)
+        {
+            if (feeders & (1u << f)) pnpLog(LOG_ESSENTIAL, STATE_HOME, 0, "Time: %7.2f  Feeder %d runs out on this board, the batches it starves are placed last so the other feeders keep placing while it is spliced\n", getSimTime(), f);
+        }
+        pnpLog(LOG_STATE, STATE_HOME, 0, "Time: %7.2f  %d of %d batches moved to the end of the route, %d instructions\n", getSimTime(), count, program -> number_of_batches, program -> number_of_steps);
+    }
+    free(starved);
+}
+
+/*
+ Function: runBoard
+ ------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ places one prepared board, in manual mode as the user directs and in autonomous mode by streaming its
+ compiled program. A board that could not be read or planned is reported instead. In a job of several
+ boards every board but the last ends as soon as it is placed, and manual mode boards are skipped as
+ they would stop the job to wait for the user. Every pick is counted off the feeder inventory, and in
+ autonomous mode the batches that would pick from a reel after it runs out are placed last
+ Argument(s):
+ JobBoard *board - the prepared board
+ int more_boards - TRUE if another board of the job follows this one
+ int single_board - TRUE when the job is a single board, so problems wait for a key as they always have
+ FeederInventory *inventory - the feeder inventory, NULL if no feeder is tracked
+ Return Value:
+ an int, 0 if the board was placed, otherwise the centroid file or planning error code
+ Usage:
+ res = runBoard(&job.board[b], b + 1 < job.number_of_boards, job.number_of_boards == 1, inventory);
+ */
+static int runBoard(JobBoard *board, int more_boards, int single_board, FeederInventory *inventory)
+{
+    const char *action = single_board ? "press any key to continue" : "board skipped";
+    int res = board -> centroid_result;
+
+    logFlush();  // problems go straight to the console, after the log lines of the boards before
+    if (res != CENTROID_FILE_PRESENT_AND_READ)
+    {
+        reportCentroidProblem(board, action);
+        return res;
+    }
+    if (board -> operation_mode == MANUAL_CONTROL && !single_board)
+    {
+        printf("Manual control mode centroid file in a job, %s\n", action);
+        return CENTROID_FILE_PRESENT_BUT_CONTENT_ISSUE;
+    }
+    if (board -> plan_result != PLAN_OK)
+    {
+        printf("Problem planning the placement route, error code %d, %s\n", board -> plan_result, action);
+        return board -> plan_result;
+    }
+
+    /* initialization of variables and controller window */
+    ControlContext context;
+    memset(&context, 0, sizeof(context));
+    context.pi = board -> store.pi;
+    context.number_of_components_to_place = board -> store.count;
+    context.inventory = inventory;
+    pnpSnapshot(&context.snapshot);
+
+    /* state machine for manual control mode */
+    if (board -> operation_mode == MANUAL_CONTROL)
+    {
+        context.nozzle = CENTRE_NOZZLE;
+
+        pnpLog(LOG_STATE, STATE_HOME, 0, "Time: %7.2f  Initial state: %.15s  Operating in manual control mode, there are %d parts to place\n\n", context.snapshot.sim_time, state_name[STATE_HOME], context.number_of_components_to_place);
+        logPartDetails(&context, STATE_HOME, "Part 0 details");
+
+        /* loop until user quits, only the states that wait for the user take keys, keys typed while the machine is busy stay queued for them */
+        runStateMachine(manual_transitions, STATE_HOME, &context);
+    }
+
+	/* state machine for autonomous control mode */
     //*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
 	//
 	//*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
 	//
 	//*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
 	//
-	//*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
 
 	else
     {
+        /* the program was loaded from the cache or planned and compiled when the board was prepared, it is streamed to the simulator here */
+        logAutoBoard(&context, board);
+        freePlacementPlan(&board -> plan);
+        if (inventory != NULL) deferStarvedBatches(inventory, &board -> table, &board -> program);
+
+        context.program = board -> program;
+        context.table = &board -> table;
+        context.profile = board -> profile;
+        context.photo_read = -1;
+        context.more_boards = more_boards;
+        runStateMachine(auto_transitions, STATE_HOME, &context);
+
+        /* a failed pick may have repaired the program, which moves its steps */
+        board -> program = context.program;
+        freePickRecovery(&context);
+    }
+    return 0;
+}
+
+/*
+ Function: runLineMachine
+ ------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ the control thread of one machine of a line. Plans and compiles the machine's share of the board,
+ streams it to the machine's simulator through the session bound to the thread, then parks the head.
+ The program is not cached, as the cache holds a single board. The batches that would pick from a
+ reel after it runs out are placed last
+ Argument(s):
+ void *argument - the LineMachine, its result and cycle time are set
+ Return Value: NULL
+ Usage:
+ pthread_create(&machine[k].thread, NULL, runLineMachine, &machine[k]);
+ */
+static void *runLineMachine(void *argument)
+{
+    LineMachine *machine = (LineMachine*)argument;
+    ControlContext context;
+    PlacementTable table;
+    PlacementPlan plan;
+
+    pnpSessionBind(machine -> session);
+    memset(&context, 0, sizeof(context));
+    memset(&plan, 0, sizeof(plan));
+
+    if (buildPlacementTable(machine -> pi, machine -> count, &table))
+    {
+        machine -> result = planPlacement(&table, machine -> profile, PLAN_OPTION_GANG_PICK | PLAN_OPTION_MULTI_START, &plan);
+        if (machine -> result == PLAN_OK) machine -> result = compileProgram(&table, &plan, machine -> profile, PLAN_OPTION_GANG_PICK, &context.program);
+    }
+    else machine -> result = PLAN_OUT_OF_MEMORY;
 
-        while(!isPnPSimulationQuitFlagOn())
+    if (machine -> result == PLAN_OK)
+    {
+        context.pi = machine -> pi;
+        context.table = &table;
+        context.profile = machine -> profile;
+        context.number_of_components_to_place = machine -> count;
+        context.photo_read = -1;
+        context.more_boards = TRUE;  // the board ends without waiting for the user, who quits the whole line
+        context.inventory = machine -> inventory;
+        pnpSnapshot(&context.snapshot);
+        pnpLog(LOG_STATE, STATE_HOME, 0, "Time: %7.2f  Machine %d: %d parts to place in %d batches, planned gantry travel %.0f mm, estimated %.2f s, %d instructions\n",
+               context.snapshot.sim_time, machine -> machine, machine -> count, context.program.number_of_batches, plan.planned_travel, plan.planned_time, context.program.number_of_steps);
+        if (machine -> inventory != NULL) deferStarvedBatches(machine -> inventory, &table, &context.program);
+
+        runStateMachine(auto_transitions, STATE_HOME, &context);
+        if (!isPnPSimulationQuitFlagOn())
         {
-            /* print details of part 0 */
+            setTargetPos(0,0);
+            waitForInstructionCompletion();
+        }
+        machine -> cycle_time = getSimTime();
+        freePickRecovery(&context);
+    }
+    freeProgram(&context.program);
+    freePlacementPlan(&plan);
+    freePlacementTable(&table);
+    atomic_fetch_sub(&machines_running, 1);
+    return NULL;
+}
 
-            c = getKey();
+/*
+ Function: runLine
+ -----------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ places one autonomous mode board with a line of machines. A session is opened with each machine's
+ simulator, the board's feeders are balanced across the machines and every machine with parts to place
+ is driven by its own control thread, while the calling thread reads the keyboard so that q stops the
+ whole line. The line's cycle time is that of its slowest machine. Tracing is left off, the trace
+ follows a single control loop. The feeder inventory is forecast with each machine's own cycle time, as
+ the machines place in parallel, and written back once the line stops
+ Argument(s):
+ JobBoard *board - the board, read from its centroid file here
+ int machines - the number of machines, 2 to PNP_MAX_SESSIONS
+ FeederInventory *inventory - the feeder inventory, NULL if no feeder is tracked
+ Return Value:
+ an int, 0 if the board was placed, otherwise the centroid file or planning error code
+ Usage:
+ res = runLine(&job.board[0], machines, inventory);
+ */
+static int runLine(JobBoard *board, int machines, FeederInventory *inventory)
+{
+    LineMachine machine[PNP_MAX_SESSIONS];
+    LineBalance balance;
+    char shared_file[PNP_PATH_LENGTH], notify_fifo[PNP_PATH_LENGTH];
+    double line_time = 0.0;
+    int res = 0;
+
+    memset(machine, 0, sizeof(machine));
+    for (int k = 0; k < machines; k++)
+    {
+        lineSessionFiles(k, shared_file, notify_fifo);
+        machine[k].session = pnpSessionOpen(shared_file, notify_fifo, k == 0);
+        machine[k].machine = k;
+        machine[k].profile = board -> profile;
+        machine[k].inventory = inventory;
+    }
+    pnpSessionBind(machine[0].session);
+    logOpen();
 
-            switch (state)
-            {
+    if (board -> path == JOB_WORKING_DIRECTORY_BOARD) board -> centroid_result = getCentroidFileContents(&board -> operation_mode, &board -> store, &board -> error);
+    else board -> centroid_result = loadCentroidFile(board -> path, &board -> operation_mode, &board -> store, &board -> error);
 
-                /* Initial state - waits for correct feeder to be selected */
-                case HOME:
-
-                        if (pickedCount == 0)//initial loop, display components to place
-                        {
-                            //sort the centroid file and print it to the terminal
-                            qsort (pi, number_of_components_to_place, sizeof(PlacementInfo), compare);
-                            printf("Time: %7.2f  Operating in Auto control mode, there are %d parts to place\n\n", getSimTime(), number_of_components_to_place);
-                            for(int k = 0; k < number_of_components_to_place; k++)
-                            {
-                                printf("Part %d details:\nDesignation: %s\nFootprint: %s\nValue: %.2f\nx: %.2f\ny: %.2f\ntheta: %.2f\nFeeder: %d\n\n",
-                                k, pi[k].component_designation, pi[k].component_footprint, pi[k].component_value, pi[k].x_target, pi[k].y_target, pi[k].theta_target, pi[k].feeder);
-                            }
-                        }
-                        //all components pplaced
-                        if (placedCount == number_of_components_to_place)
-                        {
-
-                            state = COMPLETED;
-                            break;
-
-                        }
-
-                        //all components picked
-						if (pickedCount == number_of_components_to_place)//exit and place components when no more to pick
-						{
-							picked = TRUE;
-						}
-
-                        //nozzles are not full
-						if (picked == FALSE)//pick 3 components
-                        {
-                            if(i == 0)
-                            {
-                                offset = 20;
-                            }
-                            if(i == 1)
-                            {
-                                offset = 0;
-                            }
-                            if(i == 2)
-                            {
-                                offset = -20;
-                            }
-
-                            setTargetPos(TAPE_FEEDER_X[pi[pickedCount].feeder]+offset, TAPE_FEEDER_Y[pi[pickedCount].feeder]);
-                            printf("Time: %7.2f  New state: %.20s  Issued instruction to move to tape feeder %d\n", getSimTime(), state_name[state], pi[pickedCount].feeder);
-                            state = MOVE_TO_FEEDER;
-                        }
-
-                        //all nozzles have a part or no parts left to pick
-						if (picked == TRUE)
-                        {
-							state = ROTATE;
-							if (autoPicked[0] == TRUE)
-							{
-								i = 0;
-								break;
-							}
-							if (autoPicked[1] == TRUE)
-							{
-								i = 1;
-								break;
-							}
-							if (autoPicked[2] == TRUE)
-							{
-								i = 2;
-								break;
-							}
-						}
-
-					break;
-
-				case MOVE_TO_FEEDER:
-
-					if (isSimulatorReadyForNextInstruction())
-					{
-						state = LOWER_NOZZLE;
-						printf("Time: %7.2f  New state: %.20s  Arrived at feeder, Ready to pick\n", getSimTime(), state_name[state]);
-					}
-					break;
-
-				case LOWER_NOZZLE:
-
-                    if (isSimulatorReadyForNextInstruction())
-					{
-						lowerNozzle(i);
-						state = PICK_COMPONENT;
-						printf("Time: %7.2f  New state: %.20s  Issued instruction to pick Component \n", getSimTime(), state_name[state]);
-					}
-					break;
-
-                case PICK_COMPONENT:
-
-                    if (isSimulatorReadyForNextInstruction())
-					{
-						applyVacuum(i);
-						state = RAISE_COMPONENT;
-						printf("Time: %7.2f  New state: %.20s  Issued instruction to Raise Nozzle \n", getSimTime(), state_name[state]);
-					}
-					break;
-
-                case RAISE_COMPONENT:
-
-                    if (isSimulatorReadyForNextInstruction())
-					{
-						raiseNozzle(i);
-						autoPicked[i] = TRUE;
-						pickedCount++;
-						printf("Time: %7.2f  New state: %.20s  Component Picked \n", getSimTime(), state_name[state]);
-						if (i < 2)
-						{
-							i++;
-							state = HOME;
-						}
-						else if (i == 2)
-						{
-							i = 0;
-							picked = TRUE;
-							state = TAKE_UP_PHOTO;
-						}
-					}
-					break;
-
-				case TAKE_UP_PHOTO:
-
-                    if (isSimulatorReadyForNextInstruction())
-					{
-						takePhoto(0);
-						state = HOME;
-						printf("Time: %7.2f  Up Photo taken\n", getSimTime());
-					}
-					break;
-
-				case ROTATE:
-
-                    if (isSimulatorReadyForNextInstruction())
-					{
-                        theta_pick_error[i] = getPickErrorTheta(i);
-						rotateAngle =  pi[placedCount].theta_target - theta_pick_error[i];
-						rotateNozzle(i, rotateAngle);
-						state = MOVE_TO_PCB;
-						printf("Time: %7.2f  New state: %.20s  Component Rotation = %.2f error = %.2f Total = %.2f  \n", getSimTime(), state_name[state], pi[placedCount].theta_target, theta_pick_error[i], rotateAngle);
-					}
-					break;
-
-				case MOVE_TO_PCB:
-
-                    if (isSimulatorReadyForNextInstruction())
-					{
-						setTargetPos(pi[placedCount].x_target, pi[placedCount].y_target);
-						state = TAKE_DOWN_PHOTO;
-						printf("Time: %7.2f  New state: %.20s  Issued instruction to Take Photo from Above \n", getSimTime(), state_name[state]);
-					}
-					break;
-
-				case TAKE_DOWN_PHOTO:
-
-                    if (isSimulatorReadyForNextInstruction())
-					{
-						takePhoto(1);
-						state = ADJUST;
-						printf("Time: %7.2f  New state: %.20s  Photos taken\n", getSimTime(), state_name[state]);
-
-					}
-					break;
-
-				case ADJUST:
-
-                    if (isSimulatorReadyForNextInstruction())
-					{
-						amendPos(x_preplace_error, y_preplace_error);
-						state = LOWER_COMPONENT;
-						printf("Time: %7.2f  New state: %.20s  Gantry Adjusted, Position error = x: %.2f y: %.2f\n", getSimTime(), state_name[state], x_preplace_error, y_preplace_error);
-					}
-                    break;
-
-				case LOWER_COMPONENT:
-
-                    if (isSimulatorReadyForNextInstruction())
-					{
-						lowerNozzle(i);
-						state = PLACE_COMPONENT;
-						printf("Time: %7.2f  New state: %.20s  Issued instruction to Place component \n", getSimTime(), state_name[state]);
-					}
-                    break;
-
-				case PLACE_COMPONENT:
-
-                    if (isSimulatorReadyForNextInstruction())
-					{
-						releaseVacuum(i);
-						state = RAISE_HEAD;
-						printf("Time: %7.2f  New state: %.20s  Issued instruction to Raise Nozzle \n", getSimTime(), state_name[state]);
-					}
-                    break;
-
-				case RAISE_HEAD:
-
-                    if (isSimulatorReadyForNextInstruction())
-					{
-						raiseNozzle(i);
-						//increase counter
-						placedCount++;
-						printf("Time: %7.2f  New state: %.20s  Component %d Placed, waiting for next instruction\n", getSimTime(), state_name[state], placedCount);
-
-						//Reset variables
-						state = HOME;
-						autoPicked[i] = FALSE;
-
-						if (i == 2)
-						{
-							//all nozzles empty, reset flag and counter
-							picked = FALSE;
-							i = 0;
-						}
-
-						if (placedCount == number_of_components_to_place) //check if there are any components to pick
-                        {
-                            state = COMPLETED;
-                            break;
-                        }
-
-					}
-                    break;
-
-                case COMPLETED:
-
-                    if (isSimulatorReadyForNextInstruction())
-                    {
-                        setTargetPos(0,0);
-                        printf("All components places - hit q to quit\n");
-                        while(!isPnPSimulationQuitFlagOn())
-                        {
-                            c = getKey();
-                            if(c != '\0')
-                            {
-                                printf("Time: %7.2f  All components placed - press q to quit \n", getSimTime());
-                            }
-                        }
-					}
-					break;
+    res = board -> centroid_result;
+    if (res != CENTROID_FILE_PRESENT_AND_READ) reportCentroidProblem(board, "press any key to continue");
+    else if (board -> operation_mode != AUTONOMOUS_CONTROL)
+    {
+        printf("Manual control mode centroid file for a line of machines, press any key to continue\n");
+        res = CENTROID_FILE_PRESENT_BUT_CONTENT_ISSUE;
+    }
+    else if ((res = balanceLine(board -> store.pi, board -> store.count, machines, board -> profile, &balance)) != PLAN_OK) printf("Problem planning the placement route, error code %d, press any key to continue\n", res);
 
-            }
-            sleepMilliseconds((long) 1000 / POLL_LOOP_RATE);
+    for (int k = 0; k < machines && res == 0; k++)
+    {
+        machine[k].pi = machinePlacements(board -> store.pi, board -> store.count, &balance, k, &machine[k].count);
+        if (machine[k].pi == NULL)
+        {
+            printf("Problem planning the placement route, error code %d, press any key to continue\n", PLAN_OUT_OF_MEMORY);
+            res = PLAN_OUT_OF_MEMORY;
+        }
+    }
+    if (res != 0)
+    {
+        waitForKey();
+        logClose();
+        for (int k = machines - 1; k >= 0; k--)
+        {
+            free(machine[k].pi);
+            pnpSessionClose(machine[k].session);
         }
+        return res;
+    }
 
+    pnpLog(LOG_STATE, STATE_HOME, 0, "Time: %7.2f  Operating in Auto control mode with a line of %d machines, there are %d parts to place, estimated cycle time %.2f s\n",
+           getSimTime(), machines, board -> store.count, balance.bottleneck_time);
+    for (int k = 0; k < machines; k++)
+    {
+        char feeders[2 * NUMBER_OF_FEEDERS + 1];
+        int length = 0;
 
+        feeders[0] = '\0';
+        for (int f = 0; f < NUMBER_OF_FEEDERS; f++)
+        {
+            if (balance.machine_of_feeder[f] == k) length += snprintf(feeders + length, sizeof(feeders) - length, "%s%d", (length > 0) ? "," : "", f);
+        }
+        pnpLog(LOG_STATE, STATE_HOME, 0, "Time: %7.2f  Machine %d: feeders %s, %d parts, estimated %.2f s\n", getSimTime(), k, (length > 0) ? feeders : "none", balance.machine_parts[k], balance.machine_time[k]);
+    }
+    for (int k = 0; k < machines && inventory != NULL; k++)
+    {
+        int picks[1][NUMBER_OF_FEEDERS];
+
+        for (int f = 0; f < NUMBER_OF_FEEDERS; f++) picks[0][f] = (balance.machine_of_feeder[f] == k) ? balance.feeder_parts[f] : 0;
+        logFeederForecast(inventory, picks, &balance.machine_time[k], 1, 1);
+    }
+    pnpLog(LOG_STATE, STATE_HOME, 0, "\n");
+
+    for (int k = 0; k < machines; k++)
+    {
+        if (machine[k].count == 0) continue;
+        atomic_fetch_add(&machines_running, 1);
+        machine[k].started = pthread_create(&machine[k].thread, NULL, runLineMachine, &machine[k]) == 0;
+        if (machine[k].started == FALSE)
+        {
+            atomic_fetch_sub(&machines_running, 1);
+            machine[k].result = PLAN_OUT_OF_MEMORY;
+        }
+    }
+
+    /* the keys are read here, a q sets the quit flag of every machine */
+    while (atomic_load(&machines_running) > 0 && !isPnPSimulationQuitFlagOn())
+    {
+        if (waitForEvents(PNP_EVENT_KEY, LINE_SUPERVISE_INTERVAL_MS) & PNP_EVENT_KEY) getKey();
+    }
+    for (int k = 0; k < machines; k++)
+    {
+        if (machine[k].started) pthread_join(machine[k].thread, NULL);
+    }
+
+    logFlush();  // problems go straight to the console, after the log lines of the machines
+    if (inventory != NULL && !saveFeederInventory(FEEDER_INVENTORY_FILE, inventory)) printf("Problem writing the feeder inventory to " FEEDER_INVENTORY_FILE "\n");
+    for (int k = 0; k < machines; k++)
+    {
+        if (machine[k].count == 0) continue;
+        if (machine[k].result != PLAN_OK)
+        {
+            printf("Problem planning the placement route of machine %d, error code %d\n", k, machine[k].result);
+            res = machine[k].result;
+        }
+        else if (!isPnPSimulationQuitFlagOn()) pnpLog(LOG_STATE, STATE_COMPLETED, 0, "Time: %7.2f  Machine %d placed %d parts\n", machine[k].cycle_time, k, machine[k].count);
+        if (machine[k].cycle_time > line_time) line_time = machine[k].cycle_time;
+    }
+    if (res == 0 && !isPnPSimulationQuitFlagOn())
+    {
+        pnpLog(LOG_ESSENTIAL, STATE_COMPLETED, 0, "Time: %7.2f  All components placed - press q to quit \n", line_time);
+        logFlush();
+        while (!isPnPSimulationQuitFlagOn() && waitForKey() != NO_KEY);
+    }
+
+    logClose();
+    for (int k = machines - 1; k >= 0; k--)
+    {
+        free(machine[k].pi);
+        pnpSessionClose(machine[k].session);
+    }
+    return res;
+}
+
+/*
+ Function: forecastJob
+ ---------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ forecasts the feeder inventory over the boards of a job from the one about to be placed on. A board
+ not yet read takes the parts and cycle time of an earlier board read from the same file, and the
+ forecast ends at the first board not known that way. The next board is not looked at, as it is being
+ prepared in the background. A board that is skipped takes nothing
+ Argument(s):
+ const PnPJob *job - the job
+ int b - the board about to be placed, already prepared
+ const FeederInventory *inventory - the inventory
+ Return Value: none
+ Usage:
+ forecastJob(&job, b, &inventory);
+ */
+static void forecastJob(const PnPJob *job, int b, const FeederInventory *inventory)
+{
+    int (*picks)[NUMBER_OF_FEEDERS] = malloc(sizeof(*picks) * (size_t)(job -> number_of_boards - b));
+    double *time = malloc(sizeof(double) * (size_t)(job -> number_of_boards - b));
+    int boards = 0;
+
+    for (int j = b; picks != NULL && time != NULL && j < job -> number_of_boards; j++)
+    {
+        const JobBoard *known = NULL;
+
+        for (int i = (j == b) ? b : 0; i <= b && known == NULL; i++)
+        {
+            const JobBoard *board = &job -> board[i];
+            if (board -> path == job -> board[j].path && board -> centroid_result == CENTROID_FILE_PRESENT_AND_READ) known = board;
+        }
+        if (known == NULL) break;
+        if (known -> operation_mode == AUTONOMOUS_CONTROL ? known -> plan_result == PLAN_OK : job -> number_of_boards == 1)
+        {
+            memcpy(picks[boards], known -> feeder_picks, sizeof(picks[boards]));
+            time[boards++] = known -> planned_time;
+        }
+        else
+        {
+            memset(picks[boards], 0, sizeof(picks[boards]));
+            time[boards++] = 0.0;
+        }
+    }
+    if (boards > 0) logFeederForecast(inventory, picks, time, boards, b + 1);
+    free(picks);
+    free(time);
+}
+
+/*
+ * Usage: Assgn1_2021_Controller [-p columns,rows,x step,y step] [-m machines] [-c motion profile] [centroid file ...]
+ * With no centroid files the board is read from the working directory as it always has been. Several
+ * files, or a panel repeating each board on a grid of offsets, run as one job in a single session.
+ * With -m a single board is placed by a line of machines, machine k > 0 being the simulator started with
+ * -m pnp_shared_file.k. Routes are planned for the default simulator's motion unless -c gives a motion
+ * profile, for which the simulator's own config file will do. The parts left on each feeder's reel
+ * are read from FEEDER_INVENTORY_FILE, if there is one, and written back as they are picked
+ */
+int main(int argc, char *argv[])
+{
+    JobPanel panel = {1, 1, 0.0, 0.0};
+    MotionProfile profile;
+    PnPJob job;
+    FeederInventory inventory;
+    int option, machines = 1, placed = 0, res = 0;
+
+    defaultMotionProfile(&profile);
+    while ((option = getopt(argc, argv, "p:m:c:h")) != -1)
+    {
+        if (option == 'p' && parseJobPanel(optarg, &panel)) continue;
+        if (option == 'm' && sscanf(optarg, "%d", &machines) == 1 && machines >= 1 && machines <= PNP_MAX_SESSIONS) continue;
+        if (option == 'c' && loadMotionProfile(optarg, &profile)) continue;
+        printf("Usage: %s [-p columns,rows,x step,y step] [-m machines, at most %d] [-c motion profile] [centroid file ...]\n", argv[0], PNP_MAX_SESSIONS);
+        exit(option == 'h' ? 0 : 1);
+    }
+    if (!buildJob(argv + optind, argc - optind, &panel, &profile, &job))
+    {
+        printf("A job can have at most %d boards\n", JOB_MAX_BOARDS);
+        exit(1);
+    }
+    loadFeederInventory(FEEDER_INVENTORY_FILE, &inventory);  // a problem is printed and the run goes on without an inventory
+    if (machines > 1)
+    {
+        if (job.number_of_boards > 1)
+        {
+            printf("A line of machines places a single board\n");
+            exit(1);
+        }
+        res = runLine(&job.board[0], machines, inventory.tracked ? &inventory : NULL);
+        freeJob(&job);
+        return res;
+    }
+
+    pnpOpen();
+    traceOpen(state_name, NUMBER_OF_STATES);
+    logOpen();
+
+    /*
+     * read the centroid file to obtain the operation mode, number of components to place
+     * and the placement information for those components, then plan and compile it. Each
+     * following board of a job is prepared in the background while this one is placed
+     */
+    prepareJobBoard(&job.board[0]);
+    for (int b = 0; b < job.number_of_boards && !isPnPSimulationQuitFlagOn(); b++)
+    {
+        JobBoard *board = &job.board[b];
+        double start_time = getSimTime();
+
+        finishJobBoard(board);
+        if (b + 1 < job.number_of_boards) startJobBoard(&job.board[b + 1]);
+
+        if (job.number_of_boards > 1) pnpLog(LOG_ESSENTIAL, STATE_HOME, 0, "Time: %7.2f  Board %d of %d: %s, offset x: %.2f y: %.2f\n", start_time, b + 1, job.number_of_boards,
+                                             board -> path == JOB_WORKING_DIRECTORY_BOARD ? CENTROID_FILE : board -> path, board -> x_offset, board -> y_offset);
+        if (inventory.tracked) forecastJob(&job, b, &inventory);
+        res = runBoard(board, b + 1 < job.number_of_boards, job.number_of_boards == 1, inventory.tracked ? &inventory : NULL);
+        if (res == 0 && job.number_of_boards > 1 && !isPnPSimulationQuitFlagOn()) pnpLog(LOG_ESSENTIAL, STATE_COMPLETED, 0, "Time: %7.2f  Board %d placed in %.2f s\n", getSimTime(), b + 1, getSimTime() - start_time);
+        placed += (res == 0);
+        freeJobBoard(board);
+        if (!saveFeederInventory(FEEDER_INVENTORY_FILE, &inventory)) printf("Problem writing the feeder inventory to " FEEDER_INVENTORY_FILE "\n");
+
+        if (res != 0 && job.number_of_boards == 1)
+        {
+            waitForKey();
+            freeJob(&job);
+            pnpClose();
+            exit(res);
+        }
     }
+    if (job.number_of_boards > 1) pnpLog(LOG_ESSENTIAL, STATE_COMPLETED, 0, "Time: %7.2f  Job finished, %d of %d boards placed\n", getSimTime(), placed, job.number_of_boards);
 
+    logClose();
+    freeJob(&job);
+    traceClose(getSimTime());
     pnpClose();
     return 0;
 }
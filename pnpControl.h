@@ -7,16 +7,25 @@
  *
  */
 
+#ifndef PNP_CONTROL_H
+#define PNP_CONTROL_H
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <limits.h>
+#include <string.h>
 #include <fcntl.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <time.h>
 #include <pthread.h>
 #include <termios.h>
 #include <math.h>
 #include <stdbool.h>
+#include <stdatomic.h>
 
 #define MANUAL_CONTROL 1
 #define AUTONOMOUS_CONTROL 2
@@ -24,7 +33,6 @@
 #define MEMORY_MAPPED_FILE "pnp_shared_file"
 #define CENTROID_FILE "centroid.txt"
 
-#define MAX_NUMBER_OF_COMPONENTS_TO_PLACE 100
 #define NUMBER_OF_FIELDS_IN_PLACEMENT_INFO 7
 
 #define CENTROID_FILE_PRESENT_AND_READ 0
@@ -42,16 +50,21 @@
 #define NUMBER_OF_FEEDERS 10
 #define NO_PICKED_PART -1
 #define NO_TAPE_FEEDER_AT_THIS_LOCATION -1
-#define FDR_0_X +50.0
-#define FDR_1_X +150.0
-#define FDR_2_X +250.0
-#define FDR_3_X +350.0
-#define FDR_4_X +450.0
-#define FDR_5_X +550.0
-#define FDR_6_X +650.0
-#define FDR_7_X +750.0
-#define FDR_8_X +850.0
-#define FDR_9_X +950.0
+#define SHIPPED_FEEDER_PITCH 100.0         // mm between neighbouring feeders of the shipped simulator, which cannot report its layout
+#ifndef FEEDER_PITCH
+#define FEEDER_PITCH SHIPPED_FEEDER_PITCH  // build the controller and simulator with -DFEEDER_PITCH=NOZZLE_X_SEPARATION for feeders that gang pick, a session between builds that differ is refused
+#endif
+#define FEEDER_POSITION_X(pitch, feeder) (+50.0 + (feeder) * (pitch))
+#define FDR_0_X FEEDER_POSITION_X(FEEDER_PITCH, 0)
+#define FDR_1_X FEEDER_POSITION_X(FEEDER_PITCH, 1)
+#define FDR_2_X FEEDER_POSITION_X(FEEDER_PITCH, 2)
+#define FDR_3_X FEEDER_POSITION_X(FEEDER_PITCH, 3)
+#define FDR_4_X FEEDER_POSITION_X(FEEDER_PITCH, 4)
+#define FDR_5_X FEEDER_POSITION_X(FEEDER_PITCH, 5)
+#define FDR_6_X FEEDER_POSITION_X(FEEDER_PITCH, 6)
+#define FDR_7_X FEEDER_POSITION_X(FEEDER_PITCH, 7)
+#define FDR_8_X FEEDER_POSITION_X(FEEDER_PITCH, 8)
+#define FDR_9_X FEEDER_POSITION_X(FEEDER_PITCH, 9)
 #define FDR_0_Y -100.0
 #define FDR_1_Y -100.0
 #define FDR_2_Y -100.0
@@ -68,20 +81,52 @@
 #define PHOTO_LOOKUP 0
 #define PHOTO_LOOKDOWN 1
 
-#define POLL_LOOP_RATE 20          // poll loops per second was 50 - DANGER, changing this can result in unstable or incorrect operation
+#define PNP_PROTOCOL_MAGIC 0x33504E50u     // "PNP3" marks an initialised protocol extension in the memory mapped file, "PNP2" files had a lock that was not robust
+#define PNP_PROTOCOL_LEGACY 1              // original single slot protocol, no completion signalling
+#define PNP_PROTOCOL_SIGNALLED 2           // single slot plus a completion counter, the simulator blocks on instruction_posted
+#define PNP_PROTOCOL_RING 3                // single-producer/single-consumer instruction ring plus completion counter
+#define PNP_PROTOCOL_TELEMETRY 4           // seqlock protected telemetry block, read in one go with pnpSnapshot()
+#define PNP_PROTOCOL_CONCURRENT 5          // ring instructions carry resource masks, non-conflicting ones may execute at the same time
+#define PNP_PROTOCOL_NOTIFY 6              // the simulator also writes a byte to PNP_NOTIFY_FIFO whenever an instruction completes
+#define PNP_PROTOCOL_PART_PRESENCE 7       // the lookup photo also reports which nozzles are carrying a part
+#define PNP_PROTOCOL_VERSION PNP_PROTOCOL_PART_PRESENCE  // highest protocol version supported by this controller
+#define PNP_NOTIFY_FIFO "pnp_notify_fifo"  // created and read by the controller, so it can wait on the simulator with poll()
+#define PNP_PATH_LENGTH 256                // longest shared file or FIFO path, including the null terminator
+#define PNP_MAX_SESSIONS 8                 // simulators one controller can drive at the same time
+#define PNP_COMMAND_RING_SIZE 64           // instructions that can be queued ahead of the simulator, must be a power of two
+#define PNP_NEGOTIATION_TIMEOUT_MS 500     // how long pnpOpen() waits for a running simulator to acknowledge the extension
+#define LEGACY_SIMULATOR_SETTLE_MS 50      // a version 1 simulator gives no acknowledgement, an instruction is only assumed to have been picked up after this long
+#define LEGACY_POLL_INTERVAL_MS 2          // how often waitForEvents() checks the completion counter of a simulator that does not write to PNP_NOTIFY_FIFO, protocols 1 to 5 or a FIFO that could not be opened
+#define SIMULATOR_READY_TIMEOUT_MS 1000    // upper bound on a single blocking wait in the control loop
 
 #define TRUE 1
 #define FALSE 0
 
 #define NO_KEY 0
+#define KEY_QUEUE_SIZE 64                  // key presses that can wait for the control loop, further ones are dropped
+
+#define PNP_EVENT_KEY 0x01                 // a key press is waiting to be taken with getKey()
+#define PNP_EVENT_SIMULATOR_READY 0x02     // every instruction posted has completed
+#define PNP_EVENT_INSTRUCTION_COMPLETED 0x04   // at least one instruction has completed since the wait started
+#define PNP_EVENT_TIMEOUT 0x08
+#define PNP_EVENT_QUIT 0x10                // the quit flag is set, always reported
+#define PNP_EVENT_INPUT_ENDED 0x20         // there will be no more key presses
 
 #define NUMBER_OF_NOZZLES 3
 #define LEFT_NOZZLE 0
 #define CENTRE_NOZZLE 1
 #define RIGHT_NOZZLE 2
 
+#define NOZZLE_BIT(nozzle) (1u << (nozzle))
+#define ALL_NOZZLE_BITS (NOZZLE_BIT(LEFT_NOZZLE) | NOZZLE_BIT(CENTRE_NOZZLE) | NOZZLE_BIT(RIGHT_NOZZLE))
+
 #define NOZZLE_X_SEPARATION 20
 
+#define RESOURCE_GANTRY 0x01               // gantry motion, also held by anything that needs the head to stay still
+#define RESOURCE_CAMERA 0x02
+#define RESOURCE_NOZZLE(nozzle) (0x04 << (nozzle))
+#define RESOURCE_ALL_NOZZLES (RESOURCE_NOZZLE(LEFT_NOZZLE) | RESOURCE_NOZZLE(CENTRE_NOZZLE) | RESOURCE_NOZZLE(RIGHT_NOZZLE))
+
 #define NO_INSTRUCTION 0
 #define MOVE_HEAD 1
 #define ROTATE_NOZZLE 2
@@ -92,6 +137,29 @@
 #define TAKE_PHOTO 7
 #define AMEND_HEAD_POSITION 8
 
+typedef struct
+{
+    int instruction;
+    double argument_1;
+    double argument_2;
+    int argument_3;
+    unsigned int resources;     // RESOURCE_ mask, with PNP_PROTOCOL_CONCURRENT the simulator starts an instruction as soon as
+                                // no earlier instruction still executing holds any of these resources, completion stays in order
+
+} PnPInstruction;
+
+typedef struct
+{
+    double sim_time;
+    double theta_pick_error[NUMBER_OF_NOZZLES];
+    double x_preplace_error;
+    double y_preplace_error;
+    unsigned long instructions_completed;
+    unsigned int nozzles_carrying;  // NOZZLE_BIT mask of the nozzles the most recent lookup photo saw a part on, all
+                                    // of them before PNP_PROTOCOL_PART_PRESENCE, which cannot tell
+
+} PnPSnapshot;
+
 typedef struct
 {
     double sim_time;
@@ -105,8 +173,44 @@ typedef struct
     int instruction_argument_3;
     int quit;
 
+    /* protocol extension - appended after the original fields so that version 1 simulators, which only map the fields above, are unaffected */
+    unsigned int protocol_magic;                    // PNP_PROTOCOL_MAGIC once the controller has initialised the fields below
+    unsigned int layout_size;                       // sizeof(PnP) of the controller that initialised the extension
+    unsigned int controller_protocol_version;       // highest protocol version the controller supports
+    atomic_uint simulator_protocol_version;         // written by the simulator when it attaches, 0 for a version 1 simulator
+    pthread_mutex_t ready_lock;                     // process-shared and robust, protects the instruction counters and instruction_posted
+    pthread_cond_t instruction_posted;              // signalled by the controller whenever an instruction is posted
+    atomic_ulong instructions_issued;               // incremented by the controller for every instruction posted, also the ring write index
+    atomic_ulong instructions_completed;            // incremented by the simulator for every instruction completed, also the ring read index
+    PnPInstruction command_ring[PNP_COMMAND_RING_SIZE]; // slot (n % PNP_COMMAND_RING_SIZE) holds instruction n, only used with PNP_PROTOCOL_RING
+    atomic_uint telemetry_sequence;                 // seqlock sequence, odd while the simulator is writing the telemetry block
+    PnPSnapshot telemetry;                          // consistent copy of the sensor fields, only used with PNP_PROTOCOL_TELEMETRY
+    char notify_fifo[PNP_PATH_LENGTH];              // FIFO the simulator opens at the start of the session, empty unless PNP_PROTOCOL_NOTIFY is offered
+    double feeder_x[NUMBER_OF_FEEDERS];             // TAPE_FEEDER_X of the controller, written when it starts a session
+    double simulator_feeder_x[NUMBER_OF_FEEDERS];   // feeder positions of the simulator, written before it acknowledges the session
+
 } PnP;
 
+typedef struct
+{
+    int loaded[NUMBER_OF_NOZZLES];              // TRUE for the nozzles that carried a part when the lookup photo was taken
+    double theta_pick_error[NUMBER_OF_NOZZLES]; // pick error of each loaded nozzle, 0 for an empty nozzle
+    int carrying[NUMBER_OF_NOZZLES];            // TRUE for the loaded nozzles the lookup photo actually saw a part on
+    double x_preplace_error;                    // from the most recent lookdown photo
+    double y_preplace_error;
+    double sim_time;                            // simulation time when the most recent photo completed
+
+} BatchVision;
+
+typedef struct
+{
+    char key;
+    struct timespec pressed;                    // CLOCK_MONOTONIC time the key was read
+
+} KeyEvent;
+
+typedef struct PnPSession PnPSession;      // one simulator driven by the controller, defined in pnpControlInterface.c
+
 typedef struct
 {
     char component_designation[10];
@@ -123,8 +227,6 @@ struct termios setTerminalSettings();
 
 void resetTerminalSettings(struct termios);
 
-int getCentroidFileContents(int*, int*, PlacementInfo[]);
-
 void setTargetPos(double, double);
 
 void amendPos(double, double);
@@ -141,10 +243,18 @@ void releaseVacuum(int);
 
 void takePhoto(int);
 
+PnPSession *pnpSessionOpen(const char*, const char*, int);
+
+void pnpSessionClose(PnPSession*);
+
+void pnpSessionBind(PnPSession*);
+
 void pnpOpen();
 
 void pnpClose();
 
+void pnpSnapshot(PnPSnapshot*);
+
 double getSimTime();
 
 double getPreplaceErrorX();
@@ -159,10 +269,40 @@ double getPickErrorTheta(int);
 
 int isSimulatorReadyForNextInstruction();
 
+int waitForSimulatorReady(long);
+
+int getProtocolVersion();
+
+int getInstructionCapacity();
+
+unsigned int instructionResources(int, int);
+
+int waitForInstructionCompletion();
+
+void clearBatchVision(BatchVision*);
+
+int captureLookupPhoto(BatchVision*);
+
+int captureLookdownPhoto(BatchVision*);
+
 char getKey();
 
+int getKeyEvent(KeyEvent*);
+
+char waitForKey();
+
+int waitForEvents(int, long);
+
+int waitForKeyOrSimulatorReady(long);
+
 int isPnPSimulationQuitFlagOn();
 
 void sleepMilliseconds(long);
 
 int compare (const void * a, const void * b);
+
+extern const double TAPE_FEEDER_X[NUMBER_OF_FEEDERS];
+
+extern const double TAPE_FEEDER_Y[NUMBER_OF_FEEDERS];
+
+#endif // PNP_CONTROL_H
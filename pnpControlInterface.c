@@ -3,19 +3,43 @@
  * pnpControlInterface.c - the interface routines for pick and place machine control, which simplify
  * interfacing to the simulator
  *
- * This program creates a shared memory segment with the simulator via a memory mapped file
+ * This program creates a shared memory segment with the simulator via a memory mapped file. Each
+ * simulator is a PnPSession, the interface routines act on the session bound to the calling thread
  *
  * Platform: Any POSIX compliant platform
  * Intended for and tested on: Cygwin 64 bit
  *
  */
 
+#include <errno.h>
+#include <poll.h>
 #include "pnpControl.h"
-PnP *pnp;
-int fd;
-struct termios old_term;
-pthread_t key_thread;
-char key_pressed;
+#include "pnpTrace.h"
+struct PnPSession
+{
+    PnP *pnp;                                   // the memory mapped file shared with the session's simulator
+    int fd;
+    int notify_fd;                              // read end of the session's notification FIFO, the simulator writes a byte to it as each instruction completes
+    int keyboard;                               // TRUE for the session that set the terminal settings, a q quits every open session
+    int protocol_version;
+    struct timespec last_instruction_posted;
+    unsigned long instructions_posted;
+    struct termios old_term;                    // restored when a keyboard session is closed
+
+};
+
+static _Thread_local PnPSession *session;       // the session the calling thread drives, see pnpSessionBind()
+static _Thread_local int keyboard_thread;       // TRUE on the thread that opened the keyboard session, the only one that reads and takes keys
+static PnPSession *open_sessions[PNP_MAX_SESSIONS];
+static pthread_mutex_t open_sessions_lock = PTHREAD_MUTEX_INITIALIZER;
+static KeyEvent key_queue[KEY_QUEUE_SIZE];
+static unsigned long keys_queued;
+static unsigned long keys_taken;
+static unsigned long keys_dropped;        // reported when the keyboard session is closed
+static int key_input_ended;               // set once stdin reaches the end of input, it is not polled after that
+
+const double TAPE_FEEDER_X[NUMBER_OF_FEEDERS] = {FDR_0_X, FDR_1_X, FDR_2_X, FDR_3_X, FDR_4_X, FDR_5_X, FDR_6_X, FDR_7_X, FDR_8_X, FDR_9_X};
+const double TAPE_FEEDER_Y[NUMBER_OF_FEEDERS] = {FDR_0_Y, FDR_1_Y, FDR_2_Y, FDR_3_Y, FDR_4_Y, FDR_5_Y, FDR_6_Y, FDR_7_Y, FDR_8_Y, FDR_9_Y};
 
 /*
  Function: setTerminalSettings
@@ -71,54 +95,169 @@ void resetTerminalSettings(struct termios old_term) {
 }
 
 /*
- Function: getCentroidFileContents
- ---------------------------------
- Written by Jason Brown
- Date: 19/05/2021
+ Function: millisecondsSince
+ ---------------------------
+ Date: 17/10/2026
  Version 1.0
  Purpose:
- gets the contents of the centroid file (including placement info of components) if it exists in the
- current working directory and if its contents are valid.
+ gets the number of milliseconds of monotonic clock time elapsed since a previously recorded time
  Argument(s):
- The following arguments are passed by reference and so are available to the calling function:
- int *operation_mode - a pointer to an integer variable representing the operation mode (manual or auto)
- int *number_of_components_to_place - a pointer to an integer variable representing the number of components to place
- PlacementInfo pi[] - a pointer to an array of structures, with each structure representing the placement info of one component
+ const struct timespec *then - the previously recorded CLOCK_MONOTONIC time
  Return Value:
- one of:
- CENTROID_FILE_PRESENT_AND_READ (0)
- CENTROID_FILE_NOT_PRESENT (-1)
- CENTROID_FILE_PRESENT_BUT_CONTENT_ISSUE (-2)
- CENTROID_FILE_HAS_TOO_MANY_COMPONENTS (-3)
+ a long representing the elapsed time in ms
  Usage:
- int res = getCentroidFileContents(&operation_mode, &number_of_components_to_place, placementInfo);
+ long elapsed = millisecondsSince(&session -> last_instruction_posted);
  */
-int getCentroidFileContents(int *operation_mode, int *number_of_components_to_place, PlacementInfo pi[MAX_NUMBER_OF_COMPONENTS_TO_PLACE])
+static long millisecondsSince(const struct timespec *then)
 {
+    struct timespec now;
 
-    char dummy_char = 'z';
-    char * operation_mode_char = &dummy_char;
-
-    FILE *fp = fopen(CENTROID_FILE, "r");
-
-    if (fp == NULL) return CENTROID_FILE_NOT_PRESENT;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - then -> tv_sec) * 1000 + (now.tv_nsec - then -> tv_nsec) / 1000000;
+}
 
-    if (fscanf(fp, "%c", operation_mode_char) != 1) {fclose(fp); return CENTROID_FILE_PRESENT_BUT_CONTENT_ISSUE;}
+/*
+ Function: lockReadyLock
+ -----------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ takes the process-shared lock of a session's shared file. The lock is robust, so one left held by a
+ simulator or controller that died is taken over and marked consistent rather than deadlocking every
+ later process on the file. The counters it guards are atomic and a new session rewrites the rest, so
+ there is nothing to repair
+ Argument(s):
+ PnP *pnp - the session's memory mapped file
+ Return Value: none
+ Usage:
+ lockReadyLock(pnp);
+ */
+static void lockReadyLock(PnP *pnp)
+{
+    if (pthread_mutex_lock(&pnp -> ready_lock) == EOWNERDEAD) pthread_mutex_consistent(&pnp -> ready_lock);
+}
 
-    if (*operation_mode_char == 'm' || *operation_mode_char == 'M') *operation_mode = MANUAL_CONTROL;
-    else if (*operation_mode_char == 'a' || *operation_mode_char == 'A') *operation_mode = AUTONOMOUS_CONTROL;
-    else {fclose(fp); return CENTROID_FILE_PRESENT_BUT_CONTENT_ISSUE;}
+/*
+ Function: instructionResources
+ ------------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ gets the machine resources an instruction occupies while it executes. Gantry moves only hold the
+ gantry, so nozzle rotations can run while the head travels. Lowering, raising and the vacuum hold their
+ nozzle and the gantry, since the head must not move while a nozzle is working. A lookup photo images
+ every nozzle so no nozzle may rotate during it, a lookdown photo only needs the head to stay still
+ Argument(s):
+ int instruction - the instruction, e.g. MOVE_HEAD
+ int argument_3 - the instruction's third argument (the nozzle or camera)
+ Return Value:
+ an unsigned int mask of RESOURCE_ flags
+ Usage:
+ unsigned int resources = instructionResources(ROTATE_NOZZLE, nozzle);
+ */
+unsigned int instructionResources(int instruction, int argument_3)
+{
+    switch (instruction)
+    {
+        case MOVE_HEAD:
+        case AMEND_HEAD_POSITION:
+            return RESOURCE_GANTRY;
+
+        case ROTATE_NOZZLE:
+            return RESOURCE_NOZZLE(argument_3);
+
+        case LOWER_NOZZLE:
+        case RAISE_NOZZLE:
+        case APPLY_VACUUM:
+        case RELEASE_VACUUM:
+            return RESOURCE_GANTRY | RESOURCE_NOZZLE(argument_3);
+
+        case TAKE_PHOTO:
+            if (argument_3 == PHOTO_LOOKUP) return RESOURCE_GANTRY | RESOURCE_CAMERA | RESOURCE_ALL_NOZZLES;
+            return RESOURCE_GANTRY | RESOURCE_CAMERA;
+    }
+    return RESOURCE_GANTRY | RESOURCE_CAMERA | RESOURCE_ALL_NOZZLES;
+}
 
-    if (fscanf(fp, "%i", number_of_components_to_place) != 1) {fclose(fp); return CENTROID_FILE_PRESENT_BUT_CONTENT_ISSUE;}
-    if (*number_of_components_to_place > MAX_NUMBER_OF_COMPONENTS_TO_PLACE) {fclose(fp); return CENTROID_FILE_HAS_TOO_MANY_COMPONENTS;}
+/*
+ Function: postInstruction
+ -------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ passes an instruction and its arguments to the simulator, arguments that are not used by the
+ instruction should be passed as zero. With PNP_PROTOCOL_RING the instruction is appended to the
+ command ring (waiting for a free slot if the ring is full) so that several instructions can be queued
+ ahead of the simulator, tagged with the resources it occupies so that a PNP_PROTOCOL_CONCURRENT simulator
+ can overlap it with earlier instructions that do not conflict. Otherwise there is a single instruction slot, so the call waits until the
+ simulator has finished the previous instruction before writing it. With PNP_PROTOCOL_SIGNALLED the
+ instruction counter is then advanced and the simulator woken, with a version 1 simulator the
+ instruction is written last so that the simulator never sees a partially written set of arguments
+ Argument(s):
+ int instruction - the instruction to execute, e.g. MOVE_HEAD
+ double argument_1 - the first instruction argument
+ double argument_2 - the second instruction argument
+ int argument_3 - the third instruction argument
+ Return Value: none
+ Usage:
+ postInstruction(LOWER_NOZZLE, 0.0, 0.0, nozzle);
+ */
+static void postInstruction(int instruction, double argument_1, double argument_2, int argument_3)
+{
+    PnP *pnp = session -> pnp;
+    uint64_t began = isTracing() ? traceNow() : 0;
 
-    for (int i = 0; i < *number_of_components_to_place; i++)
+    if (session -> protocol_version >= PNP_PROTOCOL_RING)
+    {
+        unsigned long issued = atomic_load_explicit(&pnp -> instructions_issued, memory_order_relaxed);
+
+        /* the slot being written must have been completed, only the simulator can free it */
+        if (issued - atomic_load_explicit(&pnp -> instructions_completed, memory_order_acquire) >= PNP_COMMAND_RING_SIZE)
+        {
+            while (issued - atomic_load(&pnp -> instructions_completed) >= PNP_COMMAND_RING_SIZE && !pnp -> quit)
+            {
+                waitForEvents(PNP_EVENT_INSTRUCTION_COMPLETED, SIMULATOR_READY_TIMEOUT_MS);
+            }
+        }
+
+        PnPInstruction *slot = &pnp -> command_ring[issued % PNP_COMMAND_RING_SIZE];
+        slot -> instruction = instruction;
+        slot -> argument_1 = argument_1;
+        slot -> argument_2 = argument_2;
+        slot -> argument_3 = argument_3;
+        slot -> resources = instructionResources(instruction, argument_3);
+        atomic_store_explicit(&pnp -> instructions_issued, issued + 1, memory_order_release);
+
+        /* the lock is only taken to avoid a lost wakeup, the simulator checks the write index while holding it */
+        lockReadyLock(pnp);
+        pthread_cond_signal(&pnp -> instruction_posted);
+        pthread_mutex_unlock(&pnp -> ready_lock);
+    }
+    else if (session -> protocol_version >= PNP_PROTOCOL_SIGNALLED)
     {
-        if (fscanf(fp, "%s %s %lf %lf %lf %lf %i", &pi[i].component_designation[0], &pi[i].component_footprint[0], &pi[i].component_value, &pi[i].x_target, &pi[i].y_target, &pi[i].theta_target, &pi[i].feeder) != NUMBER_OF_FIELDS_IN_PLACEMENT_INFO) {fclose(fp); return CENTROID_FILE_PRESENT_BUT_CONTENT_ISSUE;};
+        while (!waitForSimulatorReady(SIMULATOR_READY_TIMEOUT_MS) && !pnp -> quit);
+
+        lockReadyLock(pnp);
+        pnp -> instruction_argument_1 = argument_1;
+        pnp -> instruction_argument_2 = argument_2;
+        pnp -> instruction_argument_3 = argument_3;
+        pnp -> instruction_to_execute = instruction;
+        atomic_fetch_add(&pnp -> instructions_issued, 1);
+        pthread_cond_signal(&pnp -> instruction_posted);
+        pthread_mutex_unlock(&pnp -> ready_lock);
     }
-    fclose(fp);
-    return CENTROID_FILE_PRESENT_AND_READ;
+    else
+    {
+        while (!waitForSimulatorReady(SIMULATOR_READY_TIMEOUT_MS) && !pnp -> quit);
 
+        pnp -> instruction_argument_1 = argument_1;
+        pnp -> instruction_argument_2 = argument_2;
+        pnp -> instruction_argument_3 = argument_3;
+        atomic_thread_fence(memory_order_release);
+        pnp -> instruction_to_execute = instruction;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &session -> last_instruction_posted);
+    traceInstructionPosted(instruction, argument_3, session -> instructions_posted++, began);
 }
 
 /*
@@ -141,10 +280,7 @@ int getCentroidFileContents(int *operation_mode, int *number_of_components_to_pl
 void setTargetPos(double x_target, double y_target)
 {
 
-    pnp -> instruction_argument_1 = x_target;
-    pnp -> instruction_argument_2 = y_target;
-    pnp -> instruction_argument_3 = 0; // instruction_argument_3 is not used with the MOVE_HEAD instruction
-    pnp -> instruction_to_execute = MOVE_HEAD;
+    postInstruction(MOVE_HEAD, x_target, y_target, 0);
 
 }
 
@@ -168,10 +304,7 @@ void setTargetPos(double x_target, double y_target)
 void amendPos(double del_x, double del_y)
 {
 
-    pnp -> instruction_argument_1 = del_x;
-    pnp -> instruction_argument_2 = del_y;
-    pnp -> instruction_argument_3 = 0; // instruction_argument_3 is not used with the AMEND_HEAD instruction
-    pnp -> instruction_to_execute = AMEND_HEAD_POSITION;
+    postInstruction(AMEND_HEAD_POSITION, del_x, del_y, 0);
 
 }
 
@@ -194,10 +327,7 @@ void amendPos(double del_x, double del_y)
 void lowerNozzle(int nozzle)
 {
 
-    pnp -> instruction_argument_1 = 0.0;    // instruction_argument_1 is not used with the LOWER_NOZZLE instruction
-    pnp -> instruction_argument_2 = 0.0;    // instruction_argument_2 is not used with the LOWER_NOZZLE instruction
-    pnp -> instruction_argument_3 = nozzle;
-    pnp -> instruction_to_execute = LOWER_NOZZLE;
+    postInstruction(LOWER_NOZZLE, 0.0, 0.0, nozzle);
 
 }
 
@@ -220,10 +350,7 @@ void lowerNozzle(int nozzle)
 void raiseNozzle(int nozzle)
 {
 
-    pnp -> instruction_argument_1 = 0.0;    // instruction_argument_1 is not used with the RAISE_NOZZLE instruction
-    pnp -> instruction_argument_2 = 0.0;    // instruction_argument_2 is not used with the RAISE_NOZZLE instruction
-    pnp -> instruction_argument_3 = nozzle;
-    pnp -> instruction_to_execute = RAISE_NOZZLE;
+    postInstruction(RAISE_NOZZLE, 0.0, 0.0, nozzle);
 
 }
 
@@ -247,10 +374,7 @@ void raiseNozzle(int nozzle)
 void rotateNozzle(int nozzle, double angleInDegrees)
 {
 
-    pnp -> instruction_argument_1 = angleInDegrees;
-    pnp -> instruction_argument_2 = 0.0;    // instruction_argument_2 is not used with the ROTATE_NOZZLE instruction
-    pnp -> instruction_argument_3 = nozzle;
-    pnp -> instruction_to_execute = ROTATE_NOZZLE;
+    postInstruction(ROTATE_NOZZLE, angleInDegrees, 0.0, nozzle);
 
 }
 
@@ -273,10 +397,7 @@ void rotateNozzle(int nozzle, double angleInDegrees)
 void applyVacuum(int nozzle)
 {
 
-    pnp -> instruction_argument_1 = 0.0;    // instruction_argument_1 is not used with the APPLY_VACUUM instruction
-    pnp -> instruction_argument_2 = 0.0;    // instruction_argument_2 is not used with the APPLY_VACUUM instruction
-    pnp -> instruction_argument_3 = nozzle;
-    pnp -> instruction_to_execute = APPLY_VACUUM;
+    postInstruction(APPLY_VACUUM, 0.0, 0.0, nozzle);
 
 }
 
@@ -299,10 +420,7 @@ void applyVacuum(int nozzle)
 void releaseVacuum(int nozzle)
 {
 
-    pnp -> instruction_argument_1 = 0.0;    // instruction_argument_1 is not used with the RELEASE_VACUUM instruction
-    pnp -> instruction_argument_2 = 0.0;    // instruction_argument_2 is not used with the RELEASE_VACUUM instruction
-    pnp -> instruction_argument_3 = nozzle;
-    pnp -> instruction_to_execute = RELEASE_VACUUM;
+    postInstruction(RELEASE_VACUUM, 0.0, 0.0, nozzle);
 
 }
 
@@ -325,81 +443,289 @@ void releaseVacuum(int nozzle)
 void takePhoto(int camera)
 {
 
-    pnp -> instruction_argument_1 = 0.0;    // instruction_argument_1 is not used with the TAKE_PHOTO instruction
-    pnp -> instruction_argument_2 = 0.0;    // instruction_argument_2 is not used with the TAKE_PHOTO instruction
-    pnp -> instruction_argument_3 = camera;
-    pnp -> instruction_to_execute = TAKE_PHOTO;
+    postInstruction(TAKE_PHOTO, 0.0, 0.0, camera);
 
 }
 
 /*
- Function: getKeyPress
- ---------------------
+ Function: queueKey
+ ------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ appends a key press to the key queue. If the control loop has let the queue fill up the key is dropped
+ Argument(s):
+ char key - the key
+ Return Value: none
+ Usage: queueKey(c);
+ */
+static void queueKey(char key)
+{
+    if (keys_queued - keys_taken >= KEY_QUEUE_SIZE)
+    {
+        keys_dropped++;
+        return;
+    }
+    key_queue[keys_queued % KEY_QUEUE_SIZE].key = key;
+    clock_gettime(CLOCK_MONOTONIC, &key_queue[keys_queued % KEY_QUEUE_SIZE].pressed);
+    keys_queued++;
+}
+
+/*
+ Function: readKeys
+ ------------------
  Written by Jason Brown
  Date: 25/05/2021
  Version 1.0
  Purpose:
- thread function to handle keyboard input, called as part
- of creation of a new thread
+ handles keyboard input once waitForEvents() has found stdin readable. Queues every key read and sets
+ the quit flag of every open session on q, any keys after a q are ignored. At the end of input stdin stops being polled
  Argument(s):  None
  Return Value: none
- Usage: not called directly but via pthread_create()
+ Usage: if (sources[0].revents != 0) readKeys();
  */
-void *getKeyPress(void *arguments)
+static void readKeys()
 {
-    do {
-
-        key_pressed = getchar();
+    char keys[16];
+    ssize_t length = read(STDIN_FILENO, keys, sizeof(keys));
 
-    } while ((key_pressed != 'q') && (key_pressed != 'Q'));
+    if (length < 0 && (errno == EINTR || errno == EAGAIN)) return;
+    if (length <= 0)
+    {
+        key_input_ended = TRUE;
+        return;
+    }
 
-    pnp -> quit = TRUE;
-    return NULL;
+    for (ssize_t k = 0; k < length && !session -> pnp -> quit; k++)
+    {
+        queueKey(keys[k]);
+        if (keys[k] == 'q' || keys[k] == 'Q')
+        {
+            pthread_mutex_lock(&open_sessions_lock);
+            for (int s = 0; s < PNP_MAX_SESSIONS; s++)
+            {
+                if (open_sessions[s] != NULL) open_sessions[s] -> pnp -> quit = TRUE;
+            }
+            pthread_mutex_unlock(&open_sessions_lock);
+        }
+    }
 }
 
 /*
- Function: pnpOpen
- -------------------
+ Function: pnpSessionOpen
+ ------------------------
  Written by Jason Brown
  Date: 25/05/2021
- Version 1.0
- Purpose: sets the terminal settings, creates a separate thread to handle
- keyboard input, initializes and memory maps a file so that a shared memory
- segment is created with the simulator
- Argument(s): none
- Return Value: none
- Usage: pnpOpen();
+ Version 2.0
+ Purpose: initializes and memory maps a file so that a shared memory segment
+ is created with one simulator, creates the FIFO the simulator signals
+ instruction completion through, then negotiates the protocol version with the
+ simulator, falling back to the original polled protocol if the simulator does
+ not acknowledge the protocol extension. The FIFO's path is passed to the
+ simulator through the shared memory, so several sessions can run side by side
+ in one directory. The feeder positions are exchanged the same way, and a
+ simulator built with another FEEDER_PITCH, or a version 1 simulator when this
+ controller was, is refused. A keyboard session also sets the terminal settings, and
+ keyboard input is then read whenever the thread that opened it waits in
+ waitForEvents(), whichever session that thread is bound to
+ Argument(s):
+ const char *shared_file - the memory mapped file, MEMORY_MAPPED_FILE for the original single machine
+ const char *notify_fifo - the notification FIFO, shorter than PNP_PATH_LENGTH
+ int keyboard - TRUE for the one session of the process that reads the keyboard
+ Return Value:
+ the session, to be bound to the thread that drives it with pnpSessionBind(). Exits if the file cannot
+ be mapped, PNP_MAX_SESSIONS sessions are already open or the simulator's feeders are elsewhere
+ Usage:
+ PnPSession *machine = pnpSessionOpen("pnp_shared_file.1", "pnp_notify_fifo.1", FALSE);
  */
-void pnpOpen()
+PnPSession *pnpSessionOpen(const char *shared_file, const char *notify_fifo, int keyboard)
 {
-    /* disable character echoing and line buffering */
-    old_term = setTerminalSettings();
+    PnPSession *opened = calloc(1, sizeof(PnPSession));
+    PnP *pnp;
+    int slot = -1;
 
-    /* create separate thread to handle keyboard input */
-    int res = pthread_create(&key_thread, NULL, getKeyPress, NULL);
-    if (res != 0)
+    pthread_mutex_lock(&open_sessions_lock);
+    for (int s = 0; s < PNP_MAX_SESSIONS && opened != NULL && slot < 0; s++)
     {
-        perror("Problem creating thread to handle user input");
+        if (open_sessions[s] == NULL) open_sessions[slot = s] = opened;
+    }
+    pthread_mutex_unlock(&open_sessions_lock);
+    if (slot < 0)
+    {
+        printf("Cannot open %s, at most %d sessions can be open\n", shared_file, PNP_MAX_SESSIONS);
         exit(1);
     }
+    opened -> notify_fd = -1;
+    opened -> keyboard = keyboard;
+
+    /* disable character echoing and line buffering */
+    if (keyboard) opened -> old_term = setTerminalSettings();
+    if (keyboard) keyboard_thread = TRUE;
 
     /* initialize file */
-    fd = open(MEMORY_MAPPED_FILE, (O_CREAT | O_RDWR), 0666);
-    if (fd < 0)
+    opened -> fd = open(shared_file, (O_CREAT | O_RDWR), 0666);
+    if (opened -> fd < 0)
     {
         perror("creation/opening of file failed");
         exit(1);
     }
-    ftruncate(fd, sizeof(PnP));
+    ftruncate(opened -> fd, sizeof(PnP));
 
     /* map the file to memory */
-    pnp = (PnP *)mmap(0, sizeof(PnP), (PROT_READ | PROT_WRITE),  MAP_SHARED, fd, (off_t)0);
+    pnp = opened -> pnp = (PnP *)mmap(0, sizeof(PnP), (PROT_READ | PROT_WRITE),  MAP_SHARED, opened -> fd, (off_t)0);
     if (pnp == MAP_FAILED)
     {
         perror("memory mapping of file failed");
-        close(fd);
+        close(opened -> fd);
         exit(2);
     }
+
+    /* initialize the process-shared synchronisation objects the first time the extension is used */
+    if (pnp -> protocol_magic != PNP_PROTOCOL_MAGIC || pnp -> layout_size != sizeof(PnP))
+    {
+        pthread_mutexattr_t mutex_attr;
+        pthread_condattr_t cond_attr;
+
+        pthread_mutexattr_init(&mutex_attr);
+        pthread_mutexattr_setpshared(&mutex_attr, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&mutex_attr, PTHREAD_MUTEX_ROBUST);
+        pthread_mutex_init(&pnp -> ready_lock, &mutex_attr);
+        pthread_mutexattr_destroy(&mutex_attr);
+
+        pthread_condattr_init(&cond_attr);
+        pthread_condattr_setpshared(&cond_attr, PTHREAD_PROCESS_SHARED);
+        pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+        pthread_cond_init(&pnp -> instruction_posted, &cond_attr);
+        pthread_condattr_destroy(&cond_attr);
+
+        pnp -> layout_size = sizeof(PnP);
+        pnp -> protocol_magic = PNP_PROTOCOL_MAGIC;
+    }
+
+    /* the FIFO is opened for writing too so that it never reports end of file while no simulator has it open */
+    int controller_version = PNP_PROTOCOL_VERSION;
+    if (strlen(notify_fifo) >= PNP_PATH_LENGTH || (mkfifo(notify_fifo, 0666) != 0 && errno != EEXIST)) controller_version = PNP_PROTOCOL_CONCURRENT;
+    else if ((opened -> notify_fd = open(notify_fifo, O_RDWR | O_NONBLOCK)) < 0) controller_version = PNP_PROTOCOL_CONCURRENT;
+
+    /* start a new session, any simulator already attached must acknowledge it again */
+    lockReadyLock(pnp);
+    atomic_store(&pnp -> instructions_issued, 0);
+    atomic_store(&pnp -> instructions_completed, 0);
+    atomic_store(&pnp -> simulator_protocol_version, 0);
+    opened -> instructions_posted = 0;
+    pnp -> controller_protocol_version = controller_version;
+    snprintf(pnp -> notify_fifo, PNP_PATH_LENGTH, "%s", (controller_version >= PNP_PROTOCOL_NOTIFY) ? notify_fifo : "");
+    memcpy(pnp -> feeder_x, TAPE_FEEDER_X, sizeof(pnp -> feeder_x));
+    pthread_cond_broadcast(&pnp -> instruction_posted);
+    pthread_mutex_unlock(&pnp -> ready_lock);
+
+    for (int waited = 0; waited < PNP_NEGOTIATION_TIMEOUT_MS && atomic_load(&pnp -> simulator_protocol_version) == 0; waited += LEGACY_POLL_INTERVAL_MS)
+    {
+        sleepMilliseconds(LEGACY_POLL_INTERVAL_MS);
+    }
+
+    unsigned int simulator_version = atomic_load(&pnp -> simulator_protocol_version);
+    if (simulator_version == 0) opened -> protocol_version = PNP_PROTOCOL_LEGACY;
+    else opened -> protocol_version = (simulator_version < (unsigned int)controller_version) ? (int)simulator_version : controller_version;
+
+    /* moving to feeders that are not there would place nothing, a version 1 simulator has the shipped layout */
+    for (int f = 0; f < NUMBER_OF_FEEDERS; f++)
+    {
+        double simulator_x = (simulator_version == 0) ? FEEDER_POSITION_X(SHIPPED_FEEDER_PITCH, f) : pnp -> simulator_feeder_x[f];
+        if (simulator_x != TAPE_FEEDER_X[f])
+        {
+            printf("The simulator on %s has feeder %d at x: %.2f rather than %.2f, the controller and simulator must be built with the same FEEDER_PITCH\n",
+                   shared_file, f, simulator_x, TAPE_FEEDER_X[f]);
+            pnpSessionClose(opened);
+            exit(1);
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &opened -> last_instruction_posted);
+    return opened;
+}
+
+/*
+ Function: pnpSessionClose
+ -------------------------
+ Written by Jason Brown
+ Date: 25/05/2021
+ Version 2.0
+ Purpose: indicates to the session's simulator that the controller is quitting,
+ unmaps the memory mapped file, closes the associated file descriptors and,
+ for the keyboard session, resets the terminal settings and reports any key
+ presses dropped because the key queue was full
+ Argument(s):
+ PnPSession *closing - the session, freed on return and no longer to be bound by any thread
+ Return Value: none
+ Usage: pnpSessionClose(machine);
+ */
+void pnpSessionClose(PnPSession *closing)
+{
+    PnP *pnp = closing -> pnp;
+
+    pnp -> quit = TRUE;
+
+    /* wake a simulator blocked waiting for the next instruction so that it sees the quit flag */
+    lockReadyLock(pnp);
+    pthread_cond_broadcast(&pnp -> instruction_posted);
+    pthread_mutex_unlock(&pnp -> ready_lock);
+
+    pthread_mutex_lock(&open_sessions_lock);
+    for (int s = 0; s < PNP_MAX_SESSIONS; s++)
+    {
+        if (open_sessions[s] == closing) open_sessions[s] = NULL;
+    }
+    pthread_mutex_unlock(&open_sessions_lock);
+
+    if (closing -> notify_fd >= 0) close(closing -> notify_fd);
+    munmap(pnp, sizeof(PnP));
+    close(closing -> fd);
+
+    /* reset terminal settings to original values */
+    if (closing -> keyboard) resetTerminalSettings(closing -> old_term);
+    if (closing -> keyboard && keys_dropped > 0) printf("%lu key presses were dropped as more than %d were waiting\n", keys_dropped, KEY_QUEUE_SIZE);
+    if (session == closing) session = NULL;
+    free(closing);
+}
+
+/*
+ Function: pnpSessionBind
+ ------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ makes a session the one the calling thread drives. Every other interface routine, from setTargetPos()
+ to waitForEvents(), acts on the calling thread's session, so the same control code drives any machine
+ and each machine of a line has its own control thread. Only one thread may drive a session at a
+ time, the keyboard thread may still wait on it for keys alone while its control thread runs
+ Argument(s):
+ PnPSession *bound - the session, or NULL
+ Return Value: none
+ Usage:
+ pnpSessionBind(machine);
+ */
+void pnpSessionBind(PnPSession *bound)
+{
+    session = bound;
+}
+
+/*
+ Function: pnpOpen
+ -------------------
+ Written by Jason Brown
+ Date: 25/05/2021
+ Version 2.0
+ Purpose: opens the session with the single machine of the original controller,
+ through MEMORY_MAPPED_FILE and PNP_NOTIFY_FIFO, as the keyboard session, and
+ binds it to the calling thread
+ Argument(s): none
+ Return Value: none
+ Usage: pnpOpen();
+ */
+void pnpOpen()
+{
+    pnpSessionBind(pnpSessionOpen(MEMORY_MAPPED_FILE, PNP_NOTIFY_FIFO, TRUE));
 }
 
 /*
@@ -407,22 +733,91 @@ void pnpOpen()
  ------------------
  Written by Jason Brown
  Date: 25/05/2021
- Version 1.0
- Purpose: indicates to the simulator that the controller is quitting,
- unmaps the memory mapped file, closes the associated file descriptor
- and resets the terminal settings
+ Version 2.0
+ Purpose: closes the calling thread's session, see pnpSessionClose()
  Argument(s): none
  Return Value: none
  Usage: pnpClose();
  */
 void pnpClose()
 {
-    pnp -> quit = TRUE;
-    munmap(pnp, sizeof(PnP));
-    close(fd);
+    if (session != NULL) pnpSessionClose(session);
+}
 
-    /* reset terminal settings to original values */
-    resetTerminalSettings(old_term);
+/*
+ Function: readUnorderedTelemetry
+ --------------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ copies the original sensor fields of the PnP struct, which a version 1 to 3 simulator writes without
+ any ordering, so the copy may mix values from before and after a simulator update
+ Argument(s):
+ PnPSnapshot *snapshot - pointer to the structure to copy the sensor fields into
+ Return Value: none
+ Usage:
+ readUnorderedTelemetry(&snapshot);
+ */
+static void readUnorderedTelemetry(PnPSnapshot *snapshot)
+{
+    PnP *pnp = session -> pnp;
+    memset(snapshot, 0, sizeof(PnPSnapshot));
+    snapshot -> sim_time = pnp -> sim_time;
+    for (int nozzle = 0; nozzle < NUMBER_OF_NOZZLES; nozzle++) snapshot -> theta_pick_error[nozzle] = pnp -> theta_pick_error[nozzle];
+    snapshot -> x_preplace_error = pnp -> x_preplace_error;
+    snapshot -> y_preplace_error = pnp -> y_preplace_error;
+    snapshot -> instructions_completed = atomic_load(&pnp -> instructions_completed);
+    snapshot -> nozzles_carrying = ALL_NOZZLE_BITS;
+    atomic_thread_fence(memory_order_acquire);
+}
+
+/*
+ Function: pnpSnapshot
+ ---------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ copies a consistent view of all the simulator sensor fields (simulation time, pick errors, preplace errors
+ and the number of completed instructions) in one read, so that for example the x and y preplace errors
+ always come from the same photo. With PNP_PROTOCOL_TELEMETRY the telemetry block is read under the
+ simulator's seqlock, retrying if the simulator was writing it. A version 1 to 3 simulator writes the
+ original fields without any ordering, so they are copied repeatedly until two successive copies agree.
+ A simulator older than PNP_PROTOCOL_PART_PRESENCE is taken to have seen a part on every nozzle
+ Argument(s):
+ PnPSnapshot *snapshot - pointer to the structure to copy the sensor fields into
+ Return Value: none
+ Usage:
+ PnPSnapshot snapshot;
+ pnpSnapshot(&snapshot);
+ */
+void pnpSnapshot(PnPSnapshot *snapshot)
+{
+    PnP *pnp = session -> pnp;
+    if (session -> protocol_version >= PNP_PROTOCOL_TELEMETRY)
+    {
+        for (;;)
+        {
+            unsigned int before = atomic_load_explicit(&pnp -> telemetry_sequence, memory_order_acquire);
+            if (before & 1) continue;
+
+            memcpy(snapshot, &pnp -> telemetry, sizeof(PnPSnapshot));
+            atomic_thread_fence(memory_order_acquire);
+
+            if (atomic_load_explicit(&pnp -> telemetry_sequence, memory_order_relaxed) != before) continue;
+
+            if (session -> protocol_version < PNP_PROTOCOL_PART_PRESENCE) snapshot -> nozzles_carrying = ALL_NOZZLE_BITS;
+            return;
+        }
+    }
+
+    PnPSnapshot previous;
+
+    readUnorderedTelemetry(snapshot);
+    do
+    {
+        previous = *snapshot;
+        readUnorderedTelemetry(snapshot);
+    } while (memcmp(&previous, snapshot, sizeof(PnPSnapshot)) != 0);
 }
 
 /*
@@ -443,7 +838,10 @@ void pnpClose()
  */
 double getSimTime()
 {
-    return pnp -> sim_time;
+    PnPSnapshot snapshot;
+
+    pnpSnapshot(&snapshot);
+    return snapshot.sim_time;
 }
 
 /*
@@ -463,7 +861,10 @@ double getSimTime()
  */
 double getPreplaceErrorX()
 {
-    return pnp -> x_preplace_error;
+    PnPSnapshot snapshot;
+
+    pnpSnapshot(&snapshot);
+    return snapshot.x_preplace_error;
 }
 
 /*
@@ -483,7 +884,10 @@ double getPreplaceErrorX()
  */
 double getPreplaceErrorY()
 {
-    return pnp -> y_preplace_error;
+    PnPSnapshot snapshot;
+
+    pnpSnapshot(&snapshot);
+    return snapshot.y_preplace_error;
 }
 
 /*
@@ -503,7 +907,10 @@ double getPreplaceErrorY()
  */
 double getPickErrorTheta(int nozzle)
 {
-    return pnp -> theta_pick_error[nozzle];
+    PnPSnapshot snapshot;
+
+    pnpSnapshot(&snapshot);
+    return snapshot.theta_pick_error[nozzle];
 }
 
 /*
@@ -513,7 +920,9 @@ double getPickErrorTheta(int nozzle)
  Date: 25/05/2021
  Version 1.0
  Purpose:
- provides information on whether the simulator has finished executing the previous instruction
+ provides information on whether the simulator has finished executing the previous instruction, a version 1
+ simulator gives no acknowledgement so its ready flag is only trusted once LEGACY_SIMULATOR_SETTLE_MS has
+ passed since the last instruction was posted
  Argument(s):
  none
  Return Value:
@@ -523,7 +932,217 @@ double getPickErrorTheta(int nozzle)
  */
 int isSimulatorReadyForNextInstruction()
 {
-    return pnp -> ready_for_next_instruction;
+    PnP *pnp = session -> pnp;
+    if (session -> protocol_version >= PNP_PROTOCOL_SIGNALLED)
+    {
+        unsigned long completed = atomic_load(&pnp -> instructions_completed);
+
+        traceInstructionsCompleted(completed);
+        return completed == atomic_load(&pnp -> instructions_issued);
+    }
+
+    int ready = pnp -> ready_for_next_instruction && millisecondsSince(&session -> last_instruction_posted) >= LEGACY_SIMULATOR_SETTLE_MS;
+    if (ready) traceInstructionsCompleted(session -> instructions_posted);
+    return ready;
+}
+
+/*
+ Function: waitForSimulatorReady
+ -------------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ blocks the calling thread until the simulator has finished executing the previous instruction, the
+ quit flag is set or the timeout expires. Key presses that arrive meanwhile are queued for getKey()
+ Argument(s):
+ long timeout_ms - the maximum time to wait in ms
+ Return Value:
+ an int representing whether the simulator is ready for the next instruction (1) or not (0)
+ Usage:
+ if (waitForSimulatorReady(SIMULATOR_READY_TIMEOUT_MS)) lowerNozzle(nozzle);
+ */
+int waitForSimulatorReady(long timeout_ms)
+{
+    return (waitForEvents(PNP_EVENT_SIMULATOR_READY, timeout_ms) & PNP_EVENT_SIMULATOR_READY) != 0;
+}
+
+/*
+ Function: getProtocolVersion
+ ----------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ gets the shared memory protocol version negotiated with the simulator by pnpOpen()
+ Argument(s):
+ none
+ Return Value:
+ an int, PNP_PROTOCOL_LEGACY (1) for a simulator that predates the protocol extension, otherwise the negotiated version
+ Usage:
+ if (getProtocolVersion() >= PNP_PROTOCOL_RING) ...
+ */
+int getProtocolVersion()
+{
+    return session -> protocol_version;
+}
+
+/*
+ Function: getInstructionCapacity
+ --------------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ gets the number of instructions that can be passed to the simulator straight away without overwriting
+ an instruction that has not yet been executed. With PNP_PROTOCOL_RING this is the number of free slots
+ in the command ring, otherwise it is 1 when the simulator is ready for the next instruction and 0 if not
+ Argument(s):
+ none
+ Return Value:
+ an int representing the number of instructions that can be posted without waiting
+ Usage:
+ if (getInstructionCapacity() >= 4) ... queue a whole pick sequence ...
+ */
+int getInstructionCapacity()
+{
+    PnP *pnp = session -> pnp;
+    if (session -> protocol_version >= PNP_PROTOCOL_RING)
+    {
+        unsigned long queued = atomic_load(&pnp -> instructions_issued) - atomic_load(&pnp -> instructions_completed);
+        return PNP_COMMAND_RING_SIZE - (int)queued;
+    }
+    return isSimulatorReadyForNextInstruction() ? 1 : 0;
+}
+
+/*
+ Function: waitForInstructionCompletion
+ --------------------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ blocks the calling thread until every instruction passed to the simulator has been executed, or the
+ quit flag is set
+ Argument(s):
+ none
+ Return Value:
+ an int representing whether the instructions completed (1) or the quit flag was set first (0)
+ Usage:
+ takePhoto(PHOTO_LOOKUP);
+ if (waitForInstructionCompletion()) ... read the photo results ...
+ */
+int waitForInstructionCompletion()
+{
+    PnP *pnp = session -> pnp;
+    while (!waitForSimulatorReady(SIMULATOR_READY_TIMEOUT_MS))
+    {
+        if (pnp -> quit) return FALSE;
+    }
+    return TRUE;
+}
+
+/*
+ Function: clearBatchVision
+ --------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ resets the cached photo results at the start of a new batch
+ Argument(s):
+ BatchVision *vision - the cached photo results, the loaded array is left for the caller to fill in
+ Return Value: none
+ Usage:
+ clearBatchVision(&vision);
+ */
+void clearBatchVision(BatchVision *vision)
+{
+    memset(vision, 0, sizeof(BatchVision));
+}
+
+/*
+ Function: captureLookupPhoto
+ ----------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ takes one lookup photo for all the nozzles (the head should already be over the lookup camera),
+ waits for it to complete and caches the pick error of every loaded nozzle, and whether a part was
+ seen on it, from a single snapshot
+ Argument(s):
+ BatchVision *vision - the cached photo results, vision -> loaded selects the nozzles to record
+ Return Value:
+ an int representing whether the photo completed (1) or the quit flag was set first (0)
+ Usage:
+ vision.loaded[CENTRE_NOZZLE] = TRUE;
+ if (captureLookupPhoto(&vision)) theta_error = vision.theta_pick_error[CENTRE_NOZZLE];
+ */
+int captureLookupPhoto(BatchVision *vision)
+{
+    PnPSnapshot snapshot;
+
+    takePhoto(PHOTO_LOOKUP);
+    if (!waitForInstructionCompletion()) return FALSE;
+
+    pnpSnapshot(&snapshot);
+    for (int nozzle = 0; nozzle < NUMBER_OF_NOZZLES; nozzle++)
+    {
+        vision -> theta_pick_error[nozzle] = vision -> loaded[nozzle] ? snapshot.theta_pick_error[nozzle] : 0.0;
+        vision -> carrying[nozzle] = vision -> loaded[nozzle] && (snapshot.nozzles_carrying & NOZZLE_BIT(nozzle)) != 0;
+    }
+    vision -> sim_time = snapshot.sim_time;
+    return TRUE;
+}
+
+/*
+ Function: captureLookdownPhoto
+ ------------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ takes a lookdown photo (the head should already be over the PCB target), waits for it to complete and
+ caches the x and y preplace errors from a single snapshot
+ Argument(s):
+ BatchVision *vision - the cached photo results
+ Return Value:
+ an int representing whether the photo completed (1) or the quit flag was set first (0)
+ Usage:
+ if (captureLookdownPhoto(&vision)) amendPos(vision.x_preplace_error, vision.y_preplace_error);
+ */
+int captureLookdownPhoto(BatchVision *vision)
+{
+    PnPSnapshot snapshot;
+
+    takePhoto(PHOTO_LOOKDOWN);
+    if (!waitForInstructionCompletion()) return FALSE;
+
+    pnpSnapshot(&snapshot);
+    vision -> x_preplace_error = snapshot.x_preplace_error;
+    vision -> y_preplace_error = snapshot.y_preplace_error;
+    vision -> sim_time = snapshot.sim_time;
+    return TRUE;
+}
+
+/*
+ Function: getKeyEvent
+ ---------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ takes the oldest key press that has not already been handled from the key queue. Keys are only read
+ from stdin while the control loop waits in waitForEvents(), so a loop that never waits sees no keys.
+ Only the thread that opened the keyboard session takes keys, the control thread of any other machine
+ of a line sees none
+ Argument(s):
+ KeyEvent *event - set to the key and the monotonic clock time it was read
+ Return Value:
+ TRUE (1) if there was a key press, otherwise FALSE (0)
+ Usage:
+ KeyEvent event;
+ while (getKeyEvent(&event)) ...
+ */
+int getKeyEvent(KeyEvent *event)
+{
+    if (!keyboard_thread || keys_taken == keys_queued) return FALSE;
+    *event = key_queue[keys_taken % KEY_QUEUE_SIZE];
+    keys_taken++;
+    return TRUE;
 }
 
 /*
@@ -533,24 +1152,151 @@ int isSimulatorReadyForNextInstruction()
  Date: 2/02/2020
  Version 1.0
  Purpose:
- gets the most recent key press by the user which has not already been handled, then resets
- the key to NO_KEY to prevent handling the same key press more than once
+ gets the oldest key press by the user which has not already been handled, each key press is
+ returned once and key presses that arrive together are returned one per call in order
  Argument(s):
  none
  Return Value:
- the most recent key press by the user which has not already been handled as a char,
+ the oldest key press by the user which has not already been handled as a char,
  otherwise NO_KEY (0)
  Usage:
  char c = getKey();
  */
 char getKey()
+{
+    KeyEvent event;
+
+    return getKeyEvent(&event) ? event.key : NO_KEY;
+}
+
+/*
+ Function: waitForKey
+ --------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ blocks until the user presses a key, the quit flag is set or the input ends
+ Argument(s):
+ none
+ Return Value:
+ the key as a char, or NO_KEY (0) if the quit flag was set or the input ended first
+ Usage:
+ printf("press any key to continue\n");
+ waitForKey();
+ */
+char waitForKey()
 {
     char c;
-    c = key_pressed;
-    key_pressed = NO_KEY;
+
+    while ((c = getKey()) == NO_KEY && !(waitForEvents(PNP_EVENT_KEY | PNP_EVENT_INPUT_ENDED, -1) & (PNP_EVENT_QUIT | PNP_EVENT_INPUT_ENDED)));
     return c;
 }
 
+/*
+ Function: waitForEvents
+ -----------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ the control loop's only blocking point. Waits in a single poll() on stdin and the simulator's
+ notification FIFO until one of the requested events has happened or the timeout expires, queueing any
+ keys read on the way. Nothing runs while the loop waits, so it takes no CPU time when idle and reacts
+ to a key or a completed instruction as soon as the kernel wakes it. A simulator that does not write to
+ the FIFO, one on protocols 1 to 5 or one whose FIFO could not be opened, has nothing to block on, so
+ its completion counter is checked every LEGACY_POLL_INTERVAL_MS instead. Only a wait for a simulator event reads
+ the FIFO, so a thread waiting for keys alone never takes the wake-up of the machine's control thread.
+ The wait is counted as waiting on the simulator by the instrumentation if a simulator event was asked
+ for while it was busy, otherwise as idle
+ Argument(s):
+ int events - PNP_EVENT_ flags to wait for, PNP_EVENT_QUIT is always reported
+ long timeout_ms - the maximum time to wait in ms, or -1 to wait without a timeout
+ Return Value:
+ an int mask of the PNP_EVENT_ flags that have happened, PNP_EVENT_TIMEOUT if none had by the timeout
+ Usage:
+ if (waitForEvents(PNP_EVENT_KEY | PNP_EVENT_SIMULATOR_READY, 100) & PNP_EVENT_KEY) c = getKey();
+ */
+int waitForEvents(int events, long timeout_ms)
+{
+    PnP *pnp = session -> pnp;
+    unsigned long completed_at_start = atomic_load(&pnp -> instructions_completed);
+    int simulator_events = events & (PNP_EVENT_SIMULATOR_READY | PNP_EVENT_INSTRUCTION_COMPLETED);
+    int notified = (session -> protocol_version >= PNP_PROTOCOL_NOTIFY) && (session -> notify_fd >= 0);
+    int idle = !simulator_events || isSimulatorReadyForNextInstruction();
+    int happened = 0;
+    struct timespec started;
+
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    if (idle) traceIdleBegin();
+    else traceWaitBegin();
+
+    for (;;)
+    {
+        if (pnp -> quit) happened |= PNP_EVENT_QUIT;
+        if ((events & PNP_EVENT_KEY) && keyboard_thread && keys_taken != keys_queued) happened |= PNP_EVENT_KEY;
+        if ((events & PNP_EVENT_SIMULATOR_READY) && isSimulatorReadyForNextInstruction()) happened |= PNP_EVENT_SIMULATOR_READY;
+        if ((events & PNP_EVENT_INSTRUCTION_COMPLETED) && atomic_load(&pnp -> instructions_completed) != completed_at_start) happened |= PNP_EVENT_INSTRUCTION_COMPLETED;
+        if ((events & PNP_EVENT_INPUT_ENDED) && keyboard_thread && key_input_ended) happened |= PNP_EVENT_INPUT_ENDED;
+        if (happened) break;
+
+        long remaining = -1;
+        if (timeout_ms >= 0)
+        {
+            remaining = timeout_ms - millisecondsSince(&started);
+            if (remaining <= 0)
+            {
+                happened = PNP_EVENT_TIMEOUT;
+                break;
+            }
+        }
+        if (simulator_events && !notified && (remaining < 0 || remaining > LEGACY_POLL_INTERVAL_MS)) remaining = LEGACY_POLL_INTERVAL_MS;
+
+        struct pollfd sources[2];
+        int number_of_sources = 0;
+        if (keyboard_thread && !key_input_ended) sources[number_of_sources++] = (struct pollfd){STDIN_FILENO, POLLIN, 0};
+        if (notified && simulator_events) sources[number_of_sources++] = (struct pollfd){session -> notify_fd, POLLIN, 0};
+
+        if (poll(sources, number_of_sources, (int)remaining) <= 0) continue;
+        for (int k = 0; k < number_of_sources; k++)
+        {
+            if (sources[k].revents == 0) continue;
+            if (sources[k].fd == STDIN_FILENO) readKeys();
+            else
+            {
+                char drained[64];
+                while (read(session -> notify_fd, drained, sizeof(drained)) > 0);
+            }
+        }
+    }
+
+    if (idle) traceIdleEnd();
+    else traceWaitEnd();
+    return happened;
+}
+
+/*
+ Function: waitForKeyOrSimulatorReady
+ ------------------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ blocks the control loop until there is something for it to do: a key press is waiting, the quit
+ flag is set, the simulator finishes the instruction it is executing (if it is executing one) or the
+ timeout expires
+ Argument(s):
+ long timeout_ms - the maximum time to wait in ms
+ Return Value:
+ an int representing whether a key press is waiting (1) or not (0)
+ Usage:
+ if (state == previous_state) waitForKeyOrSimulatorReady(SIMULATOR_READY_TIMEOUT_MS);
+ */
+int waitForKeyOrSimulatorReady(long timeout_ms)
+{
+    int events = PNP_EVENT_KEY;
+
+    if (!isSimulatorReadyForNextInstruction()) events |= PNP_EVENT_SIMULATOR_READY;
+    return (waitForEvents(events, timeout_ms) & PNP_EVENT_KEY) != 0;
+}
+
 /*
  Function: isPnPSimulationQuitFlagOn
  -------------------------------------
@@ -570,7 +1316,7 @@ char getKey()
  */
 int isPnPSimulationQuitFlagOn()
 {
-    return pnp -> quit;
+    return session -> pnp -> quit;
 }
 
 /*
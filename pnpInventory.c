@@ -0,0 +1,268 @@
+/*
+ *
+ * pnpInventory.c - the tape feeder inventory. The operator lists the parts left on the reel of each
+ * feeder in FEEDER_INVENTORY_FILE, and optionally the size of the reel spliced on when it runs out. Every
+ * pick counts a part off its reel and the counts are written back after each board, so they carry over
+ * from one run to the next. From the parts each queued board takes from each feeder the inventory
+ * forecasts when every reel runs out, and findStarvedBatches() picks out the batches of a board that
+ * would pick from a reel after it has run out, so they can be placed last while the reel is spliced
+ *
+ * Platform: Any POSIX compliant platform
+ * Intended for and tested on: Cygwin 64 bit
+ *
+ */
+
+#include <errno.h>
+#include "pnpInventory.h"
+
+/*
+ Function: initFeederInventory
+ -----------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: sets up an inventory that tracks no feeder
+ Argument(s):
+ FeederInventory *inventory - the inventory
+ Return Value: none
+ Usage: initFeederInventory(&inventory);
+ */
+void initFeederInventory(FeederInventory *inventory)
+{
+    for (int f = 0; f < NUMBER_OF_FEEDERS; f++)
+    {
+        inventory -> remaining[f] = FEEDER_UNTRACKED;
+        inventory -> reel_size[f] = 0;
+    }
+    inventory -> tracked = FALSE;
+}
+
+/*
+ Function: loadFeederInventory
+ -----------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ reads the inventory from a file of "feeder parts_left [reel_size]" lines. Blank lines and lines
+ starting with # are ignored, feeders not in the file are not tracked. A missing file is an inventory
+ that tracks no feeder
+ Argument(s):
+ const char *path - the inventory file
+ FeederInventory *inventory - set to the inventory, tracking no feeder if the file has a problem
+ Return Value:
+ TRUE (1) on success, FALSE (0) if the file could not be read, the problem is printed
+ Usage:
+ if (!loadFeederInventory(FEEDER_INVENTORY_FILE, &inventory)) ... carry on without an inventory ...
+ */
+int loadFeederInventory(const char *path, FeederInventory *inventory)
+{
+    char text[256];
+    int line = 0;
+
+    initFeederInventory(inventory);
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+    {
+        if (errno == ENOENT) return TRUE;
+        perror("opening of feeder inventory failed");
+        return FALSE;
+    }
+
+    while (fgets(text, sizeof(text), fp) != NULL)
+    {
+        int feeder, remaining, reel_size = 0, fields;
+        char extra[2];
+
+        line++;
+        if (sscanf(text, " %1s", extra) != 1 || extra[0] == '#') continue;
+
+        /* the reel size is optional, but nothing may follow the numbers */
+        fields = sscanf(text, "%d %d %d %1s", &feeder, &remaining, &reel_size, extra);
+        if ((fields != 2 && fields != 3) || (fields == 2 && sscanf(text, "%*d %*d %1s", extra) == 1) ||
+            feeder < 0 || feeder >= NUMBER_OF_FEEDERS || remaining < 0 || reel_size < 0)
+        {
+            printf("Problem with feeder inventory %s at line %d: expected a feeder from 0 to %d, the parts left and optionally the reel size\n", path, line, NUMBER_OF_FEEDERS - 1);
+            fclose(fp);
+            initFeederInventory(inventory);
+            return FALSE;
+        }
+        inventory -> remaining[feeder] = remaining;
+        inventory -> reel_size[feeder] = reel_size;
+        inventory -> tracked = TRUE;
+    }
+
+    fclose(fp);
+    return TRUE;
+}
+
+/*
+ Function: writeInventoryContents
+ --------------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: writes a line for each tracked feeder, the FileWriter of saveFeederInventory()
+ Argument(s):
+ FILE *fp - the open file
+ const void *context - the FeederInventory to write
+ Return Value: TRUE (1) if every write succeeded, otherwise FALSE (0)
+ Usage: replaceFile(path, "w", writeInventoryContents, inventory);
+ */
+static int writeInventoryContents(FILE *fp, const void *context)
+{
+    const FeederInventory *inventory = context;
+    int written = fprintf(fp, "# feeder parts_left reel_size\n") > 0;
+
+    for (int f = 0; f < NUMBER_OF_FEEDERS && written; f++)
+    {
+        if (inventory -> remaining[f] != FEEDER_UNTRACKED) written = fprintf(fp, "%d %d %d\n", f, inventory -> remaining[f], inventory -> reel_size[f]) > 0;
+    }
+    return written;
+}
+
+/*
+ Function: saveFeederInventory
+ -----------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ writes the tracked feeders of the inventory back to its file through replaceFile(), so a run that
+ stops part way never leaves a half written inventory
+ Argument(s):
+ const char *path - the inventory file
+ const FeederInventory *inventory - the inventory
+ Return Value:
+ TRUE (1) if the file was written or no feeder is tracked, otherwise FALSE (0)
+ Usage:
+ if (!saveFeederInventory(FEEDER_INVENTORY_FILE, &inventory)) ... report the problem ...
+ */
+int saveFeederInventory(const char *path, const FeederInventory *inventory)
+{
+    if (!inventory -> tracked) return TRUE;
+    return replaceFile(path, "w", writeInventoryContents, inventory);
+}
+
+/*
+ Function: takeFeederPart
+ ------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ counts a pick off the reel of a feeder. When the reel has run out the part comes from the reel
+ spliced onto it, if its size is known. Each feeder of a line is on one machine, so the machines'
+ control threads only ever count off different feeders
+ Argument(s):
+ FeederInventory *inventory - the inventory
+ int feeder - the feeder picked from
+ Return Value:
+ FEEDER_PICKED (0), FEEDER_SPLICED (1) or FEEDER_EMPTY (2), FEEDER_PICKED for an untracked feeder
+ Usage:
+ if (takeFeederPart(inventory, pi[part].feeder) == FEEDER_EMPTY) ... alert the operator ...
+ */
+int takeFeederPart(FeederInventory *inventory, int feeder)
+{
+    if (feeder < 0 || feeder >= NUMBER_OF_FEEDERS || inventory -> remaining[feeder] == FEEDER_UNTRACKED) return FEEDER_PICKED;
+    if (inventory -> remaining[feeder] > 0)
+    {
+        inventory -> remaining[feeder]--;
+        return FEEDER_PICKED;
+    }
+    if (inventory -> reel_size[feeder] == 0) return FEEDER_EMPTY;
+
+    inventory -> remaining[feeder] = inventory -> reel_size[feeder] - 1;
+    return FEEDER_SPLICED;
+}
+
+/*
+ Function: forecastFeederInventory
+ ---------------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ forecasts the board each tracked reel runs out on from the parts the boards still to place take from
+ it, and roughly when, taking the board's picks from the reel to be spread evenly over its cycle time
+ Argument(s):
+ const FeederInventory *inventory - the inventory
+ const int picks[][NUMBER_OF_FEEDERS] - the parts each board takes from each feeder, in the order the boards are placed
+ const double time[] - the estimated cycle time in s of each board
+ int number_of_boards - the number of boards
+ FeederForecast forecast[] - set for every feeder, board is FEEDER_NEVER if the reel lasts or is untracked
+ Return Value: none
+ Usage:
+ forecastFeederInventory(&inventory, picks, time, boards, forecast);
+ */
+void forecastFeederInventory(const FeederInventory *inventory, const int picks[][NUMBER_OF_FEEDERS], const double time[], int number_of_boards, FeederForecast forecast[])
+{
+    for (int f = 0; f < NUMBER_OF_FEEDERS; f++)
+    {
+        int left = inventory -> remaining[f];
+        double start = 0.0;
+
+        forecast[f].board = FEEDER_NEVER;
+        forecast[f].time = 0.0;
+        for (int b = 0; b < number_of_boards && left != FEEDER_UNTRACKED; b++)
+        {
+            if (picks[b][f] > left)
+            {
+                forecast[f].board = b;
+                forecast[f].time = start + time[b] * left / picks[b][f];
+                break;
+            }
+            left -= picks[b][f];
+            start += time[b];
+        }
+    }
+}
+
+/*
+ Function: findStarvedBatches
+ ----------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ finds the batches of a program that would pick from a reel after it has run out. The batches are
+ taken in route order, and a starved batch is taken to be placed after the rest, so its picks leave
+ the parts still on the reel for the batches that follow it
+ Argument(s):
+ const FeederInventory *inventory - the inventory
+ const PlacementTable *table - the parts of the board the program was compiled from
+ const PnPProgram *program - the program
+ int starved[] - set to TRUE or FALSE for each batch of the program
+ unsigned int *feeders - set to a mask with bit f set for each feeder f that runs out
+ Return Value:
+ an int representing the number of starved batches
+ Usage:
+ if (findStarvedBatches(inventory, table, &program, starved, &feeders) > 0) ... defer them ...
+ */
+int findStarvedBatches(const FeederInventory *inventory, const PlacementTable *table, const PnPProgram *program, int starved[], unsigned int *feeders)
+{
+    int left[NUMBER_OF_FEEDERS], count = 0;
+
+    memcpy(left, inventory -> remaining, sizeof(left));
+    *feeders = 0;
+    for (int b = 0; b < program -> number_of_batches; b++)
+    {
+        const NozzleBatch *batch = &program -> batch[b];
+        int needed[NUMBER_OF_FEEDERS] = {0};
+
+        starved[b] = FALSE;
+        for (int nozzle = 0; nozzle < NUMBER_OF_NOZZLES; nozzle++)
+        {
+            if (batch -> part[nozzle] != NO_PICKED_PART) needed[table -> feeder[batch -> part[nozzle]]]++;
+        }
+        for (int f = 0; f < NUMBER_OF_FEEDERS; f++)
+        {
+            if (left[f] == FEEDER_UNTRACKED || needed[f] <= left[f]) continue;
+            starved[b] = TRUE;
+            *feeders |= 1u << f;
+        }
+        if (starved[b])
+        {
+            count++;
+            continue;
+        }
+        for (int f = 0; f < NUMBER_OF_FEEDERS; f++)
+        {
+            if (left[f] != FEEDER_UNTRACKED) left[f] -= needed[f];
+        }
+    }
+    return count;
+}
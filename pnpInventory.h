@@ -0,0 +1,51 @@
+/*
+ *
+ * pnpInventory.h - declarations for the tape feeder inventory, the parts left on the reel of every
+ * feeder, kept between runs and used to warn the operator before a reel runs out
+ *
+ * Platform: Any POSIX compliant platform
+ * Intended for and tested on: Cygwin 64 bit
+ *
+ */
+
+#ifndef PNP_INVENTORY_H
+#define PNP_INVENTORY_H
+
+#include "pnpProgram.h"
+
+#define FEEDER_INVENTORY_FILE "pnp_feeders.txt"    // parts left on each reel, in the working directory, no file keeps no inventory
+#define FEEDER_UNTRACKED -1                        // parts left on a feeder that is not in the inventory file
+#define FEEDER_NEVER -1                            // forecast board of a reel that lasts the boards forecast
+
+#define FEEDER_PICKED 0                            // a part was taken from the reel
+#define FEEDER_SPLICED 1                           // the reel ran out and the new reel spliced onto it took over
+#define FEEDER_EMPTY 2                             // the reel ran out and no reel size is known, the count stays at 0
+
+typedef struct
+{
+    int remaining[NUMBER_OF_FEEDERS];       // parts left on each reel, FEEDER_UNTRACKED if not known
+    int reel_size[NUMBER_OF_FEEDERS];       // parts on the reel spliced on when one runs out, 0 if not known
+    int tracked;                            // TRUE if any feeder is tracked, only then is the file written back
+
+} FeederInventory;
+
+typedef struct
+{
+    int board;                              // index into the boards forecast of the board the reel runs out on, or FEEDER_NEVER
+    double time;                            // estimated s from the start of the first board forecast until it runs out
+
+} FeederForecast;
+
+void initFeederInventory(FeederInventory*);
+
+int loadFeederInventory(const char*, FeederInventory*);
+
+int saveFeederInventory(const char*, const FeederInventory*);
+
+int takeFeederPart(FeederInventory*, int);
+
+void forecastFeederInventory(const FeederInventory*, const int[][NUMBER_OF_FEEDERS], const double[], int, FeederForecast[]);
+
+int findStarvedBatches(const FeederInventory*, const PlacementTable*, const PnPProgram*, int[], unsigned int*);
+
+#endif // PNP_INVENTORY_H
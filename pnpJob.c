@@ -0,0 +1,234 @@
+/*
+ *
+ * pnpJob.c - job mode, a queue of boards placed one after another without leaving the controller
+ * session. Every centroid file given on the command line is a board, and a panel repeats each one on a
+ * grid of offsets. A board is read, planned and compiled by prepareJobBoard(), which startJobBoard()
+ * runs on a background thread so that the next board is ready by the time the current one is placed.
+ * The background thread only touches its own board, the control loop picks it up after finishJobBoard()
+ *
+ * Platform: Any POSIX compliant platform
+ * Intended for and tested on: Cygwin 64 bit
+ *
+ */
+
+#include "pnpJob.h"
+
+/*
+ Function: parseJobPanel
+ -----------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ reads a panel from the command line, the number of copies of each board along x and y and the offset
+ between neighbouring copies
+ Argument(s):
+ const char *text - "columns,rows,x step,y step", e.g. "2,3,120,80"
+ JobPanel *panel - set to the panel
+ Return Value:
+ TRUE (1) if the text is a valid panel, otherwise FALSE (0) and the panel is unchanged
+ Usage:
+ if (!parseJobPanel(optarg, &panel)) ... report the error ...
+ */
+int parseJobPanel(const char *text, JobPanel *panel)
+{
+    JobPanel parsed;
+    int length = 0;
+
+    if (sscanf(text, "%d,%d,%lf,%lf%n", &parsed.columns, &parsed.rows, &parsed.x_step, &parsed.y_step, &length) != 4 || text[length] != '\0') return FALSE;
+    if (parsed.columns < 1 || parsed.rows < 1 || parsed.columns > JOB_MAX_BOARDS / parsed.rows) return FALSE;
+    if (!isfinite(parsed.x_step) || !isfinite(parsed.y_step)) return FALSE;
+
+    *panel = parsed;
+    return TRUE;
+}
+
+/*
+ Function: buildJob
+ ------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ lists the boards of a job in the order they are placed, every copy of the first centroid file row by
+ row, then every copy of the next. Nothing is read until the board is prepared
+ Argument(s):
+ char *const paths[] - the centroid files, from the command line
+ int number_of_paths - how many, 0 for the centroid file of the working directory
+ const JobPanel *panel - the copies of each board, 1 by 1 for a plain queue of boards
+ const MotionProfile *profile - the motion profile every board is planned with, must outlive the job
+ PnPJob *job - set to the boards, freed with freeJob()
+ Return Value:
+ TRUE (1) if the job was built, FALSE (0) if it has more than JOB_MAX_BOARDS boards or memory ran out
+ Usage:
+ if (!buildJob(argv + optind, argc - optind, &panel, &profile, &job)) ... report the error ...
+ */
+int buildJob(char *const paths[], int number_of_paths, const JobPanel *panel, const MotionProfile *profile, PnPJob *job)
+{
+    int copies = panel -> columns * panel -> rows;
+    int files = (number_of_paths > 0) ? number_of_paths : 1;
+
+    job -> board = NULL;
+    job -> number_of_boards = 0;
+    if (files > JOB_MAX_BOARDS / copies) return FALSE;
+
+    job -> board = calloc((size_t)files * copies, sizeof(JobBoard));
+    if (job -> board == NULL) return FALSE;
+
+    for (int f = 0; f < files; f++)
+    {
+        for (int row = 0; row < panel -> rows; row++)
+        {
+            for (int column = 0; column < panel -> columns; column++)
+            {
+                JobBoard *board = &job -> board[job -> number_of_boards++];
+                board -> path = (number_of_paths > 0) ? paths[f] : JOB_WORKING_DIRECTORY_BOARD;
+                board -> profile = profile;
+                board -> x_offset = column * panel -> x_step;
+                board -> y_offset = row * panel -> y_step;
+            }
+        }
+    }
+    return TRUE;
+}
+
+/*
+ Function: prepareJobBoard
+ -------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ reads a board's centroid file and, in autonomous mode, loads its compiled program from the board's
+ cache file or plans the route, compiles it and caches it. The program is compiled without the panel
+ offset and moved by it afterwards, so the copies of a panel share one cache file. The offset is added
+ to the placement table rather than the placement info, which may be a read-only mapping of a binary
+ centroid file, and the table is kept with the board for repairing the program after a failed pick. The
+ parts taken from each feeder and the cycle time are kept for forecasting the feeder inventory. Nothing
+ is logged, so the board can be prepared on a background thread
+ Argument(s):
+ JobBoard *board - the board, its results are left in centroid_result and plan_result
+ Return Value: none
+ Usage:
+ prepareJobBoard(&job.board[0]);
+ */
+void prepareJobBoard(JobBoard *board)
+{
+    PlacementTable *table = &board -> table;
+
+    if (board -> path == JOB_WORKING_DIRECTORY_BOARD) board -> centroid_result = getCentroidFileContents(&board -> operation_mode, &board -> store, &board -> error);
+    else board -> centroid_result = loadCentroidFile(board -> path, &board -> operation_mode, &board -> store, &board -> error);
+
+    board -> plan_result = PLAN_OK;
+    if (board -> centroid_result != CENTROID_FILE_PRESENT_AND_READ) return;
+
+    for (int k = 0; k < board -> store.count; k++)
+    {
+        int feeder = board -> store.pi[k].feeder;
+        if (feeder >= 0 && feeder < NUMBER_OF_FEEDERS) board -> feeder_picks[feeder]++;
+    }
+    if (board -> operation_mode != AUTONOMOUS_CONTROL) return;
+
+    if (buildPlacementTable(board -> store.pi, board -> store.count, table))
+    {
+        /* the program is compiled and cached for the board as it is in its file, so every copy of a panel shares one */
+        programCachePath(table, board -> profile, PLAN_OPTION_GANG_PICK, board -> cache_file);
+        board -> cached = loadProgram(board -> cache_file, table, board -> profile, PLAN_OPTION_GANG_PICK, &board -> program);
+        if (board -> cached == FALSE)
+        {
+            board -> plan_result = planPlacement(table, board -> profile, PLAN_OPTION_GANG_PICK | PLAN_OPTION_MULTI_START, &board -> plan);
+            if (board -> plan_result == PLAN_OK) board -> plan_result = compileProgram(table, &board -> plan, board -> profile, PLAN_OPTION_GANG_PICK, &board -> program);
+            /* a program that cannot be cached is still run, the next run just compiles it again */
+            if (board -> plan_result == PLAN_OK) board -> saved = saveProgram(board -> cache_file, &board -> program, PLAN_OPTION_GANG_PICK);
+        }
+        board -> planned_time = board -> program.planned_time;
+
+        for (int k = 0; k < table -> count; k++)
+        {
+            table -> x[k] += board -> x_offset;
+            table -> y[k] += board -> y_offset;
+        }
+        if (board -> plan_result == PLAN_OK) offsetProgram(&board -> program, board -> x_offset, board -> y_offset);
+    }
+    else board -> plan_result = PLAN_OUT_OF_MEMORY;
+}
+
+/* background thread body, see startJobBoard() */
+static void *prepareJobBoardThread(void *argument)
+{
+    prepareJobBoard((JobBoard*)argument);
+    return NULL;
+}
+
+/*
+ Function: startJobBoard
+ -----------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ starts preparing a board on a background thread. If no thread can be started the board is prepared
+ straight away instead
+ Argument(s):
+ JobBoard *board - the board, not to be used until finishJobBoard() returns
+ Return Value: none
+ Usage:
+ startJobBoard(&job.board[b + 1]);
+ */
+void startJobBoard(JobBoard *board)
+{
+    board -> preparing = pthread_create(&board -> thread, NULL, prepareJobBoardThread, board) == 0;
+    if (board -> preparing == FALSE) prepareJobBoard(board);
+}
+
+/*
+ Function: finishJobBoard
+ ------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: waits for the background thread preparing a board, if there is one
+ Argument(s):
+ JobBoard *board - the board
+ Return Value: none
+ Usage: finishJobBoard(&job.board[b]);
+ */
+void finishJobBoard(JobBoard *board)
+{
+    if (board -> preparing) pthread_join(board -> thread, NULL);
+    board -> preparing = FALSE;
+}
+
+/*
+ Function: freeJobBoard
+ ----------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: frees the placement info, table, plan and program of a board once any background preparation ends
+ Argument(s):
+ JobBoard *board - the board
+ Return Value: none
+ Usage: freeJobBoard(&job.board[b]);
+ */
+void freeJobBoard(JobBoard *board)
+{
+    finishJobBoard(board);
+    freePlacementStore(&board -> store);
+    freePlacementTable(&board -> table);
+    freePlacementPlan(&board -> plan);
+    freeProgram(&board -> program);
+}
+
+/*
+ Function: freeJob
+ -----------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: frees every board of a job, including one still being prepared when the user quit
+ Argument(s):
+ PnPJob *job - the job
+ Return Value: none
+ Usage: freeJob(&job);
+ */
+void freeJob(PnPJob *job)
+{
+    for (int b = 0; b < job -> number_of_boards; b++) freeJobBoard(&job -> board[b]);
+    free(job -> board);
+    job -> board = NULL;
+    job -> number_of_boards = 0;
+}
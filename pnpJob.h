@@ -0,0 +1,73 @@
+/*
+ *
+ * pnpJob.h - declarations for job mode, a queue of boards run one after another in a single controller
+ * session, each board prepared on a background thread while the one before it is being placed
+ *
+ * Platform: Any POSIX compliant platform
+ * Intended for and tested on: Cygwin 64 bit
+ *
+ */
+
+#ifndef PNP_JOB_H
+#define PNP_JOB_H
+
+#include "pnpProgram.h"
+
+#define JOB_MAX_BOARDS 1024                 // boards in one job, including every copy of a panelised board
+#define JOB_WORKING_DIRECTORY_BOARD NULL    // path of the board read from the working directory the way a single board run does
+
+typedef struct
+{
+    int columns;                            // copies of every centroid file along x and along y, 1 by 1 without a panel
+    int rows;
+    double x_step;                          // offset in mm between neighbouring copies
+    double y_step;
+
+} JobPanel;
+
+typedef struct
+{
+    const char *path;                       // centroid file, or JOB_WORKING_DIRECTORY_BOARD
+    const MotionProfile *profile;           // motion profile the route is planned with
+    double x_offset;                        // step and repeat offset added to every placement target of the board
+    double y_offset;
+    int operation_mode;
+    int centroid_result;                    // CENTROID_FILE_PRESENT_AND_READ or the error reading the file
+    CentroidError error;
+    int plan_result;                        // PLAN_OK or the error planning the route, only set once the file was read
+    char cache_file[PROGRAM_CACHE_PATH_LENGTH]; // the board's program cache, shared by every copy of a panel
+    int cached;                             // TRUE if the program was loaded from cache_file rather than compiled
+    int saved;                              // TRUE if a compiled program was written to cache_file
+    PlacementStore store;
+    PlacementTable table;                   // parts with the panel offset, kept to repair the program after a failed pick
+    PlacementPlan plan;                     // route the program was compiled from, empty when cached
+    PnPProgram program;                     // autonomous mode only
+    int feeder_picks[NUMBER_OF_FEEDERS];    // parts the board takes from each feeder, once the file was read
+    double planned_time;                    // estimated cycle time in s, autonomous mode only
+    pthread_t thread;
+    int preparing;                          // TRUE while a background thread is preparing the board
+
+} JobBoard;
+
+typedef struct
+{
+    JobBoard *board;
+    int number_of_boards;
+
+} PnPJob;
+
+int parseJobPanel(const char*, JobPanel*);
+
+int buildJob(char *const[], int, const JobPanel*, const MotionProfile*, PnPJob*);
+
+void prepareJobBoard(JobBoard*);
+
+void startJobBoard(JobBoard*);
+
+void finishJobBoard(JobBoard*);
+
+void freeJobBoard(JobBoard*);
+
+void freeJob(PnPJob*);
+
+#endif // PNP_JOB_H
@@ -0,0 +1,261 @@
+/*
+ *
+ * pnpLine.c - line mode, one board placed by several machines working side by side, each with its own
+ * simulator session and control thread. The board is split by feeder: a machine is loaded with the
+ * reels of some of the tape feeders and places every part fed from them, so a feeder's parts are never
+ * split between machines. balanceLine() chooses which machine holds each feeder so that the slowest
+ * machine, which sets the line's cycle time, finishes as early as possible
+ *
+ * Platform: Any POSIX compliant platform
+ * Intended for and tested on: Cygwin 64 bit
+ *
+ */
+
+#include "pnpLine.h"
+
+/*
+ Function: lineSessionFiles
+ --------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ gets the shared file and notification FIFO of a machine of the line. Machine 0 uses the files of the
+ original single machine, so a simulator started without -m drives it
+ Argument(s):
+ int machine - the machine, from 0
+ char *shared_file - set to the shared file, must hold PNP_PATH_LENGTH characters
+ char *notify_fifo - set to the FIFO, must hold PNP_PATH_LENGTH characters
+ Return Value: none
+ Usage:
+ lineSessionFiles(k, shared_file, notify_fifo);
+ */
+void lineSessionFiles(int machine, char *shared_file, char *notify_fifo)
+{
+    if (machine == 0)
+    {
+        snprintf(shared_file, PNP_PATH_LENGTH, "%s", MEMORY_MAPPED_FILE);
+        snprintf(notify_fifo, PNP_PATH_LENGTH, "%s", PNP_NOTIFY_FIFO);
+    }
+    else
+    {
+        snprintf(shared_file, PNP_PATH_LENGTH, LINE_SHARED_FILE_FORMAT, machine);
+        snprintf(notify_fifo, PNP_PATH_LENGTH, LINE_NOTIFY_FIFO_FORMAT, machine);
+    }
+}
+
+/*
+ Function: estimateMachineTime
+ -----------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ estimates how long a machine takes to place its share of a board, the estimated cycle time of their
+ planned route
+ Argument(s):
+ const PlacementInfo pi[] - the board
+ int count - the number of parts on the board
+ const LineBalance *balance - the feeders of each machine
+ int machine - the machine
+ const MotionProfile *profile - the motion profile of the machines
+ double *seconds - set to the estimate
+ Return Value:
+ PLAN_OK, or the error planning the machine's parts
+ Usage:
+ res = estimateMachineTime(pi, count, balance, m, profile, &balance -> machine_time[m]);
+ */
+static int estimateMachineTime(const PlacementInfo pi[], int count, const LineBalance *balance, int machine, const MotionProfile *profile, double *seconds)
+{
+    PlacementTable table;
+    PlacementPlan plan;
+    int parts, res;
+
+    PlacementInfo *subset = machinePlacements(pi, count, balance, machine, &parts);
+    if (subset == NULL) return PLAN_OUT_OF_MEMORY;
+
+    memset(&plan, 0, sizeof(plan));
+    if (buildPlacementTable(subset, parts, &table)) res = planPlacement(&table, profile, PLAN_OPTION_GANG_PICK, &plan);
+    else res = PLAN_OUT_OF_MEMORY;
+    if (res == PLAN_OK) *seconds = plan.planned_time;
+
+    freePlacementPlan(&plan);
+    freePlacementTable(&table);
+    free(subset);
+    return res;
+}
+
+/*
+ Function: improveLine
+ ---------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ improves a balance by moving a feeder off the slowest machine, or swapping it for a shorter feeder of
+ another machine, for as long as that leaves both machines faster than the slowest one was. Every move
+ evens the load, so the search always ends
+ Argument(s):
+ LineBalance *balance - the balance, updated in place
+ Return Value: none
+ Usage:
+ improveLine(balance);
+ */
+static void improveLine(LineBalance *balance)
+{
+    int improved = TRUE;
+
+    while (improved)
+    {
+        int slowest = 0;
+        improved = FALSE;
+
+        for (int m = 1; m < balance -> number_of_machines; m++)
+        {
+            if (balance -> machine_time[m] > balance -> machine_time[slowest]) slowest = m;
+        }
+
+        for (int f = 0; f < NUMBER_OF_FEEDERS && !improved; f++)
+        {
+            if (balance -> machine_of_feeder[f] != slowest) continue;
+
+            for (int m = 0; m < balance -> number_of_machines && !improved; m++)
+            {
+                if (m == slowest) continue;
+
+                /* a move, or a swap with a shorter feeder g of machine m, shifts moved s of work off the slowest machine */
+                for (int g = -1; g < NUMBER_OF_FEEDERS && !improved; g++)
+                {
+                    if (g >= 0 && balance -> machine_of_feeder[g] != m) continue;
+
+                    double moved = balance -> feeder_time[f] - ((g >= 0) ? balance -> feeder_time[g] : 0.0);
+                    if (moved <= 0.0 || balance -> machine_time[m] + moved >= balance -> machine_time[slowest]) continue;
+
+                    balance -> machine_of_feeder[f] = m;
+                    balance -> machine_time[slowest] -= moved;
+                    balance -> machine_time[m] += moved;
+                    balance -> machine_parts[slowest] -= balance -> feeder_parts[f];
+                    balance -> machine_parts[m] += balance -> feeder_parts[f];
+                    if (g >= 0)
+                    {
+                        balance -> machine_of_feeder[g] = slowest;
+                        balance -> machine_parts[m] -= balance -> feeder_parts[g];
+                        balance -> machine_parts[slowest] += balance -> feeder_parts[g];
+                    }
+                    improved = TRUE;
+                }
+            }
+        }
+    }
+}
+
+/*
+ Function: balanceLine
+ ---------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ splits a board across the machines of a line by feeder. Each feeder's parts are planned on their own to
+ estimate how long they take, the feeders are dealt out longest first to the machine with the least work
+ so far, then the result is improved by moving and swapping feeders off the slowest machine. A feeder
+ planned on its own travels from home and back, so once the feeders are placed each machine's share is
+ planned as a whole for the final estimates
+ Argument(s):
+ const PlacementInfo pi[] - the board
+ int count - the number of parts on the board
+ int machines - the number of machines, 1 to PNP_MAX_SESSIONS
+ const MotionProfile *profile - the motion profile of the machines
+ LineBalance *balance - set to the feeders of each machine and the estimated times
+ Return Value:
+ PLAN_OK, PLAN_INVALID_FEEDER if a part has no valid feeder, otherwise the error planning a feeder's parts
+ Usage:
+ res = balanceLine(store.pi, store.count, machines, &profile, &balance);
+ */
+int balanceLine(const PlacementInfo pi[], int count, int machines, const MotionProfile *profile, LineBalance *balance)
+{
+    int order[NUMBER_OF_FEEDERS], used = 0;
+
+    memset(balance, 0, sizeof(LineBalance));
+    balance -> number_of_machines = machines;
+    for (int f = 0; f < NUMBER_OF_FEEDERS; f++) balance -> machine_of_feeder[f] = LINE_NO_MACHINE;
+
+    for (int k = 0; k < count; k++)
+    {
+        if (pi[k].feeder < 0 || pi[k].feeder >= NUMBER_OF_FEEDERS) return PLAN_INVALID_FEEDER;
+        balance -> feeder_parts[pi[k].feeder]++;
+    }
+
+    for (int f = 0; f < NUMBER_OF_FEEDERS; f++)
+    {
+        if (balance -> feeder_parts[f] == 0) continue;
+
+        LineBalance single;
+        for (int g = 0; g < NUMBER_OF_FEEDERS; g++) single.machine_of_feeder[g] = (g == f) ? 0 : LINE_NO_MACHINE;
+
+        int res = estimateMachineTime(pi, count, &single, 0, profile, &balance -> feeder_time[f]);
+        if (res != PLAN_OK) return res;
+
+        /* insertion sort, longest first */
+        int k = used++;
+        while (k > 0 && balance -> feeder_time[order[k - 1]] < balance -> feeder_time[f])
+        {
+            order[k] = order[k - 1];
+            k--;
+        }
+        order[k] = f;
+    }
+
+    for (int k = 0; k < used; k++)
+    {
+        int f = order[k], least = 0;
+
+        for (int m = 1; m < machines; m++)
+        {
+            if (balance -> machine_time[m] < balance -> machine_time[least]) least = m;
+        }
+        balance -> machine_of_feeder[f] = least;
+        balance -> machine_time[least] += balance -> feeder_time[f];
+        balance -> machine_parts[least] += balance -> feeder_parts[f];
+    }
+    improveLine(balance);
+
+    for (int m = 0; m < machines; m++)
+    {
+        if (balance -> machine_parts[m] > 0)
+        {
+            int res = estimateMachineTime(pi, count, balance, m, profile, &balance -> machine_time[m]);
+            if (res != PLAN_OK) return res;
+        }
+        if (balance -> machine_time[m] > balance -> bottleneck_time) balance -> bottleneck_time = balance -> machine_time[m];
+    }
+    return PLAN_OK;
+}
+
+/*
+ Function: machinePlacements
+ ---------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ copies out the parts of a board one machine of the line places, those fed from its feeders, in board order
+ Argument(s):
+ const PlacementInfo pi[] - the board
+ int count - the number of parts on the board
+ const LineBalance *balance - the feeders of each machine
+ int machine - the machine
+ int *machine_count - set to the number of parts copied
+ Return Value:
+ the parts, to be freed with free(), or NULL if memory ran out
+ Usage:
+ machine[k].pi = machinePlacements(store.pi, store.count, &balance, k, &machine[k].count);
+ */
+PlacementInfo *machinePlacements(const PlacementInfo pi[], int count, const LineBalance *balance, int machine, int *machine_count)
+{
+    PlacementInfo *subset = malloc(((count > 0) ? count : 1) * sizeof(PlacementInfo));
+    int parts = 0;
+
+    if (subset == NULL) return NULL;
+    for (int k = 0; k < count; k++)
+    {
+        if (balance -> machine_of_feeder[pi[k].feeder] == machine) subset[parts++] = pi[k];
+    }
+    *machine_count = parts;
+    return subset;
+}
@@ -0,0 +1,54 @@
+/*
+ *
+ * pnpLine.h - declarations for line mode, one board split across several machines in a line, each
+ * driven through its own session by its own control thread, and the line balancer that splits it
+ *
+ * Platform: Any POSIX compliant platform
+ * Intended for and tested on: Cygwin 64 bit
+ *
+ */
+
+#ifndef PNP_LINE_H
+#define PNP_LINE_H
+
+#include "pnpInventory.h"
+
+#define LINE_SHARED_FILE_FORMAT MEMORY_MAPPED_FILE ".%d"   // shared file of machine k > 0 of a line, machine 0 uses MEMORY_MAPPED_FILE
+#define LINE_NOTIFY_FIFO_FORMAT PNP_NOTIFY_FIFO ".%d"       // notification FIFO of machine k > 0, machine 0 uses PNP_NOTIFY_FIFO
+#define LINE_SUPERVISE_INTERVAL_MS 100 // how often the keyboard thread checks whether every machine has finished while it waits for keys
+#define LINE_NO_MACHINE -1
+
+typedef struct
+{
+    int machine_of_feeder[NUMBER_OF_FEEDERS];   // machine whose feeder slot holds the feeder's reel, LINE_NO_MACHINE if the board does not use it
+    int feeder_parts[NUMBER_OF_FEEDERS];
+    double feeder_time[NUMBER_OF_FEEDERS];      // estimated s to place the feeder's parts on their own
+    int machine_parts[PNP_MAX_SESSIONS];
+    double machine_time[PNP_MAX_SESSIONS];      // estimated s per board on each machine, its share planned as a whole
+    int number_of_machines;
+    double bottleneck_time;                     // estimated line cycle time, that of the slowest machine
+
+} LineBalance;
+
+typedef struct
+{
+    PnPSession *session;
+    const MotionProfile *profile;               // motion profile the machine's route is planned with
+    int machine;                                // position of the machine in the line, from 0
+    PlacementInfo *pi;                          // the machine's share of the board, in board order
+    int count;
+    int result;                                 // PLAN_OK or the error planning the machine's route
+    double cycle_time;                          // s of simulation time the machine took over its share
+    FeederInventory *inventory;                 // shared by the machines, each only counts off its own feeders, NULL if none is tracked
+    pthread_t thread;
+    int started;                                // TRUE if the machine's control thread was started and is to be joined
+
+} LineMachine;
+
+void lineSessionFiles(int, char*, char*);
+
+int balanceLine(const PlacementInfo[], int, int, const MotionProfile*, LineBalance*);
+
+PlacementInfo *machinePlacements(const PlacementInfo[], int, const LineBalance*, int, int*);
+
+#endif // PNP_LINE_H
@@ -0,0 +1,494 @@
+/*
+ *
+ * pnpLog.c - the asynchronous log sink. The control loop only copies a record (time stamp, state, part,
+ * format, raw arguments and copies of its strings) into a single-producer/single-consumer ring owned by
+ * the calling thread, no formatting and no locks. A background drain thread merges the rings of every thread in time
+ * stamp order, formats the records and writes them to the terminal or to a file, so a slow console
+ * never holds up the controller. Records above the verbosity selected with PNP_LOG_LEVEL are dropped
+ * at the call site before their arguments are evaluated
+ *
+ * Platform: Any POSIX compliant platform
+ * Intended for and tested on: Cygwin 64 bit
+ *
+ */
+
+#include <stdarg.h>
+#include "pnpLog.h"
+
+#define ARGUMENT_NONE 0            // %%, takes no argument
+#define ARGUMENT_INTEGER 1
+#define ARGUMENT_UNSIGNED 2
+#define ARGUMENT_CHARACTER 3
+#define ARGUMENT_DOUBLE 4
+#define ARGUMENT_POINTER 5
+#define ARGUMENT_STRING 6
+
+typedef struct LogRing
+{
+    struct LogRing *next;          // every ring ever created, newest first
+    atomic_ulong head;             // records written, only advanced by the owning thread
+    atomic_ulong tail;             // records formatted, only advanced by the drain thread
+    LogRecord record[LOG_RING_SIZE];
+
+} LogRing;
+
+int log_level = LOG_DETAIL;
+
+static _Thread_local LogRing *thread_ring;
+static _Thread_local unsigned int thread_ring_generation;  // log_generation when thread_ring was created
+static atomic_uint log_generation;  // advanced by logClose(), which frees every ring, so no thread reuses one
+static _Atomic(LogRing *) rings;
+static atomic_int running;         // TRUE while the drain thread is serving the rings, otherwise records are printed straight away
+static atomic_int stopping;
+static atomic_int draining;        // TRUE while the drain thread may hold records it has taken but not yet written out
+static atomic_ulong stalls;
+static pthread_t drain_thread;
+static FILE *log_output;
+static struct timespec log_origin;
+
+/*
+ Function: pauseMicroseconds
+ ---------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: puts the calling thread to sleep for a short time
+ Argument(s):
+ long us - the number of us to sleep
+ Return Value: none
+ Usage: pauseMicroseconds(100);
+ */
+static void pauseMicroseconds(long us)
+{
+    struct timespec ts = {us / 1000000, (us % 1000000) * 1000};
+
+    nanosleep(&ts, NULL);
+}
+
+/*
+ Function: parseConversion
+ -------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ reads one printf conversion specification. The copy made for formatting has any length modifier
+ replaced with ll for integer conversions, since every integer argument is stored as a long long.
+ Field widths and precisions given as * are not supported
+ Argument(s):
+ const char *f - points at the %
+ char *spec - set to the specification, must hold 32 characters
+ int *type - set to the kind of argument the conversion takes, ARGUMENT_NONE for %%
+ int *length - set to 1 for l, 2 for ll, 3 for z and j, 0 otherwise
+ Return Value: a pointer to the character after the conversion
+ Usage: f = parseConversion(f, spec, &type, &length);
+ */
+static const char *parseConversion(const char *f, char *spec, int *type, int *length)
+{
+    int n = 0;
+
+    spec[n++] = *f++;
+    while (*f != '\0' && strchr("-+ #0123456789.", *f) != NULL && n < 26) spec[n++] = *f++;
+
+    *length = 0;
+    while (*f == 'h' || *f == 'l' || *f == 'z' || *f == 'j' || *f == 't' || *f == 'L')
+    {
+        if (*f == 'l') *length = (*length == 1) ? 2 : 1;
+        else if (*f == 'z' || *f == 'j' || *f == 't') *length = 3;
+        f++;
+    }
+
+    switch (*f)
+    {
+        case 'd': case 'i':
+            *type = ARGUMENT_INTEGER;
+            break;
+        case 'u': case 'x': case 'X': case 'o':
+            *type = ARGUMENT_UNSIGNED;
+            break;
+        case 'c':
+            *type = ARGUMENT_CHARACTER;
+            break;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+            *type = ARGUMENT_DOUBLE;
+            break;
+        case 's':
+            *type = ARGUMENT_STRING;
+            break;
+        case 'p':
+            *type = ARGUMENT_POINTER;
+            break;
+        default:
+            *type = ARGUMENT_NONE;
+    }
+    if (*type == ARGUMENT_INTEGER || *type == ARGUMENT_UNSIGNED)
+    {
+        spec[n++] = 'l';
+        spec[n++] = 'l';
+    }
+    if (*f != '\0') spec[n++] = *f++;
+    spec[n] = '\0';
+    return f;
+}
+
+/*
+ Function: ringForThisThread
+ ---------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ gets the calling thread's ring, creating it and adding it to the list the drain thread serves on first
+ use. A ring left from before the last logClose() has been freed and is replaced
+ Argument(s): none
+ Return Value: the ring, or NULL if it could not be allocated
+ Usage: LogRing *ring = ringForThisThread();
+ */
+static LogRing *ringForThisThread()
+{
+    unsigned int generation = atomic_load(&log_generation);
+
+    if (thread_ring != NULL && thread_ring_generation == generation) return thread_ring;
+
+    LogRing *ring = calloc(1, sizeof(LogRing));
+    if (ring == NULL) return NULL;
+
+    ring -> next = atomic_load(&rings);
+    while (!atomic_compare_exchange_weak(&rings, &ring -> next, ring));
+    thread_ring = ring;
+    thread_ring_generation = generation;
+    return ring;
+}
+
+/*
+ Function: logRecord
+ -------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ logs a message. The format and arguments are copied into the calling thread's ring and formatted later
+ by the drain thread; if the ring is full the call waits for the drain thread to make room, so no message
+ is ever lost. %s arguments are copied into the record, up to their precision, and truncated once
+ LOG_STRING_SPACE is used up, so they need not outlive the call. Before logOpen() and after logClose() the message is printed straight away. Normally
+ called through the pnpLog() macro, which skips the call for records above the selected verbosity
+ Argument(s):
+ int level - LOG_ESSENTIAL, LOG_STATE or LOG_DETAIL
+ int state - the control loop state
+ int part - the index of the part being handled, or -1
+ const char *format - printf format, must outlive the log
+ ... - the arguments
+ Return Value: none
+ Usage: pnpLog(LOG_STATE, state, part, "Time: %7.2f  New state: %.20s\n", snapshot.sim_time, state_name[state]);
+ */
+void logRecord(int level, int state, int part, const char *format, ...)
+{
+    va_list arguments;
+    LogRing *ring = atomic_load(&running) ? ringForThisThread() : NULL;
+
+    va_start(arguments, format);
+    if (ring == NULL)
+    {
+        vprintf(format, arguments);
+        va_end(arguments);
+        return;
+    }
+
+    unsigned long head = atomic_load_explicit(&ring -> head, memory_order_relaxed);
+    while (head - atomic_load_explicit(&ring -> tail, memory_order_acquire) >= LOG_RING_SIZE)
+    {
+        atomic_fetch_add(&stalls, 1);
+        pauseMicroseconds(100);
+    }
+
+    LogRecord *record = &ring -> record[head & (LOG_RING_SIZE - 1)];
+    struct timespec now;
+    char spec[32];
+    size_t strings_used = 0;
+    int type, length, n = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    record -> timestamp = (uint64_t)(now.tv_sec - log_origin.tv_sec) * 1000000000ULL + (uint64_t)now.tv_nsec - (uint64_t)log_origin.tv_nsec;
+    record -> format = format;
+    record -> level = level;
+    record -> state = state;
+    record -> part = part;
+
+    for (const char *f = format; *f != '\0' && n < LOG_MAX_ARGUMENTS; )
+    {
+        if (*f != '%')
+        {
+            f++;
+            continue;
+        }
+        f = parseConversion(f, spec, &type, &length);
+        switch (type)
+        {
+            case ARGUMENT_INTEGER:
+                record -> argument[n++].i = (length == 2) ? va_arg(arguments, long long) : (length == 1) ? va_arg(arguments, long) : (length == 3) ? (long long)va_arg(arguments, ptrdiff_t) : va_arg(arguments, int);
+                break;
+            case ARGUMENT_UNSIGNED:
+                record -> argument[n++].i = (long long)((length == 2) ? va_arg(arguments, unsigned long long) : (length == 1) ? va_arg(arguments, unsigned long) : (length == 3) ? va_arg(arguments, size_t) : va_arg(arguments, unsigned int));
+                break;
+            case ARGUMENT_CHARACTER:
+                record -> argument[n++].i = va_arg(arguments, int);
+                break;
+            case ARGUMENT_DOUBLE:
+                record -> argument[n++].d = va_arg(arguments, double);
+                break;
+            case ARGUMENT_POINTER:
+                record -> argument[n++].p = va_arg(arguments, const void *);
+                break;
+            case ARGUMENT_STRING:
+            {
+                const char *string = va_arg(arguments, const char *);
+                const char *precision = strchr(spec, '.');
+                size_t offset = (strings_used < LOG_STRING_SPACE) ? strings_used : LOG_STRING_SPACE - 1;  // once full, the last terminator
+                size_t space = LOG_STRING_SPACE - offset - 1;
+                size_t copied;
+
+                if (string == NULL) string = "(null)";
+                if (precision != NULL && (size_t)atoi(precision + 1) < space) space = (size_t)atoi(precision + 1);
+                copied = strnlen(string, space);
+                memcpy(record -> strings + offset, string, copied);
+                record -> strings[offset + copied] = '\0';
+                record -> argument[n++].s = offset;
+                strings_used = offset + copied + 1;
+                break;
+            }
+        }
+    }
+    va_end(arguments);
+    record -> number_of_arguments = n;
+
+    atomic_store_explicit(&ring -> head, head + 1, memory_order_release);
+}
+
+/*
+ Function: formatRecord
+ ----------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: formats a record one conversion at a time from its stored arguments
+ Argument(s):
+ const LogRecord *record - the record
+ char *line - set to the formatted message
+ size_t size - the size of line
+ Return Value: none
+ Usage: formatRecord(record, line, sizeof(line));
+ */
+static void formatRecord(const LogRecord *record, char *line, size_t size)
+{
+    char spec[32];
+    size_t used = 0;
+    int type, length, n = 0;
+
+    for (const char *f = record -> format; *f != '\0' && used < size - 1; )
+    {
+        if (*f != '%')
+        {
+            line[used++] = *f++;
+            continue;
+        }
+        f = parseConversion(f, spec, &type, &length);
+
+        int written = 0;
+        if (type == ARGUMENT_NONE || n >= record -> number_of_arguments) written = snprintf(line + used, size - used, "%s", (type == ARGUMENT_NONE) ? "%" : spec);
+        else if (type == ARGUMENT_DOUBLE) written = snprintf(line + used, size - used, spec, record -> argument[n++].d);
+        else if (type == ARGUMENT_POINTER) written = snprintf(line + used, size - used, spec, record -> argument[n++].p);
+        else if (type == ARGUMENT_STRING) written = snprintf(line + used, size - used, spec, record -> strings + record -> argument[n++].s);
+        else if (type == ARGUMENT_CHARACTER) written = snprintf(line + used, size - used, spec, (int)record -> argument[n++].i);
+        else written = snprintf(line + used, size - used, spec, record -> argument[n++].i);
+
+        if (written > 0) used += ((size_t)written < size - used) ? (size_t)written : size - used - 1;
+    }
+    line[used] = '\0';
+}
+
+/*
+ Function: drainRecords
+ ----------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: formats and writes out every record waiting in any ring, oldest first, then flushes the output
+ Argument(s): none
+ Return Value: the number of records written
+ Usage: if (drainRecords() == 0) ... nothing to do ...
+ */
+static int drainRecords()
+{
+    char line[LOG_LINE_LENGTH];
+    int written = 0;
+
+    atomic_store(&draining, TRUE);
+    for (;;)
+    {
+        LogRing *oldest = NULL;
+        uint64_t oldest_timestamp = UINT64_MAX;
+
+        for (LogRing *ring = atomic_load(&rings); ring != NULL; ring = ring -> next)
+        {
+            unsigned long tail = atomic_load_explicit(&ring -> tail, memory_order_relaxed);
+            if (tail == atomic_load_explicit(&ring -> head, memory_order_acquire)) continue;
+            if (ring -> record[tail & (LOG_RING_SIZE - 1)].timestamp < oldest_timestamp)
+            {
+                oldest = ring;
+                oldest_timestamp = ring -> record[tail & (LOG_RING_SIZE - 1)].timestamp;
+            }
+        }
+        if (oldest == NULL) break;
+
+        unsigned long tail = atomic_load_explicit(&oldest -> tail, memory_order_relaxed);
+        const LogRecord *record = &oldest -> record[tail & (LOG_RING_SIZE - 1)];
+
+        formatRecord(record, line, sizeof(line));
+        if (log_output != stdout) fprintf(log_output, "%12.6f %2d %6d  ", record -> timestamp / 1e9, record -> state, record -> part);
+        fputs(line, log_output);
+        atomic_store_explicit(&oldest -> tail, tail + 1, memory_order_release);
+        written++;
+    }
+    if (written > 0) fflush(log_output);
+    atomic_store(&draining, FALSE);
+    return written;
+}
+
+/*
+ Function: drainLoop
+ -------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: the drain thread, writes out records until logClose() stops it, then writes out whatever is left
+ Argument(s):
+ void *arguments - unused
+ Return Value: NULL
+ Usage: pthread_create(&drain_thread, NULL, drainLoop, NULL);
+ */
+static void *drainLoop(void *arguments)
+{
+    (void)arguments;
+    while (!atomic_load(&stopping))
+    {
+        if (drainRecords() == 0) pauseMicroseconds(LOG_DRAIN_INTERVAL_MS * 1000L);
+    }
+    drainRecords();
+    return NULL;
+}
+
+/*
+ Function: logOpen
+ -----------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ reads the verbosity from PNP_LOG_LEVEL and the output file from PNP_LOG_FILE, then starts the drain
+ thread. If the drain thread cannot be started messages are printed straight away instead
+ Argument(s): none
+ Return Value: none
+ Usage: logOpen();
+ */
+void logOpen()
+{
+    const char *level = getenv(LOG_LEVEL_ENVIRONMENT_VARIABLE);
+    const char *path = getenv(LOG_FILE_ENVIRONMENT_VARIABLE);
+
+    if (level != NULL)
+    {
+        if (strcmp(level, "essential") == 0 || strcmp(level, "0") == 0) log_level = LOG_ESSENTIAL;
+        else if (strcmp(level, "state") == 0 || strcmp(level, "1") == 0) log_level = LOG_STATE;
+        else log_level = LOG_DETAIL;
+    }
+
+    log_output = stdout;
+    if (path != NULL && path[0] != '\0')
+    {
+        log_output = fopen(path, "w");
+        if (log_output == NULL)
+        {
+            perror("opening of log file failed, logging to the terminal");
+            log_output = stdout;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &log_origin);
+    atomic_store(&stopping, FALSE);
+    atomic_store(&running, TRUE);
+    if (pthread_create(&drain_thread, NULL, drainLoop, NULL) != 0) atomic_store(&running, FALSE);
+}
+
+/*
+ Function: logFlush
+ ------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: waits until every message logged so far has been written out and flushed
+ Argument(s): none
+ Return Value: none
+ Usage:
+ pnpLog(LOG_ESSENTIAL, state, -1, "All components placed - press q to quit\n");
+ logFlush();
+ */
+void logFlush()
+{
+    if (!atomic_load(&running))
+    {
+        fflush(stdout);
+        return;
+    }
+
+    /* the rings are checked before the drain flag, a record taken from a ring is only written once the flag clears */
+    for (;;)
+    {
+        int empty = TRUE;
+        for (LogRing *ring = atomic_load(&rings); ring != NULL && empty; ring = ring -> next)
+        {
+            empty = (atomic_load(&ring -> tail) == atomic_load(&ring -> head));
+        }
+        if (empty && !atomic_load(&draining)) return;
+        pauseMicroseconds(200);
+    }
+}
+
+/*
+ Function: logClose
+ ------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ writes out every message logged so far, stops the drain thread, closes the log file and frees the
+ rings of every thread. A thread that logs after the log is opened again gets a new ring
+ Argument(s): none
+ Return Value: none
+ Usage: logClose();
+ */
+void logClose()
+{
+    if (!atomic_load(&running)) return;
+
+    atomic_store(&stopping, TRUE);
+    pthread_join(drain_thread, NULL);
+    atomic_store(&running, FALSE);
+
+    if (log_output != stdout) fclose(log_output);
+    log_output = stdout;
+
+    LogRing *ring = atomic_exchange(&rings, NULL);
+    while (ring != NULL)
+    {
+        LogRing *next = ring -> next;
+        free(ring);
+        ring = next;
+    }
+    thread_ring = NULL;
+    atomic_fetch_add(&log_generation, 1);
+}
+
+/*
+ Function: getLogStalls
+ ----------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: gets the number of times a logging thread had to wait because its ring was full
+ Argument(s): none
+ Return Value: the number of waits
+ Usage: unsigned long stalls = getLogStalls();
+ */
+unsigned long getLogStalls()
+{
+    return atomic_load(&stalls);
+}
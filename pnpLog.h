@@ -0,0 +1,65 @@
+/*
+ *
+ * pnpLog.h - declarations for the asynchronous log sink used by the control loop in place of printf
+ *
+ * Platform: Any POSIX compliant platform
+ * Intended for and tested on: Cygwin 64 bit
+ *
+ */
+
+#ifndef PNP_LOG_H
+#define PNP_LOG_H
+
+#include "pnpControl.h"
+
+#define LOG_LEVEL_ENVIRONMENT_VARIABLE "PNP_LOG_LEVEL"   // essential, state or detail (or 0, 1, 2), the default is detail
+#define LOG_FILE_ENVIRONMENT_VARIABLE "PNP_LOG_FILE"     // log to this file rather than the terminal
+
+#define LOG_ESSENTIAL 0            // problems, prompts the user needs to operate the machine and the completion message
+#define LOG_STATE 1                // state transitions
+#define LOG_DETAIL 2               // part listings and per nozzle details
+
+#define LOG_RING_SIZE 1024         // records each logging thread can have waiting to be formatted, must be a power of two
+#define LOG_MAX_ARGUMENTS 12       // arguments a single record can carry
+#define LOG_DRAIN_INTERVAL_MS 5    // how often the drain thread looks for new records when it has nothing to do
+#define LOG_LINE_LENGTH 1024       // longest formatted message, longer ones are truncated
+#define LOG_STRING_SPACE 256       // bytes a record has for copies of its %s arguments, including their terminators, longer ones are truncated
+
+typedef union
+{
+    long long i;                   // any integer or character conversion
+    double d;                      // any floating point conversion
+    const void *p;                 // %p
+    size_t s;                      // %s, offset of the copy in the record's strings
+
+} LogArgument;
+
+typedef struct
+{
+    uint64_t timestamp;            // ns of monotonic clock time since logOpen()
+    const char *format;            // printf format, must be a string literal or otherwise outlive the log
+    int level;
+    int state;                     // control loop state when the record was made
+    int part;                      // index of the part being handled, or -1
+    int number_of_arguments;
+    LogArgument argument[LOG_MAX_ARGUMENTS];
+    char strings[LOG_STRING_SPACE];  // copies of the %s arguments, so the caller's strings may change or be freed at once
+
+} LogRecord;
+
+/* records above the selected verbosity are dropped before their arguments are even evaluated */
+#define pnpLog(level, state, part, ...) do { if ((level) <= log_level) logRecord((level), (state), (part), __VA_ARGS__); } while (0)
+
+extern int log_level;
+
+void logOpen();
+
+void logClose();
+
+void logFlush();
+
+void logRecord(int, int, int, const char*, ...) __attribute__((format(printf, 4, 5)));
+
+unsigned long getLogStalls();
+
+#endif // PNP_LOG_H
@@ -0,0 +1,390 @@
+/*
+ *
+ * pnpMotion.c - the motion cost model. Head moves follow a trapezoidal velocity profile along the line of
+ * the move, as in the simulator, and each axis may also be limited on its own, so a move takes as long as
+ * the slowest of the three profiles plus the settle time. The parameters are read from a motion profile,
+ * a file in the same "name value" format as the simulator's config file. The cost matrix holds the time
+ * of every head move the planner makes to or from a feeder, the lookup camera or home, so the planner
+ * looks up the cost of a move rather than working it out
+ *
+ * Platform: Any POSIX compliant platform
+ * Intended for and tested on: Cygwin 64 bit
+ *
+ */
+
+#include "pnpMotion.h"
+
+/*
+ Function: defaultMotionProfile
+ ------------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: fills in the motion profile of the default simulator
+ Argument(s):
+ MotionProfile *profile - the profile to fill in
+ Return Value: none
+ Usage: defaultMotionProfile(&profile);
+ */
+void defaultMotionProfile(MotionProfile *profile)
+{
+    profile -> gantry_speed = 500.0;
+    profile -> gantry_acceleration = 2000.0;
+    profile -> x_speed = 500.0;
+    profile -> x_acceleration = 2000.0;
+    profile -> y_speed = 500.0;
+    profile -> y_acceleration = 2000.0;
+    profile -> settle_time = 0.0;
+    profile -> rotation_speed = 360.0;
+    profile -> rotation_acceleration = 3600.0;
+    profile -> nozzle_time = 0.15;
+    profile -> vacuum_time = 0.05;
+    profile -> photo_time = 0.1;
+}
+
+/*
+ Function: loadMotionProfile
+ ---------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ reads a motion profile from a file of "name value" lines, where name is one of the MotionProfile
+ fields. The simulator's error model settings are skipped, so the simulator's config file can be given
+ as it is. Blank lines and lines starting with # are ignored, settings not in the file keep their
+ current value
+ Argument(s):
+ const char *path - the motion profile
+ MotionProfile *profile - the profile to update
+ Return Value:
+ TRUE (1) on success, FALSE (0) if the file could not be read, the problem is printed
+ Usage:
+ if (!loadMotionProfile(optarg, &profile)) exit(1);
+ */
+int loadMotionProfile(const char *path, MotionProfile *profile)
+{
+    static const struct { const char *name; size_t offset; } SETTINGS[] =
+    {
+        {"gantry_speed", offsetof(MotionProfile, gantry_speed)},
+        {"gantry_acceleration", offsetof(MotionProfile, gantry_acceleration)},
+        {"x_speed", offsetof(MotionProfile, x_speed)},
+        {"x_acceleration", offsetof(MotionProfile, x_acceleration)},
+        {"y_speed", offsetof(MotionProfile, y_speed)},
+        {"y_acceleration", offsetof(MotionProfile, y_acceleration)},
+        {"settle_time", offsetof(MotionProfile, settle_time)},
+        {"rotation_speed", offsetof(MotionProfile, rotation_speed)},
+        {"rotation_acceleration", offsetof(MotionProfile, rotation_acceleration)},
+        {"nozzle_time", offsetof(MotionProfile, nozzle_time)},
+        {"vacuum_time", offsetof(MotionProfile, vacuum_time)},
+        {"photo_time", offsetof(MotionProfile, photo_time)}
+    };
+    static const char *const SIMULATOR_ONLY[] = {"theta_error_sigma", "theta_error_limit", "position_error_sigma", "position_error_limit", "pick_failure_rate", "seed"};
+    char text[256], name[64], value[64];
+    int line = 0;
+
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+    {
+        perror("opening of motion profile failed");
+        return FALSE;
+    }
+
+    while (fgets(text, sizeof(text), fp) != NULL)
+    {
+        int fields = sscanf(text, "%63s %63s", name, value);
+        char *end;
+        int known = FALSE;
+
+        line++;
+        if (fields <= 0 || name[0] == '#') continue;
+        if (fields != 2)
+        {
+            printf("Problem with motion profile %s at line %d: expected a name and a value\n", path, line);
+            fclose(fp);
+            return FALSE;
+        }
+
+        for (size_t k = 0; k < sizeof(SIMULATOR_ONLY) / sizeof(SIMULATOR_ONLY[0]) && !known; k++) known = (strcmp(name, SIMULATOR_ONLY[k]) == 0);
+        for (size_t k = 0; k < sizeof(SETTINGS) / sizeof(SETTINGS[0]) && !known; k++)
+        {
+            if (strcmp(name, SETTINGS[k].name) != 0) continue;
+            *(double *)((char *)profile + SETTINGS[k].offset) = strtod(value, &end);
+            known = (*end == '\0');
+        }
+        if (!known)
+        {
+            printf("Problem with motion profile %s at line %d: unknown setting or bad value %s %s\n", path, line, name, value);
+            fclose(fp);
+            return FALSE;
+        }
+    }
+
+    fclose(fp);
+    return TRUE;
+}
+
+/*
+ Function: trapezoidTime
+ -----------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ gets the time taken by a motion that accelerates to the maximum speed, cruises and decelerates to a
+ stop, or for a motion too short to reach the maximum speed, accelerates half way and decelerates the rest
+ Argument(s):
+ double distance - the distance, mm or degrees, either sign
+ double speed - the maximum speed, 0 or less for no limit
+ double acceleration - the acceleration and deceleration, 0 or less for instant changes of speed
+ Return Value: a double representing the time in s
+ Usage: double t = trapezoidTime(dx, profile -> x_speed, profile -> x_acceleration);
+ */
+static double trapezoidTime(double distance, double speed, double acceleration)
+{
+    distance = fabs(distance);
+    if (distance == 0.0 || speed <= 0.0) return 0.0;
+    if (acceleration <= 0.0) return distance / speed;
+    if (distance < speed * speed / acceleration) return 2.0 * sqrt(distance / acceleration);
+    return distance / speed + speed / acceleration;
+}
+
+/*
+ Function: moveTime
+ ------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ gets the time a head move takes: the slowest of the profile along the line of the move and the profiles
+ of the x and y axes, which accelerate independently, then the settle time. A move to where the head
+ already is takes no time, no move is made
+ Argument(s):
+ const MotionProfile *profile - the motion profile
+ double x1, double y1 - the head position before the move
+ double x2, double y2 - the head position after it
+ Return Value: a double representing the time in s
+ Usage: double t = moveTime(&profile, HOME_X, HOME_Y, LOOKUP_CAMERA_X, LOOKUP_CAMERA_Y);
+ */
+double moveTime(const MotionProfile *profile, double x1, double y1, double x2, double y2)
+{
+    double dx = x2 - x1, dy = y2 - y1;
+
+    if (dx == 0.0 && dy == 0.0) return 0.0;
+
+    double time = trapezoidTime(hypot(dx, dy), profile -> gantry_speed, profile -> gantry_acceleration);
+    double x_time = trapezoidTime(dx, profile -> x_speed, profile -> x_acceleration);
+    double y_time = trapezoidTime(dy, profile -> y_speed, profile -> y_acceleration);
+
+    if (x_time > time) time = x_time;
+    if (y_time > time) time = y_time;
+    return time + profile -> settle_time;
+}
+
+/*
+ Function: rotationTime
+ ----------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: gets the time a nozzle takes to rotate through an angle
+ Argument(s):
+ const MotionProfile *profile - the motion profile
+ double degrees - the rotation, either sign
+ Return Value: a double representing the time in s
+ Usage: matrix -> rotation_time[k] = rotationTime(profile, table -> theta[k]);
+ */
+double rotationTime(const MotionProfile *profile, double degrees)
+{
+    return trapezoidTime(degrees, profile -> rotation_speed, profile -> rotation_acceleration);
+}
+
+/*
+ Function: nozzleOffsetX
+ -----------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ gets the x-offset of a nozzle from the centre of the gantry head
+ Argument(s):
+ int nozzle - LEFT_NOZZLE, CENTRE_NOZZLE or RIGHT_NOZZLE
+ Return Value:
+ a double representing the offset in mm, negative for the left nozzle
+ Usage:
+ double offset = nozzleOffsetX(nozzle);
+ */
+double nozzleOffsetX(int nozzle)
+{
+    return (nozzle - CENTRE_NOZZLE) * NOZZLE_X_SEPARATION;
+}
+
+/*
+ Function: nozzlePickPosition
+ ----------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ gets the head position that places the specified nozzle over the specified tape feeder
+ Argument(s):
+ int feeder - the tape feeder to pick from
+ int nozzle - the nozzle to pick with
+ double *head_x, double *head_y - set to the head position
+ Return Value: none
+ Usage:
+ nozzlePickPosition(table -> feeder[part], nozzle, &x, &y);
+ */
+void nozzlePickPosition(int feeder, int nozzle, double *head_x, double *head_y)
+{
+    *head_x = TAPE_FEEDER_X[feeder] - nozzleOffsetX(nozzle);
+    *head_y = TAPE_FEEDER_Y[feeder];
+}
+
+/*
+ Function: nozzlePlacePosition
+ -----------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ gets the head position that places the specified nozzle over the target position of a part
+ Argument(s):
+ const PlacementTable *table - the placement table of all parts
+ int part - the index of the part to place
+ int nozzle - the nozzle carrying the part
+ double *head_x, double *head_y - set to the head position
+ Return Value: none
+ Usage:
+ nozzlePlacePosition(table, part, nozzle, &x, &y);
+ */
+void nozzlePlacePosition(const PlacementTable *table, int part, int nozzle, double *head_x, double *head_y)
+{
+    *head_x = table -> x[part] - nozzleOffsetX(nozzle);
+    *head_y = table -> y[part];
+}
+
+/*
+ Function: isReachable
+ ---------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ determines whether a head position lies within the gantry travel limits
+ Argument(s):
+ double x, double y - the head position
+ Return Value:
+ TRUE (1) if the simulator will accept a MOVE_HEAD to the position, otherwise FALSE (0)
+ Usage:
+ if (isReachable(x, y)) ...
+ */
+static int isReachable(double x, double y)
+{
+    return x >= MIN_X && x <= MAX_X && y >= MIN_Y && y <= MAX_Y;
+}
+
+/*
+ Function: buildMotionCostMatrix
+ -------------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ works out the head position of every site of a board, home, the lookup camera, every feeder under every
+ nozzle and every part's target under every nozzle, and the time of every move between a fixed site and
+ any other site. Moves between two place sites are not stored, a dense matrix of them would grow with
+ the square of the parts, so motionTime() works them out from the profile, which takes as long
+ Argument(s):
+ const PlacementTable *table - the placement table of all parts, every feeder must be valid
+ const MotionProfile *profile - the motion profile, copied into the matrix
+ MotionCostMatrix *matrix - set to the matrix, free with freeMotionCostMatrix()
+ Return Value:
+ TRUE (1) on success, FALSE (0) if memory ran out
+ Usage:
+ if (!buildMotionCostMatrix(table, profile, &matrix)) return PLAN_OUT_OF_MEMORY;
+ */
+int buildMotionCostMatrix(const PlacementTable *table, const MotionProfile *profile, MotionCostMatrix *matrix)
+{
+    size_t parts = (table -> count > 0) ? (size_t)table -> count : 1;
+
+    memset(matrix, 0, sizeof(MotionCostMatrix));
+    arenaInit(&matrix -> arena, ARENA_BLOCK_SIZE);
+    matrix -> profile = *profile;
+    matrix -> number_of_sites = MOTION_PLACE_SITE(table -> count, 0);
+    matrix -> pick_handling_time = 2.0 * profile -> nozzle_time + profile -> vacuum_time;
+    matrix -> place_handling_time = 2.0 * profile -> nozzle_time + profile -> vacuum_time;
+
+    matrix -> site_x = arenaAlloc(&matrix -> arena, sizeof(double) * (size_t)matrix -> number_of_sites);
+    matrix -> site_y = arenaAlloc(&matrix -> arena, sizeof(double) * (size_t)matrix -> number_of_sites);
+    matrix -> reachable = arenaAlloc(&matrix -> arena, (size_t)matrix -> number_of_sites);
+    matrix -> fixed_time = arenaAlloc(&matrix -> arena, sizeof(double) * MOTION_FIXED_SITES * MOTION_FIXED_SITES);
+    matrix -> place_time = arenaAlloc(&matrix -> arena, sizeof(double) * MOTION_FIXED_SITES * NUMBER_OF_NOZZLES * parts);
+    matrix -> rotation_time = arenaAlloc(&matrix -> arena, sizeof(double) * parts);
+    if (matrix -> site_x == NULL || matrix -> site_y == NULL || matrix -> reachable == NULL || matrix -> fixed_time == NULL ||
+        matrix -> place_time == NULL || matrix -> rotation_time == NULL) return FALSE;
+
+    matrix -> site_x[MOTION_HOME_SITE] = HOME_X;
+    matrix -> site_y[MOTION_HOME_SITE] = HOME_Y;
+    matrix -> site_x[MOTION_CAMERA_SITE] = LOOKUP_CAMERA_X;
+    matrix -> site_y[MOTION_CAMERA_SITE] = LOOKUP_CAMERA_Y;
+    for (int nozzle = 0; nozzle < NUMBER_OF_NOZZLES; nozzle++)
+    {
+        for (int f = 0; f < NUMBER_OF_FEEDERS; f++)
+        {
+            nozzlePickPosition(f, nozzle, &matrix -> site_x[MOTION_PICK_SITE(f, nozzle)], &matrix -> site_y[MOTION_PICK_SITE(f, nozzle)]);
+        }
+        for (int k = 0; k < table -> count; k++)
+        {
+            nozzlePlacePosition(table, k, nozzle, &matrix -> site_x[MOTION_PLACE_SITE(k, nozzle)], &matrix -> site_y[MOTION_PLACE_SITE(k, nozzle)]);
+        }
+    }
+    for (int s = 0; s < matrix -> number_of_sites; s++) matrix -> reachable[s] = isReachable(matrix -> site_x[s], matrix -> site_y[s]);
+
+    for (int s = 0; s < matrix -> number_of_sites; s++)
+    {
+        double *row = (s < MOTION_FIXED_SITES) ? &matrix -> fixed_time[s * MOTION_FIXED_SITES] : &matrix -> place_time[(size_t)(s - MOTION_FIXED_SITES) * MOTION_FIXED_SITES];
+
+        for (int f = 0; f < MOTION_FIXED_SITES; f++)
+        {
+            if (!matrix -> reachable[s] || !matrix -> reachable[f]) row[f] = INFINITY;
+            else row[f] = moveTime(profile, matrix -> site_x[s], matrix -> site_y[s], matrix -> site_x[f], matrix -> site_y[f]);
+        }
+    }
+    for (int k = 0; k < table -> count; k++) matrix -> rotation_time[k] = rotationTime(profile, table -> theta[k]);
+    return TRUE;
+}
+
+/*
+ Function: motionTime
+ --------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ gets the time of the head move between two sites, looked up unless both are place sites
+ Argument(s):
+ const MotionCostMatrix *matrix - the cost matrix
+ int from, int to - the sites, e.g. MOTION_CAMERA_SITE or MOTION_PLACE_SITE(part, nozzle)
+ Return Value:
+ a double representing the time in s, INFINITY if either site is out of range
+ Usage:
+ time += motionTime(matrix, site, MOTION_CAMERA_SITE);
+ */
+double motionTime(const MotionCostMatrix *matrix, int from, int to)
+{
+    if (to < MOTION_FIXED_SITES)
+    {
+        if (from < MOTION_FIXED_SITES) return matrix -> fixed_time[from * MOTION_FIXED_SITES + to];
+        return matrix -> place_time[(size_t)(from - MOTION_FIXED_SITES) * MOTION_FIXED_SITES + to];
+    }
+    if (from < MOTION_FIXED_SITES) return matrix -> place_time[(size_t)(to - MOTION_FIXED_SITES) * MOTION_FIXED_SITES + from];
+
+    if (!matrix -> reachable[from] || !matrix -> reachable[to]) return INFINITY;
+    return moveTime(&matrix -> profile, matrix -> site_x[from], matrix -> site_y[from], matrix -> site_x[to], matrix -> site_y[to]);
+}
+
+/*
+ Function: freeMotionCostMatrix
+ ------------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: frees a cost matrix built by buildMotionCostMatrix()
+ Argument(s):
+ MotionCostMatrix *matrix - the matrix
+ Return Value: none
+ Usage: freeMotionCostMatrix(&matrix);
+ */
+void freeMotionCostMatrix(MotionCostMatrix *matrix)
+{
+    arenaFree(&matrix -> arena);
+    matrix -> number_of_sites = 0;
+}
@@ -0,0 +1,77 @@
+/*
+ *
+ * pnpMotion.h - declarations for the motion cost model, how long the machine takes to move the head,
+ * rotate a nozzle and pick and place a part, and the cost matrix of head moves the planner queries
+ *
+ * Platform: Any POSIX compliant platform
+ * Intended for and tested on: Cygwin 64 bit
+ *
+ */
+
+#ifndef PNP_MOTION_H
+#define PNP_MOTION_H
+
+#include "pnpPlacementTable.h"
+
+/* sites are the head positions the planner moves between, the fixed sites first then every place site */
+#define MOTION_NO_SITE -1
+#define MOTION_HOME_SITE 0
+#define MOTION_CAMERA_SITE 1
+#define MOTION_PICK_SITE(feeder, nozzle) (2 + (feeder) * NUMBER_OF_NOZZLES + (nozzle))
+#define MOTION_FIXED_SITES (2 + NUMBER_OF_FEEDERS * NUMBER_OF_NOZZLES)
+#define MOTION_PLACE_SITE(part, nozzle) (MOTION_FIXED_SITES + (part) * NUMBER_OF_NOZZLES + (nozzle))
+
+typedef struct
+{
+    double gantry_speed;                    // mm/s along the line of a move, the simulator's gantry_speed
+    double gantry_acceleration;             // mm/s^2 along the line of a move, moves follow a trapezoidal (or triangular, if short) velocity profile
+    double x_speed;                         // mm/s of the x axis on its own, 0 if only the line of the move is limited
+    double x_acceleration;                  // mm/s^2 of the x axis, 0 likewise
+    double y_speed;
+    double y_acceleration;
+    double settle_time;                     // s for the head to settle after a move
+    double rotation_speed;                  // degrees/s
+    double rotation_acceleration;           // degrees/s^2
+    double nozzle_time;                     // s to lower or raise a nozzle
+    double vacuum_time;                     // s to apply or release the vacuum
+    double photo_time;                      // s to take a photo
+
+} MotionProfile;
+
+typedef struct
+{
+    MotionProfile profile;
+    int number_of_sites;
+    double *site_x;                         // head position of every site
+    double *site_y;
+    unsigned char *reachable;               // FALSE for a site outside the gantry travel limits, every move to or from it costs INFINITY
+    double *fixed_time;                     // s to move between every pair of fixed sites, MOTION_FIXED_SITES squared
+    double *place_time;                     // s to move between every place site and every fixed site, MOTION_FIXED_SITES per place site
+    double *rotation_time;                  // s to rotate every part to its target
+    double pick_handling_time;              // s to lower, pick with and raise a nozzle, the head held still
+    double place_handling_time;             // s to lower, place with and raise a nozzle, the head held still
+    Arena arena;                            // owns every array, freed in one go by freeMotionCostMatrix()
+
+} MotionCostMatrix;
+
+void defaultMotionProfile(MotionProfile*);
+
+int loadMotionProfile(const char*, MotionProfile*);
+
+double moveTime(const MotionProfile*, double, double, double, double);
+
+double rotationTime(const MotionProfile*, double);
+
+double nozzleOffsetX(int);
+
+void nozzlePickPosition(int, int, double*, double*);
+
+void nozzlePlacePosition(const PlacementTable*, int, int, double*, double*);
+
+int buildMotionCostMatrix(const PlacementTable*, const MotionProfile*, MotionCostMatrix*);
+
+double motionTime(const MotionCostMatrix*, int, int);
+
+void freeMotionCostMatrix(MotionCostMatrix*);
+
+#endif // PNP_MOTION_H
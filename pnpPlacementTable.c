@@ -0,0 +1,131 @@
+/*
+ *
+ * pnpPlacementTable.c - builds the structure of arrays copy of the placement info that the planner runs
+ * over. PlacementInfo interleaves two 10 character strings with the numbers, so a loop over the targets or
+ * feeders of every part strides 64 bytes per part; the table keeps each field in its own dense array
+ * and the strings in a separate pool
+ *
+ * Platform: Any POSIX compliant platform
+ * Intended for and tested on: Cygwin 64 bit
+ *
+ */
+
+#include "pnpPlacementTable.h"
+
+/*
+ Function: buildPlacementTable
+ -----------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ copies the placement info of every part into a placement table
+ Argument(s):
+ const PlacementInfo pi[] - the placement info of all parts, as read from the centroid file
+ int number_of_components - the number of parts
+ PlacementTable *table - initialized by the call and filled with the placement info, free with
+ freePlacementTable() whatever the result
+ Return Value:
+ TRUE (1) on success, FALSE (0) if the memory could not be allocated
+ Usage:
+ if (!buildPlacementTable(store.pi, store.count, &table)) ...
+ */
+int buildPlacementTable(const PlacementInfo pi[], int number_of_components, PlacementTable *table)
+{
+    size_t n = (number_of_components > 0) ? (size_t)number_of_components : 1;
+    size_t pool_size = 0;
+
+    memset(table, 0, sizeof(PlacementTable));
+    arenaInit(&table -> arena, ARENA_BLOCK_SIZE);
+
+    for (int k = 0; k < number_of_components; k++)
+        pool_size += strnlen(pi[k].component_designation, sizeof(pi[k].component_designation) - 1) + 1
+                     + strnlen(pi[k].component_footprint, sizeof(pi[k].component_footprint) - 1) + 1;
+
+    table -> x = arenaAlloc(&table -> arena, sizeof(double) * n);
+    table -> y = arenaAlloc(&table -> arena, sizeof(double) * n);
+    table -> theta = arenaAlloc(&table -> arena, sizeof(double) * n);
+    table -> value = arenaAlloc(&table -> arena, sizeof(double) * n);
+    table -> feeder = arenaAlloc(&table -> arena, sizeof(int) * n);
+    table -> designation = arenaAlloc(&table -> arena, sizeof(int) * n);
+    table -> footprint = arenaAlloc(&table -> arena, sizeof(int) * n);
+    table -> strings = arenaAlloc(&table -> arena, pool_size + 1);
+    if (table -> x == NULL || table -> y == NULL || table -> theta == NULL || table -> value == NULL || table -> feeder == NULL ||
+        table -> designation == NULL || table -> footprint == NULL || table -> strings == NULL) return FALSE;
+
+    size_t used = 0;
+    for (int k = 0; k < number_of_components; k++)
+    {
+        size_t length;
+
+        table -> x[k] = pi[k].x_target;
+        table -> y[k] = pi[k].y_target;
+        table -> theta[k] = pi[k].theta_target;
+        table -> value[k] = pi[k].component_value;
+        table -> feeder[k] = pi[k].feeder;
+
+        length = strnlen(pi[k].component_designation, sizeof(pi[k].component_designation) - 1);
+        table -> designation[k] = (int)used;
+        memcpy(table -> strings + used, pi[k].component_designation, length);
+        table -> strings[used + length] = '\0';
+        used += length + 1;
+
+        length = strnlen(pi[k].component_footprint, sizeof(pi[k].component_footprint) - 1);
+        table -> footprint[k] = (int)used;
+        memcpy(table -> strings + used, pi[k].component_footprint, length);
+        table -> strings[used + length] = '\0';
+        used += length + 1;
+    }
+    table -> count = number_of_components;
+    return TRUE;
+}
+
+/*
+ Function: placementDesignation
+ ------------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: gets the designation of a part from the string pool
+ Argument(s):
+ const PlacementTable *table - the placement table
+ int part - the index of the part
+ Return Value: the designation
+ Usage: printf("%s", placementDesignation(&table, part));
+ */
+const char *placementDesignation(const PlacementTable *table, int part)
+{
+    return table -> strings + table -> designation[part];
+}
+
+/*
+ Function: placementFootprint
+ ----------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: gets the footprint of a part from the string pool
+ Argument(s):
+ const PlacementTable *table - the placement table
+ int part - the index of the part
+ Return Value: the footprint
+ Usage: printf("%s", placementFootprint(&table, part));
+ */
+const char *placementFootprint(const PlacementTable *table, int part)
+{
+    return table -> strings + table -> footprint[part];
+}
+
+/*
+ Function: freePlacementTable
+ ----------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: frees every array of a placement table
+ Argument(s):
+ PlacementTable *table - the placement table
+ Return Value: none
+ Usage: freePlacementTable(&table);
+ */
+void freePlacementTable(PlacementTable *table)
+{
+    arenaFree(&table -> arena);
+    memset(table, 0, sizeof(PlacementTable));
+}
@@ -0,0 +1,38 @@
+/*
+ *
+ * pnpPlacementTable.h - declarations for the structure of arrays copy of the placement info used by the planner
+ *
+ * Platform: Any POSIX compliant platform
+ * Intended for and tested on: Cygwin 64 bit
+ *
+ */
+
+#ifndef PNP_PLACEMENT_TABLE_H
+#define PNP_PLACEMENT_TABLE_H
+
+#include "pnpCentroid.h"
+
+typedef struct
+{
+    double *x;                              // target x of every part, contiguous so distance loops touch only the fields they use
+    double *y;                              // target y of every part
+    double *theta;                          // target rotation of every part
+    double *value;                          // component value of every part
+    int *feeder;                            // tape feeder of every part
+    int *designation;                       // offset of each part's designation in strings
+    int *footprint;                         // offset of each part's footprint in strings
+    char *strings;                          // null terminated designations and footprints packed end to end
+    int count;
+    Arena arena;                            // owns every array, freed in one go by freePlacementTable()
+
+} PlacementTable;
+
+int buildPlacementTable(const PlacementInfo[], int, PlacementTable*);
+
+const char *placementDesignation(const PlacementTable*, int);
+
+const char *placementFootprint(const PlacementTable*, int);
+
+void freePlacementTable(PlacementTable*);
+
+#endif // PNP_PLACEMENT_TABLE_H
@@ -0,0 +1,1507 @@
+/*
+ *
+ * pnpPlanner.c - the placement route planner used in autonomous mode. Parts are grouped into batches of
+ * up to one part per nozzle and the batches are ordered to minimise the estimated cycle time of the route,
+ * every head move costed by the motion cost matrix. Each batch is toured as: pick each part from its
+ * feeder, visit the lookup camera once for all nozzles, then place each part on the PCB. The route is
+ * built with a nearest neighbour construction and improved with 2-opt and Or-opt moves over the batch
+ * sequence plus part exchanges between nearby batches. For the route a board is actually run with, many
+ * randomised starts are constructed and improved in parallel on a work-stealing pool within a wall
+ * clock budget, and the quickest is kept
+ *
+ * Platform: Any POSIX compliant platform
+ * Intended for and tested on: Cygwin 64 bit
+ *
+ */
+
+#include "pnpPlanner.h"
+#include "pnpWorkPool.h"
+
+static const int PERMUTATIONS[6][3] = {{0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0}};
+
+typedef struct
+{
+    int feeder;
+    int index;
+
+} FeederOrder;
+
+typedef struct
+{
+    int feeder_first[NUMBER_OF_FEEDERS + 1];    // the parts of feeder f are by_feeder[feeder_first[f]] to by_feeder[feeder_first[f + 1] - 1]
+    int cursor[NUMBER_OF_FEEDERS];              // no part of feeder f before by_feeder[cursor[f]] is unused
+    int *by_feeder;                             // every part by feeder, in centroid file order
+    int columns;
+    int rows;
+    double x0;                                  // corner of the grid of targets
+    double y0;
+    double cell;                                // side of a cell in mm
+    int *first;                                 // the parts of cell c start at part[first[c]], one more entry than cells
+    int *unused;                                // how many of them are unused, these come first
+    int *part;
+    int *slot;                                  // where each part is in part[]
+    char *used;
+    Arena arena;                                // owns every array
+
+} PartIndex;
+
+typedef struct
+{
+    PlacementPlan trial;                        // the route of the start being run
+    PlacementPlan best;                         // the quickest route of the starts this worker has run
+    double best_time;                           // INFINITY until a start finishes
+    int best_start;
+    int result;                                 // PLAN_OK, or the error of a start that failed
+
+} PlanSearchWorker;
+
+typedef struct
+{
+    const MotionCostMatrix *matrix;
+    const PlacementTable *table;
+    struct timespec deadline;                   // no start begins after this and improvement stops at it
+    _Atomic double best_time;                   // the quickest route of any start so far, shared without locks
+    PlanSearchWorker worker[PLAN_SEARCH_MAX_THREADS];
+
+} PlanSearch;
+
+/*
+ Function: distance
+ ------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ gets the straight line gantry travel between two head positions
+ Argument(s):
+ double x1, double y1 - the first position
+ double x2, double y2 - the second position
+ Return Value:
+ a double representing the distance in mm
+ Usage:
+ double d = distance(x1, y1, x2, y2);
+ */
+static double distance(double x1, double y1, double x2, double y2)
+{
+    return hypot(x2 - x1, y2 - y1);
+}
+
+/*
+ Function: siteTravel
+ --------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ gets the gantry travel of the head move between two sites
+ Argument(s):
+ const MotionCostMatrix *matrix - the cost matrix
+ int from, int to - the sites
+ Return Value:
+ a double representing the travel in mm, INFINITY if either site is out of range
+ Usage:
+ *travel += siteTravel(matrix, site, MOTION_CAMERA_SITE);
+ */
+static double siteTravel(const MotionCostMatrix *matrix, int from, int to)
+{
+    if (!matrix -> reachable[from] || !matrix -> reachable[to]) return INFINITY;
+    return distance(matrix -> site_x[from], matrix -> site_y[from], matrix -> site_x[to], matrix -> site_y[to]);
+}
+
+/*
+ Function: pickLegTime
+ ---------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ gets the time from a start site, picking at the feeders of a batch in the specified nozzle order, to
+ the end of the lookup photo
+ Argument(s):
+ const MotionCostMatrix *matrix - the cost matrix
+ const PlacementTable *table - the placement table of all parts
+ const NozzleBatch *batch - the batch, only the part array is used
+ const int order[] - the loaded nozzles in pick order
+ int start - the site of the head before the first pick
+ double *travel - if not NULL, the gantry travel in mm of the leg is added to it
+ Return Value:
+ a double representing the time in s, INFINITY if a pick position is out of range
+ Usage:
+ double time = pickLegTime(matrix, table, batch, batch -> pick_order, site, NULL);
+ */
+static double pickLegTime(const MotionCostMatrix *matrix, const PlacementTable *table, const NozzleBatch *batch, const int order[], int start, double *travel)
+{
+    int site = start;
+    double time = 0.0;
+
+    for (int k = 0; k < batch -> number_of_parts; k++)
+    {
+        int next = MOTION_PICK_SITE(table -> feeder[batch -> part[order[k]]], order[k]);
+
+        time += motionTime(matrix, site, next) + matrix -> pick_handling_time;
+        if (travel != NULL) *travel += siteTravel(matrix, site, next);
+        site = next;
+    }
+    if (travel != NULL) *travel += siteTravel(matrix, site, MOTION_CAMERA_SITE);
+    return time + motionTime(matrix, site, MOTION_CAMERA_SITE) + matrix -> profile.photo_time;
+}
+
+/*
+ Function: placeLegTime
+ ----------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ gets the time from the end of the lookup photo, placing the parts of a batch in the specified nozzle
+ order. Every nozzle starts rotating its part when the photo ends and runs while the head moves, so a
+ place only waits for a rotation that takes longer than the moves, photos and places before it
+ Argument(s):
+ const MotionCostMatrix *matrix - the cost matrix
+ const PlacementTable *table - the placement table of all parts
+ const NozzleBatch *batch - the batch, only the part array is used
+ const int order[] - the loaded nozzles in place order
+ int *end - set to the site of the head after the last place
+ double *travel - if not NULL, the gantry travel in mm of the leg is added to it
+ Return Value:
+ a double representing the time in s, INFINITY if a place position is out of range
+ Usage:
+ double time = placeLegTime(matrix, table, batch, batch -> place_order, &site, NULL);
+ */
+static double placeLegTime(const MotionCostMatrix *matrix, const PlacementTable *table, const NozzleBatch *batch, const int order[], int *end, double *travel)
+{
+    int site = MOTION_CAMERA_SITE;
+    double time = 0.0;
+
+    for (int k = 0; k < batch -> number_of_parts; k++)
+    {
+        int part = batch -> part[order[k]], next = MOTION_PLACE_SITE(part, order[k]);
+
+        time += motionTime(matrix, site, next) + matrix -> profile.photo_time;
+        if (time < matrix -> rotation_time[part]) time = matrix -> rotation_time[part];
+        time += matrix -> place_handling_time;
+        if (travel != NULL) *travel += siteTravel(matrix, site, next);
+        site = next;
+    }
+    *end = site;
+    return time;
+}
+
+/*
+ Function: batchTime
+ -------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ gets the time of one batch: every pick, the lookup photo, then every place
+ Argument(s):
+ const MotionCostMatrix *matrix - the cost matrix
+ const PlacementTable *table - the placement table of all parts
+ const NozzleBatch *batch - the batch
+ int start - the site of the head before the first pick
+ int *end - set to the site of the head after the last place
+ double *travel - if not NULL, the gantry travel in mm of the batch is added to it
+ Return Value:
+ a double representing the time in s, INFINITY if any head position is out of range
+ Usage:
+ time += batchTime(matrix, table, &plan.batch[b], site, &site, NULL);
+ */
+static double batchTime(const MotionCostMatrix *matrix, const PlacementTable *table, const NozzleBatch *batch, int start, int *end, double *travel)
+{
+    double time = pickLegTime(matrix, table, batch, batch -> pick_order, start, travel);
+
+    return time + placeLegTime(matrix, table, batch, batch -> place_order, end, travel);
+}
+
+/*
+ Function: planTime
+ ------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ gets the estimated cycle time of a whole route, starting and finishing at the home position, and
+ optionally its gantry travel
+ Argument(s):
+ const MotionCostMatrix *matrix - the cost matrix
+ const PlacementTable *table - the placement table of all parts
+ const NozzleBatch batch[] - the batches in route order
+ int number_of_batches - the number of batches
+ double *travel - if not NULL, set to the gantry travel in mm of the route
+ Return Value:
+ a double representing the time in s, INFINITY if any head position is out of range
+ Usage:
+ plan -> planned_time = planTime(&matrix, table, plan -> batch, plan -> number_of_batches, &plan -> planned_travel);
+ */
+double planTime(const MotionCostMatrix *matrix, const PlacementTable *table, const NozzleBatch batch[], int number_of_batches, double *travel)
+{
+    int site = MOTION_HOME_SITE;
+    double time = 0.0;
+
+    if (travel != NULL) *travel = 0.0;
+    for (int b = 0; b < number_of_batches; b++)
+    {
+        time += batchTime(matrix, table, &batch[b], site, &site, travel);
+    }
+    if (travel != NULL) *travel += siteTravel(matrix, site, MOTION_HOME_SITE);
+    return time + motionTime(matrix, site, MOTION_HOME_SITE);
+}
+
+/*
+ Function: optimiseBatchOrder
+ ----------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ exhaustively chooses the nozzle for each part of a batch, the pick order and the place order to
+ minimise the time of the batch, including the move on to the next site if there is one.
+ The pick and place legs only meet at the lookup camera so they are optimised independently
+ Argument(s):
+ const MotionCostMatrix *matrix - the cost matrix
+ const PlacementTable *table - the placement table of all parts
+ NozzleBatch *batch - the batch to reorder in place
+ int start - the site of the head before the first pick
+ int next - the site visited after the batch, MOTION_NO_SITE to leave the move on out
+ Return Value:
+ a double representing the time of the best order, INFINITY if no order keeps the head in range
+ Usage:
+ double cost = optimiseBatchOrder(matrix, table, &batch, site, MOTION_NO_SITE);
+ */
+static double optimiseBatchOrder(const MotionCostMatrix *matrix, const PlacementTable *table, NozzleBatch *batch, int start, int next)
+{
+    int parts[NUMBER_OF_NOZZLES], k = 0;
+    NozzleBatch best = *batch;
+    double best_cost = INFINITY;
+
+    for (int nozzle = 0; nozzle < NUMBER_OF_NOZZLES; nozzle++)
+    {
+        if (batch -> part[nozzle] != NO_PICKED_PART) parts[k++] = batch -> part[nozzle];
+    }
+
+    for (int a = 0; a < 6; a++)
+    {
+        NozzleBatch trial;
+        int loaded[NUMBER_OF_NOZZLES];
+        double pick_cost = INFINITY, place_cost = INFINITY;
+
+        for (int nozzle = 0; nozzle < NUMBER_OF_NOZZLES; nozzle++) trial.part[nozzle] = NO_PICKED_PART;
+        for (int m = 0; m < k; m++)
+        {
+            loaded[m] = PERMUTATIONS[a][m];
+            trial.part[loaded[m]] = parts[m];
+        }
+        trial.number_of_parts = k;
+
+        for (int p = 0; p < 6; p++)
+        {
+            int order[NUMBER_OF_NOZZLES], valid = TRUE, end;
+            double cost;
+
+            for (int m = 0; m < k; m++)
+            {
+                if (PERMUTATIONS[p][m] >= k) valid = FALSE;
+                else order[m] = loaded[PERMUTATIONS[p][m]];
+            }
+            if (!valid) continue;
+
+            cost = pickLegTime(matrix, table, &trial, order, start, NULL);
+            if (cost < pick_cost)
+            {
+                pick_cost = cost;
+                memcpy(trial.pick_order, order, sizeof(order));
+            }
+
+            cost = placeLegTime(matrix, table, &trial, order, &end, NULL);
+            if (next != MOTION_NO_SITE) cost += motionTime(matrix, end, next);
+            if (cost < place_cost)
+            {
+                place_cost = cost;
+                memcpy(trial.place_order, order, sizeof(order));
+            }
+        }
+
+        if (pick_cost + place_cost < best_cost)
+        {
+            best_cost = pick_cost + place_cost;
+            best = trial;
+        }
+    }
+
+    if (best_cost < INFINITY) *batch = best;
+    return best_cost;
+}
+
+/*
+ Function: firstPickSite
+ -----------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ gets the site of the first pick of a batch, or home for an index outside the route
+ Argument(s):
+ const PlacementTable *table - the placement table of all parts
+ const PlacementPlan *plan - the plan
+ int b - the batch index, -1 for the start or plan -> number_of_batches for the end of the route
+ Return Value:
+ an int representing the site
+ Usage:
+ int site = firstPickSite(table, plan, b);
+ */
+static int firstPickSite(const PlacementTable *table, const PlacementPlan *plan, int b)
+{
+    if (b < 0 || b >= plan -> number_of_batches) return MOTION_HOME_SITE;
+
+    int nozzle = plan -> batch[b].pick_order[0];
+    return MOTION_PICK_SITE(table -> feeder[plan -> batch[b].part[nozzle]], nozzle);
+}
+
+/*
+ Function: lastPlaceSite
+ -----------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ gets the site of the last place of a batch, or home for an index outside the route
+ Argument(s):
+ const PlacementPlan *plan - the plan
+ int b - the batch index, -1 for the start or plan -> number_of_batches for the end of the route
+ Return Value:
+ an int representing the site
+ Usage:
+ int site = lastPlaceSite(plan, b);
+ */
+static int lastPlaceSite(const PlacementPlan *plan, int b)
+{
+    if (b < 0 || b >= plan -> number_of_batches) return MOTION_HOME_SITE;
+
+    const NozzleBatch *batch = &plan -> batch[b];
+    int nozzle = batch -> place_order[batch -> number_of_parts - 1];
+    return MOTION_PLACE_SITE(batch -> part[nozzle], nozzle);
+}
+
+/*
+ Function: transition
+ --------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ gets the time of the move between the end of one batch and the start of another, either may be home
+ Argument(s):
+ const MotionCostMatrix *matrix - the cost matrix
+ const PlacementTable *table - the placement table of all parts
+ const PlacementPlan *plan - the plan
+ int from - the batch travelled from, -1 for home
+ int to - the batch travelled to, plan -> number_of_batches for home
+ Return Value:
+ a double representing the time in s
+ Usage:
+ double t = transition(matrix, table, plan, b - 1, b);
+ */
+static double transition(const MotionCostMatrix *matrix, const PlacementTable *table, const PlacementPlan *plan, int from, int to)
+{
+    return motionTime(matrix, lastPlaceSite(plan, from), firstPickSite(table, plan, to));
+}
+
+/*
+ Function: compareFeederOrder
+ ----------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ qsort comparison ordering parts by feeder, then by their position in the centroid file
+ Argument(s):
+ const void *a, const void *b - pointers to the FeederOrder entries to compare
+ Return Value:
+ negative, zero or positive as a orders before, with or after b
+ Usage:
+ qsort(order, n, sizeof(FeederOrder), compareFeederOrder);
+ */
+static int compareFeederOrder(const void *a, const void *b)
+{
+    const FeederOrder *order_a = (const FeederOrder *)a;
+    const FeederOrder *order_b = (const FeederOrder *)b;
+
+    if (order_a -> feeder != order_b -> feeder) return (order_a -> feeder > order_b -> feeder) ? 1 : -1;
+    return order_a -> index - order_b -> index;
+}
+
+/*
+ Function: buildNaiveBatches
+ ---------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ builds the original autonomous mode route: parts sorted by feeder, picked three at a time on the
+ left, centre and right nozzles in turn and placed in the same order
+ Argument(s):
+ const PlacementTable *table - the placement table of all parts
+ int number_of_components - the number of parts
+ NozzleBatch batch[] - filled with (number_of_components + 2) / 3 batches
+ Return Value:
+ PLAN_OK or PLAN_OUT_OF_MEMORY
+ Usage:
+ res = buildNaiveBatches(table, n, batch);
+ */
+static int buildNaiveBatches(const PlacementTable *table, int number_of_components, NozzleBatch batch[])
+{
+    FeederOrder *order = malloc(sizeof(FeederOrder) * number_of_components);
+    if (order == NULL) return PLAN_OUT_OF_MEMORY;
+
+    for (int k = 0; k < number_of_components; k++)
+    {
+        order[k].feeder = table -> feeder[k];
+        order[k].index = k;
+    }
+    qsort(order, number_of_components, sizeof(FeederOrder), compareFeederOrder);
+
+    for (int k = 0; k < number_of_components; k++)
+    {
+        NozzleBatch *current = &batch[k / NUMBER_OF_NOZZLES];
+        int nozzle = k % NUMBER_OF_NOZZLES;
+
+        if (nozzle == 0)
+        {
+            for (int n = 0; n < NUMBER_OF_NOZZLES; n++) current -> part[n] = NO_PICKED_PART;
+            current -> number_of_parts = 0;
+        }
+        current -> part[nozzle] = order[k].index;
+        current -> pick_order[nozzle] = nozzle;
+        current -> place_order[nozzle] = nozzle;
+        current -> number_of_parts++;
+    }
+    free(order);
+    return PLAN_OK;
+}
+
+/*
+ Function: partCell
+ ------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: gets the grid cell of a part's target
+ Argument(s):
+ const PartIndex *index - the index
+ const PlacementTable *table - the placement table of all parts
+ int k - the part
+ Return Value: an int representing the cell, row by row
+ Usage: int c = partCell(index, table, k);
+ */
+static int partCell(const PartIndex *index, const PlacementTable *table, int k)
+{
+    int column = (int)((table -> x[k] - index -> x0) / index -> cell);
+    int row = (int)((table -> y[k] - index -> y0) / index -> cell);
+
+    if (column >= index -> columns) column = index -> columns - 1;
+    if (row >= index -> rows) row = index -> rows - 1;
+    return row * index -> columns + column;
+}
+
+/*
+ Function: buildPartIndex
+ ------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ indexes the parts for the nearest neighbour construction: by feeder in centroid file order, and by
+ target position on a grid of square cells holding about PLAN_GRID_PARTS_PER_CELL parts each, so
+ neither the seed nor the candidates of a batch need a scan of every part
+ Argument(s):
+ const PlacementTable *table - the placement table of all parts
+ int number_of_components - the number of parts, at least 1
+ PartIndex *index - set to the index of every part, all unused, free with arenaFree(&index -> arena)
+ Return Value:
+ TRUE (1) on success, FALSE (0) if memory ran out
+ Usage:
+ if (!buildPartIndex(table, n, &index)) return PLAN_OUT_OF_MEMORY;
+ */
+static int buildPartIndex(const PlacementTable *table, int number_of_components, PartIndex *index)
+{
+    double max_x, max_y, width, height;
+    int cells;
+
+    memset(index, 0, sizeof(PartIndex));
+    if (number_of_components < 1) return FALSE;
+    arenaInit(&index -> arena, ARENA_BLOCK_SIZE);
+
+    index -> x0 = max_x = table -> x[0];
+    index -> y0 = max_y = table -> y[0];
+    for (int k = 1; k < number_of_components; k++)
+    {
+        index -> x0 = fmin(index -> x0, table -> x[k]);
+        index -> y0 = fmin(index -> y0, table -> y[k]);
+        max_x = fmax(max_x, table -> x[k]);
+        max_y = fmax(max_y, table -> y[k]);
+    }
+    width = max_x - index -> x0;
+    height = max_y - index -> y0;
+    cells = number_of_components / PLAN_GRID_PARTS_PER_CELL + 1;
+    index -> cell = sqrt((width + 1.0) * (height + 1.0) / cells);
+    index -> columns = (int)(width / index -> cell) + 1;
+    index -> rows = (int)(height / index -> cell) + 1;
+    cells = index -> columns * index -> rows;
+
+    index -> first = arenaAlloc(&index -> arena, sizeof(int) * (cells + 1));
+    index -> unused = arenaAlloc(&index -> arena, sizeof(int) * cells);
+    index -> part = arenaAlloc(&index -> arena, sizeof(int) * number_of_components);
+    index -> slot = arenaAlloc(&index -> arena, sizeof(int) * number_of_components);
+    index -> by_feeder = arenaAlloc(&index -> arena, sizeof(int) * number_of_components);
+    index -> used = arenaAlloc(&index -> arena, number_of_components);
+    if (index -> first == NULL || index -> unused == NULL || index -> part == NULL || index -> slot == NULL
+        || index -> by_feeder == NULL || index -> used == NULL)
+    {
+        arenaFree(&index -> arena);
+        return FALSE;
+    }
+
+    /* counting sorts, by feeder then by cell, both keeping centroid file order within a bucket */
+    memset(index -> feeder_first, 0, sizeof(index -> feeder_first));
+    for (int k = 0; k < number_of_components; k++) index -> feeder_first[table -> feeder[k] + 1]++;
+    for (int f = 0; f < NUMBER_OF_FEEDERS; f++) index -> feeder_first[f + 1] += index -> feeder_first[f];
+    for (int f = 0; f < NUMBER_OF_FEEDERS; f++) index -> cursor[f] = index -> feeder_first[f];
+    for (int k = 0; k < number_of_components; k++) index -> by_feeder[index -> cursor[table -> feeder[k]]++] = k;
+    for (int f = 0; f < NUMBER_OF_FEEDERS; f++) index -> cursor[f] = index -> feeder_first[f];
+
+    memset(index -> first, 0, sizeof(int) * (cells + 1));
+    memset(index -> unused, 0, sizeof(int) * cells);
+    for (int k = 0; k < number_of_components; k++) index -> first[partCell(index, table, k) + 1]++;
+    for (int c = 0; c < cells; c++) index -> first[c + 1] += index -> first[c];
+    for (int k = 0; k < number_of_components; k++)
+    {
+        int c = partCell(index, table, k);
+
+        index -> slot[k] = index -> first[c] + index -> unused[c]++;
+        index -> part[index -> slot[k]] = k;
+    }
+    memset(index -> used, FALSE, number_of_components);
+    return TRUE;
+}
+
+/*
+ Function: markPartUsed
+ ----------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ takes a part out of the index once it is in a batch, swapping it behind the unused parts of its cell
+ Argument(s):
+ PartIndex *index - the index
+ const PlacementTable *table - the placement table of all parts
+ int k - the part
+ Return Value: none
+ Usage: markPartUsed(&index, table, seed);
+ */
+static void markPartUsed(PartIndex *index, const PlacementTable *table, int k)
+{
+    int c = partCell(index, table, k);
+    int last = index -> first[c] + --index -> unused[c], moved = index -> part[last];
+
+    index -> part[last] = k;
+    index -> part[index -> slot[k]] = moved;
+    index -> slot[moved] = index -> slot[k];
+    index -> slot[k] = last;
+    index -> used[k] = TRUE;
+}
+
+/*
+ Function: chooseSeed
+ --------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ chooses the part that seeds the next batch. The pick site only depends on the feeder, so the feeders
+ are compared rather than the parts: without a random state the seed is the first unused part, in
+ centroid file order, of the quickest feeder to reach. With one, it is a random unused part of one of
+ the PLAN_SEARCH_SEED_FEEDERS quickest feeders, so each start of the route search builds its own route
+ Argument(s):
+ const MotionCostMatrix *matrix - the cost matrix
+ PartIndex *index - the index of the unused parts, at least one
+ int site - the current head site
+ unsigned int *random - the random state of the start, NULL for the deterministic construction
+ Return Value:
+ an int representing the part
+ Usage:
+ int seed = chooseSeed(matrix, &index, site, random);
+ */
+static int chooseSeed(const MotionCostMatrix *matrix, PartIndex *index, int site, unsigned int *random)
+{
+    int feeder[NUMBER_OF_FEEDERS], number_of_feeders = 0, f, k;
+    double time[NUMBER_OF_FEEDERS];
+
+    /* the feeders with unused parts, quickest first, ties to the lowest first unused part */
+    for (f = 0; f < NUMBER_OF_FEEDERS; f++)
+    {
+        while (index -> cursor[f] < index -> feeder_first[f + 1] && index -> used[index -> by_feeder[index -> cursor[f]]]) index -> cursor[f]++;
+        if (index -> cursor[f] == index -> feeder_first[f + 1]) continue;
+
+        double t = motionTime(matrix, site, MOTION_PICK_SITE(f, CENTRE_NOZZLE));
+        int m = number_of_feeders++;
+        k = index -> by_feeder[index -> cursor[f]];
+        while (m > 0 && (time[m - 1] > t || (time[m - 1] == t && index -> by_feeder[index -> cursor[feeder[m - 1]]] > k)))
+        {
+            time[m] = time[m - 1];
+            feeder[m] = feeder[m - 1];
+            m--;
+        }
+        time[m] = t;
+        feeder[m] = f;
+    }
+
+    if (random == NULL) return index -> by_feeder[index -> cursor[feeder[0]]];
+
+    f = feeder[rand_r(random) % ((number_of_feeders < PLAN_SEARCH_SEED_FEEDERS) ? number_of_feeders : PLAN_SEARCH_SEED_FEEDERS)];
+    for (int attempt = 0; attempt < PLAN_SEARCH_SEED_ATTEMPTS; attempt++)
+    {
+        k = index -> by_feeder[index -> cursor[f] + rand_r(random) % (index -> feeder_first[f + 1] - index -> cursor[f])];
+        if (!index -> used[k]) return k;
+    }
+    return index -> by_feeder[index -> cursor[f]];
+}
+
+/*
+ Function: nearestCandidates
+ ---------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ finds the PLAN_CANDIDATE_PARTS unused parts whose feeder and target are closest to a seed, searching
+ the grid in square rings of cells around the seed's cell. Every part outside the rings searched so far
+ is at least as far from the seed as the inner edge of the next ring, so the search stops as soon as
+ the candidates found are all closer than that. Ties go to the part earlier in the centroid file, as
+ with a scan of every part
+ Argument(s):
+ const PartIndex *index - the index of the unused parts
+ const PlacementTable *table - the placement table of all parts
+ int seed - the seed part
+ int candidate[] - set to the candidates, closest first, PLAN_CANDIDATE_PARTS entries
+ Return Value:
+ an int representing the number of candidates found
+ Usage:
+ number_of_candidates = nearestCandidates(&index, table, seed, candidate);
+ */
+static int nearestCandidates(const PartIndex *index, const PlacementTable *table, int seed, int candidate[])
+{
+    double closeness[PLAN_CANDIDATE_PARTS];
+    int number_of_candidates = 0, c = partCell(index, table, seed);
+    int column = c % index -> columns, row = c / index -> columns;
+    int rings = (index -> columns > index -> rows) ? index -> columns : index -> rows;
+
+    for (int r = 0; r < rings; r++)
+    {
+        for (int j = row - r; j <= row + r; j++)
+        {
+            if (j < 0 || j >= index -> rows) continue;
+            int step = (j == row - r || j == row + r) ? 1 : 2 * r;     // only the two ends of the rows in between are on the ring
+
+            for (int i = column - r; i <= column + r; i += step)
+            {
+                if (i < 0 || i >= index -> columns) continue;
+
+                int cell = j * index -> columns + i;
+                for (int s = index -> first[cell]; s < index -> first[cell] + index -> unused[cell]; s++)
+                {
+                    int k = index -> part[s];
+                    double d = fabs(TAPE_FEEDER_X[table -> feeder[k]] - TAPE_FEEDER_X[table -> feeder[seed]])
+                               + distance(table -> x[k], table -> y[k], table -> x[seed], table -> y[seed]);
+
+                    if (number_of_candidates == PLAN_CANDIDATE_PARTS)
+                    {
+                        double last = closeness[number_of_candidates - 1];
+                        if (d > last || (d == last && k > candidate[number_of_candidates - 1])) continue;
+                    }
+
+                    int m = (number_of_candidates < PLAN_CANDIDATE_PARTS) ? number_of_candidates++ : number_of_candidates - 1;
+                    while (m > 0 && (closeness[m - 1] > d || (closeness[m - 1] == d && candidate[m - 1] > k)))
+                    {
+                        closeness[m] = closeness[m - 1];
+                        candidate[m] = candidate[m - 1];
+                        m--;
+                    }
+                    closeness[m] = d;
+                    candidate[m] = k;
+                }
+            }
+        }
+        if (number_of_candidates == PLAN_CANDIDATE_PARTS && closeness[number_of_candidates - 1] < r * index -> cell) break;
+    }
+    return number_of_candidates;
+}
+
+/*
+ Function: buildGreedyBatches
+ ----------------------------
+ Date: 17/10/2026
+ Version 2.0
+ Purpose:
+ nearest neighbour construction: from the current head position the part with the quickest feeder to
+ reach seeds a batch, which is then filled from the PLAN_CANDIDATE_PARTS parts whose feeder and target
+ are closest to the seed, choosing each time the part that adds the least time to the batch. Given a
+ random state the seeds are drawn at random instead, see chooseSeed()
+ Argument(s):
+ const MotionCostMatrix *matrix - the cost matrix
+ const PlacementTable *table - the placement table of all parts
+ int number_of_components - the number of parts
+ unsigned int *random - the random state of a start of the route search, NULL for the deterministic route
+ PlacementPlan *plan - the batch array is filled and number_of_batches set
+ Return Value:
+ PLAN_OK, PLAN_UNREACHABLE_POSITION or PLAN_OUT_OF_MEMORY
+ Usage:
+ res = buildGreedyBatches(matrix, table, n, NULL, &plan);
+ */
+static int buildGreedyBatches(const MotionCostMatrix *matrix, const PlacementTable *table, int number_of_components, unsigned int *random, PlacementPlan *plan)
+{
+    PartIndex index;
+    int site = MOTION_HOME_SITE, remaining = number_of_components;
+
+    if (!buildPartIndex(table, number_of_components, &index)) return PLAN_OUT_OF_MEMORY;
+    plan -> number_of_batches = 0;
+
+    while (remaining > 0)
+    {
+        NozzleBatch *batch = &plan -> batch[plan -> number_of_batches];
+        int seed = chooseSeed(matrix, &index, site, random);
+
+        for (int n = 0; n < NUMBER_OF_NOZZLES; n++) batch -> part[n] = NO_PICKED_PART;
+        batch -> part[CENTRE_NOZZLE] = seed;
+        batch -> number_of_parts = 1;
+        markPartUsed(&index, table, seed);
+        remaining--;
+
+        double cost = optimiseBatchOrder(matrix, table, batch, site, MOTION_NO_SITE);
+        if (cost == INFINITY)
+        {
+            arenaFree(&index.arena);
+            return PLAN_UNREACHABLE_POSITION;
+        }
+
+        while (batch -> number_of_parts < NUMBER_OF_NOZZLES && remaining > 0)
+        {
+            int candidate[PLAN_CANDIDATE_PARTS];
+            int number_of_candidates = nearestCandidates(&index, table, seed, candidate);
+
+            NozzleBatch best = *batch;
+            double best_cost = INFINITY;
+            int best_candidate = NO_PICKED_PART;
+
+            for (int m = 0; m < number_of_candidates; m++)
+            {
+                NozzleBatch trial = *batch;
+                for (int n = 0; n < NUMBER_OF_NOZZLES; n++)
+                {
+                    if (trial.part[n] == NO_PICKED_PART)
+                    {
+                        trial.part[n] = candidate[m];
+                        break;
+                    }
+                }
+                trial.number_of_parts++;
+
+                double trial_cost = optimiseBatchOrder(matrix, table, &trial, site, MOTION_NO_SITE);
+                if (trial_cost < best_cost)
+                {
+                    best_cost = trial_cost;
+                    best = trial;
+                    best_candidate = candidate[m];
+                }
+            }
+
+            if (best_candidate == NO_PICKED_PART) break;   // no candidate fits on a free nozzle within the travel limits
+            *batch = best;
+            markPartUsed(&index, table, best_candidate);
+            remaining--;
+        }
+
+        batchTime(matrix, table, batch, site, &site, NULL);
+        plan -> number_of_batches++;
+    }
+
+    arenaFree(&index.arena);
+    return PLAN_OK;
+}
+
+/*
+ Function: pastDeadline
+ ----------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: checks the monotonic clock against a deadline
+ Argument(s):
+ const struct timespec *deadline - the deadline, NULL for none
+ Return Value: TRUE (1) if there is a deadline and it has passed, otherwise FALSE (0)
+ Usage: if (pastDeadline(&search -> deadline)) return;
+ */
+static int pastDeadline(const struct timespec *deadline)
+{
+    struct timespec now;
+
+    if (deadline == NULL) return FALSE;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec > deadline -> tv_sec || (now.tv_sec == deadline -> tv_sec && now.tv_nsec >= deadline -> tv_nsec);
+}
+
+/*
+ Function: improveByRelocation
+ -----------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ Or-opt move over the batch sequence: moves single batches to a better position within
+ PLAN_IMPROVEMENT_WINDOW batches of their current position
+ Argument(s):
+ const MotionCostMatrix *matrix - the cost matrix
+ const PlacementTable *table - the placement table of all parts
+ PlacementPlan *plan - the plan to improve in place
+ Return Value:
+ TRUE (1) if the route was improved, otherwise FALSE (0)
+ Usage:
+ improved |= improveByRelocation(matrix, table, plan);
+ */
+static int improveByRelocation(const MotionCostMatrix *matrix, const PlacementTable *table, PlacementPlan *plan)
+{
+    int improved = FALSE, nb = plan -> number_of_batches;
+
+    for (int i = 0; i < nb; i++)
+    {
+        double removal = transition(matrix, table, plan, i - 1, i + 1) - transition(matrix, table, plan, i - 1, i) - transition(matrix, table, plan, i, i + 1);
+        int best_j = i;
+        double best_delta = -1e-9;
+
+        /* j is the batch that i is inserted in front of, nb meaning the end of the route */
+        for (int j = (i - PLAN_IMPROVEMENT_WINDOW < 0) ? 0 : i - PLAN_IMPROVEMENT_WINDOW; j <= nb && j <= i + PLAN_IMPROVEMENT_WINDOW; j++)
+        {
+            if (j == i || j == i + 1) continue;
+            int p = (j - 1 == i) ? i - 1 : j - 1;
+            double delta = removal + transition(matrix, table, plan, p, i) + transition(matrix, table, plan, i, j) - transition(matrix, table, plan, p, j);
+            if (delta < best_delta)
+            {
+                best_delta = delta;
+                best_j = j;
+            }
+        }
+
+        if (best_j != i)
+        {
+            NozzleBatch moved = plan -> batch[i];
+            if (best_j < i)
+            {
+                memmove(&plan -> batch[best_j + 1], &plan -> batch[best_j], sizeof(NozzleBatch) * (i - best_j));
+                plan -> batch[best_j] = moved;
+            }
+            else
+            {
+                memmove(&plan -> batch[i], &plan -> batch[i + 1], sizeof(NozzleBatch) * (best_j - i - 1));
+                plan -> batch[best_j - 1] = moved;
+            }
+            improved = TRUE;
+        }
+    }
+    return improved;
+}
+
+/*
+ Function: improveByReversal
+ ---------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ 2-opt move over the batch sequence: reverses runs of up to PLAN_IMPROVEMENT_WINDOW batches. The
+ batches keep their internal order, so the forward and backward transition sums along the run are
+ accumulated as the run grows to give an O(1) cost change per candidate
+ Argument(s):
+ const MotionCostMatrix *matrix - the cost matrix
+ const PlacementTable *table - the placement table of all parts
+ PlacementPlan *plan - the plan to improve in place
+ Return Value:
+ TRUE (1) if the route was improved, otherwise FALSE (0)
+ Usage:
+ improved |= improveByReversal(matrix, table, plan);
+ */
+static int improveByReversal(const MotionCostMatrix *matrix, const PlacementTable *table, PlacementPlan *plan)
+{
+    int improved = FALSE, nb = plan -> number_of_batches;
+
+    for (int i = 0; i < nb - 1; i++)
+    {
+        double forward = 0.0, backward = 0.0;
+
+        for (int j = i + 1; j < nb && j <= i + PLAN_IMPROVEMENT_WINDOW; j++)
+        {
+            forward += transition(matrix, table, plan, j - 1, j);
+            backward += transition(matrix, table, plan, j, j - 1);
+
+            double before = transition(matrix, table, plan, i - 1, i) + forward + transition(matrix, table, plan, j, j + 1);
+            double after = transition(matrix, table, plan, i - 1, j) + backward + transition(matrix, table, plan, i, j + 1);
+            if (after < before - 1e-9)
+            {
+                for (int lo = i, hi = j; lo < hi; lo++, hi--)
+                {
+                    NozzleBatch swap = plan -> batch[lo];
+                    plan -> batch[lo] = plan -> batch[hi];
+                    plan -> batch[hi] = swap;
+                }
+                improved = TRUE;
+                break;
+            }
+        }
+    }
+    return improved;
+}
+
+/*
+ Function: localTime
+ -------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ gets the time of the route around two batches a < b: into, through and out of each of them
+ Argument(s):
+ const MotionCostMatrix *matrix - the cost matrix
+ const PlacementTable *table - the placement table of all parts
+ const PlacementPlan *plan - the plan
+ int a, int b - the batch indices
+ Return Value:
+ a double representing the time in s, INFINITY if any head position is out of range
+ Usage:
+ double before = localTime(matrix, table, plan, a, b);
+ */
+static double localTime(const MotionCostMatrix *matrix, const PlacementTable *table, const PlacementPlan *plan, int a, int b)
+{
+    int end;
+    double time = batchTime(matrix, table, &plan -> batch[a], lastPlaceSite(plan, a - 1), &end, NULL);
+
+    if (b != a + 1)
+    {
+        time += transition(matrix, table, plan, a, a + 1);
+        end = lastPlaceSite(plan, b - 1);
+    }
+    time += batchTime(matrix, table, &plan -> batch[b], end, &end, NULL);
+    return time + motionTime(matrix, end, firstPickSite(table, plan, b + 1));
+}
+
+/*
+ Function: reoptimiseBatch
+ -------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ re-runs optimiseBatchOrder() on a batch using its current neighbours in the route
+ Argument(s):
+ const MotionCostMatrix *matrix - the cost matrix
+ const PlacementTable *table - the placement table of all parts
+ PlacementPlan *plan - the plan
+ int b - the batch index
+ Return Value:
+ a double representing the time from the previous batch through b to the next one
+ Usage:
+ reoptimiseBatch(matrix, table, plan, b);
+ */
+static double reoptimiseBatch(const MotionCostMatrix *matrix, const PlacementTable *table, PlacementPlan *plan, int b)
+{
+    return optimiseBatchOrder(matrix, table, &plan -> batch[b], lastPlaceSite(plan, b - 1), firstPickSite(table, plan, b + 1));
+}
+
+/*
+ Function: improveByExchange
+ ---------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ exchanges parts between batches close together in the route, or moves a part onto a free nozzle of
+ a nearby batch, keeping the change whenever the time around the two batches falls. This is the
+ slowest of the improvement moves, so it gives up part way through at the deadline
+ Argument(s):
+ const MotionCostMatrix *matrix - the cost matrix
+ const PlacementTable *table - the placement table of all parts
+ PlacementPlan *plan - the plan to improve in place
+ const struct timespec *deadline - when to stop, NULL for no limit
+ Return Value:
+ TRUE (1) if the route was improved, otherwise FALSE (0)
+ Usage:
+ improved |= improveByExchange(matrix, table, plan, deadline);
+ */
+static int improveByExchange(const MotionCostMatrix *matrix, const PlacementTable *table, PlacementPlan *plan, const struct timespec *deadline)
+{
+    int improved = FALSE, nb = plan -> number_of_batches;
+
+    for (int a = 0; a < nb - 1 && !pastDeadline(deadline); a++)
+    {
+        for (int b = a + 1; b < nb && b <= a + 3; b++)
+        {
+            for (int na = 0; na < NUMBER_OF_NOZZLES; na++)
+            {
+                for (int nz = 0; nz < NUMBER_OF_NOZZLES; nz++)
+                {
+                    NozzleBatch *batch_a = &plan -> batch[a], *batch_b = &plan -> batch[b];
+                    int part_a = batch_a -> part[na], part_b = batch_b -> part[nz];
+
+                    if (part_a == NO_PICKED_PART) continue;
+                    if (part_b == NO_PICKED_PART && batch_a -> number_of_parts < 2) continue;
+
+                    NozzleBatch saved_a = *batch_a, saved_b = *batch_b;
+                    double before = localTime(matrix, table, plan, a, b);
+
+                    batch_a -> part[na] = part_b;
+                    batch_b -> part[nz] = part_a;
+                    if (part_b == NO_PICKED_PART)
+                    {
+                        batch_a -> number_of_parts--;
+                        batch_b -> number_of_parts++;
+                    }
+
+                    if (reoptimiseBatch(matrix, table, plan, a) < INFINITY && reoptimiseBatch(matrix, table, plan, b) < INFINITY
+                        && localTime(matrix, table, plan, a, b) < before - 1e-9)
+                    {
+                        improved = TRUE;
+                    }
+                    else
+                    {
+                        *batch_a = saved_a;
+                        *batch_b = saved_b;
+                    }
+                }
+            }
+        }
+    }
+    return improved;
+}
+
+/*
+ Function: improvePlan
+ ---------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ improves a constructed route with passes of 2-opt, Or-opt and exchange moves until a pass finds
+ nothing, PLAN_MAX_IMPROVEMENT_PASSES have run or the deadline passes, then fits the pick and place
+ order of every batch to its final neighbours. A start of the route search is abandoned once a pass
+ leaves it more than PLAN_SEARCH_PRUNE_MARGIN slower than the best route of any start so far
+ Argument(s):
+ const MotionCostMatrix *matrix - the cost matrix
+ const PlacementTable *table - the placement table of all parts
+ PlacementPlan *plan - the plan to improve in place
+ const struct timespec *deadline - when to stop, NULL for no limit
+ _Atomic double *best_time - the best time of the route search so far, NULL outside the search
+ Return Value:
+ a double representing the estimated cycle time in s of the route, INFINITY if it was abandoned
+ Usage:
+ time = improvePlan(matrix, table, &worker -> trial, &search -> deadline, &search -> best_time);
+ */
+static double improvePlan(const MotionCostMatrix *matrix, const PlacementTable *table, PlacementPlan *plan, const struct timespec *deadline, _Atomic double *best_time)
+{
+    for (int pass = 0; pass < PLAN_MAX_IMPROVEMENT_PASSES && !pastDeadline(deadline); pass++)
+    {
+        int improved = FALSE;
+
+        improved |= improveByReversal(matrix, table, plan);
+        improved |= improveByRelocation(matrix, table, plan);
+        improved |= improveByExchange(matrix, table, plan, deadline);
+        if (!improved) break;
+
+        if (best_time != NULL && planTime(matrix, table, plan -> batch, plan -> number_of_batches, NULL) > atomic_load(best_time) * (1.0 + PLAN_SEARCH_PRUNE_MARGIN))
+        {
+            return INFINITY;
+        }
+    }
+    for (int b = 0; b < plan -> number_of_batches; b++) reoptimiseBatch(matrix, table, plan, b);
+    return planTime(matrix, table, plan -> batch, plan -> number_of_batches, NULL);
+}
+
+/*
+ Function: runPlanStart
+ ----------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ one start of the route search, run by the work pool: constructs a route, deterministically for start 0
+ and from random seeds for the rest, improves it and keeps it if it is the worker's best so far. The
+ best time of every start is shared through an atomic compare and swap, so no worker ever waits on
+ another. Starts that have not begun by the deadline are skipped, except start 0, so there is always
+ a route
+ Argument(s):
+ void *context - the PlanSearch
+ int w - the worker running the start
+ int start - the start, 0 to PLAN_SEARCH_STARTS - 1
+ Return Value: none
+ Usage: runWorkPool(PLAN_SEARCH_STARTS, workers, runPlanStart, search);
+ */
+static void runPlanStart(void *context, int w, int start)
+{
+    PlanSearch *search = (PlanSearch *)context;
+    PlanSearchWorker *worker = &search -> worker[w];
+    unsigned int random = (unsigned int)start * 2654435761U;
+    double time, best;
+    int res;
+
+    if (start > 0 && pastDeadline(&search -> deadline)) return;
+
+    res = buildGreedyBatches(search -> matrix, search -> table, search -> table -> count, (start == 0) ? NULL : &random, &worker -> trial);
+    if (res != PLAN_OK)
+    {
+        if (worker -> result == PLAN_OK) worker -> result = res;
+        return;
+    }
+
+    time = improvePlan(search -> matrix, search -> table, &worker -> trial, &search -> deadline, &search -> best_time);
+    if (time == INFINITY || time > worker -> best_time || (time == worker -> best_time && start > worker -> best_start)) return;
+
+    NozzleBatch *swap = worker -> best.batch;
+    worker -> best.batch = worker -> trial.batch;
+    worker -> best.number_of_batches = worker -> trial.number_of_batches;
+    worker -> trial.batch = swap;
+    worker -> best_time = time;
+    worker -> best_start = start;
+
+    best = atomic_load(&search -> best_time);
+    while (time < best && !atomic_compare_exchange_weak(&search -> best_time, &best, time));
+}
+
+/*
+ Function: searchPlacement
+ -------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ multi-start route search: runs PLAN_SEARCH_STARTS constructions and improvements on a work-stealing
+ pool of one worker per core, up to PLAN_SEARCH_MAX_THREADS, and keeps the quickest route, the lowest
+ start winning a tie. Each worker only writes its own routes, so the only state shared while the
+ search runs is the best time. Small boards finish every start well inside the budget; on large ones
+ the deadline cuts the search short and the best route found by then is used
+ Argument(s):
+ const MotionCostMatrix *matrix - the cost matrix
+ const PlacementTable *table - the placement table of all parts, at least one
+ const struct timespec *deadline - when the search must finish by
+ PlacementPlan *plan - its batch array, room for a batch per part, is set to the route
+ Return Value:
+ PLAN_OK, PLAN_UNREACHABLE_POSITION or PLAN_OUT_OF_MEMORY
+ Usage:
+ res = searchPlacement(&matrix, table, &deadline, plan);
+ */
+static int searchPlacement(const MotionCostMatrix *matrix, const PlacementTable *table, const struct timespec *deadline, PlacementPlan *plan)
+{
+    PlanSearch *search = calloc(1, sizeof(PlanSearch));
+    int workers = workPoolSize(PLAN_SEARCH_MAX_THREADS), winner = -1, res = PLAN_OUT_OF_MEMORY;
+
+    if (search == NULL) return PLAN_OUT_OF_MEMORY;
+    search -> matrix = matrix;
+    search -> table = table;
+    search -> deadline = *deadline;
+    atomic_init(&search -> best_time, INFINITY);
+
+    for (int w = 0; w < workers; w++)
+    {
+        PlanSearchWorker *worker = &search -> worker[w];
+
+        worker -> trial.batch = malloc(sizeof(NozzleBatch) * table -> count);
+        worker -> best.batch = malloc(sizeof(NozzleBatch) * table -> count);
+        worker -> best_time = INFINITY;
+        worker -> best_start = PLAN_SEARCH_STARTS;
+        worker -> result = PLAN_OK;
+        if (worker -> trial.batch == NULL || worker -> best.batch == NULL)
+        {
+            free(worker -> trial.batch);
+            free(worker -> best.batch);
+            workers = w;    // run with the workers that have room
+        }
+    }
+
+    if (workers > 0) runWorkPool(PLAN_SEARCH_STARTS, workers, runPlanStart, search);
+
+    for (int w = 0; w < workers; w++)
+    {
+        PlanSearchWorker *worker = &search -> worker[w];
+
+        if (worker -> result != PLAN_OK && res == PLAN_OUT_OF_MEMORY) res = worker -> result;
+        if (worker -> best_time == INFINITY) continue;
+        if (winner < 0 || worker -> best_time < search -> worker[winner].best_time
+            || (worker -> best_time == search -> worker[winner].best_time && worker -> best_start < search -> worker[winner].best_start))
+        {
+            winner = w;
+        }
+    }
+    if (winner >= 0)
+    {
+        memcpy(plan -> batch, search -> worker[winner].best.batch, sizeof(NozzleBatch) * search -> worker[winner].best.number_of_batches);
+        plan -> number_of_batches = search -> worker[winner].best.number_of_batches;
+        res = PLAN_OK;
+    }
+
+    for (int w = 0; w < workers; w++)
+    {
+        free(search -> worker[w].trial.batch);
+        free(search -> worker[w].best.batch);
+    }
+    free(search);
+    return res;
+}
+
+/*
+ Function: markBatchPickPositions
+ --------------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ finds the picks of a batch that can be made without moving the gantry because the head position for
+ the nozzle is the same as for the previous pick, i.e. the feeders line up with the nozzle spacing.
+ Such picks are marked so that no MOVE_HEAD is issued for them. With the default FEEDER_PITCH of 100 mm
+ no two feeders line up with the nozzles, so nothing is marked unless FEEDER_PITCH is NOZZLE_X_SEPARATION
+ Argument(s):
+ const PlacementTable *table - the placement table of all parts
+ NozzleBatch *batch - the batch to mark
+ int options - PLAN_OPTION_GANG_PICK to mark shared positions, otherwise every pick moves the head
+ Return Value:
+ an int representing the number of picks marked
+ Usage:
+ plan -> head_moves_saved += markBatchPickPositions(table, &plan -> batch[b], options);
+ */
+static int markBatchPickPositions(const PlacementTable *table, NozzleBatch *batch, int options)
+{
+    double previous_x = INFINITY, previous_y = INFINITY;
+    int saved = 0;
+
+    for (int k = 0; k < batch -> number_of_parts; k++)
+    {
+        double x, y;
+        int nozzle = batch -> pick_order[k];
+
+        nozzlePickPosition(table -> feeder[batch -> part[nozzle]], nozzle, &x, &y);
+        batch -> pick_moves_head[k] = TRUE;
+        if ((options & PLAN_OPTION_GANG_PICK) && distance(x, y, previous_x, previous_y) < PLAN_SAME_POSITION_TOLERANCE)
+        {
+            batch -> pick_moves_head[k] = FALSE;
+            saved++;
+        }
+        previous_x = x;
+        previous_y = y;
+    }
+    return saved;
+}
+
+/*
+ Function: markSharedPickPositions
+ ---------------------------------
+ Date: 17/10/2026
+ Version 2.0
+ Purpose:
+ marks the picks of every batch that share the head position of the previous pick, see
+ markBatchPickPositions(). The time based ordering already places picks from a shared head position
+ next to each other, since the move between them is free
+ Argument(s):
+ const PlacementTable *table - the placement table of all parts
+ PlacementPlan *plan - the plan to mark
+ int options - PLAN_OPTION_GANG_PICK to mark shared positions, otherwise every pick moves the head
+ Return Value: none
+ Usage:
+ markSharedPickPositions(table, plan, options);
+ */
+static void markSharedPickPositions(const PlacementTable *table, PlacementPlan *plan, int options)
+{
+    plan -> head_moves_saved = 0;
+    for (int b = 0; b < plan -> number_of_batches; b++)
+    {
+        plan -> head_moves_saved += markBatchPickPositions(table, &plan -> batch[b], options);
+    }
+}
+
+/*
+ Function: planPlacement
+ -----------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ plans the autonomous mode route for a board: groups the parts into nozzle batches and orders the
+ picks, the lookup camera visit and the places of every batch to minimise the estimated cycle time
+ under the motion profile. The result is never slower than the naive feeder ordered route, which is
+ also measured for reporting. With PLAN_OPTION_GANG_PICK, picks that can share a head position are
+ marked so no MOVE_HEAD is issued. With PLAN_OPTION_MULTI_START the route comes from the parallel
+ multi-start search and planning takes at most about PLAN_SEARCH_BUDGET_MS, otherwise from a single
+ deterministic start run to the end, which is what estimates of many candidate setups want
+ Argument(s):
+ const PlacementTable *table - the placement table of all parts, not modified
+ const MotionProfile *profile - the motion profile of the machine
+ int options - PLAN_OPTION_NONE, or PLAN_OPTION_GANG_PICK and/or PLAN_OPTION_MULTI_START
+ PlacementPlan *plan - filled with the planned batches, free with freePlacementPlan()
+ Return Value:
+ one of:
+ PLAN_OK (0)
+ PLAN_INVALID_FEEDER (-1)
+ PLAN_UNREACHABLE_POSITION (-2)
+ PLAN_OUT_OF_MEMORY (-3)
+ Usage:
+ int res = planPlacement(&table, &profile, PLAN_OPTION_GANG_PICK | PLAN_OPTION_MULTI_START, &plan);
+ */
+int planPlacement(const PlacementTable *table, const MotionProfile *profile, int options, PlacementPlan *plan)
+{
+    int number_of_components = table -> count;
+    int capacity = (number_of_components + NUMBER_OF_NOZZLES - 1) / NUMBER_OF_NOZZLES, res;
+    MotionCostMatrix matrix;
+    NozzleBatch *naive;
+    struct timespec deadline;
+
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += PLAN_SEARCH_BUDGET_MS / 1000;
+    deadline.tv_nsec += (PLAN_SEARCH_BUDGET_MS % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    memset(&matrix, 0, sizeof(matrix));
+    plan -> batch = NULL;
+    plan -> number_of_batches = 0;
+    plan -> planned_travel = plan -> naive_travel = 0.0;
+    plan -> planned_time = plan -> naive_time = 0.0;
+    plan -> head_moves_saved = 0;
+
+    for (int k = 0; k < number_of_components; k++)
+    {
+        if (table -> feeder[k] < 0 || table -> feeder[k] >= NUMBER_OF_FEEDERS) return PLAN_INVALID_FEEDER;
+    }
+    if (number_of_components == 0) return PLAN_OK;
+
+    /* every batch holds at least one part, so there are at most as many batches as parts */
+    plan -> batch = malloc(sizeof(NozzleBatch) * number_of_components);
+    naive = malloc(sizeof(NozzleBatch) * capacity);
+    if (plan -> batch == NULL || naive == NULL || !buildMotionCostMatrix(table, profile, &matrix))
+    {
+        free(naive);
+        freeMotionCostMatrix(&matrix);
+        freePlacementPlan(plan);
+        return PLAN_OUT_OF_MEMORY;
+    }
+
+    res = buildNaiveBatches(table, number_of_components, naive);
+    if (res == PLAN_OK && (options & PLAN_OPTION_MULTI_START)) res = searchPlacement(&matrix, table, &deadline, plan);
+    else if (res == PLAN_OK)
+    {
+        res = buildGreedyBatches(&matrix, table, number_of_components, NULL, plan);
+        if (res == PLAN_OK) improvePlan(&matrix, table, plan, NULL, NULL);
+    }
+    if (res != PLAN_OK)
+    {
+        free(naive);
+        freeMotionCostMatrix(&matrix);
+        freePlacementPlan(plan);
+        return res;
+    }
+
+    plan -> planned_time = planTime(&matrix, table, plan -> batch, plan -> number_of_batches, &plan -> planned_travel);
+    plan -> naive_time = planTime(&matrix, table, naive, capacity, &plan -> naive_travel);
+
+    if (plan -> naive_time < plan -> planned_time)
+    {
+        memcpy(plan -> batch, naive, sizeof(NozzleBatch) * capacity);
+        plan -> number_of_batches = capacity;
+        plan -> planned_time = plan -> naive_time;
+        plan -> planned_travel = plan -> naive_travel;
+    }
+    free(naive);
+    freeMotionCostMatrix(&matrix);
+
+    markSharedPickPositions(table, plan, options);
+    return PLAN_OK;
+}
+
+/*
+ Function: repairPlacementPlan
+ -----------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ puts a part back into the part of a route still to be run, e.g. after its pick failed, without
+ replanning the rest. Within PLAN_REPAIR_WINDOW batches of the first batch still to run, the part is
+ either added to a batch with a free nozzle, which is reordered around it, or given a batch of its own
+ between two batches, whichever adds the least time. Batches outside the window, and the order of the
+ batches, are left as they are
+ Argument(s):
+ const MotionCostMatrix *matrix - the cost matrix of the table
+ const PlacementTable *table - the placement table of all parts
+ int options - PLAN_OPTION_GANG_PICK to mark the picks of the changed batch that share a head position
+ PlacementPlan *plan - the plan, the batches before first are taken as already run
+ int first - the first batch still to run, plan -> number_of_batches if none is left
+ int part - index into the placement table of the part
+ Return Value:
+ one of:
+ PLAN_OK (0)
+ PLAN_INVALID_FEEDER (-1)
+ PLAN_UNREACHABLE_POSITION (-2)
+ PLAN_OUT_OF_MEMORY (-3)
+ Usage:
+ res = repairPlacementPlan(&matrix, table, PLAN_OPTION_GANG_PICK, &plan, b + 1, part);
+ */
+int repairPlacementPlan(const MotionCostMatrix *matrix, const PlacementTable *table, int options, PlacementPlan *plan, int first, int part)
+{
+    int last = (first + PLAN_REPAIR_WINDOW < plan -> number_of_batches) ? first + PLAN_REPAIR_WINDOW : plan -> number_of_batches;
+    int best_batch = -1, best_inserts = FALSE;
+    double best_cost = INFINITY;
+    NozzleBatch best, *grown;
+
+    if (part < 0 || part >= table -> count || table -> feeder[part] < 0 || table -> feeder[part] >= NUMBER_OF_FEEDERS) return PLAN_INVALID_FEEDER;
+    grown = realloc(plan -> batch, sizeof(NozzleBatch) * (plan -> number_of_batches + 1));
+    if (grown == NULL) return PLAN_OUT_OF_MEMORY;
+    plan -> batch = grown;
+
+    for (int j = first; j <= last; j++)
+    {
+        NozzleBatch trial;
+        double cost;
+        int end;
+
+        /* a batch of the part alone, run between batches j - 1 and j */
+        for (int nozzle = 0; nozzle < NUMBER_OF_NOZZLES; nozzle++) trial.part[nozzle] = NO_PICKED_PART;
+        trial.part[CENTRE_NOZZLE] = part;
+        trial.number_of_parts = 1;
+        cost = optimiseBatchOrder(matrix, table, &trial, lastPlaceSite(plan, j - 1), firstPickSite(table, plan, j)) - transition(matrix, table, plan, j - 1, j);
+        if (cost < best_cost)
+        {
+            best_cost = cost;
+            best_batch = j;
+            best_inserts = TRUE;
+            best = trial;
+        }
+        if (j == last || plan -> batch[j].number_of_parts == NUMBER_OF_NOZZLES) continue;
+
+        /* the part on a free nozzle of batch j */
+        trial = plan -> batch[j];
+        for (int nozzle = 0; nozzle < NUMBER_OF_NOZZLES; nozzle++)
+        {
+            if (trial.part[nozzle] != NO_PICKED_PART) continue;
+            trial.part[nozzle] = part;
+            break;
+        }
+        trial.number_of_parts++;
+        cost = batchTime(matrix, table, &plan -> batch[j], lastPlaceSite(plan, j - 1), &end, NULL);
+        cost = optimiseBatchOrder(matrix, table, &trial, lastPlaceSite(plan, j - 1), firstPickSite(table, plan, j + 1)) -
+               (cost + motionTime(matrix, end, firstPickSite(table, plan, j + 1)));
+        if (cost < best_cost)
+        {
+            best_cost = cost;
+            best_batch = j;
+            best_inserts = FALSE;
+            best = trial;
+        }
+    }
+    if (best_batch < 0) return PLAN_UNREACHABLE_POSITION;
+
+    if (best_inserts)
+    {
+        memmove(&plan -> batch[best_batch + 1], &plan -> batch[best_batch], sizeof(NozzleBatch) * (plan -> number_of_batches - best_batch));
+        plan -> number_of_batches++;
+    }
+    else plan -> head_moves_saved -= markBatchPickPositions(table, &plan -> batch[best_batch], options);
+    plan -> batch[best_batch] = best;
+    plan -> head_moves_saved += markBatchPickPositions(table, &plan -> batch[best_batch], options);
+    plan -> planned_time += best_cost;
+    return PLAN_OK;
+}
+
+/*
+ Function: freePlacementPlan
+ ---------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: frees the batches of a plan created by planPlacement()
+ Argument(s):
+ PlacementPlan *plan - the plan
+ Return Value: none
+ Usage: freePlacementPlan(&plan);
+ */
+void freePlacementPlan(PlacementPlan *plan)
+{
+    free(plan -> batch);
+    plan -> batch = NULL;
+    plan -> number_of_batches = 0;
+}
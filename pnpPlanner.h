@@ -0,0 +1,67 @@
+/*
+ *
+ * pnpPlanner.h - declarations for the placement route planner used in autonomous mode
+ *
+ * Platform: Any POSIX compliant platform
+ * Intended for and tested on: Cygwin 64 bit
+ *
+ */
+
+#ifndef PNP_PLANNER_H
+#define PNP_PLANNER_H
+
+#include "pnpMotion.h"
+
+#define PLAN_OK 0
+#define PLAN_INVALID_FEEDER -1
+#define PLAN_UNREACHABLE_POSITION -2
+#define PLAN_OUT_OF_MEMORY -3
+
+#define PLAN_CANDIDATE_PARTS 8          // nearest parts considered when filling a nozzle batch
+#define PLAN_IMPROVEMENT_WINDOW 12      // how many batches either side of a batch are considered by the improvement moves
+#define PLAN_MAX_IMPROVEMENT_PASSES 20  // cap on 2-opt/Or-opt/exchange passes, each pass must improve the route to continue
+#define PLAN_SAME_POSITION_TOLERANCE 0.01   // head positions closer than this in mm are treated as the same position
+#define PLAN_GRID_PARTS_PER_CELL 4      // parts per cell of the grid the construction finds nearby parts with
+#define PLAN_SEARCH_STARTS 64           // starts of the multi-start route search
+#define PLAN_SEARCH_MAX_THREADS 16      // cap on the search's workers, one per core
+#define PLAN_SEARCH_BUDGET_MS 500       // wall clock budget of the search, from the call to planPlacement()
+#define PLAN_SEARCH_SEED_FEEDERS 2      // a random start seeds each batch from one of this many quickest feeders to reach
+#define PLAN_SEARCH_SEED_ATTEMPTS 8     // random draws for an unused part of the seed feeder before taking its first one
+#define PLAN_SEARCH_PRUNE_MARGIN 0.01   // a start more than this fraction slower than the best so far after a pass is abandoned
+#define PLAN_REPAIR_WINDOW 12           // batches after the current one a part put back into the route can join
+
+#define PLAN_OPTION_NONE 0
+#define PLAN_OPTION_GANG_PICK 1         // pick with several nozzles from one head position when their feeders line up with the nozzle spacing
+#define PLAN_OPTION_MULTI_START 2       // search many starts in parallel within PLAN_SEARCH_BUDGET_MS rather than one start to the end
+
+typedef struct
+{
+    int part[NUMBER_OF_NOZZLES];        // index into the placement table of the part on each nozzle, NO_PICKED_PART if empty
+    int pick_order[NUMBER_OF_NOZZLES];  // the loaded nozzles in the order they pick
+    int place_order[NUMBER_OF_NOZZLES]; // the loaded nozzles in the order they place
+    int pick_moves_head[NUMBER_OF_NOZZLES]; // FALSE when pick k is made from the head position of pick k - 1 without a MOVE_HEAD
+    int number_of_parts;
+
+} NozzleBatch;
+
+typedef struct
+{
+    NozzleBatch *batch;
+    int number_of_batches;
+    double planned_travel;              // gantry travel in mm of the planned route, from home back to home
+    double naive_travel;                // gantry travel in mm picking in feeder order three at a time, from home back to home
+    double planned_time;                // estimated cycle time in s of the planned route under the motion profile
+    double naive_time;                  // and of the feeder ordered route
+    int head_moves_saved;               // MOVE_HEAD instructions removed by PLAN_OPTION_GANG_PICK
+
+} PlacementPlan;
+
+double planTime(const MotionCostMatrix*, const PlacementTable*, const NozzleBatch[], int, double*);
+
+int planPlacement(const PlacementTable*, const MotionProfile*, int, PlacementPlan*);
+
+int repairPlacementPlan(const MotionCostMatrix*, const PlacementTable*, int, PlacementPlan*, int, int);
+
+void freePlacementPlan(PlacementPlan*);
+
+#endif // PNP_PLANNER_H
@@ -0,0 +1,697 @@
+/*
+ *
+ * pnpProgram.c - compiles the planned route of a board into a flat program of instructions and caches it
+ * on disk. Every instruction of the board is decided here, once, so autonomous mode only has to stream
+ * the program to the simulator. The only arguments that cannot be known in advance are the nozzle
+ * rotations, which need the pick errors from the lookup photo, and the head position corrections, which
+ * need the preplace errors from the lookdown photo. Those steps name the photo they depend on and are
+ * completed with resolveProgramStep() once its results are in
+ *
+ * Platform: Any POSIX compliant platform
+ * Intended for and tested on: Cygwin 64 bit
+ *
+ */
+
+#include "pnpStateMachine.h"
+
+typedef struct
+{
+    const ProgramFileHeader *header;
+    const PnPProgram *program;
+
+} ProgramContents;
+
+/*
+ Function: programBoardHash
+ --------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ identifies the board a program is compiled for: the targets, rotations and feeders of every part, the
+ feeder layout and camera position of the machine, its motion profile and the options the route is
+ planned with. A cached program is only used for a board with the same hash
+ Argument(s):
+ const PlacementTable *table - the parts of the board
+ const MotionProfile *profile - the motion profile the route is planned with
+ int options - PLAN_OPTION_ flags
+ Return Value: the hash
+ Usage: program -> board_hash = programBoardHash(table, profile, options);
+ */
+uint64_t programBoardHash(const PlacementTable *table, const MotionProfile *profile, int options)
+{
+    const double layout[] = {LOOKUP_CAMERA_X, LOOKUP_CAMERA_Y, NOZZLE_X_SEPARATION};
+    uint64_t hash = FNV_OFFSET_BASIS;
+
+    hash = fnv1a(hash, &table -> count, sizeof(table -> count));
+    hash = fnv1a(hash, table -> x, sizeof(double) * (size_t)table -> count);
+    hash = fnv1a(hash, table -> y, sizeof(double) * (size_t)table -> count);
+    hash = fnv1a(hash, table -> theta, sizeof(double) * (size_t)table -> count);
+    hash = fnv1a(hash, table -> feeder, sizeof(int) * (size_t)table -> count);
+    hash = fnv1a(hash, TAPE_FEEDER_X, sizeof(double) * NUMBER_OF_FEEDERS);
+    hash = fnv1a(hash, TAPE_FEEDER_Y, sizeof(double) * NUMBER_OF_FEEDERS);
+    hash = fnv1a(hash, layout, sizeof(layout));
+    hash = fnv1a(hash, profile, sizeof(MotionProfile));
+    return fnv1a(hash, &options, sizeof(options));
+}
+
+/*
+ Function: addStep
+ -----------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ appends a step to a program being compiled, its storage is sized for the worst case in advance
+ Argument(s):
+ PnPProgram *program - the program
+ int state - the state the step belongs to
+ int batch - the batch the step belongs to
+ int part - the part the step handles, or -1
+ int instruction - the instruction, e.g. MOVE_HEAD
+ double argument_1, double argument_2, int argument_3 - its arguments
+ int dependency - the step of the photo it depends on, or PROGRAM_NO_DEPENDENCY
+ Return Value:
+ the index of the new step
+ Usage:
+ int photo = addStep(program, STATE_TAKE_UP_PHOTO, b, -1, TAKE_PHOTO, 0.0, 0.0, PHOTO_LOOKUP, PROGRAM_NO_DEPENDENCY);
+ */
+static int addStep(PnPProgram *program, int state, int batch, int part, int instruction, double argument_1, double argument_2, int argument_3, int dependency)
+{
+    ProgramStep *step = &program -> step[program -> number_of_steps];
+
+    memset(step, 0, sizeof(ProgramStep));
+    step -> argument_1 = argument_1;
+    step -> argument_2 = argument_2;
+    step -> instruction = instruction;
+    step -> argument_3 = argument_3;
+    step -> dependency = dependency;
+    step -> state = state;
+    step -> part = part;
+    step -> batch = batch;
+    return program -> number_of_steps++;
+}
+
+/*
+ Function: compilePicks
+ ----------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ appends the picks of a batch and its lookup photo: the head moves over the feeder of each pick that
+ needs a move, every nozzle picking from that position is lowered, picks and is raised, then the head
+ moves to the lookup camera for one photo of all the nozzles
+ Argument(s):
+ PnPProgram *program - the program, program -> batch holds the batch
+ const PlacementTable *table - the parts of the board
+ int b - the batch index
+ Return Value:
+ the index of the lookup photo step
+ Usage:
+ int lookup = compilePicks(program, table, b);
+ */
+static int compilePicks(PnPProgram *program, const PlacementTable *table, int b)
+{
+    const NozzleBatch *batch = &program -> batch[b];
+    double x, y;
+
+    /* a move per head position then the lower, vacuum and raise of every nozzle picking there */
+    for (int pick = 0; pick < batch -> number_of_parts; )
+    {
+        int nozzle = batch -> pick_order[pick], gang = 1;
+
+        while (pick + gang < batch -> number_of_parts && batch -> pick_moves_head[pick + gang] == FALSE) gang++;
+        if (batch -> pick_moves_head[pick])
+        {
+            nozzlePickPosition(table -> feeder[batch -> part[nozzle]], nozzle, &x, &y);
+            addStep(program, STATE_MOVE_TO_FEEDER, b, batch -> part[nozzle], MOVE_HEAD, x, y, 0, PROGRAM_NO_DEPENDENCY);
+        }
+        for (int k = pick; k < pick + gang; k++) addStep(program, STATE_LOWER_NOZZLE, b, batch -> part[batch -> pick_order[k]], LOWER_NOZZLE, 0.0, 0.0, batch -> pick_order[k], PROGRAM_NO_DEPENDENCY);
+        for (int k = pick; k < pick + gang; k++) addStep(program, STATE_PICK_COMPONENT, b, batch -> part[batch -> pick_order[k]], APPLY_VACUUM, 0.0, 0.0, batch -> pick_order[k], PROGRAM_NO_DEPENDENCY);
+        for (int k = pick; k < pick + gang; k++) addStep(program, STATE_RAISE_COMPONENT, b, batch -> part[batch -> pick_order[k]], RAISE_NOZZLE, 0.0, 0.0, batch -> pick_order[k], PROGRAM_NO_DEPENDENCY);
+        pick += gang;
+    }
+
+    addStep(program, STATE_MOVE_TO_CAMERA, b, -1, MOVE_HEAD, LOOKUP_CAMERA_X, LOOKUP_CAMERA_Y, 0, PROGRAM_NO_DEPENDENCY);
+    return addStep(program, STATE_TAKE_UP_PHOTO, b, -1, TAKE_PHOTO, 0.0, 0.0, PHOTO_LOOKUP, PROGRAM_NO_DEPENDENCY);
+}
+
+/*
+ Function: compilePlaces
+ -----------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ appends the places of a batch: every nozzle is rotated at once while the head moves to the first
+ place, then each place takes a lookdown photo, corrects the head position, lowers, releases and raises
+ the nozzle before the head moves to the next place
+ Argument(s):
+ PnPProgram *program - the program, program -> batch holds the batch
+ const PlacementTable *table - the parts of the board
+ int b - the batch index
+ int lookup - the step of the batch's lookup photo
+ Return Value: none
+ Usage:
+ compilePlaces(program, table, b, lookup);
+ */
+static void compilePlaces(PnPProgram *program, const PlacementTable *table, int b, int lookup)
+{
+    const NozzleBatch *batch = &program -> batch[b];
+    double x, y;
+
+    /* the rotations only hold their nozzle, so a concurrent simulator overlaps them with the move to the first place */
+    for (int k = 0; k < batch -> number_of_parts; k++)
+    {
+        int nozzle = batch -> place_order[k], part = batch -> part[nozzle];
+        addStep(program, STATE_ROTATE, b, part, ROTATE_NOZZLE, table -> theta[part], 0.0, nozzle, lookup);
+    }
+
+    for (int k = 0; k < batch -> number_of_parts; k++)
+    {
+        int nozzle = batch -> place_order[k], part = batch -> part[nozzle];
+
+        nozzlePlacePosition(table, part, nozzle, &x, &y);
+        addStep(program, STATE_MOVE_TO_PCB, b, part, MOVE_HEAD, x, y, 0, PROGRAM_NO_DEPENDENCY);
+        int lookdown = addStep(program, STATE_TAKE_DOWN_PHOTO, b, part, TAKE_PHOTO, 0.0, 0.0, PHOTO_LOOKDOWN, PROGRAM_NO_DEPENDENCY);
+        addStep(program, STATE_ADJUST, b, part, AMEND_HEAD_POSITION, 0.0, 0.0, 0, lookdown);
+        addStep(program, STATE_LOWER_COMPONENT, b, part, LOWER_NOZZLE, 0.0, 0.0, nozzle, PROGRAM_NO_DEPENDENCY);
+        addStep(program, STATE_PLACE_COMPONENT, b, part, RELEASE_VACUUM, 0.0, 0.0, nozzle, PROGRAM_NO_DEPENDENCY);
+        addStep(program, STATE_RAISE_HEAD, b, part, RAISE_NOZZLE, 0.0, 0.0, nozzle, PROGRAM_NO_DEPENDENCY);
+    }
+}
+
+/*
+ Function: compileProgram
+ ------------------------
+ Date: 17/10/2026
+ Version 2.0
+ Purpose:
+ turns a planned route into the program that places it, the picks and lookup photo of each batch (see
+ compilePicks()) followed by its places (see compilePlaces()). The batches are kept with the program so
+ that repairProgram() can change the rest of the route while it runs
+ Argument(s):
+ const PlacementTable *table - the parts of the board
+ const PlacementPlan *plan - the planned route
+ const MotionProfile *profile - the motion profile the route was planned with
+ int options - the PLAN_OPTION_ flags the route was planned with
+ PnPProgram *program - set to the compiled program, free with freeProgram()
+ Return Value:
+ PLAN_OK (0) or PLAN_OUT_OF_MEMORY (-3)
+ Usage:
+ res = compileProgram(&table, &plan, &profile, PLAN_OPTION_GANG_PICK, &program);
+ */
+int compileProgram(const PlacementTable *table, const PlacementPlan *plan, const MotionProfile *profile, int options, PnPProgram *program)
+{
+    size_t capacity = PROGRAM_STEPS_PER_PART * (size_t)table -> count + PROGRAM_STEPS_PER_BATCH * (size_t)plan -> number_of_batches;
+
+    memset(program, 0, sizeof(PnPProgram));
+    program -> step = malloc(sizeof(ProgramStep) * (capacity > 0 ? capacity : 1));
+    program -> batch = malloc(sizeof(NozzleBatch) * (plan -> number_of_batches > 0 ? (size_t)plan -> number_of_batches : 1));
+    if (program -> step == NULL || program -> batch == NULL)
+    {
+        freeProgram(program);
+        return PLAN_OUT_OF_MEMORY;
+    }
+    if (plan -> number_of_batches > 0) memcpy(program -> batch, plan -> batch, sizeof(NozzleBatch) * (size_t)plan -> number_of_batches);
+    program -> number_of_parts = table -> count;
+    program -> number_of_batches = plan -> number_of_batches;
+    program -> planned_travel = plan -> planned_travel;
+    program -> planned_time = plan -> planned_time;
+    program -> board_hash = programBoardHash(table, profile, options);
+
+    for (int b = 0; b < program -> number_of_batches; b++)
+    {
+        compilePlaces(program, table, b, compilePicks(program, table, b));
+    }
+    return PLAN_OK;
+}
+
+/*
+ Function: repairProgram
+ -----------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ changes the rest of a running program once the lookup photo of a batch shows picks that failed. The
+ program is cut back to the photo. Every part that failed is released over the camera into the reject
+ bin if it is on its nozzle at all, the batch goes on to place only the parts that were picked well,
+ and each part to retry is put into one of the next batches, or a batch of its own, by
+ repairPlacementPlan(). Only the batches after the photo are compiled again, the steps already posted
+ are left as they were
+ Argument(s):
+ PnPProgram *program - the program
+ const PlacementTable *table - the parts of the board the program was compiled from
+ const MotionCostMatrix *matrix - the cost matrix of the table
+ int options - the PLAN_OPTION_ flags the route was planned with
+ int lookup - the step of the lookup photo
+ const BatchVision *vision - the photo results, vision -> carrying says which nozzles hold a part to reject
+ int outcome[] - PICK_OK, PICK_RETRY or PICK_SKIP for each nozzle, a part that cannot be put back into
+ the route is changed to PICK_SKIP
+ Return Value:
+ PLAN_OK (0) or PLAN_OUT_OF_MEMORY (-3), when the program is left unchanged
+ Usage:
+ res = repairProgram(&context -> program, context -> table, &context -> matrix, PLAN_OPTION_GANG_PICK, lookup, &context -> vision, outcome);
+ */
+int repairProgram(PnPProgram *program, const PlacementTable *table, const MotionCostMatrix *matrix, int options, int lookup, const BatchVision *vision, int outcome[])
+{
+    int b = program -> step[lookup].batch, next = b + 1, parts = 0, kept = 0;
+    NozzleBatch *batch;
+    PlacementPlan plan;
+    ProgramStep *grown;
+    size_t capacity;
+
+    /* the route is repaired on a copy, so the program is unchanged if memory runs out */
+    memset(&plan, 0, sizeof(plan));
+    plan.batch = malloc(sizeof(NozzleBatch) * (size_t)program -> number_of_batches);
+    if (plan.batch == NULL) return PLAN_OUT_OF_MEMORY;
+    memcpy(plan.batch, program -> batch, sizeof(NozzleBatch) * (size_t)program -> number_of_batches);
+    plan.number_of_batches = program -> number_of_batches;
+
+    /* the batch keeps the parts that were picked well in their place order, it is dropped if none were */
+    batch = &plan.batch[b];
+    for (int k = 0; k < batch -> number_of_parts; k++)
+    {
+        if (outcome[batch -> place_order[k]] == PICK_OK) batch -> place_order[kept++] = batch -> place_order[k];
+    }
+    for (int nozzle = 0; nozzle < NUMBER_OF_NOZZLES; nozzle++)
+    {
+        if (outcome[nozzle] != PICK_OK) batch -> part[nozzle] = NO_PICKED_PART;
+    }
+    batch -> number_of_parts = kept;
+    if (kept == 0)
+    {
+        memmove(&plan.batch[b], &plan.batch[b + 1], sizeof(NozzleBatch) * (size_t)(plan.number_of_batches - b - 1));
+        plan.number_of_batches--;
+        next = b;
+    }
+
+    for (int nozzle = 0; nozzle < NUMBER_OF_NOZZLES; nozzle++)
+    {
+        if (outcome[nozzle] == PICK_RETRY && repairPlacementPlan(matrix, table, options, &plan, next, program -> batch[b].part[nozzle]) != PLAN_OK) outcome[nozzle] = PICK_SKIP;
+    }
+
+    for (int j = b; j < plan.number_of_batches; j++) parts += plan.batch[j].number_of_parts;
+    capacity = (size_t)lookup + 1 + NUMBER_OF_NOZZLES + PROGRAM_STEPS_PER_PART * (size_t)parts + PROGRAM_STEPS_PER_BATCH * (size_t)(plan.number_of_batches - b);
+    grown = realloc(program -> step, sizeof(ProgramStep) * capacity);
+    if (grown == NULL)
+    {
+        free(plan.batch);
+        return PLAN_OUT_OF_MEMORY;
+    }
+    program -> step = grown;
+
+    /* the reject bin is under the lookup camera, a part released with its nozzle raised falls into it */
+    program -> number_of_steps = lookup + 1;
+    for (int nozzle = 0; nozzle < NUMBER_OF_NOZZLES; nozzle++)
+    {
+        if (outcome[nozzle] != PICK_OK && vision -> carrying[nozzle])
+        {
+            addStep(program, STATE_REJECT_COMPONENT, b, program -> batch[b].part[nozzle], RELEASE_VACUUM, 0.0, 0.0, nozzle, PROGRAM_NO_DEPENDENCY);
+        }
+    }
+
+    free(program -> batch);
+    program -> batch = plan.batch;
+    program -> number_of_batches = plan.number_of_batches;
+    if (kept > 0) compilePlaces(program, table, b, lookup);
+    for (int j = next; j < program -> number_of_batches; j++)
+    {
+        compilePlaces(program, table, j, compilePicks(program, table, j));
+    }
+    return PLAN_OK;
+}
+
+/*
+ Function: deferProgramBatches
+ -----------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ moves some batches of a program that has not started to run to the end of its route, keeping the
+ order of the batches moved and of the rest, and compiles the program again in the new order. The
+ batches keep their steps, so the program still fits its storage
+ Argument(s):
+ PnPProgram *program - the program
+ const PlacementTable *table - the parts of the board the program was compiled from
+ const int deferred[] - TRUE for each batch to move to the end
+ Return Value:
+ PLAN_OK (0) or PLAN_OUT_OF_MEMORY (-3), when the program is left unchanged
+ Usage:
+ res = deferProgramBatches(&program, &table, starved);
+ */
+int deferProgramBatches(PnPProgram *program, const PlacementTable *table, const int deferred[])
+{
+    NozzleBatch *batch = malloc(sizeof(NozzleBatch) * (program -> number_of_batches > 0 ? (size_t)program -> number_of_batches : 1));
+    int k = 0;
+
+    if (batch == NULL) return PLAN_OUT_OF_MEMORY;
+    for (int pass = FALSE; pass <= TRUE; pass++)
+    {
+        for (int b = 0; b < program -> number_of_batches; b++)
+        {
+            if ((deferred[b] != FALSE) == pass) batch[k++] = program -> batch[b];
+        }
+    }
+
+    free(program -> batch);
+    program -> batch = batch;
+    program -> number_of_steps = 0;
+    for (int b = 0; b < program -> number_of_batches; b++)
+    {
+        compilePlaces(program, table, b, compilePicks(program, table, b));
+    }
+    return PLAN_OK;
+}
+
+/*
+ Function: offsetProgram
+ -----------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ moves every place of a program by the same offset, so one compiled program places each copy of a
+ panelised board. Only the moves to the board carry board coordinates, the feeders and the lookup
+ camera stay where they are
+ Argument(s):
+ PnPProgram *program - the program
+ double x_offset - the offset in mm along x
+ double y_offset - the offset in mm along y
+ Return Value: none
+ Usage:
+ offsetProgram(&board -> program, board -> x_offset, board -> y_offset);
+ */
+void offsetProgram(PnPProgram *program, double x_offset, double y_offset)
+{
+    for (int k = 0; k < program -> number_of_steps; k++)
+    {
+        ProgramStep *step = &program -> step[k];
+
+        if (step -> state != STATE_MOVE_TO_PCB || step -> instruction != MOVE_HEAD) continue;
+        step -> argument_1 += x_offset;
+        step -> argument_2 += y_offset;
+    }
+}
+
+/*
+ Function: programCachePath
+ --------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ names the cache file of a board's program after the hash of everything the program is compiled from,
+ so every board run in a directory keeps its own program and the boards of a job do not overwrite one
+ another's
+ Argument(s):
+ const PlacementTable *table - the parts of the board, without any panel offset
+ const MotionProfile *profile - the motion profile the route is planned with
+ int options - the PLAN_OPTION_ flags the route is planned with
+ char path[] - set to the file name, must hold PROGRAM_CACHE_PATH_LENGTH characters
+ Return Value: none
+ Usage:
+ programCachePath(&table, &profile, PLAN_OPTION_GANG_PICK, path);
+ */
+void programCachePath(const PlacementTable *table, const MotionProfile *profile, int options, char path[])
+{
+    snprintf(path, PROGRAM_CACHE_PATH_LENGTH, PROGRAM_CACHE_FILE_FORMAT, (unsigned long long)programBoardHash(table, profile, options));
+}
+
+/*
+ Function: writeProgramContents
+ ------------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: writes the header, steps and batches of a program cache file, the FileWriter of saveProgram()
+ Argument(s):
+ FILE *fp - the open file
+ const void *context - the ProgramContents to write
+ Return Value: TRUE (1) if every write succeeded, otherwise FALSE (0)
+ Usage: replaceFile(path, "wb", writeProgramContents, &contents);
+ */
+static int writeProgramContents(FILE *fp, const void *context)
+{
+    const ProgramContents *contents = context;
+    size_t steps_size = sizeof(ProgramStep) * (size_t)contents -> program -> number_of_steps;
+    size_t batches_size = sizeof(NozzleBatch) * (size_t)contents -> program -> number_of_batches;
+
+    return fwrite(contents -> header, sizeof(ProgramFileHeader), 1, fp) == 1 && (steps_size == 0 || fwrite(contents -> program -> step, steps_size, 1, fp) == 1) &&
+           (batches_size == 0 || fwrite(contents -> program -> batch, batches_size, 1, fp) == 1);
+}
+
+/*
+ Function: saveProgram
+ ---------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ writes a compiled program to its cache file: a ProgramFileHeader followed by the steps and the batches
+ they were compiled from. It goes through replaceFile(), so a controller starting at the same time never
+ reads a half written program. A program that cannot be saved is simply compiled again next time
+ Argument(s):
+ const char *path - the cache file
+ const PnPProgram *program - the program
+ int options - the PLAN_OPTION_ flags the route was planned with
+ Return Value:
+ TRUE (1) if the program was written, otherwise FALSE (0)
+ Usage:
+ saveProgram(path, &program, PLAN_OPTION_GANG_PICK);
+ */
+int saveProgram(const char *path, const PnPProgram *program, int options)
+{
+    ProgramFileHeader header;
+    ProgramContents contents = {&header, program};
+    size_t steps_size = sizeof(ProgramStep) * (size_t)program -> number_of_steps;
+    size_t batches_size = sizeof(NozzleBatch) * (size_t)program -> number_of_batches;
+
+    memset(&header, 0, sizeof(header));
+    header.magic = PROGRAM_MAGIC;
+    header.version = PROGRAM_VERSION;
+    header.step_size = sizeof(ProgramStep);
+    header.number_of_steps = program -> number_of_steps;
+    header.number_of_parts = program -> number_of_parts;
+    header.number_of_batches = program -> number_of_batches;
+    header.options = options;
+    header.board_hash = program -> board_hash;
+    header.content_hash = fnv1a(fnv1a(FNV_OFFSET_BASIS, program -> step, steps_size), program -> batch, batches_size);
+    header.planned_travel = program -> planned_travel;
+    header.planned_time = program -> planned_time;
+
+    return replaceFile(path, "wb", writeProgramContents, &contents);
+}
+
+/*
+ Function: isProgramStepValid
+ ----------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ checks a step read from a cache file, so that a damaged file can never pass the simulator an
+ instruction the compiler would not have produced
+ Argument(s):
+ const PnPProgram *program - the program, its steps before this one already checked
+ int index - the step to check
+ Return Value:
+ TRUE (1) if the step is valid, otherwise FALSE (0)
+ Usage:
+ if (!isProgramStepValid(program, k)) ...
+ */
+static int isProgramStepValid(const PnPProgram *program, int index)
+{
+    const ProgramStep *step = &program -> step[index];
+
+    if (step -> instruction <= NO_INSTRUCTION || step -> instruction > AMEND_HEAD_POSITION) return FALSE;
+    if (step -> state < 0 || step -> state >= NUMBER_OF_STATES) return FALSE;
+    if (step -> part < -1 || step -> part >= program -> number_of_parts) return FALSE;
+    if (step -> batch < 0 || step -> batch >= program -> number_of_batches) return FALSE;
+    if (!isfinite(step -> argument_1) || !isfinite(step -> argument_2)) return FALSE;
+    if (step -> instruction != MOVE_HEAD && step -> instruction != TAKE_PHOTO && step -> instruction != AMEND_HEAD_POSITION &&
+        (step -> argument_3 < 0 || step -> argument_3 >= NUMBER_OF_NOZZLES)) return FALSE;
+    if (step -> state == STATE_REJECT_COMPONENT) return FALSE;      // only added to a running program, which is never saved
+    if (step -> instruction == TAKE_PHOTO && step -> argument_3 != PHOTO_LOOKUP && step -> argument_3 != PHOTO_LOOKDOWN) return FALSE;
+    if (step -> dependency == PROGRAM_NO_DEPENDENCY) return step -> instruction != AMEND_HEAD_POSITION;
+
+    /* a dependency must be an earlier photo of the camera the step needs */
+    if (step -> dependency < 0 || step -> dependency >= index || program -> step[step -> dependency].instruction != TAKE_PHOTO) return FALSE;
+    if (step -> instruction == ROTATE_NOZZLE) return program -> step[step -> dependency].argument_3 == PHOTO_LOOKUP;
+    if (step -> instruction == AMEND_HEAD_POSITION) return program -> step[step -> dependency].argument_3 == PHOTO_LOOKDOWN;
+    return FALSE;
+}
+
+/*
+ Function: isProgramBatchValid
+ -----------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ checks a batch read from a cache file, so that a damaged file can never give repairProgram() a batch
+ the planner would not have produced
+ Argument(s):
+ const PnPProgram *program - the program
+ int index - the batch to check
+ Return Value:
+ TRUE (1) if the batch is valid, otherwise FALSE (0)
+ Usage:
+ if (!isProgramBatchValid(program, b)) ...
+ */
+static int isProgramBatchValid(const PnPProgram *program, int index)
+{
+    const NozzleBatch *batch = &program -> batch[index];
+    unsigned int picked = 0, placed = 0, loaded = 0;
+
+    if (batch -> number_of_parts < 1 || batch -> number_of_parts > NUMBER_OF_NOZZLES) return FALSE;
+    for (int nozzle = 0; nozzle < NUMBER_OF_NOZZLES; nozzle++)
+    {
+        if (batch -> part[nozzle] == NO_PICKED_PART) continue;
+        if (batch -> part[nozzle] < 0 || batch -> part[nozzle] >= program -> number_of_parts) return FALSE;
+        loaded |= NOZZLE_BIT(nozzle);
+    }
+
+    /* the pick and place orders must each name every loaded nozzle once */
+    for (int k = 0; k < batch -> number_of_parts; k++)
+    {
+        if (batch -> pick_order[k] < 0 || batch -> pick_order[k] >= NUMBER_OF_NOZZLES) return FALSE;
+        if (batch -> place_order[k] < 0 || batch -> place_order[k] >= NUMBER_OF_NOZZLES) return FALSE;
+        picked |= NOZZLE_BIT(batch -> pick_order[k]);
+        placed |= NOZZLE_BIT(batch -> place_order[k]);
+    }
+    return picked == loaded && placed == loaded && __builtin_popcount(loaded) == batch -> number_of_parts;
+}
+
+/*
+ Function: loadProgram
+ ---------------------
+ Date: 17/10/2026
+ Version 2.0
+ Purpose:
+ reads the compiled program of a board from its cache file. The program is only accepted if it was
+ compiled by this version of the controller for the same board, planning options, machine layout and
+ motion profile, and its steps and batches match their content hash and pass validation
+ Argument(s):
+ const char *path - the cache file
+ const PlacementTable *table - the parts of the board
+ const MotionProfile *profile - the motion profile the route would be planned with
+ int options - the PLAN_OPTION_ flags the route would be planned with
+ PnPProgram *program - set to the cached program, free with freeProgram()
+ Return Value:
+ TRUE (1) if a cached program was loaded, otherwise FALSE (0) and the program must be compiled
+ Usage:
+ if (!loadProgram(path, &table, &profile, PLAN_OPTION_GANG_PICK, &program)) ... plan and compile ...
+ */
+int loadProgram(const char *path, const PlacementTable *table, const MotionProfile *profile, int options, PnPProgram *program)
+{
+    ProgramFileHeader header;
+    size_t steps_size = 0, batches_size = 0;
+    FILE *fp;
+    int loaded;
+
+    memset(program, 0, sizeof(PnPProgram));
+    fp = fopen(path, "rb");
+    if (fp == NULL) return FALSE;
+
+    loaded = fread(&header, sizeof(header), 1, fp) == 1 && header.magic == PROGRAM_MAGIC && header.version == PROGRAM_VERSION &&
+             header.step_size == sizeof(ProgramStep) && header.options == options && header.number_of_parts == table -> count &&
+             header.number_of_steps >= 0 && (size_t)header.number_of_steps <= (PROGRAM_STEPS_PER_PART + PROGRAM_STEPS_PER_BATCH) * (size_t)table -> count &&
+             header.number_of_batches >= 0 && header.number_of_batches <= table -> count &&
+             header.board_hash == programBoardHash(table, profile, options);
+    if (loaded)
+    {
+        steps_size = sizeof(ProgramStep) * (size_t)header.number_of_steps;
+        batches_size = sizeof(NozzleBatch) * (size_t)header.number_of_batches;
+        program -> step = malloc(steps_size > 0 ? steps_size : 1);
+        program -> batch = malloc(batches_size > 0 ? batches_size : 1);
+        loaded = program -> step != NULL && program -> batch != NULL && (steps_size == 0 || fread(program -> step, steps_size, 1, fp) == 1) &&
+                 (batches_size == 0 || fread(program -> batch, batches_size, 1, fp) == 1);
+    }
+    fclose(fp);
+
+    if (loaded)
+    {
+        program -> number_of_steps = header.number_of_steps;
+        program -> number_of_parts = header.number_of_parts;
+        program -> number_of_batches = header.number_of_batches;
+        program -> planned_travel = header.planned_travel;
+        program -> planned_time = header.planned_time;
+        program -> board_hash = header.board_hash;
+        loaded = fnv1a(fnv1a(FNV_OFFSET_BASIS, program -> step, steps_size), program -> batch, batches_size) == header.content_hash;
+        for (int b = 0; b < program -> number_of_batches && loaded; b++) loaded = isProgramBatchValid(program, b);
+        for (int k = 0; k < program -> number_of_steps && loaded; k++) loaded = isProgramStepValid(program, k);
+    }
+    if (!loaded) freeProgram(program);
+    return loaded;
+}
+
+/*
+ Function: resolveProgramStep
+ ----------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ completes the arguments of a step from the results of the photo it depends on, leaving the program
+ itself unchanged so that it can be run again. A rotation becomes the target angle less the nozzle's
+ pick error, a head position correction becomes the preplace errors
+ Argument(s):
+ const ProgramStep *step - the compiled step
+ const BatchVision *vision - the results of the photo named by step -> dependency
+ ProgramStep *resolved - set to the step with its arguments completed
+ Return Value: none
+ Usage:
+ resolveProgramStep(&program.step[k], &vision, &resolved);
+ */
+void resolveProgramStep(const ProgramStep *step, const BatchVision *vision, ProgramStep *resolved)
+{
+    *resolved = *step;
+    if (step -> dependency == PROGRAM_NO_DEPENDENCY) return;
+
+    if (step -> instruction == ROTATE_NOZZLE)
+    {
+        resolved -> argument_1 = step -> argument_1 - vision -> theta_pick_error[step -> argument_3];
+    }
+    else if (step -> instruction == AMEND_HEAD_POSITION)
+    {
+        resolved -> argument_1 = vision -> x_preplace_error;
+        resolved -> argument_2 = vision -> y_preplace_error;
+    }
+}
+
+/*
+ Function: postProgramStep
+ -------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ passes a step to the simulator through the interface routine for its instruction
+ Argument(s):
+ const ProgramStep *step - the step, resolved if it has a dependency
+ Return Value: none
+ Usage:
+ postProgramStep(&resolved);
+ */
+void postProgramStep(const ProgramStep *step)
+{
+    switch (step -> instruction)
+    {
+        case MOVE_HEAD: setTargetPos(step -> argument_1, step -> argument_2); break;
+        case ROTATE_NOZZLE: rotateNozzle(step -> argument_3, step -> argument_1); break;
+        case LOWER_NOZZLE: lowerNozzle(step -> argument_3); break;
+        case RAISE_NOZZLE: raiseNozzle(step -> argument_3); break;
+        case APPLY_VACUUM: applyVacuum(step -> argument_3); break;
+        case RELEASE_VACUUM: releaseVacuum(step -> argument_3); break;
+        case TAKE_PHOTO: takePhoto(step -> argument_3); break;
+        case AMEND_HEAD_POSITION: amendPos(step -> argument_1, step -> argument_2); break;
+    }
+}
+
+/*
+ Function: freeProgram
+ ---------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: frees the steps and batches of a program
+ Argument(s):
+ PnPProgram *program - the program
+ Return Value: none
+ Usage: freeProgram(&program);
+ */
+void freeProgram(PnPProgram *program)
+{
+    free(program -> step);
+    free(program -> batch);
+    memset(program, 0, sizeof(PnPProgram));
+}
@@ -0,0 +1,94 @@
+/*
+ *
+ * pnpProgram.h - declarations for the compiled instruction program of a board, the flat list of every
+ * instruction autonomous mode passes to the simulator, and its cache on disk
+ *
+ * Platform: Any POSIX compliant platform
+ * Intended for and tested on: Cygwin 64 bit
+ *
+ */
+
+#ifndef PNP_PROGRAM_H
+#define PNP_PROGRAM_H
+
+#include "pnpPlanner.h"
+
+#define PROGRAM_CACHE_PREFIX "pnp_program."   // compiled program of each board run in this directory, see programCachePath()
+#define PROGRAM_CACHE_FILE_FORMAT PROGRAM_CACHE_PREFIX "%016llx.bin"
+#define PROGRAM_CACHE_PATH_LENGTH 64
+#define PROGRAM_MAGIC 0x47504E50u              // "PNPG" in little endian byte order
+#define PROGRAM_VERSION 3
+#define PROGRAM_NO_DEPENDENCY -1
+#define PROGRAM_STEPS_PER_PART 11              // most steps compiled for one part, a pick move, 3 pick steps, a rotation and 6 place steps
+#define PROGRAM_STEPS_PER_BATCH 2              // steps compiled once per batch, the move to the lookup camera and the photo
+
+#define PICK_OK 0                              // the part is on its nozzle, squarely enough to place
+#define PICK_RETRY 1                           // the pick failed, the part is picked again in a later batch
+#define PICK_SKIP 2                            // the pick failed too often, the part is left off the board
+#define PICK_MAX_THETA_ERROR 6.0               // degrees, a part picked further out of line than this is rejected
+#define PICK_MAX_ATTEMPTS 3                    // picks of one part before it is skipped
+typedef struct
+{
+    double argument_1;                  // compiled value, a rotation holds the target angle until the pick error is subtracted
+    double argument_2;
+    int instruction;                    // MOVE_HEAD etc.
+    int argument_3;                     // nozzle or camera
+    int dependency;                     // step of the TAKE_PHOTO whose result completes the arguments, or PROGRAM_NO_DEPENDENCY
+    int state;                          // state the step belongs to, for display and the instrumentation
+    int part;                           // index of the part the step handles, -1 for the lookup camera
+    int batch;                          // index of the batch the step belongs to
+
+} ProgramStep;
+
+typedef struct
+{
+    ProgramStep *step;
+    NozzleBatch *batch;                 // the batches the steps are compiled from, kept to repair the route after a failed pick
+    int number_of_steps;
+    int number_of_parts;
+    int number_of_batches;
+    double planned_travel;              // gantry travel in mm of the route the program follows
+    double planned_time;                // estimated cycle time in s of the route
+    uint64_t board_hash;                // of everything the program was compiled from, see programBoardHash()
+
+} PnPProgram;
+
+typedef struct
+{
+    uint32_t magic;                     // PROGRAM_MAGIC
+    uint32_t version;                   // PROGRAM_VERSION
+    uint32_t step_size;                 // sizeof(ProgramStep) of the writer, must match the reader
+    int32_t number_of_steps;
+    int32_t number_of_parts;
+    int32_t number_of_batches;
+    int32_t options;                    // PLAN_OPTION_ flags the route was planned with
+    uint64_t board_hash;
+    uint64_t content_hash;              // FNV-1a of the steps then the batches, padding bytes are written as zero
+    double planned_travel;
+    double planned_time;
+
+} ProgramFileHeader;
+
+uint64_t programBoardHash(const PlacementTable*, const MotionProfile*, int);
+
+int compileProgram(const PlacementTable*, const PlacementPlan*, const MotionProfile*, int, PnPProgram*);
+
+int repairProgram(PnPProgram*, const PlacementTable*, const MotionCostMatrix*, int, int, const BatchVision*, int[]);
+
+int deferProgramBatches(PnPProgram*, const PlacementTable*, const int[]);
+
+void offsetProgram(PnPProgram*, double, double);
+
+void programCachePath(const PlacementTable*, const MotionProfile*, int, char[]);
+
+int saveProgram(const char*, const PnPProgram*, int);
+
+int loadProgram(const char*, const PlacementTable*, const MotionProfile*, int, PnPProgram*);
+
+void resolveProgramStep(const ProgramStep*, const BatchVision*, ProgramStep*);
+
+void postProgramStep(const ProgramStep*);
+
+void freeProgram(PnPProgram*);
+
+#endif // PNP_PROGRAM_H
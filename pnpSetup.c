@@ -0,0 +1,431 @@
+/*
+ *
+ * pnpSetup.c - the feeder setup optimizer. A reel is identified by the feeder number its parts are given
+ * in the input centroid files, and the optimizer chooses the slot each reel is loaded into. Reels are
+ * first assigned exactly under a travel model, the pick-to-place travel of every part weighted by how
+ * many there are, then the assignment is checked and refined with the route planner's estimated cycle
+ * time, so the setup it returns is never planned slower than the original
+ *
+ * Platform: Any POSIX compliant platform
+ * Intended for and tested on: Cygwin 64 bit
+ *
+ */
+
+#include "pnpSetup.h"
+
+/*
+ Function: reelSlotCost
+ ----------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ gets the travel model cost of loading a reel into a slot: for every part fed from the reel, the travel
+ from the slot to the lookup camera on the way to the board and from the part's target back to the slot
+ for the next pick, so a reel whose parts sit near a slot is drawn to it in proportion to its part count
+ Argument(s):
+ const PlacementStore boards[] - the boards of the family
+ int number_of_boards - how many
+ int reel - the reel, a feeder number of the input files
+ int slot - the tape feeder slot
+ Return Value:
+ a double representing the cost in mm
+ Usage:
+ cost[reel][slot] = reelSlotCost(boards, number_of_boards, reel, slot);
+ */
+static double reelSlotCost(const PlacementStore boards[], int number_of_boards, int reel, int slot)
+{
+    double pick_x, pick_y, cost = 0.0;
+
+    nozzlePickPosition(slot, CENTRE_NOZZLE, &pick_x, &pick_y);
+    for (int b = 0; b < number_of_boards; b++)
+    {
+        for (int k = 0; k < boards[b].count; k++)
+        {
+            const PlacementInfo *pi = &boards[b].pi[k];
+            if (pi -> feeder == reel) cost += hypot(LOOKUP_CAMERA_X - pick_x, LOOKUP_CAMERA_Y - pick_y) + hypot(pi -> x_target - pick_x, pi -> y_target - pick_y);
+        }
+    }
+    return cost;
+}
+
+/*
+ Function: assignReels
+ ---------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ finds the assignment of reels to slots with the least total travel model cost, exactly, by dynamic
+ programming over the sets of slots taken by the first reels. Reels with no parts are then left in
+ their own slot where it is free, so the setup changes as little as it needs to
+ Argument(s):
+ const double cost[][NUMBER_OF_FEEDERS] - the cost of each reel in each slot
+ const int reel_parts[] - the parts fed from each reel
+ int slot_of_reel[] - set to the slot of each reel
+ Return Value: none
+ Usage:
+ assignReels(cost, setup -> reel_parts, slot_of_reel);
+ */
+static void assignReels(const double cost[][NUMBER_OF_FEEDERS], const int reel_parts[], int slot_of_reel[])
+{
+    static double best[1 << NUMBER_OF_FEEDERS];
+    static int last_slot[1 << NUMBER_OF_FEEDERS];
+    int reels[NUMBER_OF_FEEDERS], used = 0, taken = 0;
+
+    for (int r = 0; r < NUMBER_OF_FEEDERS; r++)
+    {
+        slot_of_reel[r] = SETUP_NO_REEL;
+        if (reel_parts[r] > 0) reels[used++] = r;
+    }
+
+    /* best[mask] is the least cost of placing the first popcount(mask) used reels in the slots of mask */
+    for (int mask = 0; mask < (1 << NUMBER_OF_FEEDERS); mask++) best[mask] = HUGE_VAL;
+    best[0] = 0.0;
+    for (int mask = 0; mask < (1 << NUMBER_OF_FEEDERS); mask++)
+    {
+        int placed = __builtin_popcount(mask);
+        if (best[mask] == HUGE_VAL || placed >= used) continue;
+
+        for (int s = 0; s < NUMBER_OF_FEEDERS; s++)
+        {
+            if (mask & (1 << s)) continue;
+            double total = best[mask] + cost[reels[placed]][s];
+            if (total < best[mask | (1 << s)])
+            {
+                best[mask | (1 << s)] = total;
+                last_slot[mask | (1 << s)] = s;
+            }
+        }
+    }
+
+    int full = -1;
+    for (int mask = 0; mask < (1 << NUMBER_OF_FEEDERS); mask++)
+    {
+        if (__builtin_popcount(mask) == used && (full < 0 || best[mask] < best[full])) full = mask;
+    }
+    for (int mask = full, placed = used; placed > 0; placed--)
+    {
+        slot_of_reel[reels[placed - 1]] = last_slot[mask];
+        mask &= ~(1 << last_slot[mask]);
+    }
+    taken = full;
+
+    /* unused reels keep their own slot if it is free, otherwise take the first free one */
+    for (int r = 0; r < NUMBER_OF_FEEDERS; r++)
+    {
+        if (reel_parts[r] > 0 || (taken & (1 << r))) continue;
+        slot_of_reel[r] = r;
+        taken |= 1 << r;
+    }
+    for (int r = 0, s = 0; r < NUMBER_OF_FEEDERS; r++)
+    {
+        if (slot_of_reel[r] != SETUP_NO_REEL) continue;
+        while (taken & (1 << s)) s++;
+        slot_of_reel[r] = s;
+        taken |= 1 << s;
+    }
+}
+
+/*
+ Function: planSetup
+ -------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ plans every board of a family with its reels loaded into the given slots and gets the planned gantry
+ travel and estimated cycle time of each
+ Argument(s):
+ const PlacementStore boards[] - the boards of the family
+ int number_of_boards - how many
+ const MotionProfile *profile - the motion profile of the machine
+ const int slot_of_reel[] - the slot of each reel
+ double travel[] - set to the planned gantry travel in mm of each board
+ double time[] - set to the estimated cycle time in s of each board
+ Return Value:
+ PLAN_OK, or the error planning a board
+ Usage:
+ res = planSetup(boards, number_of_boards, profile, setup.slot_of_reel, setup.travel_after, setup.time_after);
+ */
+int planSetup(const PlacementStore boards[], int number_of_boards, const MotionProfile *profile, const int slot_of_reel[], double travel[], double time[])
+{
+    for (int b = 0; b < number_of_boards; b++)
+    {
+        PlacementTable table;
+        PlacementPlan plan;
+        int res = PLAN_OUT_OF_MEMORY;
+
+        memset(&plan, 0, sizeof(plan));
+        if (buildPlacementTable(boards[b].pi, boards[b].count, &table))
+        {
+            res = PLAN_OK;
+            for (int k = 0; k < table.count && res == PLAN_OK; k++)
+            {
+                if (table.feeder[k] < 0 || table.feeder[k] >= NUMBER_OF_FEEDERS) res = PLAN_INVALID_FEEDER;
+                else table.feeder[k] = slot_of_reel[table.feeder[k]];
+            }
+            if (res == PLAN_OK) res = planPlacement(&table, profile, PLAN_OPTION_GANG_PICK, &plan);
+            if (res == PLAN_OK)
+            {
+                travel[b] = plan.planned_travel;
+                time[b] = plan.planned_time;
+            }
+        }
+        freePlacementPlan(&plan);
+        freePlacementTable(&table);
+        if (res != PLAN_OK) return res;
+    }
+    return PLAN_OK;
+}
+
+/*
+ Function: familyTime
+ --------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: adds up the estimated cycle times of the boards of a family
+ Argument(s):
+ const double time[] - the estimated cycle time of each board
+ int number_of_boards - how many
+ Return Value: a double representing the total in s
+ Usage: if (familyTime(trial, n) < familyTime(best, n)) ...
+ */
+static double familyTime(const double time[], int number_of_boards)
+{
+    double total = 0.0;
+
+    for (int b = 0; b < number_of_boards; b++) total += time[b];
+    return total;
+}
+
+/*
+ Function: optimizeFeederSetup
+ -----------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ chooses the slot of every reel for a family of boards sharing one setup. The travel model assignment is
+ kept only if the planner agrees it beats the original setup, then for families of up to
+ SETUP_REFINE_MAX_PARTS parts the contents of pairs of slots are swapped for as long as that shortens the
+ estimated cycle time of the family
+ Argument(s):
+ const PlacementStore boards[] - the boards of the family, at most SETUP_MAX_BOARDS
+ int number_of_boards - how many
+ const MotionProfile *profile - the motion profile of the machine
+ FeederSetup *setup - set to the chosen setup and the travel and cycle time before and after
+ Return Value:
+ PLAN_OK, PLAN_INVALID_FEEDER if a part has no valid feeder, otherwise the error planning a board
+ Usage:
+ res = optimizeFeederSetup(store, number_of_boards, &profile, &setup);
+ */
+int optimizeFeederSetup(const PlacementStore boards[], int number_of_boards, const MotionProfile *profile, FeederSetup *setup)
+{
+    double cost[NUMBER_OF_FEEDERS][NUMBER_OF_FEEDERS], trial_travel[SETUP_MAX_BOARDS], trial_time[SETUP_MAX_BOARDS];
+    int original[NUMBER_OF_FEEDERS], candidate[NUMBER_OF_FEEDERS];
+    int res;
+
+    memset(setup, 0, sizeof(FeederSetup));
+    setup -> number_of_boards = number_of_boards;
+    for (int b = 0; b < number_of_boards; b++)
+    {
+        for (int k = 0; k < boards[b].count; k++)
+        {
+            if (boards[b].pi[k].feeder < 0 || boards[b].pi[k].feeder >= NUMBER_OF_FEEDERS) return PLAN_INVALID_FEEDER;
+            setup -> reel_parts[boards[b].pi[k].feeder]++;
+        }
+        setup -> parts += boards[b].count;
+    }
+
+    for (int r = 0; r < NUMBER_OF_FEEDERS; r++)
+    {
+        original[r] = r;
+        for (int s = 0; s < NUMBER_OF_FEEDERS; s++) cost[r][s] = (setup -> reel_parts[r] > 0) ? reelSlotCost(boards, number_of_boards, r, s) : 0.0;
+    }
+    if ((res = planSetup(boards, number_of_boards, profile, original, setup -> travel_before, setup -> time_before)) != PLAN_OK) return res;
+
+    /* start from whichever of the original setup and the travel model's assignment the planner prefers */
+    assignReels(cost, setup -> reel_parts, candidate);
+    if ((res = planSetup(boards, number_of_boards, profile, candidate, setup -> travel_after, setup -> time_after)) != PLAN_OK) return res;
+    if (familyTime(setup -> time_after, number_of_boards) < familyTime(setup -> time_before, number_of_boards)) memcpy(setup -> slot_of_reel, candidate, sizeof(candidate));
+    else
+    {
+        memcpy(setup -> slot_of_reel, original, sizeof(original));
+        memcpy(setup -> travel_after, setup -> travel_before, sizeof(double) * number_of_boards);
+        memcpy(setup -> time_after, setup -> time_before, sizeof(double) * number_of_boards);
+    }
+
+    for (int s = 0; s < NUMBER_OF_FEEDERS; s++) setup -> reel_of_slot[s] = SETUP_NO_REEL;
+    for (int r = 0; r < NUMBER_OF_FEEDERS; r++) setup -> reel_of_slot[setup -> slot_of_reel[r]] = r;
+
+    /* swapping two slots moves both reels, or one reel into an empty slot, slots of unused reels count as empty */
+    int improved = setup -> parts <= SETUP_REFINE_MAX_PARTS;
+    for (int pass = 0; improved && pass < SETUP_MAX_REFINE_PASSES; pass++)
+    {
+        improved = FALSE;
+        for (int a = 0; a < NUMBER_OF_FEEDERS; a++)
+        {
+            for (int b = a + 1; b < NUMBER_OF_FEEDERS; b++)
+            {
+                int reel_a = setup -> reel_of_slot[a], reel_b = setup -> reel_of_slot[b];
+                if ((reel_a == SETUP_NO_REEL || setup -> reel_parts[reel_a] == 0) && (reel_b == SETUP_NO_REEL || setup -> reel_parts[reel_b] == 0)) continue;
+
+                memcpy(candidate, setup -> slot_of_reel, sizeof(candidate));
+                if (reel_a != SETUP_NO_REEL) candidate[reel_a] = b;
+                if (reel_b != SETUP_NO_REEL) candidate[reel_b] = a;
+                if ((res = planSetup(boards, number_of_boards, profile, candidate, trial_travel, trial_time)) != PLAN_OK) return res;
+                if (familyTime(trial_time, number_of_boards) >= familyTime(setup -> time_after, number_of_boards) - SETUP_MIN_GAIN) continue;
+
+                memcpy(setup -> slot_of_reel, candidate, sizeof(candidate));
+                memcpy(setup -> travel_after, trial_travel, sizeof(double) * number_of_boards);
+                memcpy(setup -> time_after, trial_time, sizeof(double) * number_of_boards);
+                setup -> reel_of_slot[a] = reel_b;
+                setup -> reel_of_slot[b] = reel_a;
+                improved = TRUE;
+            }
+        }
+    }
+
+    setup -> cycle_time_before = familyTime(setup -> time_before, number_of_boards);
+    setup -> cycle_time_after = familyTime(setup -> time_after, number_of_boards);
+    return PLAN_OK;
+}
+
+/*
+ Function: applyFeederSetup
+ --------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ copies a board with the feeder of every part changed to the slot its reel is loaded into
+ Argument(s):
+ const FeederSetup *setup - the setup
+ const PlacementStore *board - the board, as read from its centroid file
+ PlacementStore *rewritten - set to the copy, freed with freePlacementStore()
+ Return Value:
+ TRUE (1) on success, FALSE (0) if memory ran out
+ Usage:
+ if (!applyFeederSetup(&setup, &store[b], &rewritten)) ...
+ */
+int applyFeederSetup(const FeederSetup *setup, const PlacementStore *board, PlacementStore *rewritten)
+{
+    initPlacementStore(rewritten);
+    if (!reservePlacementStore(rewritten, (board -> count > 0) ? board -> count : 1)) return FALSE;
+
+    memcpy(rewritten -> pi, board -> pi, sizeof(PlacementInfo) * (size_t)board -> count);
+    rewritten -> count = board -> count;
+    for (int k = 0; k < rewritten -> count; k++) rewritten -> pi[k].feeder = setup -> slot_of_reel[rewritten -> pi[k].feeder];
+    return TRUE;
+}
+
+/*
+ Function: writeReelComponents
+ -----------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ writes the footprints and values fed from a reel over the family, the most common first, up to
+ SETUP_SHEET_MAX_TYPES of them
+ Argument(s):
+ FILE *fp - the setup sheet
+ const PlacementStore boards[] - the boards of the family
+ int number_of_boards - how many
+ int reel - the reel
+ Return Value: none
+ Usage:
+ writeReelComponents(fp, boards, setup -> number_of_boards, reel);
+ */
+static void writeReelComponents(FILE *fp, const PlacementStore boards[], int number_of_boards, int reel)
+{
+    const PlacementInfo *type[SETUP_SHEET_MAX_TYPES];
+    int type_parts[SETUP_SHEET_MAX_TYPES], types = 0, others = 0;
+
+    for (int b = 0; b < number_of_boards; b++)
+    {
+        for (int k = 0; k < boards[b].count; k++)
+        {
+            const PlacementInfo *pi = &boards[b].pi[k];
+            int t = 0;
+
+            if (pi -> feeder != reel) continue;
+            while (t < types && (strcmp(type[t] -> component_footprint, pi -> component_footprint) != 0 || type[t] -> component_value != pi -> component_value)) t++;
+            if (t < types) type_parts[t]++;
+            else if (types < SETUP_SHEET_MAX_TYPES)
+            {
+                type[types] = pi;
+                type_parts[types++] = 1;
+            }
+            else others++;
+        }
+    }
+
+    /* insertion sort, most parts first */
+    for (int t = 1; t < types; t++)
+    {
+        for (int u = t; u > 0 && type_parts[u] > type_parts[u - 1]; u--)
+        {
+            const PlacementInfo *swap_type = type[u];
+            int swap_parts = type_parts[u];
+            type[u] = type[u - 1];
+            type_parts[u] = type_parts[u - 1];
+            type[u - 1] = swap_type;
+            type_parts[u - 1] = swap_parts;
+        }
+    }
+
+    for (int t = 0; t < types; t++) fprintf(fp, "%s%s %g x%d", (t > 0) ? ", " : "", type[t] -> component_footprint, type[t] -> component_value, type_parts[t]);
+    if (others > 0) fprintf(fp, ", %d other parts", others);
+}
+
+/*
+ Function: writeSetupSheet
+ -------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ writes the setup sheet of a family: the predicted cycle time gain, the reel to load into every slot
+ with the components it feeds, and the planned travel and estimated cycle time of each board before and
+ after
+ Argument(s):
+ const char *path - the setup sheet
+ const char *const names[] - the centroid file of each board
+ const PlacementStore boards[] - the boards, as read from their centroid files
+ const FeederSetup *setup - the setup
+ Return Value:
+ TRUE (1) on success, FALSE (0) if the file could not be written
+ Usage:
+ if (!writeSetupSheet(SETUP_SHEET_FILE, names, store, &setup)) ...
+ */
+int writeSetupSheet(const char *path, const char *const names[], const PlacementStore boards[], const FeederSetup *setup)
+{
+    double gain = setup -> cycle_time_before - setup -> cycle_time_after;
+
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) return FALSE;
+
+    fprintf(fp, "Feeder setup for %d board%s, %d parts\n", setup -> number_of_boards, (setup -> number_of_boards == 1) ? "" : "s", setup -> parts);
+    fprintf(fp, "Predicted cycle time %.2f s with the original setup, %.2f s with this one, a gain of %.2f s (%.1f%%)\n",
+            setup -> cycle_time_before, setup -> cycle_time_after, gain, (setup -> cycle_time_before > 0.0) ? 100.0 * gain / setup -> cycle_time_before : 0.0);
+    fprintf(fp, "Reel n is the reel of feeder n in the original centroid files\n\n");
+
+    fprintf(fp, "%4s %10s %5s %6s  %s\n", "Slot", "Pick x mm", "Reel", "Parts", "Components");
+    for (int s = 0; s < NUMBER_OF_FEEDERS; s++)
+    {
+        int reel = setup -> reel_of_slot[s];
+
+        if (reel == SETUP_NO_REEL || setup -> reel_parts[reel] == 0)
+        {
+            fprintf(fp, "%4d %10.2f %5s %6d  empty\n", s, TAPE_FEEDER_X[s], "-", 0);
+            continue;
+        }
+        fprintf(fp, "%4d %10.2f %5d %6d  ", s, TAPE_FEEDER_X[s], reel, setup -> reel_parts[reel]);
+        writeReelComponents(fp, boards, setup -> number_of_boards, reel);
+        fprintf(fp, "\n");
+    }
+
+    fprintf(fp, "\n%-30s %7s %17s %16s %15s %14s\n", "Board", "Parts", "Travel before mm", "Travel after mm", "Cycle before s", "Cycle after s");
+    for (int b = 0; b < setup -> number_of_boards; b++)
+    {
+        const char *name = strrchr(names[b], '/');
+        fprintf(fp, "%-30s %7d %17.0f %16.0f %15.2f %14.2f\n", (name != NULL) ? name + 1 : names[b], boards[b].count, setup -> travel_before[b], setup -> travel_after[b],
+                setup -> time_before[b], setup -> time_after[b]);
+    }
+    return fclose(fp) == 0;
+}
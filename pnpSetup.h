@@ -0,0 +1,49 @@
+/*
+ *
+ * pnpSetup.h - declarations for the feeder setup optimizer, which chooses the tape feeder slot each reel
+ * is loaded into for a board or a family of boards sharing one setup
+ *
+ * Platform: Any POSIX compliant platform
+ * Intended for and tested on: Cygwin 64 bit
+ *
+ */
+
+#ifndef PNP_SETUP_H
+#define PNP_SETUP_H
+
+#include "pnpPlanner.h"
+
+#define SETUP_SHEET_FILE "feeder_setup.txt"     // default setup sheet, written to the output directory
+#define SETUP_FILE_SUFFIX ".setup.txt"          // the rewritten centroid file of board.txt is board.setup.txt
+#define SETUP_MAX_BOARDS 64                     // boards in one family
+#define SETUP_MAX_REFINE_PASSES 4               // cap on passes of slot swaps checked with the planner, each pass must improve the setup to continue
+#define SETUP_REFINE_MAX_PARTS 20000            // larger families keep the travel model's assignment, planning every swap would take too long
+#define SETUP_MIN_GAIN 0.001                    // s a slot swap must take off the family's estimated cycle time to be kept
+#define SETUP_SHEET_MAX_TYPES 4                 // footprint and value pairs listed for a reel on the setup sheet
+#define SETUP_NO_REEL -1
+
+typedef struct
+{
+    int slot_of_reel[NUMBER_OF_FEEDERS];        // slot each reel is loaded into, a reel being a feeder number of the input files
+    int reel_of_slot[NUMBER_OF_FEEDERS];        // the reverse, SETUP_NO_REEL for a slot left empty
+    int reel_parts[NUMBER_OF_FEEDERS];          // parts fed from each reel over the whole family
+    int number_of_boards;
+    int parts;
+    double travel_before[SETUP_MAX_BOARDS];     // planned gantry travel in mm of each board with the original setup
+    double travel_after[SETUP_MAX_BOARDS];      // and with the optimized setup
+    double time_before[SETUP_MAX_BOARDS];       // estimated cycle time in s of each board with the original setup
+    double time_after[SETUP_MAX_BOARDS];        // and with the optimized setup
+    double cycle_time_before;                   // estimated cycle time in s of the whole family, one of each board
+    double cycle_time_after;
+
+} FeederSetup;
+
+int planSetup(const PlacementStore[], int, const MotionProfile*, const int[], double[], double[]);
+
+int optimizeFeederSetup(const PlacementStore[], int, const MotionProfile*, FeederSetup*);
+
+int applyFeederSetup(const FeederSetup*, const PlacementStore*, PlacementStore*);
+
+int writeSetupSheet(const char*, const char *const[], const PlacementStore[], const FeederSetup*);
+
+#endif // PNP_SETUP_H
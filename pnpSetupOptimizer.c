@@ -0,0 +1,135 @@
+/*
+ *
+ * pnpSetupOptimizer.c - chooses the tape feeder slot each reel is loaded into for a board, or a family of
+ * boards sharing one setup, so that the most used reels sit where their parts are picked and placed with
+ * the least gantry travel. Writes each board's centroid file rewritten for the new setup and a setup sheet
+ * with the reel to load into every slot and the predicted cycle time gain
+ *
+ * Usage: pnpSetupOptimizer [-o output directory] [-s setup sheet] [-c motion profile] [centroid file ...]
+ * defaults are the current working directory, feeder_setup.txt, the simulator's motion and centroid.txt.
+ * The rewritten centroid file of board.txt is board.setup.txt in the output directory
+ *
+ * Platform: Any POSIX compliant platform
+ * Intended for and tested on: Cygwin 64 bit
+ *
+ */
+
+#include "pnpSetup.h"
+
+/*
+ Function: setupFileName
+ -----------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ gets the path of the rewritten centroid file of a board in the output directory, the board's file name
+ with its .txt extension, if any, replaced by SETUP_FILE_SUFFIX
+ Argument(s):
+ const char *directory - the output directory
+ const char *board - the board's centroid file
+ char *path - set to the path
+ size_t size - the size of path
+ Return Value: none
+ Usage:
+ setupFileName(output_directory, argv[k], path, sizeof(path));
+ */
+static void setupFileName(const char *directory, const char *board, char *path, size_t size)
+{
+    const char *name = strrchr(board, '/');
+    size_t length;
+
+    name = (name != NULL) ? name + 1 : board;
+    length = strlen(name);
+    if (length > 4 && strcmp(name + length - 4, ".txt") == 0) length -= 4;
+    snprintf(path, size, "%s/%.*s%s", directory, (int)length, name, SETUP_FILE_SUFFIX);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *output_directory = ".", *sheet = SETUP_SHEET_FILE;
+    const char *boards[SETUP_MAX_BOARDS];
+    char path[PATH_MAX];
+    int operation_mode[SETUP_MAX_BOARDS], number_of_boards = 0, status = EXIT_SUCCESS, option, res;
+    PlacementStore store[SETUP_MAX_BOARDS];
+    FeederSetup setup;
+    MotionProfile profile;
+
+    defaultMotionProfile(&profile);
+    while ((option = getopt(argc, argv, "o:s:c:h")) != -1)
+    {
+        switch (option)
+        {
+            case 'o': output_directory = optarg; break;
+            case 's': sheet = optarg; break;
+            case 'c': if (!loadMotionProfile(optarg, &profile)) exit(1); break;
+            default:
+                printf("Usage: %s [-o output directory] [-s setup sheet] [-c motion profile] [centroid file ...]\n", argv[0]);
+                exit(option == 'h' ? 0 : 1);
+        }
+    }
+    if (argc - optind > SETUP_MAX_BOARDS)
+    {
+        printf("At most %d boards can share one setup\n", SETUP_MAX_BOARDS);
+        exit(1);
+    }
+    if (optind == argc) boards[number_of_boards++] = CENTROID_FILE;
+    for (int k = optind; k < argc; k++) boards[number_of_boards++] = argv[k];
+
+    for (int b = 0; b < number_of_boards; b++)
+    {
+        CentroidError error;
+
+        res = loadCentroidFile(boards[b], &operation_mode[b], &store[b], &error);
+        if (res == CENTROID_FILE_PRESENT_AND_READ) continue;
+
+        if (error.line > 0) printf("Problem with centroid file %s, error code %d at line %d column %d: %s\n", boards[b], res, error.line, error.column, error.message);
+        else if (error.message[0] != '\0') printf("Problem with centroid file %s, error code %d: %s\n", boards[b], res, error.message);
+        else printf("Problem with centroid file %s, error code %d\n", boards[b], res);
+        for (int c = 0; c <= b; c++) freePlacementStore(&store[c]);
+        exit(1);
+    }
+
+    res = optimizeFeederSetup(store, number_of_boards, &profile, &setup);
+    if (res != PLAN_OK)
+    {
+        printf("Could not plan the boards, error code %d\n", res);
+        status = EXIT_FAILURE;
+    }
+
+    for (int b = 0; b < number_of_boards && status == EXIT_SUCCESS; b++)
+    {
+        PlacementStore rewritten;
+
+        setupFileName(output_directory, boards[b], path, sizeof(path));
+        if (!applyFeederSetup(&setup, &store[b], &rewritten))
+        {
+            printf("Out of memory rewriting %s\n", boards[b]);
+            status = EXIT_FAILURE;
+        }
+        else if (writeCentroidFile(path, operation_mode[b], &rewritten) != CENTROID_FILE_PRESENT_AND_READ)
+        {
+            printf("Could not write centroid file %s\n", path);
+            status = EXIT_FAILURE;
+        }
+        else printf("Wrote %s, planned travel %.0f mm, was %.0f mm\n", path, setup.travel_after[b], setup.travel_before[b]);
+        freePlacementStore(&rewritten);
+    }
+
+    if (status == EXIT_SUCCESS)
+    {
+        snprintf(path, sizeof(path), "%s/%s", output_directory, sheet);
+        if (writeSetupSheet(path, boards, store, &setup))
+        {
+            printf("Wrote setup sheet %s, predicted cycle time %.2f s, was %.2f s, a gain of %.2f s\n",
+                   path, setup.cycle_time_after, setup.cycle_time_before, setup.cycle_time_before - setup.cycle_time_after);
+        }
+        else
+        {
+            printf("Could not write setup sheet %s\n", path);
+            status = EXIT_FAILURE;
+        }
+    }
+
+    for (int b = 0; b < number_of_boards; b++) freePlacementStore(&store[b]);
+    return status;
+}
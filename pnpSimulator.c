@@ -0,0 +1,1118 @@
+/*
+ *
+ * pnpSimulator.c - a headless pick and place machine simulator. It maps the same file as the controller,
+ * negotiates the protocol extension, executes the instructions posted to the command ring against a
+ * kinematic model of the gantry, nozzles and cameras, and publishes the results through the telemetry
+ * block. Pick misalignments and head position errors come from a seeded random number generator so a
+ * run can be repeated exactly. Simulation time either follows the wall clock (optionally scaled) or
+ * jumps straight to the next instruction completion, for benchmarking.
+ *
+ * Instructions start in the order they were posted. With PNP_PROTOCOL_CONCURRENT an instruction starts
+ * as soon as every earlier instruction holding one of its resources has finished, so nozzle rotations
+ * overlap gantry moves, and instructions always complete in the order they were posted.
+ *
+ * Usage: pnpSimulator [-f] [-x speed] [-s seed] [-c config file] [-q] [-p] [-m shared file]
+ * -f fast mode, -x simulated seconds per wall clock second in real time mode, -s error seed,
+ * -c kinematic model settings, -q quiet, -p keep serving controller sessions after the controller quits,
+ * -m the file shared with the controller, for one machine of a line (default pnp_shared_file)
+ *
+ * Platform: Any POSIX compliant platform
+ * Intended for and tested on: Cygwin 64 bit
+ *
+ */
+
+#include <stdarg.h>
+#include <errno.h>
+#include <signal.h>
+#include "pnpSimulator.h"
+
+#define SESSION_QUIT 0
+#define SESSION_RESTARTED 1
+
+typedef struct
+{
+    int down;
+    int vacuum;
+    int part_feeder;                                // feeder the carried part came from, NO_PICKED_PART if empty
+    double rotation;                                // degrees the nozzle has turned since it picked its part
+    double theta_error;                             // misalignment of the carried part
+
+} NozzleState;
+
+typedef struct
+{
+    int feeder;
+    double x;
+    double y;
+    double rotation;
+
+} PlacedPart;
+
+typedef struct
+{
+    PnPInstruction instruction;
+    double start;
+    double retire;                                  // when the instruction completes, never before an earlier instruction
+    int photo;                                      // PHOTO_LOOKUP or PHOTO_LOOKDOWN if the instruction updates the photo results, -1 otherwise
+    double theta_pick_error[NUMBER_OF_NOZZLES];
+    double x_preplace_error;
+    double y_preplace_error;
+    unsigned int nozzles_carrying;                  // NOZZLE_BIT mask of the nozzles a lookup photo saw a part on
+    int number_of_lines;
+    char line[NUMBER_OF_NOZZLES + 2][160];          // messages printed when the instruction completes
+
+} ScheduledInstruction;
+
+typedef struct
+{
+    int protocol;                                   // protocol version agreed with the controller
+    double now;                                     // simulation time
+    struct timespec wall_origin;                    // wall clock time at the start of the session
+    double head_x, head_y;                          // nominal head position, where the controller last sent it
+    double error_x, error_y;                        // actual head position minus nominal
+    NozzleState nozzle[NUMBER_OF_NOZZLES];
+    double resource_free[RESOURCE_COUNT];           // when each resource is next free
+    double last_start;
+    double last_retire;
+    unsigned long fetched;                          // instructions copied out of the shared memory
+    unsigned long retired;                          // instructions completed
+    ScheduledInstruction pending[PNP_COMMAND_RING_SIZE];   // slot (n % PNP_COMMAND_RING_SIZE) holds instruction n while it is in flight
+    double theta_pick_error[NUMBER_OF_NOZZLES];     // most recent photo results, as published
+    double x_preplace_error;
+    double y_preplace_error;
+    unsigned int nozzles_carrying;
+    PlacedPart *placed;
+    int number_placed;
+    int placed_capacity;
+    int number_dropped;
+    int number_bad;
+    double gantry_travel;
+    unsigned long long random_state;
+
+} Simulation;
+
+static const char NOZZLE_NAME[NUMBER_OF_NOZZLES][10] = {"left", "centre", "right"};
+static const double FEEDER_X[NUMBER_OF_FEEDERS] = {FDR_0_X, FDR_1_X, FDR_2_X, FDR_3_X, FDR_4_X, FDR_5_X, FDR_6_X, FDR_7_X, FDR_8_X, FDR_9_X};
+static const double FEEDER_Y[NUMBER_OF_FEEDERS] = {FDR_0_Y, FDR_1_Y, FDR_2_Y, FDR_3_Y, FDR_4_Y, FDR_5_Y, FDR_6_Y, FDR_7_Y, FDR_8_Y, FDR_9_Y};
+
+static PnP *pnp;
+static SimulatorConfig config;
+static Simulation sim;
+static int notify_fd = -1;                          // write end of the controller's FIFO while the session uses PNP_PROTOCOL_NOTIFY
+
+/*
+ Function: defaultSimulatorConfig
+ --------------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: fills in the default kinematic model, error model and run mode
+ Argument(s):
+ SimulatorConfig *settings - the settings to fill in
+ Return Value: none
+ Usage: defaultSimulatorConfig(&config);
+ */
+void defaultSimulatorConfig(SimulatorConfig *settings)
+{
+    settings -> gantry_speed = 500.0;
+    settings -> gantry_acceleration = 2000.0;
+    settings -> rotation_speed = 360.0;
+    settings -> rotation_acceleration = 3600.0;
+    settings -> nozzle_time = 0.15;
+    settings -> vacuum_time = 0.05;
+    settings -> photo_time = 0.1;
+    settings -> theta_error_sigma = 2.0;
+    settings -> theta_error_limit = 6.0;
+    settings -> position_error_sigma = 0.3;
+    settings -> position_error_limit = 1.0;
+    settings -> pick_failure_rate = 0.0;
+    settings -> speed = 1.0;
+    settings -> seed = 2021;
+    settings -> fast = FALSE;
+    settings -> quiet = FALSE;
+    settings -> persistent = FALSE;
+}
+
+/*
+ Function: loadSimulatorConfig
+ -----------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ reads kinematic and error model settings from a file of "name value" lines, where name is one of the
+ SimulatorConfig fields gantry_speed to pick_failure_rate, or seed. Blank lines and lines starting
+ with # are ignored, settings not in the file keep their current value
+ Argument(s):
+ const char *path - the settings file
+ SimulatorConfig *settings - the settings to update
+ Return Value:
+ TRUE (1) on success, FALSE (0) if the file could not be read, the problem is printed
+ Usage:
+ if (!loadSimulatorConfig(path, &config)) exit(1);
+ */
+int loadSimulatorConfig(const char *path, SimulatorConfig *settings)
+{
+    static const struct { const char *name; size_t offset; } SETTINGS[] =
+    {
+        {"gantry_speed", offsetof(SimulatorConfig, gantry_speed)},
+        {"gantry_acceleration", offsetof(SimulatorConfig, gantry_acceleration)},
+        {"rotation_speed", offsetof(SimulatorConfig, rotation_speed)},
+        {"rotation_acceleration", offsetof(SimulatorConfig, rotation_acceleration)},
+        {"nozzle_time", offsetof(SimulatorConfig, nozzle_time)},
+        {"vacuum_time", offsetof(SimulatorConfig, vacuum_time)},
+        {"photo_time", offsetof(SimulatorConfig, photo_time)},
+        {"theta_error_sigma", offsetof(SimulatorConfig, theta_error_sigma)},
+        {"theta_error_limit", offsetof(SimulatorConfig, theta_error_limit)},
+        {"position_error_sigma", offsetof(SimulatorConfig, position_error_sigma)},
+        {"position_error_limit", offsetof(SimulatorConfig, position_error_limit)},
+        {"pick_failure_rate", offsetof(SimulatorConfig, pick_failure_rate)}
+    };
+    char text[256], name[64], value[64];
+    int line = 0;
+
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+    {
+        perror("opening of simulator config file failed");
+        return FALSE;
+    }
+
+    while (fgets(text, sizeof(text), fp) != NULL)
+    {
+        int fields = sscanf(text, "%63s %63s", name, value);
+        char *end;
+        int known = FALSE;
+
+        line++;
+        if (fields <= 0 || name[0] == '#') continue;
+        if (fields != 2)
+        {
+            printf("Problem with simulator config file %s at line %d: expected a name and a value\n", path, line);
+            fclose(fp);
+            return FALSE;
+        }
+
+        if (strcmp(name, "seed") == 0)
+        {
+            settings -> seed = strtoull(value, &end, 10);
+            known = (*end == '\0');
+        }
+        for (size_t k = 0; k < sizeof(SETTINGS) / sizeof(SETTINGS[0]) && !known; k++)
+        {
+            if (strcmp(name, SETTINGS[k].name) != 0) continue;
+            *(double *)((char *)settings + SETTINGS[k].offset) = strtod(value, &end);
+            known = (*end == '\0');
+        }
+        if (!known)
+        {
+            printf("Problem with simulator config file %s at line %d: unknown setting or bad value %s %s\n", path, line, name, value);
+            fclose(fp);
+            return FALSE;
+        }
+    }
+
+    fclose(fp);
+    return TRUE;
+}
+
+/*
+ Function: profileTime
+ ---------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ gets the time taken by a move that accelerates to the maximum speed, cruises and decelerates to a stop,
+ or for a move too short to reach the maximum speed, accelerates half way and decelerates the rest
+ Argument(s):
+ double distance - the length of the move (mm or degrees)
+ double speed - the maximum speed
+ double acceleration - the acceleration and deceleration, 0 or less for instant changes of speed
+ Return Value: the time taken in s
+ Usage: double t = profileTime(hypot(dx, dy), config.gantry_speed, config.gantry_acceleration);
+ */
+double profileTime(double distance, double speed, double acceleration)
+{
+    distance = fabs(distance);
+    if (distance == 0.0 || speed <= 0.0) return 0.0;
+    if (acceleration <= 0.0) return distance / speed;
+    if (distance < speed * speed / acceleration) return 2.0 * sqrt(distance / acceleration);
+    return distance / speed + speed / acceleration;
+}
+
+/*
+ Function: randomUniform
+ -----------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: gets the next number from the seeded xorshift64* generator
+ Argument(s): none
+ Return Value: a double in the range (0, 1)
+ Usage: double u = randomUniform();
+ */
+static double randomUniform()
+{
+    sim.random_state ^= sim.random_state >> 12;
+    sim.random_state ^= sim.random_state << 25;
+    sim.random_state ^= sim.random_state >> 27;
+    return ((sim.random_state * 2685821657736338717ULL >> 11) + 0.5) / 9007199254740992.0;
+}
+
+/*
+ Function: randomError
+ ---------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: gets a normally distributed error, clipped to a limit
+ Argument(s):
+ double sigma - the standard deviation
+ double limit - the largest magnitude returned
+ Return Value: the error
+ Usage: sim.error_x = randomError(config.position_error_sigma, config.position_error_limit);
+ */
+static double randomError(double sigma, double limit)
+{
+    double error = sigma * sqrt(-2.0 * log(randomUniform())) * cos(2.0 * M_PI * randomUniform());
+
+    if (error > limit) return limit;
+    if (error < -limit) return -limit;
+    return error;
+}
+
+/*
+ Function: report
+ ----------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: prints a time stamped simulator message, unless running quietly
+ Argument(s):
+ double time - the simulation time of the event
+ const char *format, ... - the message, as for printf
+ Return Value: none
+ Usage: report(start, "%s nozzle being lowered", NOZZLE_NAME[nozzle]);
+ */
+static void report(double time, const char *format, ...)
+{
+    va_list arguments;
+
+    if (config.quiet) return;
+    printf("Time: %7.2f  ", time);
+    va_start(arguments, format);
+    vprintf(format, arguments);
+    va_end(arguments);
+    printf("\n");
+}
+
+/*
+ Function: addCompletionLine
+ ---------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: records a message to print when an instruction completes
+ Argument(s):
+ ScheduledInstruction *scheduled - the instruction
+ const char *format, ... - the message, as for printf
+ Return Value: none
+ Usage: addCompletionLine(scheduled, "%s nozzle lowered", NOZZLE_NAME[nozzle]);
+ */
+static void addCompletionLine(ScheduledInstruction *scheduled, const char *format, ...)
+{
+    va_list arguments;
+
+    if (scheduled -> number_of_lines == NUMBER_OF_NOZZLES + 2) return;
+    va_start(arguments, format);
+    vsnprintf(scheduled -> line[scheduled -> number_of_lines++], sizeof(scheduled -> line[0]), format, arguments);
+    va_end(arguments);
+}
+
+/*
+ Function: publishTelemetry
+ --------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ writes the simulation time, the photo results and the number of completed instructions to the telemetry
+ block under the seqlock, and to the original fields for controllers that predate it. Which nozzles are
+ carrying a part is only in the telemetry block
+ Argument(s): none
+ Return Value: none
+ Usage: publishTelemetry();
+ */
+static void publishTelemetry()
+{
+    unsigned int sequence = atomic_load_explicit(&pnp -> telemetry_sequence, memory_order_relaxed);
+
+    atomic_store_explicit(&pnp -> telemetry_sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    pnp -> telemetry.sim_time = sim.now;
+    for (int nozzle = 0; nozzle < NUMBER_OF_NOZZLES; nozzle++) pnp -> telemetry.theta_pick_error[nozzle] = sim.theta_pick_error[nozzle];
+    pnp -> telemetry.x_preplace_error = sim.x_preplace_error;
+    pnp -> telemetry.y_preplace_error = sim.y_preplace_error;
+    pnp -> telemetry.instructions_completed = sim.retired;
+    pnp -> telemetry.nozzles_carrying = sim.nozzles_carrying;
+
+    atomic_store_explicit(&pnp -> telemetry_sequence, sequence + 2, memory_order_release);
+
+    pnp -> sim_time = sim.now;
+    for (int nozzle = 0; nozzle < NUMBER_OF_NOZZLES; nozzle++) pnp -> theta_pick_error[nozzle] = sim.theta_pick_error[nozzle];
+    pnp -> x_preplace_error = sim.x_preplace_error;
+    pnp -> y_preplace_error = sim.y_preplace_error;
+}
+
+/*
+ Function: wallClockSimTime
+ --------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: gets the simulation time that corresponds to the wall clock in real time mode
+ Argument(s): none
+ Return Value: the simulation time in s
+ Usage: sim.now = wallClockSimTime();
+ */
+static double wallClockSimTime()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((now.tv_sec - sim.wall_origin.tv_sec) + (now.tv_nsec - sim.wall_origin.tv_nsec) / 1e9) * config.speed;
+}
+
+/*
+ Function: lockReadyLock
+ -----------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ takes the process-shared lock of the shared file. The lock is robust, so one left held by a controller
+ that died is taken over and marked consistent rather than deadlocking the simulator. The counters it
+ guards are atomic and a new session rewrites the rest, so there is nothing to repair
+ Argument(s): none
+ Return Value: none
+ Usage: lockReadyLock();
+ */
+static void lockReadyLock()
+{
+    if (pthread_mutex_lock(&pnp -> ready_lock) == EOWNERDEAD) pthread_mutex_consistent(&pnp -> ready_lock);
+}
+
+/*
+ Function: waitForInstructionPosted
+ ----------------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ waits on instruction_posted with the lock held, taking the lock over as lockReadyLock() does if the
+ controller died holding it while the simulator waited
+ Argument(s):
+ const struct timespec *deadline - CLOCK_MONOTONIC time to give up at
+ Return Value:
+ 0 when woken, otherwise the error from pthread_cond_timedwait(), ETIMEDOUT at the deadline
+ Usage: res = waitForInstructionPosted(&deadline);
+ */
+static int waitForInstructionPosted(const struct timespec *deadline)
+{
+    int res = pthread_cond_timedwait(&pnp -> instruction_posted, &pnp -> ready_lock, deadline);
+
+    if (res != EOWNERDEAD) return res;
+    pthread_mutex_consistent(&pnp -> ready_lock);
+    return 0;
+}
+
+/*
+ Function: waitForController
+ ---------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ sleeps until the controller posts an instruction, starts a new session or quits, or the timeout expires
+ Argument(s):
+ double timeout - the longest wait in s
+ Return Value: none
+ Usage: waitForController(SIMULATOR_TICK_MS / 1000.0);
+ */
+static void waitForController(double timeout)
+{
+    struct timespec deadline;
+    int res = 0;
+
+    if (timeout <= 0.0) return;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    long nanoseconds = deadline.tv_nsec + (long)((timeout - floor(timeout)) * 1e9);
+    deadline.tv_sec += (time_t)timeout + nanoseconds / 1000000000;
+    deadline.tv_nsec = nanoseconds % 1000000000;
+
+    lockReadyLock();
+    while (atomic_load(&pnp -> instructions_issued) == sim.fetched && !pnp -> quit && atomic_load(&pnp -> simulator_protocol_version) != 0 && res == 0)
+    {
+        res = waitForInstructionPosted(&deadline);
+    }
+    pthread_mutex_unlock(&pnp -> ready_lock);
+}
+
+/*
+ Function: startSession
+ ----------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ acknowledges a controller that has just called pnpOpen(): the machine is reset to its home state, the
+ quit flag is cleared, the controller's notification FIFO is opened if the session uses it and the
+ simulator's feeder positions and protocol version are written so that pnpOpen() can return. A
+ controller whose feeders are elsewhere, because it was built with another FEEDER_PITCH, is told where
+ they are but the session is refused
+ Argument(s): none
+ Return Value: an int, TRUE if the session can run, FALSE if it was refused
+ Usage: if (!startSession()) ... wait for another controller ...
+ */
+static int startSession()
+{
+    lockReadyLock();
+
+    free(sim.placed);
+    memset(&sim, 0, sizeof(sim));
+    for (int nozzle = 0; nozzle < NUMBER_OF_NOZZLES; nozzle++) sim.nozzle[nozzle].part_feeder = NO_PICKED_PART;
+    sim.head_x = HOME_X;
+    sim.head_y = HOME_Y;
+    sim.random_state = config.seed * 0x9E3779B97F4A7C15ULL + 1;
+    sim.protocol = (pnp -> controller_protocol_version < PNP_PROTOCOL_VERSION) ? (int)pnp -> controller_protocol_version : PNP_PROTOCOL_VERSION;
+    if (sim.protocol < PNP_PROTOCOL_SIGNALLED) sim.protocol = PNP_PROTOCOL_SIGNALLED;
+
+    /* without the controller's FIFO the session falls back to the controller checking the completion counter */
+    unsigned int version = PNP_PROTOCOL_VERSION;
+    if (notify_fd >= 0) close(notify_fd);
+    char notify_fifo[PNP_PATH_LENGTH];
+    snprintf(notify_fifo, sizeof(notify_fifo), "%.*s", PNP_PATH_LENGTH - 1, pnp -> notify_fifo);
+    notify_fd = (sim.protocol >= PNP_PROTOCOL_NOTIFY) ? open(notify_fifo, O_WRONLY | O_NONBLOCK) : -1;
+    if (sim.protocol >= PNP_PROTOCOL_NOTIFY && notify_fd < 0) version = sim.protocol = PNP_PROTOCOL_CONCURRENT;
+    sim.fetched = sim.retired = atomic_load(&pnp -> instructions_completed);
+    clock_gettime(CLOCK_MONOTONIC, &sim.wall_origin);
+
+    pnp -> quit = FALSE;
+    pnp -> ready_for_next_instruction = TRUE;
+    pnp -> instruction_to_execute = NO_INSTRUCTION;
+    publishTelemetry();
+    memcpy(pnp -> simulator_feeder_x, FEEDER_X, sizeof(pnp -> simulator_feeder_x));
+    atomic_store(&pnp -> simulator_protocol_version, version);
+
+    pthread_mutex_unlock(&pnp -> ready_lock);
+
+    for (int f = 0; f < NUMBER_OF_FEEDERS; f++)
+    {
+        if (pnp -> feeder_x[f] != FEEDER_X[f])
+        {
+            printf("Session refused, the controller has feeder %d at x: %.2f rather than %.2f, the controller and simulator must be built with the same FEEDER_PITCH\n",
+                   f, pnp -> feeder_x[f], FEEDER_X[f]);
+            fflush(stdout);
+            return FALSE;
+        }
+    }
+    report(sim.now, "Pick and place machine simulation started successfully!");
+    return TRUE;
+}
+
+/*
+ Function: fetchInstruction
+ --------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ copies the next posted instruction out of the command ring, or out of the single instruction slot for a
+ controller that stopped short of PNP_PROTOCOL_RING. Instructions without resource masks hold everything
+ Argument(s):
+ PnPInstruction *instruction - set to the instruction
+ Return Value: none
+ Usage: fetchInstruction(&instruction);
+ */
+static void fetchInstruction(PnPInstruction *instruction)
+{
+    if (sim.protocol >= PNP_PROTOCOL_RING)
+    {
+        atomic_thread_fence(memory_order_acquire);
+        *instruction = pnp -> command_ring[sim.fetched % PNP_COMMAND_RING_SIZE];
+    }
+    else
+    {
+        lockReadyLock();
+        instruction -> instruction = pnp -> instruction_to_execute;
+        instruction -> argument_1 = pnp -> instruction_argument_1;
+        instruction -> argument_2 = pnp -> instruction_argument_2;
+        instruction -> argument_3 = pnp -> instruction_argument_3;
+        pthread_mutex_unlock(&pnp -> ready_lock);
+    }
+
+    if (sim.protocol < PNP_PROTOCOL_CONCURRENT || instruction -> resources == 0)
+    {
+        instruction -> resources = RESOURCE_GANTRY | RESOURCE_CAMERA | RESOURCE_ALL_NOZZLES;
+    }
+}
+
+/*
+ Function: isNozzleIndexValid
+ ----------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: checks the nozzle argument of an instruction, reporting a bad command if it is out of range
+ Argument(s):
+ int nozzle - the nozzle argument
+ double time - when the instruction starts
+ const char *command - the instruction name for the report
+ Return Value:
+ TRUE (1) if the nozzle exists, otherwise FALSE (0)
+ Usage: if (!isNozzleIndexValid(nozzle, start, "LOWER_NOZZLE")) break;
+ */
+static int isNozzleIndexValid(int nozzle, double time, const char *command)
+{
+    if (nozzle >= 0 && nozzle < NUMBER_OF_NOZZLES) return TRUE;
+    report(time, "Bad %s command: nozzle out of range", command);
+    sim.number_bad++;
+    return FALSE;
+}
+
+/*
+ Function: canHeadMoveTo
+ -----------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: checks a head movement, reporting a bad command if the destination is out of range or a nozzle is down
+ Argument(s):
+ double x, double y - the actual destination of the head
+ double time - when the instruction starts
+ const char *command - the instruction name for the report
+ Return Value:
+ TRUE (1) if the head may move, otherwise FALSE (0)
+ Usage: if (!canHeadMoveTo(x, y, start, "MOVE_HEAD")) break;
+ */
+static int canHeadMoveTo(double x, double y, double time, const char *command)
+{
+    if (x < MIN_X || x > MAX_X || y < MIN_Y || y > MAX_Y)
+    {
+        report(time, "Bad %s command: destination out of range", command);
+        sim.number_bad++;
+        return FALSE;
+    }
+    for (int nozzle = 0; nozzle < NUMBER_OF_NOZZLES; nozzle++)
+    {
+        if (sim.nozzle[nozzle].down)
+        {
+            report(time, "Bad %s command: one or more nozzles down", command);
+            sim.number_bad++;
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/*
+ Function: feederUnderNozzle
+ ---------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: finds the tape feeder under a nozzle, using the actual head position
+ Argument(s):
+ int nozzle - the nozzle
+ Return Value:
+ the tape feeder, or NO_TAPE_FEEDER_AT_THIS_LOCATION
+ Usage: int feeder = feederUnderNozzle(nozzle);
+ */
+static int feederUnderNozzle(int nozzle)
+{
+    double x = sim.head_x + sim.error_x + (nozzle - CENTRE_NOZZLE) * NOZZLE_X_SEPARATION;
+    double y = sim.head_y + sim.error_y;
+
+    for (int feeder = 0; feeder < NUMBER_OF_FEEDERS; feeder++)
+    {
+        if (hypot(x - FEEDER_X[feeder], y - FEEDER_Y[feeder]) <= FEEDER_PICK_TOLERANCE) return feeder;
+    }
+    return NO_TAPE_FEEDER_AT_THIS_LOCATION;
+}
+
+/*
+ Function: recordPlacedPart
+ --------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: adds a part to the record of placed parts printed when the session ends
+ Argument(s):
+ int feeder - the feeder the part came from
+ double x, double y, double rotation - where the part was placed
+ Return Value: none
+ Usage: recordPlacedPart(feeder, x, y, rotation);
+ */
+static void recordPlacedPart(int feeder, double x, double y, double rotation)
+{
+    if (sim.number_placed == sim.placed_capacity)
+    {
+        PlacedPart *placed = realloc(sim.placed, sizeof(PlacedPart) * (sim.placed_capacity + SIMULATOR_PLACED_PARTS_CHUNK));
+        if (placed == NULL) return;
+        sim.placed = placed;
+        sim.placed_capacity += SIMULATOR_PLACED_PARTS_CHUNK;
+    }
+    sim.placed[sim.number_placed].feeder = feeder;
+    sim.placed[sim.number_placed].x = x;
+    sim.placed[sim.number_placed].y = y;
+    sim.placed[sim.number_placed].rotation = rotation;
+    sim.number_placed++;
+}
+
+/*
+ Function: issueInstruction
+ --------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ starts an instruction: works out when it can start from the resources it holds, applies its effect on
+ the machine (instructions take effect in the order they were posted, and instructions that share a
+ resource never overlap, so the machine state is always that seen by the instruction), works out how
+ long it takes from the kinematic model and schedules its completion
+ Argument(s):
+ const PnPInstruction *instruction - the instruction
+ Return Value: none
+ Usage: issueInstruction(&instruction);
+ */
+static void issueInstruction(const PnPInstruction *instruction)
+{
+    ScheduledInstruction *scheduled = &sim.pending[sim.fetched % PNP_COMMAND_RING_SIZE];
+    int nozzle = instruction -> argument_3, feeder;
+    double start = (sim.now > sim.last_start) ? sim.now : sim.last_start;
+    double duration = 0.0, x, y, d;
+
+    for (int r = 0; r < RESOURCE_COUNT; r++)
+    {
+        if ((instruction -> resources & (1u << r)) && sim.resource_free[r] > start) start = sim.resource_free[r];
+    }
+
+    memset(scheduled, 0, sizeof(ScheduledInstruction));
+    scheduled -> instruction = *instruction;
+    scheduled -> photo = -1;
+
+    switch (instruction -> instruction)
+    {
+        case MOVE_HEAD:
+            x = instruction -> argument_1;
+            y = instruction -> argument_2;
+            if (!canHeadMoveTo(x, y, start, "MOVE_HEAD")) break;
+            report(start, "Head moving from (%.2f, %.2f) to (%.2f, %.2f)", sim.head_x, sim.head_y, x, y);
+            d = hypot(x - sim.head_x - sim.error_x, y - sim.head_y - sim.error_y);
+            duration = profileTime(d, config.gantry_speed, config.gantry_acceleration);
+            sim.gantry_travel += d;
+            sim.head_x = x;
+            sim.head_y = y;
+            sim.error_x = randomError(config.position_error_sigma, config.position_error_limit);
+            sim.error_y = randomError(config.position_error_sigma, config.position_error_limit);
+            addCompletionLine(scheduled, "Head arrived at nominal location (%.2f, %.2f)", x, y);
+            break;
+
+        case AMEND_HEAD_POSITION:
+            x = sim.head_x + sim.error_x + instruction -> argument_1;
+            y = sim.head_y + sim.error_y + instruction -> argument_2;
+            if (!canHeadMoveTo(x, y, start, "AMEND_HEAD_POSITION")) break;
+            d = hypot(instruction -> argument_1, instruction -> argument_2);
+            duration = profileTime(d, config.gantry_speed, config.gantry_acceleration);
+            sim.gantry_travel += d;
+            sim.error_x += instruction -> argument_1;
+            sim.error_y += instruction -> argument_2;
+            addCompletionLine(scheduled, "Head position amended to (%.2f, %.2f)", x, y);
+            break;
+
+        case ROTATE_NOZZLE:
+            if (!isNozzleIndexValid(nozzle, start, "ROTATE_NOZZLE")) break;
+            report(start, "%s nozzle being rotated by %.2f degrees", NOZZLE_NAME[nozzle], instruction -> argument_1);
+            duration = profileTime(instruction -> argument_1, config.rotation_speed, config.rotation_acceleration);
+            sim.nozzle[nozzle].rotation += instruction -> argument_1;
+            addCompletionLine(scheduled, "%s nozzle finished rotating by %.2f degrees, effective rotation including misalignment theta_error=%.2f degrees is %.2f degrees",
+                              NOZZLE_NAME[nozzle], instruction -> argument_1, sim.nozzle[nozzle].theta_error, sim.nozzle[nozzle].rotation + sim.nozzle[nozzle].theta_error);
+            break;
+
+        case LOWER_NOZZLE:
+            if (!isNozzleIndexValid(nozzle, start, "LOWER_NOZZLE")) break;
+            report(start, "%s nozzle being lowered", NOZZLE_NAME[nozzle]);
+            duration = config.nozzle_time;
+            sim.nozzle[nozzle].down = TRUE;
+            addCompletionLine(scheduled, "%s nozzle lowered", NOZZLE_NAME[nozzle]);
+            break;
+
+        case RAISE_NOZZLE:
+            if (!isNozzleIndexValid(nozzle, start, "RAISE_NOZZLE")) break;
+            report(start, "%s nozzle being raised", NOZZLE_NAME[nozzle]);
+            duration = config.nozzle_time;
+            sim.nozzle[nozzle].down = FALSE;
+            addCompletionLine(scheduled, "%s nozzle raised", NOZZLE_NAME[nozzle]);
+            break;
+
+        case APPLY_VACUUM:
+            if (!isNozzleIndexValid(nozzle, start, "APPLY_VACUUM")) break;
+            report(start, "%s nozzle is about to apply vacuum", NOZZLE_NAME[nozzle]);
+            duration = config.vacuum_time;
+            sim.nozzle[nozzle].vacuum = TRUE;
+            addCompletionLine(scheduled, "%s nozzle now has vacuum applied", NOZZLE_NAME[nozzle]);
+            if (sim.nozzle[nozzle].part_feeder != NO_PICKED_PART) break;
+
+            feeder = sim.nozzle[nozzle].down ? feederUnderNozzle(nozzle) : NO_TAPE_FEEDER_AT_THIS_LOCATION;
+            if (feeder == NO_TAPE_FEEDER_AT_THIS_LOCATION)
+            {
+                addCompletionLine(scheduled, "No tape feeder underneath nozzle %s when vacuum applied so no part picked up", NOZZLE_NAME[nozzle]);
+                break;
+            }
+            /* no random number is drawn unless failures are modelled, so the default errors are unchanged */
+            if (config.pick_failure_rate > 0.0 && randomUniform() < config.pick_failure_rate)
+            {
+                addCompletionLine(scheduled, "%s nozzle FAILED to pick up a part from feeder %d", NOZZLE_NAME[nozzle], feeder);
+                break;
+            }
+            sim.nozzle[nozzle].part_feeder = feeder;
+            sim.nozzle[nozzle].rotation = 0.0;
+            sim.nozzle[nozzle].theta_error = randomError(config.theta_error_sigma, config.theta_error_limit);
+            addCompletionLine(scheduled, "%s nozzle has picked up part from feeder %d", NOZZLE_NAME[nozzle], feeder);
+            break;
+
+        case RELEASE_VACUUM:
+            if (!isNozzleIndexValid(nozzle, start, "RELEASE_VACUUM")) break;
+            report(start, "%s nozzle is about to release vacuum", NOZZLE_NAME[nozzle]);
+            duration = config.vacuum_time;
+            sim.nozzle[nozzle].vacuum = FALSE;
+            addCompletionLine(scheduled, "%s nozzle now has vacuum released", NOZZLE_NAME[nozzle]);
+            if (sim.nozzle[nozzle].part_feeder == NO_PICKED_PART) break;
+
+            x = sim.head_x + sim.error_x + (nozzle - CENTRE_NOZZLE) * NOZZLE_X_SEPARATION;
+            y = sim.head_y + sim.error_y;
+            if (sim.nozzle[nozzle].down)
+            {
+                double rotation = sim.nozzle[nozzle].rotation + sim.nozzle[nozzle].theta_error;
+
+                recordPlacedPart(sim.nozzle[nozzle].part_feeder, x, y, rotation);
+                addCompletionLine(scheduled, "%s nozzle has placed part from feeder %d at (%.2f, %.2f) with rotation %.2f degrees", NOZZLE_NAME[nozzle], sim.nozzle[nozzle].part_feeder, x, y, rotation);
+            }
+            else
+            {
+                sim.number_dropped++;
+                addCompletionLine(scheduled, "%s nozzle has DROPPED part from feeder %d at (%.2f, %.2f)", NOZZLE_NAME[nozzle], sim.nozzle[nozzle].part_feeder, x, y);
+            }
+            sim.nozzle[nozzle].part_feeder = NO_PICKED_PART;
+            break;
+
+        case TAKE_PHOTO:
+            if (nozzle == PHOTO_LOOKUP)
+            {
+                int over_camera = hypot(sim.head_x + sim.error_x - LOOKUP_CAMERA_X, sim.head_y + sim.error_y - LOOKUP_CAMERA_Y) <= LOOKUP_CAMERA_FIELD;
+
+                report(start, "Photo about to be taken by lookup camera");
+                duration = config.photo_time;
+                scheduled -> photo = PHOTO_LOOKUP;
+                addCompletionLine(scheduled, "Photo taken by lookup camera");
+                if (!over_camera) addCompletionLine(scheduled, "Head is not over the lookup camera so no misalignment measured");
+                scheduled -> nozzles_carrying = over_camera ? 0 : ALL_NOZZLE_BITS;
+                for (int n = 0; n < NUMBER_OF_NOZZLES; n++)
+                {
+                    if (!over_camera || sim.nozzle[n].part_feeder == NO_PICKED_PART) continue;
+                    scheduled -> nozzles_carrying |= NOZZLE_BIT(n);
+                    scheduled -> theta_pick_error[n] = sim.nozzle[n].theta_error;
+                    addCompletionLine(scheduled, "Picked part on %s nozzle has misalignment theta_error=%.2f degrees", NOZZLE_NAME[n], sim.nozzle[n].theta_error);
+                }
+            }
+            else if (nozzle == PHOTO_LOOKDOWN)
+            {
+                report(start, "Photo about to be taken by lookdown camera");
+                duration = config.photo_time;
+                scheduled -> photo = PHOTO_LOOKDOWN;
+                scheduled -> x_preplace_error = -sim.error_x;
+                scheduled -> y_preplace_error = -sim.error_y;
+                addCompletionLine(scheduled, "Photo taken by lookdown camera");
+                addCompletionLine(scheduled, "Head has preplace misalignment x_error=%.2f y_error=%.2f", -sim.error_x, -sim.error_y);
+            }
+            else
+            {
+                report(start, "Bad TAKE_PHOTO command: specified camera is not Lookup or Lookdown");
+                sim.number_bad++;
+            }
+            break;
+
+        default:
+            report(start, "Bad instruction %d ignored", instruction -> instruction);
+            sim.number_bad++;
+            break;
+    }
+
+    scheduled -> start = start;
+    scheduled -> retire = (start + duration > sim.last_retire) ? start + duration : sim.last_retire;
+    for (int r = 0; r < RESOURCE_COUNT; r++)
+    {
+        if (instruction -> resources & (1u << r)) sim.resource_free[r] = start + duration;
+    }
+    sim.last_start = start;
+    sim.last_retire = scheduled -> retire;
+    sim.fetched++;
+}
+
+/*
+ Function: retireInstruction
+ ---------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ completes the oldest instruction in flight: publishes its photo results with the new simulation time,
+ advances the completion counter and wakes the controller through the notification FIFO, a controller
+ without the FIFO polls the counter
+ Argument(s): none
+ Return Value: none
+ Usage: retireInstruction();
+ */
+static void retireInstruction()
+{
+    ScheduledInstruction *scheduled = &sim.pending[sim.retired % PNP_COMMAND_RING_SIZE];
+
+    if (config.fast || scheduled -> retire > sim.now) sim.now = scheduled -> retire;
+    if (scheduled -> photo == PHOTO_LOOKUP)
+    {
+        for (int nozzle = 0; nozzle < NUMBER_OF_NOZZLES; nozzle++) sim.theta_pick_error[nozzle] = scheduled -> theta_pick_error[nozzle];
+        sim.nozzles_carrying = scheduled -> nozzles_carrying;
+    }
+    else if (scheduled -> photo == PHOTO_LOOKDOWN)
+    {
+        sim.x_preplace_error = scheduled -> x_preplace_error;
+        sim.y_preplace_error = scheduled -> y_preplace_error;
+    }
+    for (int k = 0; k < scheduled -> number_of_lines; k++) report(sim.now, "%s", scheduled -> line[k]);
+
+    sim.retired++;
+    publishTelemetry();
+    atomic_store_explicit(&pnp -> instructions_completed, sim.retired, memory_order_release);
+    pnp -> ready_for_next_instruction = (sim.retired == atomic_load(&pnp -> instructions_issued));
+
+    /* a full FIFO already holds a wakeup the controller has not read, so a failed write loses nothing */
+    if (notify_fd >= 0)
+    {
+        char notification = 1;
+        if (write(notify_fd, &notification, 1) < 0 && errno == EPIPE)
+        {
+            close(notify_fd);      // the controller has closed the FIFO on its way out
+            notify_fd = -1;
+        }
+    }
+}
+
+/*
+ Function: runSession
+ --------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ executes the instructions of one controller session until the controller quits or another controller
+ starts a new session. Every posted instruction is started straight away so that its completion time
+ is known, then completions are published in order, either when the wall clock reaches them (real time
+ mode) or immediately (fast mode, after briefly waiting for the rest of a burst of instructions so that
+ they can overlap as they would in real time)
+ Argument(s): none
+ Return Value:
+ SESSION_QUIT or SESSION_RESTARTED
+ Usage: if (runSession() == SESSION_QUIT) ...
+ */
+static int runSession()
+{
+    PnPInstruction instruction;
+
+    for (;;)
+    {
+        if (atomic_load(&pnp -> simulator_protocol_version) == 0) return SESSION_RESTARTED;
+        if (pnp -> quit) return SESSION_QUIT;
+
+        if (!config.fast) sim.now = wallClockSimTime();
+        while (sim.fetched < atomic_load_explicit(&pnp -> instructions_issued, memory_order_acquire) && sim.fetched - sim.retired < PNP_COMMAND_RING_SIZE)
+        {
+            fetchInstruction(&instruction);
+            issueInstruction(&instruction);
+        }
+
+        if (config.fast)
+        {
+            if (sim.retired == sim.fetched)
+            {
+                waitForController(SIMULATOR_SESSION_POLL_MS / 1000.0);
+                continue;
+            }
+            waitForController(SIMULATOR_FAST_GATHER_US / 1e6);
+            if (sim.fetched < atomic_load(&pnp -> instructions_issued)) continue;
+            retireInstruction();
+        }
+        else
+        {
+            double timeout = SIMULATOR_TICK_MS / 1000.0;
+
+            if (sim.retired < sim.fetched)
+            {
+                double until = (sim.pending[sim.retired % PNP_COMMAND_RING_SIZE].retire - sim.now) / config.speed;
+
+                if (until <= 0.0)
+                {
+                    retireInstruction();
+                    continue;
+                }
+                if (until < timeout) timeout = until;
+            }
+            publishTelemetry();
+            waitForController(timeout);
+        }
+    }
+}
+
+/*
+ Function: printSessionSummary
+ -----------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: prints every part placed in the session (unless running quietly) and the session totals
+ Argument(s): none
+ Return Value: none
+ Usage: printSessionSummary();
+ */
+static void printSessionSummary()
+{
+    if (!config.quiet)
+    {
+        printf("Summary of placed parts so far:\n");
+        for (int k = 0; k < sim.number_placed; k++)
+        {
+            printf("Part %d from feeder %d placed at (%.2f, %.2f) with rotation %.2f degrees\n", k, sim.placed[k].feeder, sim.placed[k].x, sim.placed[k].y, sim.placed[k].rotation);
+        }
+    }
+    printf("Time: %7.2f  Session finished, %d parts placed, %d dropped, %d bad instructions, %lu instructions, gantry travel %.0f mm\n",
+           sim.now, sim.number_placed, sim.number_dropped, sim.number_bad, sim.retired, sim.gantry_travel);
+    fflush(stdout);
+}
+
+/*
+ Function: mapSharedFile
+ -----------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ memory maps the file shared with the controller, creating it if necessary, and initializes the
+ process-shared synchronisation objects if no controller has done so yet. Either program may be
+ started first
+ Argument(s):
+ const char *path - the file, MEMORY_MAPPED_FILE unless the simulator is one machine of a line
+ Return Value: none, exits if the file cannot be mapped
+ Usage: mapSharedFile(MEMORY_MAPPED_FILE);
+ */
+static void mapSharedFile(const char *path)
+{
+    struct stat file_status;
+
+    int fd = open(path, (O_CREAT | O_RDWR), 0666);
+    if (fd < 0)
+    {
+        perror("creation/opening of file failed");
+        exit(1);
+    }
+    if (fstat(fd, &file_status) == 0 && file_status.st_size < (off_t)sizeof(PnP)) ftruncate(fd, sizeof(PnP));
+
+    pnp = (PnP *)mmap(0, sizeof(PnP), (PROT_READ | PROT_WRITE), MAP_SHARED, fd, (off_t)0);
+    close(fd);
+    if (pnp == MAP_FAILED)
+    {
+        perror("memory mapping of file failed");
+        exit(2);
+    }
+
+    if (pnp -> protocol_magic != PNP_PROTOCOL_MAGIC || pnp -> layout_size != sizeof(PnP))
+    {
+        pthread_mutexattr_t mutex_attr;
+        pthread_condattr_t cond_attr;
+
+        pthread_mutexattr_init(&mutex_attr);
+        pthread_mutexattr_setpshared(&mutex_attr, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&mutex_attr, PTHREAD_MUTEX_ROBUST);
+        pthread_mutex_init(&pnp -> ready_lock, &mutex_attr);
+        pthread_mutexattr_destroy(&mutex_attr);
+
+        pthread_condattr_init(&cond_attr);
+        pthread_condattr_setpshared(&cond_attr, PTHREAD_PROCESS_SHARED);
+        pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+        pthread_cond_init(&pnp -> instruction_posted, &cond_attr);
+        pthread_condattr_destroy(&cond_attr);
+
+        /* no controller has started a session in this file, so wait for one rather than acknowledging a stale one */
+        atomic_store(&pnp -> simulator_protocol_version, PNP_PROTOCOL_VERSION);
+        pnp -> layout_size = sizeof(PnP);
+        pnp -> protocol_magic = PNP_PROTOCOL_MAGIC;
+    }
+}
+
+/*
+ Function: waitForSession
+ ------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ sleeps until a controller starts a session, which it does by clearing the simulator protocol version
+ Argument(s): none
+ Return Value: none
+ Usage: waitForSession();
+ */
+static void waitForSession()
+{
+    while (atomic_load(&pnp -> simulator_protocol_version) != 0)
+    {
+        struct timespec deadline;
+
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_nsec += SIMULATOR_SESSION_POLL_MS * 1000000L;
+        if (deadline.tv_nsec >= 1000000000)
+        {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+
+        lockReadyLock();
+        if (atomic_load(&pnp -> simulator_protocol_version) != 0) waitForInstructionPosted(&deadline);
+        pthread_mutex_unlock(&pnp -> ready_lock);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const char *shared_file = MEMORY_MAPPED_FILE;
+    int option;
+
+    defaultSimulatorConfig(&config);
+    while ((option = getopt(argc, argv, "fx:s:c:qpm:h")) != -1)
+    {
+        switch (option)
+        {
+            case 'f': config.fast = TRUE; break;
+            case 'x': config.speed = atof(optarg); break;
+            case 's': config.seed = strtoull(optarg, NULL, 10); break;
+            case 'c': if (!loadSimulatorConfig(optarg, &config)) exit(1); break;
+            case 'q': config.quiet = TRUE; break;
+            case 'p': config.persistent = TRUE; break;
+            case 'm': shared_file = optarg; break;
+            default:
+                printf("Usage: %s [-f] [-x speed] [-s seed] [-c config file] [-q] [-p] [-m shared file]\n", argv[0]);
+                exit(option == 'h' ? 0 : 1);
+        }
+    }
+    if (config.speed <= 0.0) config.speed = 1.0;
+
+    mapSharedFile(shared_file);
+    signal(SIGPIPE, SIG_IGN);  // a controller quitting closes the notification FIFO under a write
+
+    printf("Pick and place machine simulator waiting for the controller in %s mode\n", config.fast ? "fast" : "real time");
+    fflush(stdout);
+
+    for (;;)
+    {
+        waitForSession();
+        if (!startSession())
+        {
+            if (!config.persistent) break;
+            continue;
+        }
+
+        int res = runSession();
+        printSessionSummary();
+        if (res == SESSION_QUIT && !config.persistent) break;
+    }
+
+    if (notify_fd >= 0) close(notify_fd);
+    free(sim.placed);
+    munmap(pnp, sizeof(PnP));
+    return 0;
+}
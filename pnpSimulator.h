@@ -0,0 +1,53 @@
+/*
+ *
+ * pnpSimulator.h - declarations for the headless pick and place machine simulator, a native stand-in for
+ * Assgn1_2021_Simulator.exe that serves the controller over the same memory mapped file
+ *
+ * Platform: Any POSIX compliant platform
+ * Intended for and tested on: Cygwin 64 bit
+ *
+ */
+
+#ifndef PNP_SIMULATOR_H
+#define PNP_SIMULATOR_H
+
+#include "pnpControl.h"
+
+#define SIMULATOR_TICK_MS 20               // how often sim_time is published while idle in real time mode
+#define SIMULATOR_SESSION_POLL_MS 100      // how often a simulator with no controller checks for a new session
+#define SIMULATOR_FAST_GATHER_US 200       // in fast mode, how long to wait for the rest of a burst of instructions before completing one
+#define SIMULATOR_PLACED_PARTS_CHUNK 256   // the record of placed parts grows by this many parts at a time
+
+#define FEEDER_PICK_TOLERANCE 2.0          // mm a nozzle may be from a tape feeder and still pick from it
+#define LOOKUP_CAMERA_FIELD 30.0           // mm the head may be from the lookup camera and still see every nozzle
+#define RESOURCE_COUNT 5                   // number of RESOURCE_ flags, gantry, camera and one per nozzle
+
+typedef struct
+{
+    double gantry_speed;                   // mm/s
+    double gantry_acceleration;            // mm/s^2, moves follow a trapezoidal (or triangular, if short) velocity profile
+    double rotation_speed;                 // degrees/s
+    double rotation_acceleration;          // degrees/s^2
+    double nozzle_time;                    // s to lower or raise a nozzle
+    double vacuum_time;                    // s to apply or release the vacuum
+    double photo_time;                     // s to take a photo
+    double theta_error_sigma;              // degrees, standard deviation of the misalignment of a picked part
+    double theta_error_limit;              // degrees, largest misalignment of a picked part
+    double position_error_sigma;           // mm, standard deviation of the head position error after each MOVE_HEAD
+    double position_error_limit;           // mm, largest head position error
+    double pick_failure_rate;              // chance that applying the vacuum over a feeder picks nothing, 0 to 1
+    double speed;                          // real time mode only, simulated seconds per wall clock second
+    unsigned long long seed;               // seeds the pick and position errors, the same seed gives the same errors every session
+    int fast;                              // TRUE to advance sim_time as fast as possible rather than in real time
+    int quiet;                             // TRUE to print only session start and end
+    int persistent;                        // TRUE to keep serving new controller sessions after the controller quits
+
+} SimulatorConfig;
+
+void defaultSimulatorConfig(SimulatorConfig*);
+
+int loadSimulatorConfig(const char*, SimulatorConfig*);
+
+double profileTime(double, double, double);
+
+#endif // PNP_SIMULATOR_H
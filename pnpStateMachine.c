@@ -0,0 +1,56 @@
+/*
+ *
+ * pnpStateMachine.c - the table-driven state machine engine that runs the controller. Each mode supplies
+ * a transition table with one row per state, generated at compile time from the single list of states in
+ * pnpStateMachine.h, and the engine makes one table lookup and one handler call per tick. The guards common to
+ * every state, whether it takes key presses and whether it must wait for the simulator, are applied here
+ * rather than in each handler
+ *
+ * Platform: Any POSIX compliant platform
+ * Intended for and tested on: Cygwin 64 bit
+ *
+ */
+
+#include "pnpStateMachine.h"
+#include "pnpTrace.h"
+
+/*
+ Function: runStateMachine
+ -------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ runs the control loop until the user quits or, in job mode, a handler finishes the board. Every tick
+ the state's row of the transition table is looked up: if the state needs the simulator and it is
+ still busy nothing runs, otherwise the state's handler is called with the next key press (if the
+ state takes keys) and returns the next state. The next tick runs straight away after a state change,
+ otherwise the loop blocks until the simulator finishes or the user presses a key
+ Argument(s):
+ const StateTransition transitions[] - the mode's transition table, indexed by state
+ int state - the initial state
+ ControlContext *context - the state shared by the handlers
+ Return Value:
+ an int, the state the machine was in when it stopped
+ Usage:
+ runStateMachine(auto_transitions, STATE_HOME, &context);
+ */
+int runStateMachine(const StateTransition transitions[], int state, ControlContext *context)
+{
+    while (!isPnPSimulationQuitFlagOn() && context -> board_finished == FALSE)
+    {
+        const StateTransition *transition = &transitions[state];
+        int previous_state = state;
+
+        /* the snapshot follows the ready check so a state that waited for the simulator sees its final sensor values */
+        int runnable = !transition -> needs_simulator || isSimulatorReadyForNextInstruction();
+
+        pnpSnapshot(&context -> snapshot);
+        traceState(state, context -> snapshot.sim_time);
+        char c = (transition -> takes_keys && runnable) ? getKey() : NO_KEY;
+
+        if (runnable && transition -> handler != NULL) state = transition -> handler(context, c);
+
+        if (state == previous_state && context -> board_finished == FALSE) waitForKeyOrSimulatorReady(SIMULATOR_READY_TIMEOUT_MS);
+    }
+    return state;
+}
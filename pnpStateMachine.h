@@ -0,0 +1,103 @@
+/*
+ *
+ * pnpStateMachine.h - declarations for the table-driven state machine engine that runs the controller in
+ * both manual and autonomous mode
+ *
+ * Platform: Any POSIX compliant platform
+ * Intended for and tested on: Cygwin 64 bit
+ *
+ */
+
+#ifndef PNP_STATE_MACHINE_H
+#define PNP_STATE_MACHINE_H
+
+#include "pnpControl.h"
+#include "pnpInventory.h"
+
+/*
+ * state, display name of up to 19 characters (only required for display purposes), then for manual and
+ * for autonomous mode: whether the state takes key presses, whether it waits for the simulator to be
+ * ready and its handler. The handlers are defined in pnpControl.c, the only place the tables are built.
+ * In autonomous mode the states between HOME and COMPLETED only label the steps of the compiled program
+ */
+#define PNP_STATES(X) \
+    X(HOME,            "HOME              ",   TRUE,  FALSE, manualHome,           TRUE,  FALSE, autoExecute) \
+    X(MOVE_TO_FEEDER,  "MOVE TO FEEDER\t\t",   FALSE, TRUE,  manualMoveToFeeder,   TRUE,  FALSE, autoExecute) \
+    X(WAIT,            "WAIT\t            ",   TRUE,  FALSE, manualWait,           TRUE,  FALSE, NULL) \
+    X(LOWER_NOZZLE,    "LOWER_NOZZLE       ",  FALSE, TRUE,  lowerNozzleState,     TRUE,  FALSE, autoExecute) \
+    X(PICK_COMPONENT,  "PICK_COMPONENT     ",  FALSE, TRUE,  pickComponentState,   TRUE,  FALSE, autoExecute) \
+    X(RAISE_COMPONENT, "RAISE_COMPONENT    ",  FALSE, TRUE,  manualRaiseComponent, TRUE,  FALSE, autoExecute) \
+    X(MOVE_TO_CAMERA,  "MOVE_TO_CAMERA     ",  FALSE, TRUE,  manualMoveToCamera,   TRUE,  FALSE, autoExecute) \
+    X(TAKE_UP_PHOTO,   "TAKE_UP_PHOTO      ",  FALSE, TRUE,  manualTakeUpPhoto,    TRUE,  FALSE, autoExecute) \
+    X(MOVE_TO_PCB,     "MOVE_TO_PCB\t    ",    FALSE, TRUE,  manualMoveToPcb,      TRUE,  FALSE, autoExecute) \
+    X(TAKE_DOWN_PHOTO, "TAKE_DOWN_PHOTO    ",  FALSE, TRUE,  manualTakeDownPhoto,  TRUE,  FALSE, autoExecute) \
+    X(ROTATE,          "ROTATE  \t\t    ",     FALSE, TRUE,  manualRotate,         TRUE,  FALSE, autoExecute) \
+    X(ADJUST,          "ADJUST  \t\t    ",     FALSE, TRUE,  manualAdjust,         TRUE,  FALSE, autoExecute) \
+    X(LOWER_COMPONENT, "LOWER_COMPONENT    ",  FALSE, TRUE,  manualLowerComponent, TRUE,  FALSE, autoExecute) \
+    X(PLACE_COMPONENT, "PLACE_COMPONENT    ",  FALSE, TRUE,  placeComponentState,  TRUE,  FALSE, autoExecute) \
+    X(RAISE_HEAD,      "RAISE_HEAD         ",  FALSE, TRUE,  manualRaiseHead,      TRUE,  FALSE, autoExecute) \
+    X(REJECT_COMPONENT,"REJECT_COMPONENT   ",  FALSE, TRUE,  NULL,                 TRUE,  FALSE, autoExecute) \
+    X(COMPLETED,       "COMPLETED          ",  TRUE,  TRUE,  manualCompleted,      TRUE,  TRUE,  autoCompleted)
+
+// state numbers, STATE_HOME etc. (prefixed as LOWER_NOZZLE is also an instruction)
+#define STATE_NUMBER(state, name, manual_keys, manual_simulator, manual_handler, auto_keys, auto_simulator, auto_handler) STATE_##state,
+
+enum { PNP_STATES(STATE_NUMBER) NUMBER_OF_STATES };
+
+typedef struct
+{
+    PlacementInfo *pi;
+    int number_of_components_to_place;
+    PnPSnapshot snapshot;                   // consistent copy of the simulator sensor fields, refreshed every tick
+    BatchVision vision;                     // photo results, of the current part in manual mode and the last photo read in autonomous mode
+    int nozzle;                             // nozzle of the current pick or place
+    int part;                               // index of the part on the current nozzle, the part being placed in manual mode
+
+    /* manual mode progress through the current part */
+    int finished;
+    int picked;
+    int rotated;
+    int adjusted;
+    int camera;
+    double theta_pick_error[NUMBER_OF_NOZZLES];
+    double x_preplace_error;
+    double y_preplace_error;
+
+    /* autonomous mode position in the compiled program */
+    PnPProgram program;
+    int next_step;                          // first step not yet passed to the simulator
+    int photo_read;                         // step of the photo whose results are in vision, -1 before the first
+    int parked;                             // head parked and the cycle time reported
+
+    /* autonomous mode pick failure recovery, see checkPicks() */
+    const PlacementTable *table;            // parts of the board the program places, NULL if a failed pick cannot be repaired
+    const MotionProfile *profile;
+    MotionCostMatrix matrix;                // of table, built at the first failed pick
+    int *failed_picks;                      // of each part, allocated at the first failed pick
+    int rejected;                           // parts dropped in the reject bin
+    int retried;                            // parts put back into the rest of the route
+    int skipped;                            // parts left off the board after PICK_MAX_ATTEMPTS failed picks
+
+    /* feeder inventory, see pnpInventory.c */
+    FeederInventory *inventory;             // every pick is counted off its feeder's reel, NULL if no feeder is tracked
+
+    /* job mode, see pnpJob.c */
+    int more_boards;                        // TRUE if another board follows, the board then ends without parking or waiting for the user
+    int board_finished;                     // set by a handler to return from runStateMachine() before the user quits
+
+} ControlContext;
+
+/* runs one tick of a state, returning the next state, or the same state to wait for a key or the simulator */
+typedef int (*StateHandler)(ControlContext*, char);
+
+typedef struct
+{
+    int takes_keys;                         // TRUE if the state is handed key presses, otherwise they stay queued
+    int needs_simulator;                    // TRUE if the state only runs once the simulator is ready for the next instruction
+    StateHandler handler;                   // NULL for a state the mode never enters
+
+} StateTransition;
+
+int runStateMachine(const StateTransition[], int, ControlContext*);
+
+#endif // PNP_STATE_MACHINE_H
@@ -0,0 +1,575 @@
+/*
+ *
+ * pnpTrace.c - the controller instrumentation. When the PNP_TRACE environment variable names a file, the
+ * time of every visit to a state is split into time spent inside the controller, time blocked waiting
+ * on the simulator and time idle waiting on the user, and every instruction is timed from being posted
+ * until the controller sees it complete. The times go into log-linear (HDR style) histograms, summarised
+ * when the controller quits, and every state visit and instruction is written to the trace file in
+ * Chrome trace-event JSON, which can be opened in chrome://tracing or Perfetto. State visits are also
+ * drawn against simulation time, so the trace shows where the cycle time of a board goes
+ *
+ * Platform: Any POSIX compliant platform
+ * Intended for and tested on: Cygwin 64 bit
+ *
+ */
+
+#include "pnpTrace.h"
+
+typedef struct
+{
+    int instruction;
+    int argument_3;
+    uint64_t posted;
+
+} PendingInstruction;
+
+static const char INSTRUCTION_NAME[TRACE_NUMBER_OF_INSTRUCTIONS][20] = {"NO_INSTRUCTION", "MOVE_HEAD", "ROTATE_NOZZLE", "LOWER_NOZZLE", "RAISE_NOZZLE",
+                                                                        "APPLY_VACUUM", "RELEASE_VACUUM", "TAKE_PHOTO", "AMEND_HEAD_POSITION"};
+
+static int tracing = FALSE;
+static char trace_path[PATH_MAX];
+static struct timespec trace_origin;
+static char state_names[TRACE_MAX_STATES][TRACE_STATE_NAME_LENGTH];
+static int number_of_states;
+
+/* one block of histograms, split into the four groups below */
+static LatencyHistogram *histograms;
+static LatencyHistogram *state_controller_time;
+static LatencyHistogram *state_wait_time;
+static LatencyHistogram *instruction_post_time;
+static LatencyHistogram *instruction_latency;
+
+/* the state visit in progress */
+static int visit_state = -1;
+static uint64_t visit_began, visit_waited, visit_idled;
+static double visit_sim_began;
+static int wait_depth;
+static uint64_t wait_began, idle_began;
+
+static PendingInstruction pending[TRACE_PENDING_INSTRUCTIONS];
+static unsigned long instructions_posted, instructions_seen_completed;
+
+static TraceEvent *events;
+static size_t number_of_events, events_capacity;
+static int events_dropped;
+
+/*
+ Function: histogramReset
+ ------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: empties a latency histogram
+ Argument(s):
+ LatencyHistogram *histogram - the histogram
+ Return Value: none
+ Usage: histogramReset(&histogram);
+ */
+void histogramReset(LatencyHistogram *histogram)
+{
+    memset(histogram, 0, sizeof(LatencyHistogram));
+    histogram -> min = UINT64_MAX;
+}
+
+/*
+ Function: histogramIndex
+ ------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ gets the bucket a value falls in. Values below HISTOGRAM_SUB_BUCKETS have a bucket each, above that each
+ power of two range is split into HISTOGRAM_SUB_BUCKETS / 2 equal buckets, so the bucket width is always
+ within 1 part in HISTOGRAM_SUB_BUCKETS / 2 of the value
+ Argument(s):
+ uint64_t value - the value, in ns
+ Return Value: the bucket index
+ Usage: histogram -> counts[histogramIndex(value)]++;
+ */
+static int histogramIndex(uint64_t value)
+{
+    if (value < HISTOGRAM_SUB_BUCKETS) return (int)value;
+    if (value >> HISTOGRAM_MAX_BITS) return HISTOGRAM_BUCKETS - 1;
+
+    int shift = (63 - __builtin_clzll(value)) - HISTOGRAM_SUB_BUCKET_BITS + 1;
+    return HISTOGRAM_SUB_BUCKETS + (shift - 1) * (HISTOGRAM_SUB_BUCKETS / 2) + (int)(value >> shift) - HISTOGRAM_SUB_BUCKETS / 2;
+}
+
+/*
+ Function: histogramBucketTop
+ ----------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: gets the largest value that falls in a bucket
+ Argument(s):
+ int index - the bucket index
+ Return Value: the value, in ns
+ Usage: uint64_t value = histogramBucketTop(index);
+ */
+static uint64_t histogramBucketTop(int index)
+{
+    if (index < HISTOGRAM_SUB_BUCKETS) return (uint64_t)index;
+
+    int shift = (index - HISTOGRAM_SUB_BUCKETS) / (HISTOGRAM_SUB_BUCKETS / 2) + 1;
+    uint64_t top = HISTOGRAM_SUB_BUCKETS / 2 + (index - HISTOGRAM_SUB_BUCKETS) % (HISTOGRAM_SUB_BUCKETS / 2);
+    return ((top + 1) << shift) - 1;
+}
+
+/*
+ Function: histogramRecord
+ -------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: records a value in a latency histogram
+ Argument(s):
+ LatencyHistogram *histogram - the histogram
+ uint64_t value - the value, in ns
+ Return Value: none
+ Usage: histogramRecord(&histogram, traceNow() - began);
+ */
+void histogramRecord(LatencyHistogram *histogram, uint64_t value)
+{
+    histogram -> counts[histogramIndex(value)]++;
+    histogram -> total_count++;
+    histogram -> sum += (double)value;
+    if (value < histogram -> min) histogram -> min = value;
+    if (value > histogram -> max) histogram -> max = value;
+}
+
+/*
+ Function: histogramValueAtPercentile
+ ------------------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: gets the value that the given percentage of the recorded values are at or below
+ Argument(s):
+ const LatencyHistogram *histogram - the histogram
+ double percentile - the percentage, 0 to 100
+ Return Value: the value in ns, to within the bucket width, or 0 for an empty histogram
+ Usage: uint64_t p99 = histogramValueAtPercentile(&histogram, 99.0);
+ */
+uint64_t histogramValueAtPercentile(const LatencyHistogram *histogram, double percentile)
+{
+    if (histogram -> total_count == 0) return 0;
+
+    uint64_t wanted = (uint64_t)ceil(percentile / 100.0 * histogram -> total_count);
+    uint64_t seen = 0;
+
+    if (wanted < 1) wanted = 1;
+    for (int k = 0; k < HISTOGRAM_BUCKETS; k++)
+    {
+        seen += histogram -> counts[k];
+        if (seen >= wanted)
+        {
+            uint64_t value = histogramBucketTop(k);
+            if (value > histogram -> max) value = histogram -> max;
+            if (value < histogram -> min) value = histogram -> min;
+            return value;
+        }
+    }
+    return histogram -> max;
+}
+
+/*
+ Function: traceNow
+ ------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: gets the monotonic clock time since traceOpen()
+ Argument(s): none
+ Return Value: the time in ns
+ Usage: uint64_t began = traceNow();
+ */
+uint64_t traceNow()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)(now.tv_sec - trace_origin.tv_sec) * 1000000000ULL + (uint64_t)now.tv_nsec - (uint64_t)trace_origin.tv_nsec;
+}
+
+/*
+ Function: isTracing
+ -------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: tells whether the controller instrumentation is on
+ Argument(s): none
+ Return Value: TRUE (1) if traceOpen() found PNP_TRACE set, otherwise FALSE (0)
+ Usage: uint64_t began = isTracing() ? traceNow() : 0;
+ */
+int isTracing()
+{
+    return tracing;
+}
+
+/*
+ Function: traceOpen
+ -------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ turns the instrumentation on if the PNP_TRACE environment variable is set, should be called after
+ pnpOpen() so that instruction numbers start with the session
+ Argument(s):
+ const char names[][TRACE_STATE_NAME_LENGTH] - the display name of each state, trailing blanks are dropped
+ int states - the number of states
+ Return Value: TRUE (1) if the instrumentation is on, otherwise FALSE (0)
+ Usage: traceOpen(state_name, COMPLETED + 1);
+ */
+int traceOpen(const char names[][TRACE_STATE_NAME_LENGTH], int states)
+{
+    const char *path = getenv(TRACE_ENVIRONMENT_VARIABLE);
+
+    if (path == NULL || path[0] == '\0' || states > TRACE_MAX_STATES) return FALSE;
+
+    histograms = malloc(sizeof(LatencyHistogram) * (2 * states + 2 * TRACE_NUMBER_OF_INSTRUCTIONS));
+    if (histograms == NULL) return FALSE;
+    for (int k = 0; k < 2 * states + 2 * TRACE_NUMBER_OF_INSTRUCTIONS; k++) histogramReset(&histograms[k]);
+    state_controller_time = histograms;
+    state_wait_time = state_controller_time + states;
+    instruction_post_time = state_wait_time + states;
+    instruction_latency = instruction_post_time + TRACE_NUMBER_OF_INSTRUCTIONS;
+
+    number_of_states = states;
+    for (int k = 0; k < states; k++)
+    {
+        int length = (int)strnlen(names[k], TRACE_STATE_NAME_LENGTH - 1);
+        while (length > 0 && (names[k][length - 1] == ' ' || names[k][length - 1] == '\t')) length--;
+        snprintf(state_names[k], TRACE_STATE_NAME_LENGTH, "%.*s", length, names[k]);
+    }
+
+    snprintf(trace_path, sizeof(trace_path), "%s", path);
+    clock_gettime(CLOCK_MONOTONIC, &trace_origin);
+    visit_state = -1;
+    wait_depth = 0;
+    instructions_posted = instructions_seen_completed = 0;
+    events = NULL;
+    number_of_events = events_capacity = 0;
+    events_dropped = FALSE;
+    tracing = TRUE;
+    return TRUE;
+}
+
+/*
+ Function: addEvent
+ ------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: appends an event to the trace, growing the buffer as needed
+ Argument(s):
+ const TraceEvent *event - the event
+ Return Value: none, if the buffer cannot grow the event is dropped and the trace file notes it
+ Usage: addEvent(&event);
+ */
+static void addEvent(const TraceEvent *event)
+{
+    if (number_of_events == events_capacity)
+    {
+        TraceEvent *grown = realloc(events, sizeof(TraceEvent) * (events_capacity + TRACE_EVENT_CHUNK));
+        if (grown == NULL)
+        {
+            events_dropped = TRUE;
+            return;
+        }
+        events = grown;
+        events_capacity += TRACE_EVENT_CHUNK;
+    }
+    events[number_of_events++] = *event;
+}
+
+/*
+ Function: endVisit
+ ------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: records the state visit in progress in the histograms and the trace
+ Argument(s):
+ uint64_t now - the time the visit ended, from traceNow()
+ double sim_time - the simulation time the visit ended
+ Return Value: none
+ Usage: endVisit(traceNow(), snapshot.sim_time);
+ */
+static void endVisit(uint64_t now, double sim_time)
+{
+    TraceEvent event = {TRACE_STATE, visit_state, 0, 0, visit_began, now - visit_began, visit_waited, visit_idled, visit_sim_began, sim_time};
+    uint64_t outside = visit_waited + visit_idled;
+
+    histogramRecord(&state_controller_time[visit_state], (event.duration > outside) ? event.duration - outside : 0);
+    histogramRecord(&state_wait_time[visit_state], visit_waited);
+    addEvent(&event);
+}
+
+/*
+ Function: traceState
+ --------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ called at the start of every iteration of the control loop, ends the current state visit and starts a
+ new one when the state has changed
+ Argument(s):
+ int state - the state the iteration runs
+ double sim_time - the simulation time of the iteration's snapshot
+ Return Value: none
+ Usage: traceState(state, snapshot.sim_time);
+ */
+void traceState(int state, double sim_time)
+{
+    if (!tracing || state == visit_state || state < 0 || state >= number_of_states) return;
+
+    uint64_t now = traceNow();
+    if (visit_state >= 0) endVisit(now, sim_time);
+
+    visit_state = state;
+    visit_began = now;
+    visit_sim_began = sim_time;
+    visit_waited = 0;
+    visit_idled = 0;
+}
+
+/*
+ Function: traceWaitBegin
+ ------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ marks the start of a wait for the simulator, time until the matching traceWaitEnd() is counted as
+ waiting rather than controller time. Waits may nest, only the outermost one counts
+ Argument(s): none
+ Return Value: none
+ Usage:
+ traceWaitBegin();
+ ... block on the simulator ...
+ traceWaitEnd();
+ */
+void traceWaitBegin()
+{
+    if (tracing && wait_depth++ == 0) wait_began = traceNow();
+}
+
+/*
+ Function: traceWaitEnd
+ ----------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: marks the end of a wait for the simulator started by traceWaitBegin()
+ Argument(s): none
+ Return Value: none
+ Usage: traceWaitEnd();
+ */
+void traceWaitEnd()
+{
+    if (tracing && wait_depth > 0 && --wait_depth == 0) visit_waited += traceNow() - wait_began;
+}
+
+/*
+ Function: traceIdleBegin
+ ------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ marks the start of a wait while the controller has nothing to do but wait for the user, time until
+ the matching traceIdleEnd() is counted as idle rather than controller time
+ Argument(s): none
+ Return Value: none
+ Usage:
+ traceIdleBegin();
+ ... block waiting for a key ...
+ traceIdleEnd();
+ */
+void traceIdleBegin()
+{
+    if (tracing) idle_began = traceNow();
+}
+
+/*
+ Function: traceIdleEnd
+ ----------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: marks the end of an idle wait started by traceIdleBegin()
+ Argument(s): none
+ Return Value: none
+ Usage: traceIdleEnd();
+ */
+void traceIdleEnd()
+{
+    if (tracing) visit_idled += traceNow() - idle_began;
+}
+
+/*
+ Function: traceInstructionPosted
+ --------------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: records an instruction that has just been passed to the simulator
+ Argument(s):
+ int instruction - the instruction, e.g. MOVE_HEAD
+ int argument_3 - the instruction's nozzle or camera
+ unsigned long sequence - the instruction number in the session, starting from 0
+ uint64_t began - when posting the instruction started, from traceNow(), so that time blocked waiting for a free slot is included
+ Return Value: none
+ Usage: traceInstructionPosted(instruction, argument_3, sequence, began);
+ */
+void traceInstructionPosted(int instruction, int argument_3, unsigned long sequence, uint64_t began)
+{
+    if (!tracing || instruction < 0 || instruction >= TRACE_NUMBER_OF_INSTRUCTIONS) return;
+
+    uint64_t now = traceNow();
+    TraceEvent event = {TRACE_INSTRUCTION_POSTED, instruction, argument_3, sequence, now, 0, 0, 0, 0.0, 0.0};
+
+    /* an instruction whose completion was never seen is forgotten rather than overwritten */
+    if (sequence - instructions_seen_completed >= TRACE_PENDING_INSTRUCTIONS) instructions_seen_completed = sequence - TRACE_PENDING_INSTRUCTIONS + 1;
+
+    histogramRecord(&instruction_post_time[instruction], now - began);
+    pending[sequence & (TRACE_PENDING_INSTRUCTIONS - 1)] = (PendingInstruction){instruction, argument_3, now};
+    instructions_posted = sequence + 1;
+    addEvent(&event);
+}
+
+/*
+ Function: traceInstructionsCompleted
+ ------------------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ records the completion of every instruction up to the given count that has not already been seen to
+ complete, cheap enough to call whenever the controller checks on the simulator
+ Argument(s):
+ unsigned long completed - the number of instructions the simulator has completed this session
+ Return Value: none
+ Usage: traceInstructionsCompleted(atomic_load(&pnp -> instructions_completed));
+ */
+void traceInstructionsCompleted(unsigned long completed)
+{
+    if (!tracing || completed <= instructions_seen_completed) return;
+    if (completed > instructions_posted) completed = instructions_posted;
+
+    uint64_t now = traceNow();
+    for (; instructions_seen_completed < completed; instructions_seen_completed++)
+    {
+        PendingInstruction *p = &pending[instructions_seen_completed & (TRACE_PENDING_INSTRUCTIONS - 1)];
+        TraceEvent event = {TRACE_INSTRUCTION_COMPLETED, p -> instruction, p -> argument_3, instructions_seen_completed, now, 0, 0, 0, 0.0, 0.0};
+
+        histogramRecord(&instruction_latency[p -> instruction], now - p -> posted);
+        addEvent(&event);
+    }
+}
+
+/*
+ Function: printHistogramRow
+ ---------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: prints one line of the latency summary
+ Argument(s):
+ const char *name - what was timed
+ const char *kind - which part of its time
+ const LatencyHistogram *histogram - the times
+ Return Value: none
+ Usage: printHistogramRow("MOVE_HEAD", "latency", &instruction_latency[MOVE_HEAD]);
+ */
+static void printHistogramRow(const char *name, const char *kind, const LatencyHistogram *histogram)
+{
+    if (histogram -> total_count == 0) return;
+
+    printf("%-20s %-15s %8llu %10.1f %10.1f %10.1f %10.1f %12.1f\n", name, kind, (unsigned long long)histogram -> total_count,
+           histogramValueAtPercentile(histogram, 50.0) / 1e3, histogramValueAtPercentile(histogram, 90.0) / 1e3,
+           histogramValueAtPercentile(histogram, 99.0) / 1e3, histogram -> max / 1e3, histogram -> sum / 1e6);
+}
+
+/*
+ Function: writeTraceFile
+ ------------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ writes the recorded events in Chrome trace-event JSON. Process 1 is the controller against the wall
+ clock, with state visits on one thread and instructions, as async spans that may overlap, on another.
+ Process 2 repeats the state visits against simulation time
+ Argument(s):
+ const char *path - the trace file
+ Return Value: TRUE (1) on success, FALSE (0) if the file could not be written
+ Usage: writeTraceFile(trace_path);
+ */
+static int writeTraceFile(const char *path)
+{
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) return FALSE;
+
+    fprintf(fp, "{\"displayTimeUnit\": \"ms\", \"otherData\": {\"events_dropped\": %s}, \"traceEvents\": [\n", events_dropped ? "true" : "false");
+    fprintf(fp, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"controller (wall clock)\"}},\n");
+    fprintf(fp, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 2, \"args\": {\"name\": \"machine (simulation time)\"}},\n");
+    fprintf(fp, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 1, \"args\": {\"name\": \"states\"}},\n");
+    fprintf(fp, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 2, \"args\": {\"name\": \"instructions\"}},\n");
+    fprintf(fp, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 2, \"tid\": 1, \"args\": {\"name\": \"states\"}}");
+
+    for (size_t k = 0; k < number_of_events; k++)
+    {
+        const TraceEvent *e = &events[k];
+
+        switch (e -> type)
+        {
+            case TRACE_STATE:
+                fprintf(fp, ",\n{\"name\": \"%s\", \"cat\": \"state\", \"ph\": \"X\", \"pid\": 1, \"tid\": 1, \"ts\": %.3f, \"dur\": %.3f, "
+                        "\"args\": {\"simulator_wait_us\": %.3f, \"idle_us\": %.3f, \"sim_time\": %.3f}}",
+                        state_names[e -> what], e -> began / 1e3, e -> duration / 1e3, e -> waited / 1e3, e -> idled / 1e3, e -> sim_began);
+                fprintf(fp, ",\n{\"name\": \"%s\", \"cat\": \"state\", \"ph\": \"X\", \"pid\": 2, \"tid\": 1, \"ts\": %.3f, \"dur\": %.3f}",
+                        state_names[e -> what], e -> sim_began * 1e6, (e -> sim_ended - e -> sim_began) * 1e6);
+                break;
+
+            case TRACE_INSTRUCTION_POSTED:
+                fprintf(fp, ",\n{\"name\": \"%s\", \"cat\": \"instruction\", \"ph\": \"b\", \"id\": %lu, \"pid\": 1, \"tid\": 2, \"ts\": %.3f, \"args\": {\"argument_3\": %d}}",
+                        INSTRUCTION_NAME[e -> what], e -> sequence, e -> began / 1e3, e -> argument_3);
+                break;
+
+            case TRACE_INSTRUCTION_COMPLETED:
+                fprintf(fp, ",\n{\"name\": \"%s\", \"cat\": \"instruction\", \"ph\": \"e\", \"id\": %lu, \"pid\": 1, \"tid\": 2, \"ts\": %.3f}",
+                        INSTRUCTION_NAME[e -> what], e -> sequence, e -> began / 1e3);
+                break;
+        }
+    }
+    fprintf(fp, "\n]}\n");
+    return fclose(fp) == 0;
+}
+
+/*
+ Function: traceClose
+ --------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ ends the state visit in progress, prints the latency summary, writes the trace file and turns the
+ instrumentation off. Does nothing if the instrumentation is not on
+ Argument(s):
+ double sim_time - the simulation time at the end of the session
+ Return Value: none
+ Usage: traceClose(getSimTime());
+ */
+void traceClose(double sim_time)
+{
+    if (!tracing) return;
+
+    if (visit_state >= 0) endVisit(traceNow(), sim_time);
+    tracing = FALSE;
+
+    printf("\nController latency summary, us             count        p50        p90        p99        max     total ms\n");
+    for (int k = 0; k < number_of_states; k++)
+    {
+        printHistogramRow(state_names[k], "controller", &state_controller_time[k]);
+        printHistogramRow(state_names[k], "simulator wait", &state_wait_time[k]);
+    }
+    for (int k = 1; k < TRACE_NUMBER_OF_INSTRUCTIONS; k++)
+    {
+        printHistogramRow(INSTRUCTION_NAME[k], "post", &instruction_post_time[k]);
+        printHistogramRow(INSTRUCTION_NAME[k], "latency", &instruction_latency[k]);
+    }
+
+    if (writeTraceFile(trace_path)) printf("Trace of %lu events written to %s\n", (unsigned long)number_of_events, trace_path);
+    else printf("Problem writing trace file %s\n", trace_path);
+    fflush(stdout);
+
+    free(events);
+    free(histograms);
+    events = NULL;
+    histograms = NULL;
+}
@@ -0,0 +1,86 @@
+/*
+ *
+ * pnpTrace.h - declarations for the controller instrumentation: latency histograms of the time spent in
+ * each state and on each instruction, and a trace of every state visit and instruction in Chrome
+ * trace-event JSON
+ *
+ * Platform: Any POSIX compliant platform
+ * Intended for and tested on: Cygwin 64 bit
+ *
+ */
+
+#ifndef PNP_TRACE_H
+#define PNP_TRACE_H
+
+#include "pnpControl.h"
+
+#define TRACE_ENVIRONMENT_VARIABLE "PNP_TRACE"  // set to the trace file to write, instrumentation is off when it is not set
+#define TRACE_MAX_STATES 32
+#define TRACE_STATE_NAME_LENGTH 20              // as state_name[] in pnpControl.c
+#define TRACE_NUMBER_OF_INSTRUCTIONS (AMEND_HEAD_POSITION + 1)
+#define TRACE_PENDING_INSTRUCTIONS 256          // instructions posted but not yet seen to complete, must be at least PNP_COMMAND_RING_SIZE and a power of two
+#define TRACE_EVENT_CHUNK 4096                  // the trace event buffer grows by this many events at a time
+
+#define HISTOGRAM_SUB_BUCKET_BITS 7             // values are recorded to within 1 part in 2^(HISTOGRAM_SUB_BUCKET_BITS - 1), about 1.6%
+#define HISTOGRAM_MAX_BITS 43                   // largest value recorded, in ns, is 2^HISTOGRAM_MAX_BITS - 1 (about 2.4 hours)
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BUCKET_BITS)
+#define HISTOGRAM_BUCKETS (HISTOGRAM_SUB_BUCKETS + (HISTOGRAM_MAX_BITS - HISTOGRAM_SUB_BUCKET_BITS) * (HISTOGRAM_SUB_BUCKETS / 2))
+
+#define TRACE_STATE 0
+#define TRACE_INSTRUCTION_POSTED 1
+#define TRACE_INSTRUCTION_COMPLETED 2
+
+typedef struct
+{
+    uint64_t counts[HISTOGRAM_BUCKETS];     // log-linear buckets, exact below HISTOGRAM_SUB_BUCKETS ns
+    uint64_t total_count;
+    uint64_t min;                           // ns
+    uint64_t max;                           // ns
+    double sum;                             // ns, for the mean and the total
+
+} LatencyHistogram;
+
+typedef struct
+{
+    int type;                               // TRACE_STATE, TRACE_INSTRUCTION_POSTED or TRACE_INSTRUCTION_COMPLETED
+    int what;                               // the state, or the instruction
+    int argument_3;                         // the nozzle or camera of an instruction
+    unsigned long sequence;                 // instruction number, pairs the posted and completed events
+    uint64_t began;                         // ns since traceOpen()
+    uint64_t duration;                      // ns, state visits only
+    uint64_t waited;                        // ns waiting on the simulator, state visits only
+    uint64_t idled;                         // ns idle waiting on the user, state visits only
+    double sim_began;                       // simulation time, state visits only
+    double sim_ended;
+
+} TraceEvent;
+
+void histogramReset(LatencyHistogram*);
+
+void histogramRecord(LatencyHistogram*, uint64_t);
+
+uint64_t histogramValueAtPercentile(const LatencyHistogram*, double);
+
+int traceOpen(const char[][TRACE_STATE_NAME_LENGTH], int);
+
+void traceClose(double);
+
+int isTracing();
+
+uint64_t traceNow();
+
+void traceState(int, double);
+
+void traceWaitBegin();
+
+void traceWaitEnd();
+
+void traceIdleBegin();
+
+void traceIdleEnd();
+
+void traceInstructionPosted(int, int, unsigned long, uint64_t);
+
+void traceInstructionsCompleted(unsigned long);
+
+#endif // PNP_TRACE_H
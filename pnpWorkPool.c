@@ -0,0 +1,204 @@
+/*
+ *
+ * pnpWorkPool.c - a work-stealing thread pool for a fixed set of independent tasks numbered 0 to n - 1.
+ * Each worker owns a contiguous run of the tasks, packed with its front and back into one atomic word,
+ * and takes them from the front, lowest first. A worker that runs out steals single tasks from the back
+ * of the others, so a worker held up by a long task never leaves the rest idle. Taking and stealing are
+ * a compare and swap on the packed word, no locks; the front only ever rises and the back only ever
+ * falls, so a stale word can never be mistaken for the current one
+ *
+ * Platform: Any POSIX compliant platform
+ * Intended for and tested on: Cygwin 64 bit
+ *
+ */
+
+#include "pnpWorkPool.h"
+
+typedef struct WorkPool WorkPool;
+
+typedef struct
+{
+    _Alignas(WORK_POOL_CACHE_LINE) atomic_ullong range;  // (front << 32) | back, the tasks front to back - 1 are still to run
+    WorkPool *pool;
+    int index;
+    pthread_t thread;
+    int started;
+
+} WorkQueue;
+
+struct WorkPool
+{
+    WorkTask task;
+    void *context;
+    int number_of_workers;
+    WorkQueue queue[WORK_POOL_MAX_WORKERS];
+};
+
+/*
+ Function: packRange
+ -------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: packs the front and back of a run of tasks into one word
+ Argument(s):
+ unsigned long long front - the first task still to run
+ unsigned long long back - one past the last task still to run
+ Return Value: the packed word
+ Usage: atomic_store(&queue -> range, packRange(first, last));
+ */
+static unsigned long long packRange(unsigned long long front, unsigned long long back)
+{
+    return (front << 32) | back;
+}
+
+/*
+ Function: takeTask
+ ------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ takes a task from one end of a worker's run, the front for the worker itself and the back when
+ stealing, so the owner and a thief only contend for the last task
+ Argument(s):
+ WorkQueue *queue - the worker's queue
+ int steal - TRUE to take from the back
+ Return Value:
+ the task index, WORK_POOL_NO_TASK if the run is empty
+ Usage:
+ task = takeTask(&pool -> queue[victim], TRUE);
+ */
+static int takeTask(WorkQueue *queue, int steal)
+{
+    unsigned long long range = atomic_load(&queue -> range);
+
+    for (;;)
+    {
+        unsigned long long front = range >> 32, back = range & 0xffffffffULL;
+
+        if (front >= back) return WORK_POOL_NO_TASK;
+        if (steal)
+        {
+            if (atomic_compare_exchange_weak(&queue -> range, &range, packRange(front, back - 1))) return (int)(back - 1);
+        }
+        else if (atomic_compare_exchange_weak(&queue -> range, &range, packRange(front + 1, back))) return (int)front;
+    }
+}
+
+/*
+ Function: workLoop
+ ------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ runs a worker: its own tasks first, then tasks stolen from the other workers, looking at them in turn
+ starting with the next one, until every run is empty. No task is added once the pool is running, so an
+ empty pass over every run means the work is done
+ Argument(s):
+ void *argument - the worker's WorkQueue
+ Return Value: NULL
+ Usage: pthread_create(&queue -> thread, NULL, workLoop, queue);
+ */
+static void *workLoop(void *argument)
+{
+    WorkQueue *queue = (WorkQueue *)argument;
+    WorkPool *pool = queue -> pool;
+    int task;
+
+    for (;;)
+    {
+        task = takeTask(queue, FALSE);
+        for (int v = 1; v < pool -> number_of_workers && task == WORK_POOL_NO_TASK; v++)
+        {
+            task = takeTask(&pool -> queue[(queue -> index + v) % pool -> number_of_workers], TRUE);
+        }
+        if (task == WORK_POOL_NO_TASK) break;
+        pool -> task(pool -> context, queue -> index, task);
+    }
+    return NULL;
+}
+
+/*
+ Function: workPoolSize
+ ----------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose: gets how many workers to run, one per online core
+ Argument(s):
+ int limit - the most wanted
+ Return Value: an int from 1 to the smaller of limit and WORK_POOL_MAX_WORKERS
+ Usage: int workers = workPoolSize(PLAN_SEARCH_MAX_THREADS);
+ */
+int workPoolSize(int limit)
+{
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (limit > WORK_POOL_MAX_WORKERS) limit = WORK_POOL_MAX_WORKERS;
+    if (cores < 1) cores = 1;
+    return (cores < limit) ? (int)cores : ((limit < 1) ? 1 : limit);
+}
+
+/*
+ Function: runWorkPool
+ ---------------------
+ Date: 17/10/2026
+ Version 1.0
+ Purpose:
+ runs the tasks 0 to number_of_tasks - 1 on a pool of workers and returns once every one has run. The
+ tasks are dealt out to the workers in contiguous runs, worker 0 getting task 0 first. The calling
+ thread is worker 0, so if a thread cannot be created its tasks are stolen by the others and every
+ task still runs. The pool is allocated on a cache line boundary, which malloc() does not promise, so
+ the queues really do sit on lines of their own
+ Argument(s):
+ int number_of_tasks - how many tasks
+ int number_of_workers - how many workers, at most WORK_POOL_MAX_WORKERS
+ WorkTask task - called with the context, the worker index and the task index, from any worker
+ void *context - passed to every call of task
+ Return Value:
+ the number of workers that ran
+ Usage:
+ runWorkPool(PLAN_SEARCH_STARTS, workPoolSize(PLAN_SEARCH_MAX_THREADS), runPlanStart, &search);
+ */
+int runWorkPool(int number_of_tasks, int number_of_workers, WorkTask task, void *context)
+{
+    size_t size = (sizeof(WorkPool) + WORK_POOL_CACHE_LINE - 1) / WORK_POOL_CACHE_LINE * WORK_POOL_CACHE_LINE;
+    WorkPool *pool = aligned_alloc(WORK_POOL_CACHE_LINE, size);
+    int running = 1;
+
+    if (number_of_workers > WORK_POOL_MAX_WORKERS) number_of_workers = WORK_POOL_MAX_WORKERS;
+    if (number_of_workers > number_of_tasks) number_of_workers = number_of_tasks;
+    if (number_of_workers < 1) number_of_workers = 1;
+
+    if (pool == NULL)
+    {
+        for (int t = 0; t < number_of_tasks; t++) task(context, 0, t);
+        return 1;
+    }
+
+    pool -> task = task;
+    pool -> context = context;
+    pool -> number_of_workers = number_of_workers;
+    for (int w = 0; w < number_of_workers; w++)
+    {
+        WorkQueue *queue = &pool -> queue[w];
+
+        queue -> pool = pool;
+        queue -> index = w;
+        queue -> started = FALSE;
+        atomic_init(&queue -> range, packRange((unsigned long long)number_of_tasks * w / number_of_workers,
+                                               (unsigned long long)number_of_tasks * (w + 1) / number_of_workers));
+    }
+
+    for (int w = 1; w < number_of_workers; w++)
+    {
+        pool -> queue[w].started = pthread_create(&pool -> queue[w].thread, NULL, workLoop, &pool -> queue[w]) == 0;
+        running += pool -> queue[w].started;
+    }
+    workLoop(&pool -> queue[0]);
+    for (int w = 1; w < number_of_workers; w++)
+    {
+        if (pool -> queue[w].started) pthread_join(pool -> queue[w].thread, NULL);
+    }
+
+    free(pool);
+    return running;
+}
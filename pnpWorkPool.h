@@ -0,0 +1,26 @@
+/*
+ *
+ * pnpWorkPool.h - declarations for the work-stealing thread pool that runs a fixed set of independent
+ * tasks, e.g. the starts of the route search, on every core
+ *
+ * Platform: Any POSIX compliant platform
+ * Intended for and tested on: Cygwin 64 bit
+ *
+ */
+
+#ifndef PNP_WORK_POOL_H
+#define PNP_WORK_POOL_H
+
+#include "pnpControl.h"
+
+#define WORK_POOL_MAX_WORKERS 64        // the caller's thread counts as one worker
+#define WORK_POOL_NO_TASK -1
+#define WORK_POOL_CACHE_LINE 64         // bytes, each worker's queue starts a line of its own so taking a task never contends with a neighbour
+
+typedef void (*WorkTask)(void*, int, int);  // context, worker index, task index
+
+int workPoolSize(int);
+
+int runWorkPool(int, int, WorkTask, void*);
+
+#endif // PNP_WORK_POOL_H